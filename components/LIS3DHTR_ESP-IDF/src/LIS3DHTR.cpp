@@ -29,8 +29,12 @@
 
 #include "LIS3DHTR.h"
 
+#include <string.h>
+
+#ifdef ESP_PLATFORM
 // Include FreeRTOS for delay
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "driver/i2c.h"
 
 #include "esp_idf_version.h"
@@ -41,27 +45,59 @@
 
 #define DELAY(ms) vTaskDelay(ms / portTICK_RATE_MS);
 
+static int i2c_bus_write(void *ctx, uint8_t addr, const uint8_t *data, uint16_t len)
+{
+    return i2c_master_write_to_device(I2C_MASTER_NUM, addr, data, len, I2C_MASTER_TIMEOUT_MS / portTICK_RATE_MS);
+}
+
+static int i2c_bus_write_read(void *ctx, uint8_t addr, const uint8_t *wr, uint16_t wr_len, uint8_t *rd, uint16_t rd_len)
+{
+    return i2c_master_write_read_device(I2C_MASTER_NUM, addr, wr, wr_len, rd, rd_len, I2C_MASTER_TIMEOUT_MS / portTICK_RATE_MS);
+}
+
+static const lis3dhtr_bus_t i2c_bus = { i2c_bus_write, i2c_bus_write_read, NULL };
+#else
+// host build, the bus has to be provided through setBus()
+#include <unistd.h>
+
+#define DELAY(ms) usleep((ms) * 1000);
+
+static const lis3dhtr_bus_t i2c_bus = { NULL, NULL, NULL };
+#endif
+
 LIS3DHTR::LIS3DHTR()
 {
+    bus = i2c_bus;
+    accRange = 16000;
+    fifoHead = 0;
+    fifoTail = 0;
+    fifoOverruns = 0;
+}
 
+void LIS3DHTR::setBus(const lis3dhtr_bus_t *bus)
+{
+    this->bus = bus ? *bus : i2c_bus;
 }
 
 void LIS3DHTR::begin(uint8_t address)
 {
+#ifdef ESP_PLATFORM
+    if (bus.write == i2c_bus_write) {
+        i2c_config_t conf = {
+            .mode = I2C_MODE_MASTER,
+            .sda_io_num = I2C_MASTER_SDA_IO,
+            .scl_io_num = I2C_MASTER_SCL_IO,
+            .sda_pullup_en = GPIO_PULLUP_ENABLE,
+            .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        };
 
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-    };
+        conf.master.clk_speed = I2C_MASTER_FREQ_HZ;
 
-    conf.master.clk_speed = I2C_MASTER_FREQ_HZ;
+        i2c_param_config(I2C_MASTER_NUM, &conf);
 
-    i2c_param_config(I2C_MASTER_NUM, &conf);
-
-    i2c_driver_install(I2C_MASTER_NUM, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, I2C_NUM_0);
+        i2c_driver_install(I2C_MASTER_NUM, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, I2C_NUM_0);
+    }
+#endif
 
     devAddr = address;
 
@@ -335,9 +371,11 @@ uint16_t LIS3DHTR::readbitADC3(void)
 void LIS3DHTR::writeRegister(uint8_t reg, uint8_t val)
 {
 
-uint8_t write_buf[2] = {reg, val};
+    uint8_t write_buf[2] = {reg, val};
 
-i2c_master_write_to_device(I2C_MASTER_NUM, devAddr, write_buf, sizeof(write_buf), I2C_MASTER_TIMEOUT_MS / portTICK_RATE_MS);
+    if (bus.write) {
+        bus.write(bus.ctx, devAddr, write_buf, sizeof(write_buf));
+    }
 
 }
 
@@ -346,7 +384,9 @@ void LIS3DHTR::readRegisterRegion(uint8_t *outputPointer, uint8_t reg, uint8_t l
 
     reg |= 0x80; //turn auto-increment bit on, bit 7 for I2C
 
-    i2c_master_write_read_device(I2C_MASTER_NUM, devAddr, &reg, 1, outputPointer, length, I2C_MASTER_TIMEOUT_MS / portTICK_RATE_MS);
+    if (!bus.write_read || bus.write_read(bus.ctx, devAddr, &reg, 1, outputPointer, length) != 0) {
+        memset(outputPointer, 0, length);
+    }
 
 }
 
@@ -397,4 +437,134 @@ void LIS3DHTR::click(uint8_t c, uint8_t click_thresh, uint8_t limit, uint8_t lat
     writeRegister(LIS3DHTR_REG_ACCEL_TIME_WINDOW, window);
 }
 
-LIS3DHTR::operator bool() { return isConnection(); }
\ No newline at end of file
+LIS3DHTR::operator bool() { return isConnection(); }
+
+/**
+ * Put the FIFO in stream mode, the oldest samples are overwritten when it is full.
+ * @param watermark FIFO level (0 - 31) that sets the watermark flag / interrupt
+ * @param watermark_int1 Route the watermark flag to the INT1 pin
+ */
+void LIS3DHTR::enableFifo(uint8_t watermark, bool watermark_int1)
+{
+    if (watermark > LIS3DHTR_REG_ACCEL_FIFO_CTRL_FTH_MASK) {
+        watermark = LIS3DHTR_REG_ACCEL_FIFO_CTRL_FTH_MASK;
+    }
+
+    fifoHead = 0;
+    fifoTail = 0;
+    fifoOverruns = 0;
+
+    uint8_t data = readRegister(LIS3DHTR_REG_ACCEL_CTRL_REG5);
+    writeRegister(LIS3DHTR_REG_ACCEL_CTRL_REG5, data | LIS3DHTR_REG_ACCEL_CTRL_REG5_FIFO_EN);
+
+    // going through bypass mode empties the FIFO
+    writeRegister(LIS3DHTR_REG_ACCEL_FIFO_CTRL, LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_BYPASS);
+    writeRegister(LIS3DHTR_REG_ACCEL_FIFO_CTRL, LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_STREAM | watermark);
+
+    data = readRegister(LIS3DHTR_REG_ACCEL_CTRL_REG3);
+    data = watermark_int1 ? data | LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_WTM : data & ~LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_WTM;
+    writeRegister(LIS3DHTR_REG_ACCEL_CTRL_REG3, data);
+}
+
+void LIS3DHTR::disableFifo(void)
+{
+    writeRegister(LIS3DHTR_REG_ACCEL_FIFO_CTRL, LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_BYPASS);
+
+    uint8_t data = readRegister(LIS3DHTR_REG_ACCEL_CTRL_REG5);
+    writeRegister(LIS3DHTR_REG_ACCEL_CTRL_REG5, data & ~LIS3DHTR_REG_ACCEL_CTRL_REG5_FIFO_EN);
+
+    data = readRegister(LIS3DHTR_REG_ACCEL_CTRL_REG3);
+    writeRegister(LIS3DHTR_REG_ACCEL_CTRL_REG3, data & ~LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_WTM);
+}
+
+bool LIS3DHTR::fifoWatermark(void)
+{
+    return readRegister(LIS3DHTR_REG_ACCEL_FIFO_SRC) & LIS3DHTR_REG_ACCEL_FIFO_SRC_WTM;
+}
+
+static uint8_t fifo_level(uint8_t src)
+{
+    if (src & LIS3DHTR_REG_ACCEL_FIFO_SRC_EMPTY) {
+        return 0;
+    }
+    // FSS counts up to 31, a full FIFO is flagged by OVRN
+    if (src & LIS3DHTR_REG_ACCEL_FIFO_SRC_OVRN) {
+        return LIS3DHTR_FIFO_SIZE;
+    }
+    return src & LIS3DHTR_REG_ACCEL_FIFO_SRC_FSS_MASK;
+}
+
+uint8_t LIS3DHTR::getFifoLevel(void)
+{
+    return fifo_level(readRegister(LIS3DHTR_REG_ACCEL_FIFO_SRC));
+}
+
+/**
+ * Move all pending FIFO samples into the ring buffer, call this on the watermark
+ * interrupt or from a poll that runs at least every 32 samples.
+ * @return number of samples read
+ */
+uint16_t LIS3DHTR::serviceFifo(void)
+{
+    uint8_t src = readRegister(LIS3DHTR_REG_ACCEL_FIFO_SRC);
+    uint8_t level = fifo_level(src);
+    if (level == 0) {
+        return 0;
+    }
+    if (src & LIS3DHTR_REG_ACCEL_FIFO_SRC_OVRN) {
+        fifoOverruns++;
+    }
+
+    // with the FIFO enabled the address rolls back from OUT_Z_H to OUT_X_L,
+    // so all pending samples come out of one auto-increment read
+    uint8_t buf[LIS3DHTR_FIFO_SIZE * 6];
+    readRegisterRegion(buf, LIS3DHTR_REG_ACCEL_OUT_X_L, level * 6);
+
+    for (uint8_t i = 0; i < level; i++) {
+        // ring full, drop the oldest sample
+        if (fifoAvailable() == LIS3DHTR_FIFO_RING_SIZE) {
+            fifoTail++;
+            fifoOverruns++;
+        }
+        int16_t *sample = fifoRing[fifoHead & (LIS3DHTR_FIFO_RING_SIZE - 1)];
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            sample[axis] = (int16_t)(buf[i * 6 + axis * 2] | (buf[i * 6 + axis * 2 + 1] << 8));
+        }
+        fifoHead++;
+    }
+
+    return level;
+}
+
+uint16_t LIS3DHTR::fifoAvailable(void)
+{
+    return (uint16_t)(fifoHead - fifoTail);
+}
+
+/**
+ * Take the oldest sample out of the ring buffer, same scaling as getAcceleration
+ * @return false if the ring buffer is empty
+ */
+bool LIS3DHTR::popSample(float *x, float *y, float *z)
+{
+    if (fifoAvailable() == 0) {
+        return false;
+    }
+
+    const int16_t *sample = fifoRing[fifoTail & (LIS3DHTR_FIFO_RING_SIZE - 1)];
+    *x = (float)sample[0] / accRange;
+    *y = (float)sample[1] / accRange;
+    *z = (float)sample[2] / accRange;
+    fifoTail++;
+
+    return true;
+}
+
+/**
+ * Number of times samples were lost since enableFifo, a chip FIFO overrun counts once,
+ * a sample dropped from the full ring buffer counts once per sample
+ */
+uint32_t LIS3DHTR::getFifoOverruns(void)
+{
+    return fifoOverruns;
+}
\ No newline at end of file
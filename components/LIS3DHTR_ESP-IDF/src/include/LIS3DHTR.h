@@ -160,6 +160,31 @@
 
 #define LIS3DHTR_REG_ACCEL_STATUS2_UPDATE_MASK (0x08)   // Has New Data Flag Mask
 
+/**************************************************************************
+    ACCELEROMETER CONTROL REGISTER 3 / 5 DESCRIPTION
+**************************************************************************/
+#define LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_WTM (0x04)      // FIFO Watermark Interrupt on INT1
+#define LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_OVERRUN (0x02)  // FIFO Overrun Interrupt on INT1
+
+#define LIS3DHTR_REG_ACCEL_CTRL_REG5_FIFO_EN (0x40)     // FIFO Enable
+
+/**************************************************************************
+    FIFO CONTROL / SOURCE REGISTER DESCRIPTION
+**************************************************************************/
+#define LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_MASK (0xC0)     // FIFO Mode Selection
+#define LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_BYPASS (0x00)   // Bypass Mode
+#define LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_FIFO (0x40)     // FIFO Mode, stops when full
+#define LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_STREAM (0x80)   // Stream Mode, oldest samples are overwritten
+#define LIS3DHTR_REG_ACCEL_FIFO_CTRL_FTH_MASK (0x1F)    // Watermark Level
+
+#define LIS3DHTR_REG_ACCEL_FIFO_SRC_WTM (0x80)          // Watermark Level Reached
+#define LIS3DHTR_REG_ACCEL_FIFO_SRC_OVRN (0x40)         // FIFO Full, oldest sample overwritten
+#define LIS3DHTR_REG_ACCEL_FIFO_SRC_EMPTY (0x20)        // FIFO Empty
+#define LIS3DHTR_REG_ACCEL_FIFO_SRC_FSS_MASK (0x1F)     // Number of Unread Samples
+
+#define LIS3DHTR_FIFO_SIZE (32)                         // Hardware FIFO depth in samples
+#define LIS3DHTR_FIFO_RING_SIZE (64)                    // Software ring buffer depth in samples, power of 2
+
 enum power_type_t // power mode
 {
     POWER_MODE_NORMAL = LIS3DHTR_REG_ACCEL_CTRL_REG1_LPEN_NORMAL,
@@ -188,6 +213,17 @@ enum odr_type_t // output data rate
     LIS3DHTR_DATARATE_5KHZ = LIS3DHTR_REG_ACCEL_CTRL_REG1_AODR_5K
 };
 
+/**
+ * I2C transport used by the driver, functions return 0 on success.
+ * The default goes through the ESP-IDF I2C master driver, setBus() swaps it
+ * for another bus (or a mock when running on a host).
+ */
+typedef struct
+{
+    int (*write)(void *ctx, uint8_t addr, const uint8_t *data, uint16_t len);
+    int (*write_read)(void *ctx, uint8_t addr, const uint8_t *wr, uint16_t wr_len, uint8_t *rd, uint16_t rd_len);
+    void *ctx;
+} lis3dhtr_bus_t;
 
 class LIS3DHTR
 {
@@ -223,6 +259,20 @@ public:
     void reset(void);
     operator bool();
 
+    void setBus(const lis3dhtr_bus_t *bus);
+
+    // FIFO streaming, the chip buffers up to 32 samples which are drained with one burst read.
+    // Driver only: the fusion inertial sensor (ei_inertial_sensor.cpp) still reads single
+    // samples with getAcceleration(), callers that want FIFO streaming use this directly.
+    void enableFifo(uint8_t watermark = LIS3DHTR_FIFO_SIZE / 2, bool watermark_int1 = false);
+    void disableFifo(void);
+    bool fifoWatermark(void);
+    uint8_t getFifoLevel(void);
+    uint16_t serviceFifo(void);
+    uint16_t fifoAvailable(void);
+    bool popSample(float *x, float *y, float *z);
+    uint32_t getFifoOverruns(void);
+
 private:
     void read(uint8_t reg, uint8_t *buf, uint16_t len);
     void readRegisterRegion(uint8_t *outputPointer, uint8_t offset, uint8_t length);
@@ -234,6 +284,12 @@ private:
     uint8_t commInterface;
     uint8_t chipSelectPin;
 
+    lis3dhtr_bus_t bus;
+    int16_t fifoRing[LIS3DHTR_FIFO_RING_SIZE][3];
+    uint16_t fifoHead;
+    uint16_t fifoTail;
+    uint32_t fifoOverruns;
+
 };
 
 #endif /*SEEED_LIS3DHTR_H*/
@@ -259,6 +259,13 @@ typedef struct {
      */
     uint32_t bounding_boxes_count;
 
+    /**
+     * Number of detected objects dropped because they did not fit into
+     * `EI_CLASSIFIER_RESULT_ARENA_CAPACITY` boxes (counted after non-max
+     * suppression, the lowest scores are dropped first).
+     */
+    uint32_t bounding_boxes_overflow_count;
+
     /**
      * Array of classification results. If object detection is enabled, this will be
      * empty.
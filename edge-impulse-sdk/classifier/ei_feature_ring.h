@@ -0,0 +1,175 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _EI_CLASSIFIER_FEATURE_RING_H_
+#define _EI_CLASSIFIER_FEATURE_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+#include "edge-impulse-sdk/dsp/numpy.hpp"
+
+/**
+ * Sliding window of features for continuous classification.
+ *
+ * The buffer holds exactly one window, used as a ring: the oldest values sit at
+ * `head` and each new slice overwrites them, so adding a slice does not move the
+ * rest of the window. A slice must be contiguous for the extractors, when it
+ * would run past the end of the buffer the window is rotated in place so the
+ * oldest value is at the start again (about once per window of new features).
+ * The window is read in order through ei_feature_ring_at / ei_feature_ring_copy,
+ * or row wise by the normalization (speechpy::processing::cmvnw_ring).
+ */
+typedef struct {
+    float *buffer;
+    size_t window;
+    size_t head;    // oldest value of the window, the next slice is written here
+    size_t slice;   // values written by the last slice
+} ei_feature_ring_t;
+
+/**
+ * Ring used by the per slice feature extractors, bound by
+ * process_impulse_continuous while a DSP block runs
+ */
+inline ei_feature_ring_t*& ei_feature_ring_active() {
+    static ei_feature_ring_t *active = nullptr;
+    return active;
+}
+
+inline void ei_feature_ring_bind(ei_feature_ring_t *ring) {
+    ei_feature_ring_active() = ring;
+}
+
+/**
+ * @brief      Drop the `count` oldest values of the window and return where the
+ *             `count` new values go (contiguous)
+ */
+static inline float *ei_feature_ring_reserve(ei_feature_ring_t *ring, size_t count)
+{
+    if (count >= ring->window) {
+        ring->head = 0;
+        return ring->buffer;
+    }
+
+    if (ring->head + count > ring->window) {
+        std::rotate(ring->buffer, ring->buffer + ring->head, ring->buffer + ring->window);
+        ring->head = 0;
+    }
+
+    float *slice = ring->buffer + ring->head;
+    ring->head += count;
+    if (ring->head == ring->window) {
+        ring->head = 0;
+    }
+    return slice;
+}
+
+/**
+ * @brief      Value `ix` of the window, 0 is the oldest
+ */
+static inline float ei_feature_ring_at(const ei_feature_ring_t *ring, size_t ix)
+{
+    ix += ring->head;
+    return ring->buffer[ix < ring->window ? ix : ix - ring->window];
+}
+
+/**
+ * @brief      Copy the window in order, oldest value first
+ *
+ * @param      out   window values
+ */
+static inline void ei_feature_ring_copy(const ei_feature_ring_t *ring, float *out)
+{
+    const size_t tail = ring->window - ring->head;
+    memcpy(out, ring->buffer + ring->head, tail * sizeof(float));
+    memcpy(out + tail, ring->buffer, ring->head * sizeof(float));
+}
+
+/**
+ * @brief      Make room for `count` new values at the end of the output matrix.
+ *             If the matrix is the window of the active ring the oldest values
+ *             of the ring are dropped, otherwise the matrix is rolled in place.
+ *
+ * @param      output_matrix  Output matrix of a per slice feature extractor
+ * @param[in]  count          Number of values the slice is going to write
+ * @param      slice          Set to where the slice is written, `count` contiguous values
+ *
+ * @return     EIDSP_OK if successful
+ */
+__attribute__((unused)) static int ei_feature_ring_advance(ei::matrix_t *output_matrix, size_t count, float **slice)
+{
+    ei_feature_ring_t *ring = ei_feature_ring_active();
+    const size_t size = output_matrix->rows * output_matrix->cols;
+
+    if (ring == nullptr || output_matrix->buffer != ring->buffer || size != ring->window) {
+        *slice = output_matrix->buffer + size - count;
+        return ei::numpy::roll(output_matrix->buffer, size, -(int)count);
+    }
+
+    *slice = ei_feature_ring_reserve(ring, count);
+
+    return ei::EIDSP_OK;
+}
+
+/**
+ * @brief      Advance the window by one slice without running DSP, the new
+ *             slice repeats the features of the last one. Used to keep the
+ *             window filled with background features while audio is gated.
+ *
+ * @param      ring  Ring of a DSP block that already processed a slice
+ *
+ * @return     Number of values added to the window
+ */
+__attribute__((unused)) static size_t ei_feature_ring_repeat_slice(ei_feature_ring_t *ring)
+{
+    const size_t count = ring->slice;
+    if (count == 0 || 2 * count > ring->window) {
+        return 0;
+    }
+
+    // an extractor may have written the last slice in pieces that a rotation
+    // separated, so it is read back in window order: after the new slice is
+    // reserved it is the second to last slice of the window
+    float *slice = ei_feature_ring_reserve(ring, count);
+    const size_t last = ring->window - 2 * count;
+    for (size_t ix = 0; ix < count; ix++) {
+        slice[ix] = ei_feature_ring_at(ring, last + ix);
+    }
+
+    return count;
+}
+
+#endif // _EI_CLASSIFIER_FEATURE_RING_H_
@@ -41,6 +41,8 @@ using namespace ei;
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/classifier/ei_nms.h"
+#include "edge-impulse-sdk/classifier/ei_result_arena.h"
+#include "edge-impulse-sdk/classifier/ei_visual_ad_grid.h"
 #include "edge-impulse-sdk/dsp/ei_vector.h"
 
 #ifndef EI_HAS_OBJECT_DETECTION
@@ -161,8 +163,7 @@ __attribute__((unused)) static void ei_handle_cube(std::vector<ei_classifier_cub
 
 __attribute__((unused)) static void fill_result_struct_from_cubes(ei_impulse_result_t *result, std::vector<ei_classifier_cube_t*> *cubes, int out_width_factor, uint32_t object_detection_count) {
     std::vector<ei_classifier_cube_t*> bbs;
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    int added_boxes_count = 0;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     for (auto sc : *cubes) {
@@ -201,16 +202,11 @@ __attribute__((unused)) static void fill_result_struct_from_cubes(ei_impulse_res
         };
 
         results.push_back(tmp);
-        added_boxes_count++;
     }
 
     // if we didn't detect min required objects, fill the rest with fixed value
-    if (added_boxes_count < object_detection_count) {
-        results.resize(object_detection_count);
-        for (size_t ix = added_boxes_count; ix < object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
-    }
+    size_t added_boxes_count = results.size();
+    results.pad(object_detection_count);
 
     for (auto c : *cubes) {
         delete c;
@@ -218,6 +214,7 @@ __attribute__((unused)) static void fill_result_struct_from_cubes(ei_impulse_res
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
+    result->bounding_boxes_overflow_count = results.overflow_count;
 }
 #endif
 
@@ -300,12 +297,12 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_object_de
                                                                                         float *labels,
                                                                                         bool debug) {
 #ifdef EI_HAS_SSD
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     int added_boxes_count = 0;
     results.clear();
-    results.resize(impulse->object_detection_count);
+    results.pad(impulse->object_detection_count);
 
-    for (size_t ix = 0; ix < impulse->object_detection_count; ix++) {
+    for (size_t ix = 0; ix < results.size(); ix++) {
 
         float score = scores[ix];
         float label = labels[ix];
@@ -358,6 +355,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_object_de
     }
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -429,55 +427,39 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_visual_ad_struct_f32
                                                                        ei_learning_block_config_tflite_graph_t* block_config,
                                                                        bool debug) {
 #if EI_CLASSIFIER_HAS_VISUAL_ANOMALY
-    float max_val = 0;
-    float sum_val = 0;
-
-    for (uint32_t ix = 0; ix < impulse->visual_ad_grid_size_x * impulse->visual_ad_grid_size_y; ix++) {
-        float value = data[ix];
-        sum_val += value;
-        if (value > max_val) {
-            max_val = value;
-        }
+    // allocated once from the grid dimensions and reused for every frame
+    static ei_visual_ad_grid_t grid = { 0 };
+
+    if (!ei_visual_ad_grid_reserve(&grid,
+                                   impulse->visual_ad_grid_size_x,
+                                   impulse->visual_ad_grid_size_y,
+                                   impulse->object_detection_count)) {
+        return EI_IMPULSE_ALLOC_FAILED;
     }
 
-    result->visual_ad_result.mean_value = sum_val / (impulse->visual_ad_grid_size_x * impulse->visual_ad_grid_size_y);
-    result->visual_ad_result.max_value = max_val;
-
-    static ei_vector<ei_impulse_result_bounding_box_t> results;
+    ei_visual_ad_grid_reduce(&grid, data, block_config->threshold);
 
-    int added_boxes_count = 0;
-    results.clear();
+    result->visual_ad_result.mean_value = grid.mean_value;
+    result->visual_ad_result.max_value = grid.max_value;
 
-    for (uint16_t x = 0; x <= impulse->visual_ad_grid_size_x - 1; x++) {
-        for (uint16_t y = 0; y <= impulse->visual_ad_grid_size_y - 1; y++) {
-            if (data[x * impulse->visual_ad_grid_size_x + y] >= block_config->threshold) {
-                ei_impulse_result_bounding_box_t tmp = {
-                    .label = "anomaly",
-                    .x = static_cast<uint32_t>(y * (static_cast<float>(impulse->input_height) / impulse->visual_ad_grid_size_y)),
-                    .y = static_cast<uint32_t>(x * (static_cast<float>(impulse->input_width) / impulse->visual_ad_grid_size_x)),
-                    .width = (impulse->input_width / impulse->visual_ad_grid_size_x),
-                    .height = (impulse->input_height / impulse->visual_ad_grid_size_y),
-                    .value = data[x * impulse->visual_ad_grid_size_x + y]
-                };
-
-                results.push_back(tmp);
-                added_boxes_count++;
-            }
-        }
-    }
+#if EI_CLASSIFIER_VISUAL_AD_MERGE_REGIONS == 1
+    uint32_t added_boxes_count = ei_visual_ad_grid_regions_to_boxes(&grid, data, impulse->input_width, impulse->input_height);
+#else
+    uint32_t added_boxes_count = ei_visual_ad_grid_cells_to_boxes(&grid, data, impulse->input_width, impulse->input_height);
+#endif
 
     // if we didn't detect min required objects, fill the rest with fixed value
-    if (added_boxes_count < impulse->object_detection_count) {
-        results.resize(impulse->object_detection_count);
-        for (size_t ix = added_boxes_count; ix < impulse->object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
+    uint32_t boxes_count = added_boxes_count;
+    if (boxes_count < impulse->object_detection_count) {
+        memset(&grid.boxes[added_boxes_count], 0,
+            (impulse->object_detection_count - added_boxes_count) * sizeof(ei_impulse_result_bounding_box_t));
+        boxes_count = impulse->object_detection_count;
     }
 
     result->classification[0].value = result->visual_ad_result.max_value;
 
-    result->visual_ad_grid_cells = results.data();
-    result->visual_ad_count = results.size();
+    result->visual_ad_grid_cells = grid.boxes;
+    result->visual_ad_count = boxes_count;
 #endif // EI_CLASSIFIER_HAS_VISUAL_ANOMALY
     return EI_IMPULSE_OK;
 }
@@ -493,7 +475,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov5(co
                                                                               size_t output_features_count,
                                                                               bool debug = false) {
 #ifdef EI_HAS_YOLOV5
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     size_t col_size = 5 + impulse->label_count;
@@ -551,7 +533,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov5(co
             r.width = static_cast<uint32_t>(w);
             r.height = static_cast<uint32_t>(h);
             r.value = score;
-            results.push_back(r);
+            results.add_candidate(r);
         }
     }
 
@@ -562,16 +544,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov5(co
 
     // if we didn't detect min required objects, fill the rest with fixed value
     size_t added_boxes_count = results.size();
-    size_t min_object_detection_count = impulse->object_detection_count;
-    if (added_boxes_count < min_object_detection_count) {
-        results.resize(min_object_detection_count);
-        for (size_t ix = added_boxes_count; ix < min_object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
-    }
+    results.pad(impulse->object_detection_count);
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -593,7 +570,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_quantized_yol
                                                                                     size_t output_features_count,
                                                                                     bool debug = false) {
 #ifdef EI_HAS_YOLOV5
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     size_t col_size = 5 + impulse->label_count;
@@ -651,7 +628,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_quantized_yol
             r.width = static_cast<uint32_t>(w);
             r.height = static_cast<uint32_t>(h);
             r.value = score;
-            results.push_back(r);
+            results.add_candidate(r);
         }
     }
 
@@ -662,16 +639,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_quantized_yol
 
     // if we didn't detect min required objects, fill the rest with fixed value
     size_t added_boxes_count = results.size();
-    size_t min_object_detection_count = impulse->object_detection_count;
-    if (added_boxes_count < min_object_detection_count) {
-        results.resize(min_object_detection_count);
-        for (size_t ix = added_boxes_count; ix < min_object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
-    }
+    results.pad(impulse->object_detection_count);
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -690,7 +662,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox(con
                                                                              size_t output_features_count,
                                                                              bool debug = false) {
 #ifdef EI_HAS_YOLOX
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     // START: def yolox_postprocess()
@@ -855,7 +827,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox(con
                 r.width = (int)round(width);
                 r.height = (int)round(height);
 
-                results.push_back(r);
+                results.add_candidate(r);
             }
         }
     }
@@ -867,16 +839,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox(con
 
     // if we didn't detect min required objects, fill the rest with fixed value
     size_t added_boxes_count = results.size();
-    size_t min_object_detection_count = impulse->object_detection_count;
-    if (added_boxes_count < min_object_detection_count) {
-        results.resize(min_object_detection_count);
-        for (size_t ix = added_boxes_count; ix < min_object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
-    }
+    results.pad(impulse->object_detection_count);
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -894,7 +861,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox_det
                                                                              float *data,
                                                                              size_t output_features_count) {
 #ifdef EI_HAS_YOLOX
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     // expected format [xmin ymin xmax ymax score label]
@@ -947,6 +914,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolox_det
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = results.size();
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -964,7 +932,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov7(co
                                                                               float *data,
                                                                               size_t output_features_count) {
 #ifdef EI_HAS_YOLOV7
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     size_t col_size = 7;
@@ -995,17 +963,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov7(co
     }
 
     // if we didn't detect min required objects, fill the rest with fixed value
-    size_t added_boxes_count = results.size();
-    size_t min_object_detection_count = impulse->object_detection_count;
-    if (added_boxes_count < min_object_detection_count) {
-        results.resize(min_object_detection_count);
-        for (size_t ix = added_boxes_count; ix < min_object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
-    }
+    results.pad(impulse->object_detection_count);
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = results.size();
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -1017,18 +979,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov7(co
 
 __attribute__((unused)) static void prepare_nms_results_common(const ei_impulse_t *impulse,
                                                                ei_impulse_result_t *result,
-                                                               std::vector<ei_impulse_result_bounding_box_t> *results) {
+                                                               ei_result_arena_t *results) {
     #define EI_CLASSIFIER_OBJECT_DETECTION_KEEP_TOPK 200
 
     // if we didn't detect min required objects, fill the rest with fixed value
-    size_t added_boxes_count = results->size();
-    size_t object_detection_count = impulse->object_detection_count;
-    if (added_boxes_count < object_detection_count) {
-        results->resize(object_detection_count);
-        for (size_t ix = added_boxes_count; ix < object_detection_count; ix++) {
-            (*results)[ix].value = 0.0f;
-        }
-    }
+    results->pad(impulse->object_detection_count);
 
     // we sort in reverse order across all classes,
     // since results for each class are pushed to the end.
@@ -1038,12 +993,11 @@ __attribute__((unused)) static void prepare_nms_results_common(const ei_impulse_
     });
 
     // keep topK
-    if (results->size() > EI_CLASSIFIER_OBJECT_DETECTION_KEEP_TOPK) {
-        results->erase(results->begin() + EI_CLASSIFIER_OBJECT_DETECTION_KEEP_TOPK, results->end());
-    }
+    results->truncate(EI_CLASSIFIER_OBJECT_DETECTION_KEEP_TOPK);
 
     result->bounding_boxes = results->data();
     result->bounding_boxes_count = results->size();
+    result->bounding_boxes_overflow_count = results->overflow_count;
 }
 
 
@@ -1066,8 +1020,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_decode_de
     size_t col_size = 12 + impulse->label_count + 1;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     for (size_t cls_idx = 1; cls_idx < (size_t)(impulse->label_count + 1); cls_idx++)  {
@@ -1075,7 +1028,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_decode_de
         std::vector<float> boxes;
         std::vector<float> scores;
         std::vector<int> classes;
-        class_results.clear();
 
         for (size_t ix = 0; ix < row_count; ix++) {
 
@@ -1160,7 +1112,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_decode_de
         }
 
         size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &class_results,
+        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &results,
                                               boxes.data(), scores.data(), classes.data(),
                                               nr_boxes,
                                               true /*clip_boxes*/,
@@ -1170,9 +1122,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_decode_de
             return nms_res;
         }
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
     }
 
     prepare_nms_results_common(impulse, result, &results);
@@ -1235,8 +1184,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  fill_result_struct_tao_yolov3_c
     size_t col_size = 11 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    ei_result_arena_t &results = *ei_result_arena_active();
 
     results.clear();
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
@@ -1244,7 +1192,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  fill_result_struct_tao_yolov3_c
         std::vector<float> boxes;
         std::vector<float> scores;
         std::vector<int> classes;
-        class_results.clear();
 
         for (size_t ix = 0; ix < row_count; ix++) {
             size_t data_ix = ix * col_size;
@@ -1292,7 +1239,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  fill_result_struct_tao_yolov3_c
         }
 
         size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &class_results,
+        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &results,
                                               boxes.data(), scores.data(), classes.data(),
                                               nr_boxes,
                                               true /*clip_boxes*/,
@@ -1301,9 +1248,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  fill_result_struct_tao_yolov3_c
             return nms_res;
         }
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
     }
 
     prepare_nms_results_common(impulse, result, &results);
@@ -1329,8 +1273,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_yolov4_co
     size_t col_size = 11 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     const float grid_scale_xy = 1.0f;
@@ -1340,7 +1283,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_yolov4_co
         std::vector<float> boxes;
         std::vector<float> scores;
         std::vector<int> classes;
-        class_results.clear();
 
         for (size_t ix = 0; ix < row_count; ix++) {
 
@@ -1398,7 +1340,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_yolov4_co
         }
 
         size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &class_results,
+        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &results,
                                               boxes.data(), scores.data(), classes.data(),
                                               nr_boxes,
                                               true /*clip_boxes*/,
@@ -1407,9 +1349,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_tao_yolov4_co
             return nms_res;
         }
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
     }
 
     prepare_nms_results_common(impulse, result, &results);
@@ -1582,7 +1521,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov2(co
                                                                               size_t output_features_count,
                                                                               bool debug = false) {
 #ifdef EI_HAS_YOLOV2
-    static std::vector<ei_impulse_result_bounding_box_t> results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     // Example output shape: (7, 7, 5, 7)
@@ -1726,16 +1665,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov2(co
 
     // if we didn't detect min required objects, fill the rest with fixed value
     size_t added_boxes_count = results.size();
-    size_t min_object_detection_count = impulse->object_detection_count;
-    if (added_boxes_count < min_object_detection_count) {
-        results.resize(min_object_detection_count);
-        for (size_t ix = added_boxes_count; ix < min_object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
-    }
+    results.pad(impulse->object_detection_count);
 
     result->bounding_boxes = results.data();
     result->bounding_boxes_count = added_boxes_count;
+    result->bounding_boxes_overflow_count = results.overflow_count;
 
     return EI_IMPULSE_OK;
 #else
@@ -1756,8 +1690,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
     size_t col_size = 4 + impulse->label_count;
     size_t row_count = output_features_count / col_size;
 
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    ei_result_arena_t &results = *ei_result_arena_active();
     results.clear();
 
     // (xmin, ymin, xmax, ymax, cls...)
@@ -1766,7 +1699,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
         std::vector<float> boxes;
         std::vector<float> scores;
         std::vector<int> classes;
-        class_results.clear();
 
 
         for (size_t ix = 0; ix < row_count; ix++) {
@@ -1820,7 +1752,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
         }
 
         size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &class_results,
+        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &results,
                                               boxes.data(), scores.data(), classes.data(),
                                               nr_boxes,
                                               true /*clip_boxes*/,
@@ -1830,9 +1762,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
             return nms_res;
         }
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
     }
 
     prepare_nms_results_common(impulse, result, &results);
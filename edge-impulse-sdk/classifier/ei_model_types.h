@@ -38,6 +38,7 @@
 #include <stdint.h>
 
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+#include "edge-impulse-sdk/classifier/ei_result_arena.h"
 #include "edge-impulse-sdk/dsp/ei_dsp_handle.h"
 #include "edge-impulse-sdk/dsp/numpy.hpp"
 #if EI_CLASSIFIER_USE_FULL_TFLITE || (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_AKIDA) || (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_MEMRYX)
@@ -377,10 +378,26 @@ public:
 class ei_impulse_handle_t {
 public:
     ei_impulse_handle_t(const ei_impulse_t *impulse)
-        : state(impulse), impulse(impulse), post_processing_state(nullptr) {};
+        : state(impulse), impulse(impulse), post_processing_state(nullptr)
+    {
+        // make sure decoders always have somewhere to write, even when
+        // they are called outside of run_inference()
+        if (ei_result_arena_active() == nullptr) {
+            ei_result_arena_bind(&result_arena);
+        }
+    };
+
+    ~ei_impulse_handle_t()
+    {
+        if (ei_result_arena_active() == &result_arena) {
+            ei_result_arena_bind(nullptr);
+        }
+    }
+
     ei_impulse_state_t state;
     const ei_impulse_t *impulse;
     void** post_processing_state;
+    ei_result_arena_t result_arena; // bounding box storage for the object detection decoders
 };
 
 typedef struct {
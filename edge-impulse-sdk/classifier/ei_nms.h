@@ -215,11 +215,12 @@ static inline void NonMaxSuppression(const float* boxes, const int num_boxes,
 }
 
 /**
- * Run non-max suppression over the results array (for bounding boxes)
+ * Run non-max suppression over the candidate boxes and append the
+ * selected ones to the results arena
  */
 EI_IMPULSE_ERROR ei_run_nms(
     const ei_impulse_t *impulse,
-    std::vector<ei_impulse_result_bounding_box_t> *results,
+    ei_result_arena_t *results,
     float *boxes,
     float *scores,
     int *classes,
@@ -262,8 +263,6 @@ EI_IMPULSE_ERROR ei_run_nms(
         selected_scores,
         &num_selected_indices);
 
-    std::vector<ei_impulse_result_bounding_box_t> new_results;
-
     for (size_t ix = 0; ix < (size_t)num_selected_indices; ix++) {
 
         int out_ix = selected_indices[ix];
@@ -287,7 +286,7 @@ EI_IMPULSE_ERROR ei_run_nms(
         bb.x      = static_cast<uint32_t>(xmin);
         bb.height = static_cast<uint32_t>(ymax) - bb.y;
         bb.width  = static_cast<uint32_t>(xmax) - bb.x;
-        new_results.push_back(bb);
+        results->push_back(bb);
 
         if (debug) {
           ei_printf("Found bb with label %s\n", bb.label);
@@ -295,12 +294,6 @@ EI_IMPULSE_ERROR ei_run_nms(
 
     }
 
-    results->clear();
-
-    for (size_t ix = 0; ix < new_results.size(); ix++) {
-        results->push_back(new_results[ix]);
-    }
-
     ei_free(selected_indices);
     ei_free(selected_scores);
 
@@ -309,24 +302,28 @@ EI_IMPULSE_ERROR ei_run_nms(
 }
 
 /**
- * Run non-max suppression over the results array (for bounding boxes)
+ * Run non-max suppression over the candidates collected in the results arena
+ * (see ei_result_arena_t::add_candidate), the selected boxes are added to the
+ * arena. The capacity of the arena only applies to the selected boxes.
  */
 EI_IMPULSE_ERROR ei_run_nms(
     const ei_impulse_t *impulse,
-    std::vector<ei_impulse_result_bounding_box_t> *results,
+    ei_result_arena_t *results,
     bool clip_boxes,
     bool debug) {
 
+    std::vector<ei_impulse_result_bounding_box_t> &candidates = results->candidates;
+
     size_t bb_count = 0;
-    for (size_t ix = 0; ix < results->size(); ix++) {
-        auto bb = results->at(ix);
-        if (bb.value == 0) {
+    for (size_t ix = 0; ix < candidates.size(); ix++) {
+        if (candidates[ix].value == 0) {
             continue;
         }
         bb_count++;
     }
 
     if (bb_count < 1) {
+        candidates.clear();
         return EI_IMPULSE_OK;
     }
 
@@ -338,12 +335,13 @@ EI_IMPULSE_ERROR ei_run_nms(
         ei_free(boxes);
         ei_free(scores);
         ei_free(classes);
+        candidates.clear();
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
 
     size_t box_ix = 0;
-    for (size_t ix = 0; ix < results->size(); ix++) {
-        auto bb = results->at(ix);
+    for (size_t ix = 0; ix < candidates.size(); ix++) {
+        auto bb = candidates[ix];
         if (bb.value == 0) {
             continue;
         }
@@ -361,6 +359,8 @@ EI_IMPULSE_ERROR ei_run_nms(
         box_ix++;
     }
 
+    candidates.clear();
+
     EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, results,
                                           boxes, scores,
                                           classes, bb_count,
@@ -377,11 +377,11 @@ EI_IMPULSE_ERROR ei_run_nms(
 }
 
 /**
- * Run non-max suppression over the results array (for bounding boxes)
+ * Run non-max suppression over the candidates in the results arena (for bounding boxes)
  */
 EI_IMPULSE_ERROR ei_run_nms(
     const ei_impulse_t *impulse,
-    std::vector<ei_impulse_result_bounding_box_t> *results,
+    ei_result_arena_t *results,
     bool debug = false) {
   return ei_run_nms(impulse, results, true, debug);
 }
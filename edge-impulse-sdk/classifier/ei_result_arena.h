@@ -0,0 +1,174 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _EI_CLASSIFIER_RESULT_ARENA_H_
+#define _EI_CLASSIFIER_RESULT_ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+
+/**
+ * Maximum number of bounding boxes an object detection decoder can return
+ * for a single frame. When non-max suppression leaves more boxes, the ones
+ * with the lowest score are dropped and counted in
+ * `ei_impulse_result_t::bounding_boxes_overflow_count`.
+ */
+#ifndef EI_CLASSIFIER_RESULT_ARENA_CAPACITY
+#if defined(EI_CLASSIFIER_OBJECT_DETECTION) && (EI_CLASSIFIER_OBJECT_DETECTION == 1)
+#define EI_CLASSIFIER_RESULT_ARENA_CAPACITY 100
+#else
+#define EI_CLASSIFIER_RESULT_ARENA_CAPACITY 1
+#endif
+#endif // EI_CLASSIFIER_RESULT_ARENA_CAPACITY
+
+#if defined(EI_CLASSIFIER_OBJECT_DETECTION_COUNT)
+static_assert(EI_CLASSIFIER_RESULT_ARENA_CAPACITY >= EI_CLASSIFIER_OBJECT_DETECTION_COUNT,
+    "EI_CLASSIFIER_RESULT_ARENA_CAPACITY must be at least EI_CLASSIFIER_OBJECT_DETECTION_COUNT");
+#endif
+
+/**
+ * Fixed-capacity storage for the bounding boxes produced by the object
+ * detection decoders. One arena is owned by each impulse handle and shared by
+ * all decoders, so memory use does not depend on how crowded the scene is.
+ *
+ * Decoders that run non-max suppression collect their candidates with
+ * add_candidate() first. The candidates are not capped (duplicates of strong
+ * objects would otherwise push out weaker, distinct ones before NMS), their
+ * storage is kept between frames so it only grows on the most crowded frame.
+ */
+class ei_result_arena_t {
+public:
+    ei_result_arena_t() : overflow_count(0), count(0) { }
+
+    /**
+     * Start a new frame
+     */
+    void clear() {
+        count = 0;
+        overflow_count = 0;
+        candidates.clear();
+    }
+
+    /**
+     * Add a box. When the arena is full the box replaces the lowest scoring
+     * entry if it scores higher, so the arena always holds the top-k boxes.
+     *
+     * @return false if a box (either this one or an evicted one) was dropped
+     */
+    bool push_back(const ei_impulse_result_bounding_box_t &bb) {
+        if (count < EI_CLASSIFIER_RESULT_ARENA_CAPACITY) {
+            boxes[count++] = bb;
+            return true;
+        }
+
+        overflow_count++;
+
+        size_t min_ix = 0;
+        for (size_t ix = 1; ix < count; ix++) {
+            if (boxes[ix].value < boxes[min_ix].value) {
+                min_ix = ix;
+            }
+        }
+        if (bb.value > boxes[min_ix].value) {
+            boxes[min_ix] = bb;
+        }
+        return false;
+    }
+
+    /**
+     * Add a candidate for non-max suppression, see ei_run_nms()
+     */
+    void add_candidate(const ei_impulse_result_bounding_box_t &bb) {
+        candidates.push_back(bb);
+    }
+
+    /**
+     * Zero-fill the arena up to `n` entries (clamped to the capacity)
+     */
+    void pad(size_t n) {
+        if (n > EI_CLASSIFIER_RESULT_ARENA_CAPACITY) {
+            n = EI_CLASSIFIER_RESULT_ARENA_CAPACITY;
+        }
+        if (n > count) {
+            memset(&boxes[count], 0, (n - count) * sizeof(ei_impulse_result_bounding_box_t));
+            count = n;
+        }
+    }
+
+    /**
+     * Drop every entry from index `n` onwards
+     */
+    void truncate(size_t n) {
+        if (n < count) {
+            count = n;
+        }
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    static constexpr size_t capacity() { return EI_CLASSIFIER_RESULT_ARENA_CAPACITY; }
+
+    ei_impulse_result_bounding_box_t *data() { return boxes; }
+    ei_impulse_result_bounding_box_t *begin() { return boxes; }
+    ei_impulse_result_bounding_box_t *end() { return boxes + count; }
+    ei_impulse_result_bounding_box_t& operator[](size_t ix) { return boxes[ix]; }
+
+    /* number of boxes dropped in the current frame */
+    uint32_t overflow_count;
+    /* boxes waiting for non-max suppression */
+    std::vector<ei_impulse_result_bounding_box_t> candidates;
+
+private:
+    ei_impulse_result_bounding_box_t boxes[EI_CLASSIFIER_RESULT_ARENA_CAPACITY];
+    size_t count;
+};
+
+/**
+ * The arena the decoders write into. Set to the arena of the impulse handle
+ * that is currently running inference (see `run_inference()`).
+ */
+inline ei_result_arena_t*& ei_result_arena_active() {
+    static ei_result_arena_t *active = nullptr;
+    return active;
+}
+
+inline void ei_result_arena_bind(ei_result_arena_t *arena) {
+    ei_result_arena_active() = arena;
+}
+
+#endif // _EI_CLASSIFIER_RESULT_ARENA_H_
@@ -143,6 +143,9 @@ __attribute__((unused)) void display_results(ei_impulse_handle_t *handle, ei_imp
     if (!bb_found) {
         ei_printf("    No objects found\n");
     }
+    if (result->bounding_boxes_overflow_count > 0) {
+        ei_printf("    %u more objects dropped (result arena full)\n", (unsigned)result->bounding_boxes_overflow_count);
+    }
 
 #elif (EI_CLASSIFIER_LABEL_COUNT == 1) && (!EI_CLASSIFIER_HAS_ANOMALY)// regression
     ei_printf("#Regression results:\r\n");
@@ -199,6 +202,8 @@ extern "C" EI_IMPULSE_ERROR run_inference(
     bool debug = false)
 {
     auto& impulse = handle->impulse;
+    ei_result_arena_bind(&handle->result_arena);
+
     for (size_t ix = 0; ix < impulse->learning_blocks_size; ix++) {
 
         ei_learning_block_t block = impulse->learning_blocks[ix];
@@ -259,6 +264,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
     // Shortcut for quantized image models
     ei_learning_block_t block = handle->impulse->learning_blocks[0];
     if (can_run_classifier_image_quantized(handle->impulse, block) == EI_IMPULSE_OK) {
+        ei_result_arena_bind(&handle->result_arena);
         EI_IMPULSE_ERROR res = run_classifier_image_quantized(handle->impulse, signal, result, debug);
         if (res != EI_IMPULSE_OK) {
             return res;
@@ -431,6 +437,92 @@ extern "C" EI_IMPULSE_ERROR init_impulse(ei_impulse_handle_t *handle) {
     return EI_IMPULSE_OK;
 }
 
+/**
+ * @brief      Feature windows for continuous inference, one ring per DSP block
+ *             backed by a static matrix that holds one window per block
+ *             (see ei_feature_ring.h). Allocated on first use.
+ *
+ * @param      impulse  struct with information about model and DSP
+ *
+ * @return     The rings, nullptr if out of memory
+ */
+static ei_feature_ring_t *get_continuous_feature_rings(const ei_impulse_t *impulse)
+{
+    static ei::matrix_t static_features_matrix(1, impulse->nn_input_frame_size);
+    static ei_feature_ring_t *feature_rings = nullptr;
+    if (!static_features_matrix.buffer) {
+        return nullptr;
+    }
+
+    if (!feature_rings) {
+        feature_rings = (ei_feature_ring_t*)ei_calloc(impulse->dsp_blocks_size, sizeof(ei_feature_ring_t));
+        if (!feature_rings) {
+            return nullptr;
+        }
+        size_t ring_offset = 0;
+        for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
+            feature_rings[ix].buffer = static_features_matrix.buffer + ring_offset;
+            feature_rings[ix].window = impulse->dsp_blocks[ix].n_output_features;
+            feature_rings[ix].head = 0;
+            ring_offset += impulse->dsp_blocks[ix].n_output_features;
+        }
+    }
+
+    return feature_rings;
+}
+
+/**
+ * @brief      Compute the peak working memory of the DSP stage, on top of the
+ *             feature matrix. Does not allocate.
+ *
+ * @param      impulse  struct with information about model and DSP
+ *
+ * @return     Largest working memory of a single DSP block, in bytes
+ */
+static size_t get_dsp_workspace_size(const ei_impulse_t *impulse)
+{
+    size_t peak = 0;
+    for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
+        ei_model_dsp_t block = impulse->dsp_blocks[ix];
+        if (block.extract_fn == extract_spectral_analysis_features) {
+            size_t input_size =
+                impulse->dsp_input_frame_size / impulse->raw_samples_per_frame * block.axes_size;
+            peak = std::max(peak, get_spectral_analysis_workspace_size(block.config, input_size));
+        }
+    }
+    return peak;
+}
+
+/**
+ * @brief      Allocate the cached DSP workspaces (the FFT workspace of spectral
+ *             analysis, MFCC, MFE and spectrogram blocks, one per FFT length), so
+ *             the first inference does not pay for it
+ *
+ * @param      impulse  struct with information about model and DSP
+ *
+ * @return     false if out of memory, the workspace is then retried on first use
+ */
+static bool reserve_dsp_workspaces(const ei_impulse_t *impulse)
+{
+    bool ok = true;
+    for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
+        ei_model_dsp_t block = impulse->dsp_blocks[ix];
+        if (block.extract_fn == extract_spectral_analysis_features) {
+            ok = reserve_spectral_analysis_workspace(block.config) && ok;
+        }
+        else if (block.extract_fn == extract_mfcc_features) {
+            ok = reserve_speechpy_workspace(((ei_dsp_config_mfcc_t *)block.config)->fft_length) && ok;
+        }
+        else if (block.extract_fn == extract_mfe_features) {
+            ok = reserve_speechpy_workspace(((ei_dsp_config_mfe_t *)block.config)->fft_length) && ok;
+        }
+        else if (block.extract_fn == extract_spectrogram_features) {
+            ok = reserve_speechpy_workspace(((ei_dsp_config_spectrogram_t *)block.config)->fft_length) && ok;
+        }
+    }
+    return ok;
+}
+
 /**
  * @brief      Process a complete impulse for continuous inference
  *
@@ -451,8 +543,8 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     }
 
     auto impulse = handle->impulse;
-    static ei::matrix_t static_features_matrix(1, impulse->nn_input_frame_size);
-    if (!static_features_matrix.buffer) {
+    ei_feature_ring_t *feature_rings = get_continuous_feature_rings(impulse);
+    if (!feature_rings) {
         return EI_IMPULSE_ALLOC_FAILED;
     }
 
@@ -472,8 +564,8 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
             return EI_IMPULSE_DSP_ERROR;
         }
 
-        ei::matrix_t fm(1, block.n_output_features,
-                        static_features_matrix.buffer + out_features_index);
+        ei_feature_ring_t *ring = &feature_rings[ix];
+        ei::matrix_t fm(1, block.n_output_features, ring->buffer);
 
         int (*extract_fn_slice)(ei::signal_t *signal, ei::matrix_t *output_matrix, void *config, const float frequency, matrix_size_t *out_matrix_size);
 
@@ -494,9 +586,11 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
 
         matrix_size_t features_written;
 
+        ei_feature_ring_bind(ring);
 #if EIDSP_SIGNAL_C_FN_POINTER
         if (block.axes_size != impulse->raw_samples_per_frame) {
             ei_printf("ERR: EIDSP_SIGNAL_C_FN_POINTER can only be used when all axes are selected for DSP blocks\n");
+            ei_feature_ring_bind(nullptr);
             return EI_IMPULSE_DSP_ERROR;
         }
         int ret = extract_fn_slice(signal, &fm, block.config, impulse->frequency, &features_written);
@@ -504,6 +598,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         SignalWithAxes swa(signal, block.axes, block.axes_size, impulse);
         int ret = extract_fn_slice(swa.get_signal(), &fm, block.config, impulse->frequency, &features_written);
 #endif
+        ei_feature_ring_bind(nullptr);
 
         if (ret != EIDSP_OK) {
             ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
@@ -514,7 +609,8 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
             return EI_IMPULSE_CANCELED;
         }
 
-        classifier_continuous_features_written += (features_written.rows * features_written.cols);
+        ring->slice = features_written.rows * features_written.cols;
+        classifier_continuous_features_written += ring->slice;
 
         out_features_index += block.n_output_features;
     }
@@ -552,10 +648,12 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         // iterate over every dsp block and run normalization
         for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
             ei_model_dsp_t block = impulse->dsp_blocks[ix];
+            ei_feature_ring_t *ring = &feature_rings[ix];
             matrix_ptrs[ix] = std::unique_ptr<ei::matrix_t>(new ei::matrix_t(1, block.n_output_features));
-            
+
             if (matrix_ptrs[ix] == nullptr) {
                 ei_printf("ERR: Out of memory, can't allocate matrix_ptrs[%lu]\n", ix);
+                delete[] matrix_ptrs;
                 return EI_IMPULSE_ALLOC_FAILED;
             }
 
@@ -564,23 +662,23 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
                 delete[] matrix_ptrs;
                 return EI_IMPULSE_ALLOC_FAILED;
             }
-        
+
             features[ix].matrix = matrix_ptrs[ix].get();
             features[ix].blockId = block.blockId;
 
-            /* Create a copy of the matrix for normalization */
-            for (size_t m_ix = 0; m_ix < block.n_output_features; m_ix++) {
-                features[ix].matrix->buffer[m_ix] = static_features_matrix.buffer[out_features_index + m_ix];
-            }
-
+            /* Normalized out of place straight from the ring, the window stays intact
+             * for the next slice. Every row is normalized over a window reflected at
+             * the edges of the whole window, so all rows change when a slice is added
+             * and the window sums are taken again on each inference (linear in the
+             * window size). */
             if (block.extract_fn == extract_mfcc_features) {
-                calc_cepstral_mean_and_var_normalization_mfcc(features[ix].matrix, block.config);
+                calc_cepstral_mean_and_var_normalization_mfcc_ring(ring, features[ix].matrix, block.config);
             }
             else if (block.extract_fn == extract_spectrogram_features) {
-                calc_cepstral_mean_and_var_normalization_spectrogram(features[ix].matrix, block.config);
+                calc_cepstral_mean_and_var_normalization_spectrogram_ring(ring, features[ix].matrix, block.config);
             }
             else if (block.extract_fn == extract_mfe_features) {
-                calc_cepstral_mean_and_var_normalization_mfe(features[ix].matrix, block.config);
+                calc_cepstral_mean_and_var_normalization_mfe_ring(ring, features[ix].matrix, block.config);
             }
             out_features_index += block.n_output_features;
         }
@@ -606,6 +704,42 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     return ei_impulse_error;
 }
 
+/**
+ * @brief      Advance the continuous feature windows by one slice without running
+ *             DSP or inference, every DSP block repeats the features of its last
+ *             slice. Lets a caller skip slices (e.g. silent audio) while keeping
+ *             the window warm, so the next processed slice classifies a window of
+ *             recent background instead of stale features. The partial frame the
+ *             slice extractors carry between slices is dropped, the next slice
+ *             starts on a fresh frame.
+ *
+ * @param      handle  struct with information about model and DSP
+ *
+ * @return     The ei impulse error, EI_IMPULSE_OK also if no slice was processed yet
+ */
+extern "C" EI_IMPULSE_ERROR process_impulse_continuous_skip(ei_impulse_handle_t *handle)
+{
+    if ((handle == nullptr) || (handle->impulse == nullptr)) {
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+    auto impulse = handle->impulse;
+    ei_feature_ring_t *feature_rings = get_continuous_feature_rings(impulse);
+    if (!feature_rings) {
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
+        classifier_continuous_features_written += ei_feature_ring_repeat_slice(&feature_rings[ix]);
+    }
+
+    // the audio of this slice is never seen by the slice extractors, so the
+    // overlap they kept from the previous slice must not be joined to the next one
+    ei_dsp_continuous_skip_slice();
+
+    return EI_IMPULSE_OK;
+}
+
 /**
  * Check if the current impulse could be used by 'run_classifier_image_quantized'
  */
@@ -636,8 +770,21 @@ __attribute__((unused)) static EI_IMPULSE_ERROR can_run_classifier_image_quantiz
         return EI_IMPULSE_ONLY_SUPPORTED_FOR_IMAGES;
     }
 
+    if (impulse->dsp_blocks_size != 1) {
+        return EI_IMPULSE_ONLY_SUPPORTED_FOR_IMAGES;
+    }
+
+#if EIDSP_MFE_FIXED_POINT == 1 && EI_CLASSIFIER_QUANTIZATION_ENABLED == 1 && EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE
+    // ...or one MFE block that the fixed-point front end can compute
+    if (impulse->inferencing_engine == EI_CLASSIFIER_TFLITE &&
+        impulse->dsp_blocks[0].extract_fn == extract_mfe_features &&
+        can_extract_mfe_features_quantized(impulse->dsp_blocks[0].config, impulse->frequency)) {
+        return EI_IMPULSE_OK;
+    }
+#endif
+
     // And if we have one DSP block which operates on images...
-    if (impulse->dsp_blocks_size != 1 || impulse->dsp_blocks[0].extract_fn != extract_image_features) {
+    if (impulse->dsp_blocks[0].extract_fn != extract_image_features) {
         return EI_IMPULSE_ONLY_SUPPORTED_FOR_IMAGES;
     }
 
@@ -822,6 +969,7 @@ extern "C" void run_classifier_init(void)
     ei_dsp_clear_continuous_audio_state();
     init_impulse(&ei_default_impulse);
     init_postprocessing(&ei_default_impulse);
+    reserve_dsp_workspaces(ei_default_impulse.impulse);
 }
 
 /**
@@ -844,14 +992,42 @@ __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
     ei_dsp_clear_continuous_audio_state();
     init_impulse(handle);
     init_postprocessing(handle);
+    reserve_dsp_workspaces(handle->impulse);
+}
+
+/**
+ * @brief Working memory of the DSP stage.
+ *
+ * Returns the peak working memory a single DSP block needs while extracting features,
+ * on top of the feature matrix. Useful to size the heap up front. Does not allocate,
+ * `run_classifier_init()` reserves the cached workspaces.
+ *
+ * @return Size in bytes
+ */
+extern "C" size_t run_classifier_dsp_workspace_size(void)
+{
+    return get_dsp_workspace_size(ei_default_impulse.impulse);
+}
+
+/**
+ * @brief Working memory of the DSP stage, see `run_classifier_dsp_workspace_size()`.
+ *
+ * @param[in] handle struct with information about model and DSP
+ *
+ * @return Size in bytes
+ */
+__attribute__((unused)) size_t run_classifier_dsp_workspace_size(ei_impulse_handle_t *handle)
+{
+    return get_dsp_workspace_size(handle->impulse);
 }
 
 /**
  * @brief Deletes static variables when running preprocessing and inference continuously.
  *
  * Deletes internal static variables used by `run_classifier_continuous()`, which
- * includes the moving average filter (MAF). This function should be called when you
- * are done running continuous classification.
+ * includes the moving average filter (MAF), and releases the workspaces the DSP blocks
+ * cache between inferences (FFT workspace, DCT plan). This function should be called
+ * when you are done running continuous classification.
  *
  * **Blocking**: yes
  *
@@ -860,11 +1036,19 @@ __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
 extern "C" void run_classifier_deinit(void)
 {
     deinit_postprocessing(&ei_default_impulse);
+    ei_dsp_free_workspaces();
+#if EI_CLASSIFIER_HAS_ANOMALY
+    ei_kmeans_scorer_deinit();
+#endif
 }
 
 __attribute__((unused)) void run_classifier_deinit(ei_impulse_handle_t *handle)
 {
     deinit_postprocessing(handle);
+    ei_dsp_free_workspaces();
+#if EI_CLASSIFIER_HAS_ANOMALY
+    ei_kmeans_scorer_deinit();
+#endif
 }
 
 /**
@@ -986,6 +1170,32 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_classifier_continuous(
     return process_impulse_continuous(impulse, signal, result, debug);
 }
 
+/**
+ * @brief Skip one slice in continuous mode, see `process_impulse_continuous_skip`.
+ *
+ * Call instead of `run_classifier_continuous()` for a slice that does not need to be
+ * classified, the sliding window advances by repeating the features of the last slice.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_continuous_skip(void)
+{
+    auto& impulse = ei_default_impulse;
+    return process_impulse_continuous_skip(&impulse);
+}
+
+/**
+ * @brief Skip one slice in continuous mode, see `process_impulse_continuous_skip`.
+ *
+ * @param[in] impulse `ei_impulse_handle_t` struct with information about preprocessing and model.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_continuous_skip(ei_impulse_handle_t *impulse)
+{
+    return process_impulse_continuous_skip(impulse);
+}
+
 /**
  * @brief Run the classifier over a raw features array.
  *
@@ -39,6 +39,8 @@
 #include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
 #include "edge-impulse-sdk/classifier/ei_signal_with_range.h"
+#include "edge-impulse-sdk/classifier/ei_feature_ring.h"
+#include "edge-impulse-sdk/classifier/ei_quantize.h"
 #include "edge-impulse-sdk/dsp/ei_flatten.h"
 #include "model-parameters/model_metadata.h"
 
@@ -77,6 +79,17 @@ static float *ei_dsp_cont_current_frame = nullptr;
 static size_t ei_dsp_cont_current_frame_size = 0;
 static int ei_dsp_cont_current_frame_ix = 0;
 
+/**
+ * @brief      Continuous mode: a slice is skipped without running DSP. Drops the
+ *             partial frame carried over from the previous slice, the next slice
+ *             is not contiguous with it anymore and starts a new frame at its
+ *             first sample.
+ */
+__attribute__((unused)) static void ei_dsp_continuous_skip_slice(void)
+{
+    ei_dsp_cont_current_frame_ix = 0;
+}
+
 __attribute__((unused)) int extract_hr_features(
     signal_t *signal,
     matrix_t *output_matrix,
@@ -102,44 +115,66 @@ __attribute__((unused)) int extract_spectral_analysis_features(
 {
     ei_dsp_config_spectral_analysis_t *config = (ei_dsp_config_spectral_analysis_t *)config_ptr;
 
-    // input matrix from the raw signal
-    matrix_t input_matrix(signal->total_length / config->axes, config->axes);
-    if (!input_matrix.buffer) {
-        EIDSP_ERR(EIDSP_OUT_OF_MEM);
-    }
-
-    signal->get_data(0, signal->total_length, input_matrix.buffer);
+#if EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_FFT || EI_DSP_PARAMS_ALL
+    if (strcmp(config->analysis_type, "FFT") == 0 && config->implementation_version != 1) {
+        // deinterleave (and scale) straight into one row per axis, all axes then
+        // share the cached FFT workspace
+        matrix_t axes_matrix(config->axes, signal->total_length / config->axes);
+        if (!axes_matrix.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
 
-#if EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_WAVELET || EI_DSP_PARAMS_ALL
-    if (strcmp(config->analysis_type, "Wavelet") == 0) {
-        return spectral::wavelet::extract_wavelet_features(&input_matrix, output_matrix, config, frequency);
-    }
-#endif
+        EI_TRY(spectral::feature::read_axes(signal, &axes_matrix, config->scale_axes));
 
-#if EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_FFT || EI_DSP_PARAMS_ALL
-    if (strcmp(config->analysis_type, "FFT") == 0) {
-        if (config->implementation_version == 1) {
-            return spectral::feature::extract_spectral_analysis_features_v1(
-                &input_matrix,
-                output_matrix,
-                config,
-                frequency);
-        } else if (config->implementation_version == 4) {
+        if (config->implementation_version == 4) {
             return spectral::feature::extract_spectral_analysis_features_v4(
-                &input_matrix,
+                &axes_matrix,
                 output_matrix,
                 config,
-                frequency);
+                frequency,
+                false);
         } else {
             return spectral::feature::extract_spectral_analysis_features_v2(
-                &input_matrix,
+                &axes_matrix,
                 output_matrix,
                 config,
-                frequency);
+                frequency,
+                false);
         }
     }
 #endif
 
+#if EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_WAVELET || EI_DSP_PARAMS_ALL
+    if (strcmp(config->analysis_type, "Wavelet") == 0) {
+        matrix_t axes_matrix(config->axes, signal->total_length / config->axes);
+        if (!axes_matrix.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        EI_TRY(spectral::feature::read_axes(signal, &axes_matrix, config->scale_axes));
+
+        return spectral::wavelet::extract_wavelet_features(&axes_matrix, output_matrix, config, frequency, false);
+    }
+#endif
+
+    // input matrix from the raw signal
+    matrix_t input_matrix(signal->total_length / config->axes, config->axes);
+    if (!input_matrix.buffer) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+
+    signal->get_data(0, signal->total_length, input_matrix.buffer);
+
+#if EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_FFT || EI_DSP_PARAMS_ALL
+    if (strcmp(config->analysis_type, "FFT") == 0) {
+        return spectral::feature::extract_spectral_analysis_features_v1(
+            &input_matrix,
+            output_matrix,
+            config,
+            frequency);
+    }
+#endif
+
 #if !EI_DSP_PARAMS_GENERATED || EI_DSP_PARAMS_ALL || !(EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_FFT || EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_WAVELET)
     if (config->implementation_version == 1) {
         return spectral::feature::extract_spectral_analysis_features_v1(
@@ -159,6 +194,61 @@ __attribute__((unused)) int extract_spectral_analysis_features(
     return EIDSP_NOT_SUPPORTED;
 }
 
+/**
+ * Peak working memory of a spectral analysis block, does not allocate.
+ * @param config_ptr Block config
+ * @param input_size Number of samples the block receives, all axes
+ * @returns size in bytes, see spectral::feature::get_workspace_size
+ */
+__attribute__((unused)) size_t get_spectral_analysis_workspace_size(void *config_ptr, size_t input_size)
+{
+    ei_dsp_config_spectral_analysis_t *config = (ei_dsp_config_spectral_analysis_t *)config_ptr;
+
+    return spectral::feature::get_workspace_size(config, input_size);
+}
+
+/**
+ * Allocate the cached FFT workspace of a spectral analysis block up front, so
+ * the first inference does not pay for it.
+ * @param config_ptr Block config
+ * @returns false if out of memory
+ */
+__attribute__((unused)) bool reserve_spectral_analysis_workspace(void *config_ptr)
+{
+    ei_dsp_config_spectral_analysis_t *config = (ei_dsp_config_spectral_analysis_t *)config_ptr;
+
+#if EI_DSP_PARAMS_SPECTRAL_ANALYSIS_ANALYSIS_TYPE_FFT || EI_DSP_PARAMS_ALL
+    if (strcmp(config->analysis_type, "FFT") == 0 && config->implementation_version != 1) {
+        return spectral::fft_workspace::get_plan(config->fft_length) != nullptr;
+    }
+#endif
+    (void)config;
+
+    return true;
+}
+
+/**
+ * Allocate the cached FFT workspace of an MFCC, MFE or spectrogram block up front,
+ * so the first inference does not pay for it.
+ * @param fft_length FFT length of the block
+ * @returns false if out of memory
+ */
+__attribute__((unused)) bool reserve_speechpy_workspace(int fft_length)
+{
+    return fft_length <= 0 || spectral::fft_workspace::get_plan(fft_length) != nullptr;
+}
+
+/**
+ * Release the workspaces the DSP blocks cache between inferences (FFT
+ * workspaces, DCT plan, fixed-point MFE plan). They are rebuilt on the next inference.
+ */
+__attribute__((unused)) void ei_dsp_free_workspaces(void)
+{
+    spectral::fft_workspace::free_plan();
+    speechpy::dct_plan::free_plan();
+    speechpy::feature_q15::free_plan();
+}
+
 __attribute__((unused)) int extract_raw_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_raw_t config = *((ei_dsp_config_raw_t*)config_ptr);
 
@@ -267,19 +357,15 @@ __attribute__((unused)) static int extract_mfcc_run_slice(signal_t *signal, matr
             signal->total_length, frequency, config->frame_length, config->frame_stride, config->num_cepstral,
             implementation_version);
 
-    // we roll the output matrix back so we have room at the end...
-    x = numpy::roll(output_matrix->buffer, output_matrix->rows * output_matrix->cols,
-        -(out_matrix_size.rows * out_matrix_size.cols));
+    // we drop the oldest features of the window (or roll the matrix back) so we have room at the end...
+    float *output_slice_buffer;
+    x = ei_feature_ring_advance(output_matrix, out_matrix_size.rows * out_matrix_size.cols, &output_slice_buffer);
     if (x != EIDSP_OK) {
         EIDSP_ERR(x);
     }
 
-    // slice in the output matrix to write to
-    // the offset in the classification matrix here is always at the end
-    size_t output_matrix_offset = (output_matrix->rows * output_matrix->cols) -
-        (out_matrix_size.rows * out_matrix_size.cols);
-
-    matrix_t output_matrix_slice(out_matrix_size.rows, out_matrix_size.cols, output_matrix->buffer + output_matrix_offset);
+    // slice in the output matrix to write to, always the end of the window
+    matrix_t output_matrix_slice(out_matrix_size.rows, out_matrix_size.cols, output_slice_buffer);
 
     // and run the MFCC extraction
     x = speechpy::feature::mfcc(&output_matrix_slice, signal,
@@ -535,9 +621,9 @@ __attribute__((unused)) static int extract_spectrogram_run_slice(signal_t *signa
             signal->total_length, frequency, config->frame_length, config->frame_stride, config->fft_length / 2 + 1,
             config->implementation_version);
 
-    // we roll the output matrix back so we have room at the end...
-    x = numpy::roll(output_matrix->buffer, output_matrix->rows * output_matrix->cols,
-        -(out_matrix_size.rows * out_matrix_size.cols));
+    // we drop the oldest features of the window (or roll the matrix back) so we have room at the end...
+    float *output_slice_buffer;
+    x = ei_feature_ring_advance(output_matrix, out_matrix_size.rows * out_matrix_size.cols, &output_slice_buffer);
     if (x != EIDSP_OK) {
         if (preemphasis) {
             delete preemphasis;
@@ -545,12 +631,8 @@ __attribute__((unused)) static int extract_spectrogram_run_slice(signal_t *signa
         EIDSP_ERR(x);
     }
 
-    // slice in the output matrix to write to
-    // the offset in the classification matrix here is always at the end
-    size_t output_matrix_offset = (output_matrix->rows * output_matrix->cols) -
-        (out_matrix_size.rows * out_matrix_size.cols);
-
-    matrix_t output_matrix_slice(out_matrix_size.rows, out_matrix_size.cols, output_matrix->buffer + output_matrix_offset);
+    // slice in the output matrix to write to, always the end of the window
+    matrix_t output_matrix_slice(out_matrix_size.rows, out_matrix_size.cols, output_slice_buffer);
 
     // and run the spectrogram extraction
     int ret = speechpy::feature::spectrogram(&output_matrix_slice, signal,
@@ -846,19 +928,15 @@ __attribute__((unused)) static int extract_mfe_run_slice(signal_t *signal, matri
             signal->total_length, frequency, config->frame_length, config->frame_stride, config->num_filters,
             config->implementation_version);
 
-    // we roll the output matrix back so we have room at the end...
-    x = numpy::roll(output_matrix->buffer, output_matrix->rows * output_matrix->cols,
-        -(out_matrix_size.rows * out_matrix_size.cols));
+    // we drop the oldest features of the window (or roll the matrix back) so we have room at the end...
+    float *output_slice_buffer;
+    x = ei_feature_ring_advance(output_matrix, out_matrix_size.rows * out_matrix_size.cols, &output_slice_buffer);
     if (x != EIDSP_OK) {
         EIDSP_ERR(x);
     }
 
-    // slice in the output matrix to write to
-    // the offset in the classification matrix here is always at the end
-    size_t output_matrix_offset = (output_matrix->rows * output_matrix->cols) -
-        (out_matrix_size.rows * out_matrix_size.cols);
-
-    matrix_t output_matrix_slice(out_matrix_size.rows, out_matrix_size.cols, output_matrix->buffer + output_matrix_offset);
+    // slice in the output matrix to write to, always the end of the window
+    matrix_t output_matrix_slice(out_matrix_size.rows, out_matrix_size.cols, output_slice_buffer);
 
     // and run the MFE extraction
     // This probably seems incorrect, but the mfe func can actually handle all versions
@@ -1369,6 +1447,78 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
     }
     return EIDSP_OK;
 }
+
+/**
+ * Whether an MFE block can go through extract_mfe_features_quantized: one axis,
+ * implementation version 3 and up, a power of 2 FFT length and every filter inside
+ * the spectrum. Builds the fixed-point plan, so the first inference does not pay for it.
+ */
+__attribute__((unused)) bool can_extract_mfe_features_quantized(void *config_ptr, const float frequency) {
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t*)config_ptr;
+
+    if (config->axes != 1 || config->implementation_version < 3 || config->implementation_version > 4) {
+        return false;
+    }
+    if (config->fft_length <= 0 || config->fft_length > 32768 || config->num_filters <= 0 ||
+        !speechpy::feature_q15::is_supported(config->fft_length, config->noise_floor_db)) {
+        return false;
+    }
+
+    return speechpy::feature_q15::get_plan(config->num_filters, config->fft_length,
+        static_cast<uint32_t>(frequency), config->low_frequency, config->high_frequency,
+        config->implementation_version) != nullptr;
+}
+
+/**
+ * MFE features (implementation version 3 and up) straight into the quantized model
+ * input, see speechpy::feature_q15. Same features as extract_mfe_features quantized
+ * with `scale` and `zero_point`, within one quantization step.
+ * Only valid if can_extract_mfe_features_quantized returns true.
+ */
+__attribute__((unused)) int extract_mfe_features_quantized(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, float zero_point, const float frequency,
+                                                           bool is_signed) {
+    ei_dsp_config_mfe_t config = *((ei_dsp_config_mfe_t*)config_ptr);
+
+    if (signal->total_length == 0) {
+        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+    }
+
+    const uint32_t sampling_frequency = static_cast<uint32_t>(frequency);
+
+    matrix_size_t out_matrix_size =
+        speechpy::feature::calculate_mfe_buffer_size(
+            signal->total_length, sampling_frequency, config.frame_length, config.frame_stride, config.num_filters,
+            config.implementation_version);
+    if (out_matrix_size.rows * out_matrix_size.cols > output_matrix->rows * output_matrix->cols) {
+        ei_printf("out_matrix = %dx%d\n", (int)output_matrix->rows, (int)output_matrix->cols);
+        ei_printf("calculated size = %dx%d\n", (int)out_matrix_size.rows, (int)out_matrix_size.cols);
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+
+    // model input of every normalized value mfe_normalization can give (n / 256)
+    int8_t quantize_table[257];
+    for (size_t ix = 0; ix <= 256; ix++) {
+        quantize_table[ix] = static_cast<int8_t>(pre_cast_quantize(static_cast<float>(ix) / 256.0f,
+            scale, static_cast<int32_t>(zero_point), is_signed));
+    }
+
+    output_matrix->rows = out_matrix_size.rows;
+    output_matrix->cols = out_matrix_size.cols;
+
+    int ret = speechpy::feature_q15::mfe(output_matrix, signal,
+        sampling_frequency, config.frame_length, config.frame_stride, config.num_filters, config.fft_length,
+        config.low_frequency, config.high_frequency, config.implementation_version, config.noise_floor_db,
+        quantize_table);
+    if (ret != EIDSP_OK) {
+        ei_printf("ERR: MFE failed (%d)\n", ret);
+        EIDSP_ERR(ret);
+    }
+
+    output_matrix->cols = out_matrix_size.rows * out_matrix_size.cols;
+    output_matrix->rows = 1;
+
+    return EIDSP_OK;
+}
 #endif // (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1) && (EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_DRPAI)
 
 /**
@@ -1489,6 +1639,100 @@ __attribute__((unused)) void calc_cepstral_mean_and_var_normalization_spectrogra
     matrix->cols = (original_matrix_size);
 }
 
+/**
+ * @brief      Windowed CMVN of a continuous feature window, written out of place.
+ *             Same output as copying the window in order and running cmvnw on the
+ *             copy. Falls back to that when the ring is not row aligned.
+ *
+ * @param      ring    Feature window of the block, rows x cols values
+ * @param      matrix  Destination, as many values as the window
+ */
+static int cmvnw_feature_ring(const ei_feature_ring_t *ring, ei_matrix *matrix, uint32_t cols,
+    uint16_t win_size, bool variance_normalization, bool scale)
+{
+    uint32_t original_matrix_size = matrix->rows * matrix->cols;
+
+    /* Modify rows and colums ration for matrix normalization */
+    matrix->rows = original_matrix_size / cols;
+    matrix->cols = cols;
+
+    int ret;
+    if (ring->head % cols == 0) {
+        ret = speechpy::processing::cmvnw_ring(ring->buffer, ring->head / cols, matrix,
+            win_size, variance_normalization, scale);
+    }
+    else {
+        ei_feature_ring_copy(ring, matrix->buffer);
+        ret = speechpy::processing::cmvnw(matrix, win_size, variance_normalization, scale);
+    }
+
+    /* Reset rows and columns ratio */
+    matrix->rows = 1;
+    matrix->cols = original_matrix_size;
+
+    return ret;
+}
+
+/**
+ * @brief      Calculates the cepstral mean and variable normalization of the
+ *             continuous window of an MFCC block, see
+ *             calc_cepstral_mean_and_var_normalization_mfcc.
+ *
+ * @param      ring        Feature window of the block
+ * @param      matrix      Destination matrix, as many values as the window
+ * @param      config_ptr  ei_dsp_config_mfcc_t struct pointer
+ */
+__attribute__((unused)) void calc_cepstral_mean_and_var_normalization_mfcc_ring(const ei_feature_ring_t *ring, ei_matrix *matrix, void *config_ptr)
+{
+    ei_dsp_config_mfcc_t *config = (ei_dsp_config_mfcc_t *)config_ptr;
+
+    int ret = cmvnw_feature_ring(ring, matrix, config->num_cepstral, config->win_size, true, false);
+    if (ret != EIDSP_OK) {
+        ei_printf("ERR: cmvnw failed (%d)\n", ret);
+    }
+}
+
+/**
+ * @brief      Calculates the cepstral mean and variable normalization of the
+ *             continuous window of an MFE block, see
+ *             calc_cepstral_mean_and_var_normalization_mfe.
+ *
+ * @param      ring        Feature window of the block
+ * @param      matrix      Destination matrix, as many values as the window
+ * @param      config_ptr  ei_dsp_config_mfe_t struct pointer
+ */
+__attribute__((unused)) void calc_cepstral_mean_and_var_normalization_mfe_ring(const ei_feature_ring_t *ring, ei_matrix *matrix, void *config_ptr)
+{
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t *)config_ptr;
+
+    if (config->implementation_version < 3) {
+        int ret = cmvnw_feature_ring(ring, matrix, config->num_filters, config->win_size, false, true);
+        if (ret != EIDSP_OK) {
+            ei_printf("ERR: cmvnw failed (%d)\n", ret);
+        }
+    }
+    else {
+        // element wise, normalized in place on a copy
+        ei_feature_ring_copy(ring, matrix->buffer);
+        calc_cepstral_mean_and_var_normalization_mfe(matrix, config_ptr);
+    }
+}
+
+/**
+ * @brief      Calculates the normalization of the continuous window of a
+ *             spectrogram block on a copy, see
+ *             calc_cepstral_mean_and_var_normalization_spectrogram.
+ *
+ * @param      ring        Feature window of the block
+ * @param      matrix      Destination matrix, as many values as the window
+ * @param      config_ptr  ei_dsp_config_spectrogram_t struct pointer
+ */
+__attribute__((unused)) void calc_cepstral_mean_and_var_normalization_spectrogram_ring(const ei_feature_ring_t *ring, ei_matrix *matrix, void *config_ptr)
+{
+    ei_feature_ring_copy(ring, matrix->buffer);
+    calc_cepstral_mean_and_var_normalization_spectrogram(matrix, config_ptr);
+}
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -0,0 +1,333 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _EI_CLASSIFIER_VISUAL_AD_GRID_H_
+#define _EI_CLASSIFIER_VISUAL_AD_GRID_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/**
+ * When set to 1, neighbouring anomalous grid cells are merged into a single
+ * bounding box (4-connectivity) instead of reporting one box per cell.
+ */
+#ifndef EI_CLASSIFIER_VISUAL_AD_MERGE_REGIONS
+#define EI_CLASSIFIER_VISUAL_AD_MERGE_REGIONS 0
+#endif
+
+/**
+ * A horizontal run of anomalous cells in one grid row, used as the unit for
+ * the run-length connected components labelling.
+ */
+typedef struct {
+    uint16_t row;
+    uint16_t start; // first column of the run
+    uint16_t end;   // one past the last column of the run
+    uint32_t parent;
+    uint32_t box;   // output box index, valid for root runs only
+    float max_value;
+} ei_visual_ad_run_t;
+
+/**
+ * Visual anomaly grid state. All buffers are allocated once from the grid
+ * dimensions by `ei_visual_ad_grid_reserve()` and reused for every frame.
+ */
+typedef struct {
+    uint16_t grid_size_x;
+    uint16_t grid_size_y;
+    uint32_t box_capacity;
+
+    /* output of ei_visual_ad_grid_reduce() */
+    float mean_value;
+    float max_value;
+    uint32_t anomalous_count;
+    uint32_t *bitmap; // one bit per cell, row-major
+
+    /* scratch for region merging (one run per anomalous cell worst case) */
+    ei_visual_ad_run_t *runs;
+    uint32_t run_count;
+
+    ei_impulse_result_bounding_box_t *boxes;
+} ei_visual_ad_grid_t;
+
+static inline uint32_t ei_visual_ad_grid_bitmap_words(uint32_t cells) {
+    return (cells + 31) / 32;
+}
+
+static inline bool ei_visual_ad_grid_is_set(const ei_visual_ad_grid_t *grid, uint32_t cell) {
+    return (grid->bitmap[cell >> 5] >> (cell & 31)) & 1;
+}
+
+__attribute__((unused)) static void ei_visual_ad_grid_free(ei_visual_ad_grid_t *grid) {
+    ei_free(grid->bitmap);
+    ei_free(grid->runs);
+    ei_free(grid->boxes);
+    memset(grid, 0, sizeof(ei_visual_ad_grid_t));
+}
+
+/**
+ * @brief      Allocate the grid buffers, if not done already for this grid size
+ *
+ * @param      grid         Grid state
+ * @param[in]  grid_size_x  Number of cells per row
+ * @param[in]  grid_size_y  Number of rows
+ * @param[in]  min_boxes    Minimum number of output boxes (object_detection_count)
+ *
+ * @return     false if allocation failed
+ */
+__attribute__((unused)) static bool ei_visual_ad_grid_reserve(ei_visual_ad_grid_t *grid,
+                                                              uint16_t grid_size_x,
+                                                              uint16_t grid_size_y,
+                                                              uint32_t min_boxes) {
+    const uint32_t cells = (uint32_t)grid_size_x * grid_size_y;
+    const uint32_t box_capacity = cells > min_boxes ? cells : min_boxes;
+
+    if (grid->bitmap && grid->grid_size_x == grid_size_x && grid->grid_size_y == grid_size_y
+        && grid->box_capacity == box_capacity) {
+        return true;
+    }
+
+    ei_visual_ad_grid_free(grid);
+
+    grid->bitmap = (uint32_t *)ei_calloc(ei_visual_ad_grid_bitmap_words(cells), sizeof(uint32_t));
+    grid->runs = (ei_visual_ad_run_t *)ei_calloc(cells, sizeof(ei_visual_ad_run_t));
+    grid->boxes = (ei_impulse_result_bounding_box_t *)ei_calloc(box_capacity, sizeof(ei_impulse_result_bounding_box_t));
+
+    if (!grid->bitmap || !grid->runs || !grid->boxes) {
+        ei_visual_ad_grid_free(grid);
+        return false;
+    }
+
+    grid->grid_size_x = grid_size_x;
+    grid->grid_size_y = grid_size_y;
+    grid->box_capacity = box_capacity;
+    return true;
+}
+
+/**
+ * @brief      Single pass over the anomaly grid: computes mean and max and
+ *             marks every cell at or above the threshold in the bitmap
+ *
+ * @param      grid       Grid state (must be reserved)
+ * @param[in]  data       Row-major grid scores, grid_size_x * grid_size_y values
+ * @param[in]  threshold  Anomaly threshold
+ */
+__attribute__((unused)) static void ei_visual_ad_grid_reduce(ei_visual_ad_grid_t *grid,
+                                                             const float *data,
+                                                             float threshold) {
+    const uint32_t cells = (uint32_t)grid->grid_size_x * grid->grid_size_y;
+    float max_val = 0;
+    float sum_val = 0;
+    uint32_t anomalous = 0;
+
+    for (uint32_t w = 0; w < ei_visual_ad_grid_bitmap_words(cells); w++) {
+        const uint32_t base = w << 5;
+        const uint32_t end = (base + 32) < cells ? (base + 32) : cells;
+        uint32_t word = 0;
+
+        for (uint32_t ix = base; ix < end; ix++) {
+            const float value = data[ix];
+            sum_val += value;
+            if (value > max_val) {
+                max_val = value;
+            }
+            if (value >= threshold) {
+                word |= (1u << (ix - base));
+                anomalous++;
+            }
+        }
+        grid->bitmap[w] = word;
+    }
+
+    grid->mean_value = cells > 0 ? sum_val / cells : 0.0f;
+    grid->max_value = max_val;
+    grid->anomalous_count = anomalous;
+}
+
+/**
+ * @brief      Emit one bounding box per anomalous cell, in row-major order
+ *
+ * @return     Number of boxes written to grid->boxes
+ */
+__attribute__((unused)) static uint32_t ei_visual_ad_grid_cells_to_boxes(ei_visual_ad_grid_t *grid,
+                                                                         const float *data,
+                                                                         uint32_t input_width,
+                                                                         uint32_t input_height) {
+    const uint32_t gx = grid->grid_size_x;
+    const uint32_t gy = grid->grid_size_y;
+    const uint32_t cell_width = input_width / gx;
+    const uint32_t cell_height = input_height / gy;
+    const uint32_t cells = gx * gy;
+    uint32_t count = 0;
+
+    for (uint32_t w = 0; w < ei_visual_ad_grid_bitmap_words(cells); w++) {
+        uint32_t word = grid->bitmap[w];
+        while (word) {
+            const uint32_t bit = __builtin_ctz(word);
+            word &= word - 1;
+
+            const uint32_t cell = (w << 5) + bit;
+            const uint32_t row = cell / gx;
+            const uint32_t col = cell - row * gx;
+
+            ei_impulse_result_bounding_box_t *bb = &grid->boxes[count++];
+            bb->label = "anomaly";
+            bb->x = (col * input_width) / gx;
+            bb->y = (row * input_height) / gy;
+            bb->width = cell_width;
+            bb->height = cell_height;
+            bb->value = data[cell];
+        }
+    }
+
+    return count;
+}
+
+static inline uint32_t ei_visual_ad_run_find(ei_visual_ad_run_t *runs, uint32_t ix) {
+    while (runs[ix].parent != ix) {
+        runs[ix].parent = runs[runs[ix].parent].parent;
+        ix = runs[ix].parent;
+    }
+    return ix;
+}
+
+/**
+ * @brief      Merge 4-connected anomalous cells into regions and emit one
+ *             bounding box per region (score = max cell score in the region)
+ *
+ * Rows are scanned as runs of set bits; runs overlapping a run of the
+ * previous row are joined with a union-find, so the cost is proportional to
+ * the number of runs rather than the number of cells.
+ *
+ * @return     Number of boxes written to grid->boxes
+ */
+__attribute__((unused)) static uint32_t ei_visual_ad_grid_regions_to_boxes(ei_visual_ad_grid_t *grid,
+                                                                           const float *data,
+                                                                           uint32_t input_width,
+                                                                           uint32_t input_height) {
+    const uint32_t gx = grid->grid_size_x;
+    const uint32_t gy = grid->grid_size_y;
+    ei_visual_ad_run_t *runs = grid->runs;
+    uint32_t run_count = 0;
+    uint32_t prev_row_first = 0;
+    uint32_t prev_row_end = 0;
+
+    for (uint32_t row = 0; row < gy; row++) {
+        const uint32_t row_first = run_count;
+        uint32_t col = 0;
+
+        while (col < gx) {
+            if (!ei_visual_ad_grid_is_set(grid, row * gx + col)) {
+                col++;
+                continue;
+            }
+
+            ei_visual_ad_run_t *run = &runs[run_count];
+            run->row = row;
+            run->start = col;
+            run->parent = run_count;
+            run->max_value = 0;
+            while (col < gx && ei_visual_ad_grid_is_set(grid, row * gx + col)) {
+                if (data[row * gx + col] > run->max_value) {
+                    run->max_value = data[row * gx + col];
+                }
+                col++;
+            }
+            run->end = col;
+
+            // join with every overlapping run of the previous row
+            for (uint32_t p = prev_row_first; p < prev_row_end; p++) {
+                if (runs[p].start < run->end && run->start < runs[p].end) {
+                    uint32_t a = ei_visual_ad_run_find(runs, p);
+                    uint32_t b = ei_visual_ad_run_find(runs, run_count);
+                    if (a != b) {
+                        // keep the earliest run as root so output order is stable
+                        if (a < b) runs[b].parent = a;
+                        else runs[a].parent = b;
+                    }
+                }
+            }
+            run_count++;
+        }
+
+        prev_row_first = row_first;
+        prev_row_end = run_count;
+    }
+    grid->run_count = run_count;
+
+    // a root always has the lowest index of its set, so it is visited before
+    // any of its children; accumulate every run into its root's box
+    uint32_t count = 0;
+    for (uint32_t ix = 0; ix < run_count; ix++) {
+        const uint32_t root = ei_visual_ad_run_find(runs, ix);
+        if (root == ix) {
+            // temporarily store the cell extent (in grid units) in the box
+            ei_impulse_result_bounding_box_t *bb = &grid->boxes[count];
+            bb->label = "anomaly";
+            bb->x = runs[ix].start;
+            bb->y = runs[ix].row;
+            bb->width = runs[ix].end;
+            bb->height = runs[ix].row + 1;
+            bb->value = runs[ix].max_value;
+            runs[ix].box = count++;
+            continue;
+        }
+
+        ei_impulse_result_bounding_box_t *bb = &grid->boxes[runs[root].box];
+        if (runs[ix].start < bb->x) bb->x = runs[ix].start;
+        if (runs[ix].end > bb->width) bb->width = runs[ix].end;
+        if ((uint32_t)runs[ix].row + 1 > bb->height) bb->height = runs[ix].row + 1;
+        if (runs[ix].max_value > bb->value) bb->value = runs[ix].max_value;
+    }
+
+    // convert cell extents into pixel coordinates
+    for (uint32_t ix = 0; ix < count; ix++) {
+        ei_impulse_result_bounding_box_t *bb = &grid->boxes[ix];
+        const uint32_t x0 = (bb->x * input_width) / gx;
+        const uint32_t y0 = (bb->y * input_height) / gy;
+        const uint32_t x1 = (bb->width * input_width) / gx;
+        const uint32_t y1 = (bb->height * input_height) / gy;
+        bb->x = x0;
+        bb->y = y0;
+        bb->width = x1 - x0;
+        bb->height = y1 - y0;
+    }
+
+    return count;
+}
+
+#endif // _EI_CLASSIFIER_VISUAL_AD_GRID_H_
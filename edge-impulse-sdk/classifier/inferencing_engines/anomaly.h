@@ -42,6 +42,8 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
+#include <limits>
 
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/classifier/ei_aligned_malloc.h"
@@ -49,62 +51,253 @@
 #include "edge-impulse-sdk/classifier/inferencing_engines/engines.h"
 #include "edge-impulse-sdk/classifier/ei_fill_result_struct.h"
 
+/**
+ * Score k-means anomaly with int8 centers and inputs, trades a small
+ * quantization error on the score for 4x less center memory
+ */
+#ifndef EI_CLASSIFIER_ANOMALY_KMEANS_INT8
+#define EI_CLASSIFIER_ANOMALY_KMEANS_INT8 0
+#endif
+
 #ifdef __cplusplus
 namespace {
 #endif // __cplusplus
 
 /**
- * Standard scaler, scales all values in the input vector
- * Note that this *modifies* the array in place!
- * @param input Array of input values
- * @param scale Array of scale values (obtain from StandardScaler in Python)
- * @param mean Array of mean values (obtain from StandardScaler in Python)
- * @param input_size Size of input, scale and mean arrays
+ * K-means scorer state, built once per anomaly block from the compiled
+ * clusters. The float scorer reads the compiled centers in place, the int8
+ * scorer keeps one quantized row of input_size values per cluster. Max errors
+ * are kept in a separate array.
+ * The scaler is folded into a single multiply-add per input value:
+ * (x - mean) / scale == x * inv_scale + offset
+ * The scorer is released by run_classifier_deinit()
+ */
+typedef struct {
+    const void *config;
+    size_t input_size;
+    size_t cluster_count;
+    float *inv_scale;
+    float *offset;
+    float *input;
+    float *max_error;
+#if EI_CLASSIFIER_ANOMALY_KMEANS_INT8 == 1
+    int8_t *centers;
+    int8_t *input_q;
+    float q_scale;
+#else
+    const ei_classifier_anom_cluster_t *clusters;
+#endif
+} ei_kmeans_scorer_t;
+
+ei_kmeans_scorer_t kmeans_scorer = { 0 };
+
+void kmeans_scorer_free(ei_kmeans_scorer_t *scorer) {
+    ei_free(scorer->inv_scale);
+    ei_free(scorer->offset);
+    ei_free(scorer->input);
+    ei_free(scorer->max_error);
+#if EI_CLASSIFIER_ANOMALY_KMEANS_INT8 == 1
+    ei_free(scorer->centers);
+    ei_free(scorer->input_q);
+#endif
+    memset(scorer, 0, sizeof(ei_kmeans_scorer_t));
+}
+
+/**
+ * Build (or reuse) the scorer for a k-means block
+ * @param scorer Scorer state
+ * @param block_config K-means block configuration
+ * @return EI_IMPULSE_OK if successful, EI_IMPULSE_OUT_OF_MEMORY otherwise
  */
-void standard_scaler(float *input, const float *scale, const float *mean, size_t input_size) {
+EI_IMPULSE_ERROR kmeans_scorer_init(ei_kmeans_scorer_t *scorer, const ei_learning_block_config_anomaly_kmeans_t *block_config) {
+    if (scorer->config == block_config &&
+        scorer->input_size == block_config->anom_axes_size &&
+        scorer->cluster_count == block_config->anom_cluster_count) {
+        return EI_IMPULSE_OK;
+    }
+    kmeans_scorer_free(scorer);
+
+    const size_t input_size = block_config->anom_axes_size;
+    const size_t cluster_count = block_config->anom_cluster_count;
+
+    scorer->inv_scale = (float*)ei_malloc(input_size * sizeof(float));
+    scorer->offset = (float*)ei_malloc(input_size * sizeof(float));
+    scorer->input = (float*)ei_malloc(input_size * sizeof(float));
+    scorer->max_error = (float*)ei_malloc(cluster_count * sizeof(float));
+#if EI_CLASSIFIER_ANOMALY_KMEANS_INT8 == 1
+    scorer->centers = (int8_t*)ei_malloc(cluster_count * input_size * sizeof(int8_t));
+    scorer->input_q = (int8_t*)ei_malloc(input_size * sizeof(int8_t));
+    if (!scorer->centers || !scorer->input_q) {
+        kmeans_scorer_free(scorer);
+        return EI_IMPULSE_OUT_OF_MEMORY;
+    }
+#endif
+    if (!scorer->inv_scale || !scorer->offset || !scorer->input || !scorer->max_error) {
+        kmeans_scorer_free(scorer);
+        return EI_IMPULSE_OUT_OF_MEMORY;
+    }
+
     for (size_t ix = 0; ix < input_size; ix++) {
-        input[ix] = (input[ix] - mean[ix]) / scale[ix];
+        scorer->inv_scale[ix] = 1.0f / block_config->anom_scale[ix];
+        scorer->offset[ix] = -block_config->anom_mean[ix] * scorer->inv_scale[ix];
+    }
+
+#if EI_CLASSIFIER_ANOMALY_KMEANS_INT8 == 1
+    // symmetric per-model scale, chosen so all centers fit in int8
+    float max_abs = 0.0f;
+    for (size_t c = 0; c < cluster_count; c++) {
+        for (size_t ix = 0; ix < input_size; ix++) {
+            float v = fabsf(block_config->anom_clusters[c].centroid[ix]);
+            max_abs = v > max_abs ? v : max_abs;
+        }
+    }
+    scorer->q_scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+    for (size_t c = 0; c < cluster_count; c++) {
+        for (size_t ix = 0; ix < input_size; ix++) {
+            scorer->centers[c * input_size + ix] =
+                (int8_t)lroundf(block_config->anom_clusters[c].centroid[ix] / scorer->q_scale);
+        }
     }
+#else
+    scorer->clusters = block_config->anom_clusters;
+#endif
+    for (size_t c = 0; c < cluster_count; c++) {
+        scorer->max_error[c] = block_config->anom_clusters[c].max_error;
+    }
+
+    scorer->input_size = input_size;
+    scorer->cluster_count = cluster_count;
+    scorer->config = block_config;
+
+    return EI_IMPULSE_OK;
 }
 
 /**
- * Calculate the distance between input vector and the cluster
- * @param input Array of input values (already scaled by standard_scaler)
- * @param input_size Size of the input array
- * @param cluster A cluster (number of centroids should match input_size)
+ * Squared distance between input and center, abandoned as soon as the
+ * partial sum reaches limit
+ * @return false if the cluster was abandoned
  */
-float calculate_cluster_distance(float *input, size_t input_size, const ei_classifier_anom_cluster_t *cluster) {
-    // todo: check input_size and centroid size?
+template<typename TI, typename TC, typename TA>
+bool kmeans_partial_distance(const TI *input, const TC *center, size_t input_size, TA limit, TA *out) {
+    TA dist = 0;
+    size_t ix = 0;
+    while (ix < input_size) {
+        // check the bound every 8 values to keep the inner loop branch free
+        const size_t block_end = (ix + 8) < input_size ? (ix + 8) : input_size;
+        for (; ix < block_end; ix++) {
+            TA diff = (TA)input[ix] - (TA)center[ix];
+            dist += diff * diff;
+        }
+        if (dist >= limit) {
+            return false;
+        }
+    }
+    *out = dist;
+    return true;
+}
 
-    float dist = 0.0f;
-    for (size_t ix = 0; ix < input_size; ix++) {
-        dist += pow(input[ix] - cluster->centroid[ix], 2);
+/**
+ * Minimum over all clusters of (distance - max error), distances are in
+ * units of sqrt(unit_sq). center(c) returns the row of cluster c
+ */
+template<typename TI, typename TC, typename TA, typename CenterFn>
+float kmeans_min_distance(
+    const TI *input,
+    CenterFn center,
+    const float *max_error,
+    size_t cluster_count,
+    size_t input_size,
+    float unit_sq)
+{
+    float best = 1000.0f;
+
+    for (size_t c = 0; c < cluster_count; c++) {
+        // sqrt(dist) - max_error < best  <=>  dist < (best + max_error)^2
+        const float bound = best + max_error[c];
+        if (bound <= 0.0f) {
+            continue;
+        }
+        const float limit_f = (bound * bound) / unit_sq;
+        TA limit;
+        if (std::numeric_limits<TA>::is_integer) {
+            limit = limit_f >= (float)std::numeric_limits<TA>::max() ?
+                std::numeric_limits<TA>::max() : (TA)limit_f + 1;
+        }
+        else {
+            limit = (TA)limit_f;
+        }
+
+        TA dist;
+        if (!kmeans_partial_distance<TI, TC, TA>(input, center(c), input_size, limit, &dist)) {
+            continue;
+        }
+
+        float score = sqrtf((float)dist * unit_sq) - max_error[c];
+        if (score < best) {
+            best = score;
+        }
     }
-    return sqrt(dist) - cluster->max_error;
+
+    return best;
 }
 
 /**
- * Get minimum distance to a cluster
- * @param input Array of input values (already scaled by standard_scaler)
- * @param input_size Size of the input array
- * @param clusters Array of clusters
- * @param cluster_size Size of cluster array
+ * Get minimum distance to a cluster (distance minus the cluster's max error).
+ * Distances are compared squared, a cluster is abandoned as soon as its
+ * partial sum cannot beat the best score found so far.
+ * @param scorer Initialized scorer state
+ * @param raw_input Array of input values (not scaled), input_size long
  */
-float get_min_distance_to_cluster(float *input, size_t input_size, const ei_classifier_anom_cluster_t *clusters, size_t cluster_size) {
-    float min = 1000.0f;
-    for (size_t ix = 0; ix < cluster_size; ix++) {
-        float dist = calculate_cluster_distance(input, input_size, &clusters[ix]);
-        if (dist < min) {
-            min = dist;
+float kmeans_scorer_min_distance(ei_kmeans_scorer_t *scorer, const float *raw_input) {
+    const size_t input_size = scorer->input_size;
+    float *input = scorer->input;
+
+#if EI_CLASSIFIER_ANOMALY_KMEANS_INT8 == 1
+    const int8_t *centers = scorer->centers;
+    auto center = [centers, input_size](size_t c) { return &centers[c * input_size]; };
+    const float inv_q = 1.0f / scorer->q_scale;
+    bool saturated = false;
+    for (size_t ix = 0; ix < input_size; ix++) {
+        input[ix] = (raw_input[ix] * scorer->inv_scale[ix] + scorer->offset[ix]) * inv_q;
+        if (input[ix] > 127.0f || input[ix] < -127.0f) {
+            saturated = true;
         }
+        scorer->input_q[ix] = (int8_t)lroundf(input[ix]);
+    }
+
+    // an input outside the centers' range would be clipped and its distance
+    // underestimated, score it in float against the quantized centers instead
+    if (saturated) {
+        return kmeans_min_distance<float, int8_t, float>(
+            input, center, scorer->max_error, scorer->cluster_count, input_size,
+            scorer->q_scale * scorer->q_scale);
+    }
+    return kmeans_min_distance<int8_t, int8_t, int32_t>(
+        scorer->input_q, center, scorer->max_error, scorer->cluster_count, input_size,
+        scorer->q_scale * scorer->q_scale);
+#else
+    for (size_t ix = 0; ix < input_size; ix++) {
+        input[ix] = raw_input[ix] * scorer->inv_scale[ix] + scorer->offset[ix];
     }
-    return min;
+
+    const ei_classifier_anom_cluster_t *clusters = scorer->clusters;
+    auto center = [clusters](size_t c) { return (const float *)clusters[c].centroid; };
+    return kmeans_min_distance<float, float, float>(
+        input, center, scorer->max_error, scorer->cluster_count, input_size, 1.0f);
+#endif
 }
 
 #ifdef __cplusplus
 }
 #endif // __cplusplus
 
+/**
+ * Release the k-means scorer, it is built again on the next run_kmeans_anomaly()
+ */
+void ei_kmeans_scorer_deinit(void) {
+    kmeans_scorer_free(&kmeans_scorer);
+}
+
 
 /**
  * Extracts the input values from the feature matrix based on the anomaly axes.
@@ -182,17 +375,20 @@ EI_IMPULSE_ERROR run_kmeans_anomaly(
 
     uint64_t anomaly_start_us = ei_read_timer_us();
 
-    float *input = (float*)ei_malloc(block_config->anom_axes_size * sizeof(float));
-    if (!input) {
-        ei_printf("Failed to allocate memory for anomaly input buffer");
+    ei_kmeans_scorer_t &scorer = kmeans_scorer;
+    if (kmeans_scorer_init(&scorer, block_config) != EI_IMPULSE_OK) {
+        ei_printf("Failed to allocate memory for anomaly scorer");
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
 
-    extract_anomaly_input_values(fmatrix, input_block_ids, input_block_ids_size, block_config->anom_axes_size, block_config->anom_axis, input);
+    // the scorer scales the raw values in place
+    float *input = scorer.input;
+    EI_IMPULSE_ERROR res = extract_anomaly_input_values(fmatrix, input_block_ids, input_block_ids_size, block_config->anom_axes_size, block_config->anom_axis, input);
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
 
-    standard_scaler(input, block_config->anom_scale, block_config->anom_mean, block_config->anom_axes_size);
-    float anomaly = get_min_distance_to_cluster(
-        input, block_config->anom_axes_size, block_config->anom_clusters, block_config->anom_cluster_count);
+    float anomaly = kmeans_scorer_min_distance(&scorer, input);
 
     uint64_t anomaly_end_us = ei_read_timer_us();
 
@@ -205,7 +401,6 @@ EI_IMPULSE_ERROR run_kmeans_anomaly(
     result->timing.anomaly_us = anomaly_end_us - anomaly_start_us;
     result->timing.anomaly = (int)(result->timing.anomaly_us/1000);
     result->anomaly = anomaly;
-    ei_free(input);
 
     return EI_IMPULSE_OK;
 }
@@ -332,9 +332,20 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     // features matrix maps around the input tensor to not allocate any memory
     ei::matrix_i8_t features_matrix(1, impulse->nn_input_frame_size, input.data.int8);
 
-    // run DSP process and quantize automatically
-    int ret = extract_image_features_quantized(signal, &features_matrix, impulse->dsp_blocks[0].config, input.params.scale, input.params.zero_point,
-        impulse->frequency, impulse->learning_blocks[0].image_scaling);
+    int ret;
+#if EIDSP_MFE_FIXED_POINT == 1
+    if (impulse->dsp_blocks[0].extract_fn == extract_mfe_features) {
+        // audio, the fixed-point MFE front end writes the quantized input
+        ret = extract_mfe_features_quantized(signal, &features_matrix, impulse->dsp_blocks[0].config, input.params.scale, input.params.zero_point,
+            impulse->frequency, input.type == TfLiteType::kTfLiteInt8);
+    }
+    else
+#endif
+    {
+        // run DSP process and quantize automatically
+        ret = extract_image_features_quantized(signal, &features_matrix, impulse->dsp_blocks[0].config, input.params.scale, input.params.zero_point,
+            impulse->frequency, impulse->learning_blocks[0].image_scaling);
+    }
 
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
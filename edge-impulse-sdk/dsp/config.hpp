@@ -87,6 +87,19 @@
 #define EIDSP_QUANTIZE_FILTERBANK    1
 #endif // EIDSP_QUANTIZE_FILTERBANK
 
+// Quantized audio models with an MFE block (implementation version 3 and up) compute
+// the int8 model input straight from the audio with the Q15 front end in
+// speechpy/feature_q15.hpp, instead of float features quantized afterwards
+#ifndef EIDSP_MFE_FIXED_POINT
+#define EIDSP_MFE_FIXED_POINT        0
+#endif // EIDSP_MFE_FIXED_POINT
+
+// Number of FFT lengths whose workspace (spectral/fft_workspace.hpp) stays allocated
+// between blocks and inferences, an impulse with more distinct lengths reallocates
+#ifndef EIDSP_FFT_WORKSPACE_CACHE_SIZE
+#define EIDSP_FFT_WORKSPACE_CACHE_SIZE 4
+#endif // EIDSP_FFT_WORKSPACE_CACHE_SIZE
+
 // prints buffer allocations to stdout, useful when debugging
 #ifndef EIDSP_TRACK_ALLOCATIONS
 #define EIDSP_TRACK_ALLOCATIONS      0
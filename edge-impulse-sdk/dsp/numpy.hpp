@@ -1372,6 +1372,43 @@ public:
         return EIDSP_OK;
     }
 
+    /**
+     * Same as `rfft` above, but all scratch memory is provided by the caller so
+     * nothing is allocated per call. Meant for callers that run many FFTs of the
+     * same length (e.g. every frame of every axis).
+     * @param src Source buffer
+     * @param src_size Size of the source buffer, zero padded or truncated to n_fft
+     * @param output Output buffer, n_fft / 2 + 1 entries
+     * @param n_fft FFT length
+     * @param fft_input Scratch buffer of n_fft entries, must not overlap src
+     * @param cfg kissfft plan for n_fft, only used when there is no HW FFT.
+     *  If nullptr a temporary plan is created.
+     * @returns 0 if OK
+     */
+    static int rfft(const float *src, size_t src_size, fft_complex_t *output, size_t n_fft,
+        float *fft_input, kiss_fftr_cfg cfg)
+    {
+        if (src_size > n_fft) {
+            src_size = n_fft;
+        }
+
+        memcpy(fft_input, src, src_size * sizeof(float));
+        memset(fft_input + src_size, 0, (n_fft - src_size) * sizeof(float));
+
+        auto res = ei::fft::hw_r2c_fft(fft_input, output, n_fft);
+        if (handle_fft_hw_failure(res, n_fft)) {
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+            if (cfg) {
+                kiss_fftr(cfg, fft_input, (kiss_fft_cpx*)output);
+                return EIDSP_OK;
+            }
+#endif
+            return software_rfft(fft_input, output, n_fft, (n_fft / 2) + 1);
+        }
+
+        return EIDSP_OK;
+    }
+
 
     /**
      * Return evenly spaced numbers over a specified interval.
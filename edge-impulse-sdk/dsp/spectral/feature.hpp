@@ -35,6 +35,7 @@
 #include "processing.hpp"
 #include "wavelet.hpp"
 #include "signal.hpp"
+#include "fft_workspace.hpp"
 #include "edge-impulse-sdk/dsp/ei_utils.h"
 #include "model-parameters/model_metadata.h"
 
@@ -333,6 +334,74 @@ public:
         }
     }
 
+    /**
+     * Read an interleaved multi-axis signal directly into one row per axis (the
+     * layout `extract_spec_features` works on) and apply the axes scale on the way.
+     * Same result as reading the signal, `numpy::transpose_in_place` and `numpy::scale`.
+     * @param signal Interleaved signal
+     * @param axes_matrix Output, one row per axis
+     * @param scale_axes Scale factor
+     * @returns 0 if OK
+     */
+    static int read_axes(signal_t *signal, matrix_t *axes_matrix, float scale_axes)
+    {
+        const size_t axes = axes_matrix->rows;
+        const size_t frames = axes_matrix->cols;
+        float chunk[64];
+        const size_t chunk_frames = sizeof(chunk) / sizeof(chunk[0]) / axes;
+
+        if (chunk_frames == 0) {
+            matrix_t interleaved(frames, axes, axes_matrix->buffer);
+            EI_TRY(signal->get_data(0, frames * axes, interleaved.buffer));
+            numpy::transpose_in_place(&interleaved);
+            return numpy::scale(axes_matrix, scale_axes);
+        }
+
+        for (size_t frame = 0; frame < frames; frame += chunk_frames) {
+            const size_t n = std::min(chunk_frames, frames - frame);
+            EI_TRY(signal->get_data(frame * axes, n * axes, chunk));
+            for (size_t axis = 0; axis < axes; axis++) {
+                float *row = axes_matrix->get_row_ptr(axis) + frame;
+                for (size_t ix = 0; ix < n; ix++) {
+                    row[ix] = chunk[ix * axes + axis] * scale_axes;
+                }
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Peak working memory of one spectral analysis call: the input matrix, the
+     * decimated copy used for the extra low frequency features and the FFT workspace,
+     * or the wavelet workspace. Version 1 blocks only count the input matrix.
+     * @param config Block config
+     * @param input_size Number of samples in the signal, all axes
+     * @returns size in bytes
+     */
+    static size_t get_workspace_size(const ei_dsp_config_spectral_analysis_t *config, size_t input_size)
+    {
+        size_t size = input_size * sizeof(float);
+        if (strcmp(config->analysis_type, "Wavelet") == 0 && config->axes > 0) {
+            return size + wavelet::get_workspace_size(config->wavelet, input_size / config->axes);
+        }
+        if (strcmp(config->analysis_type, "FFT") != 0 || config->implementation_version == 1) {
+            return size;
+        }
+
+        if (config->implementation_version == 4 && config->extra_low_freq && config->axes > 0) {
+            size_t cols = input_size / config->axes;
+            if (config->input_decimation_ratio > 1) {
+                for (int r : get_ratio_combo(config->input_decimation_ratio)) {
+                    cols = signal::get_decimated_size(cols, r);
+                }
+            }
+            size += config->axes * signal::get_decimated_size(cols, 10) * sizeof(float);
+        }
+
+        return size + fft_workspace::get_size(config->fft_length);
+    }
+
     /**
      * @brief Calculates the spectral analysis features.
      *
@@ -403,6 +472,12 @@ public:
         }
         size_t num_bins = stop_bin - start_bin;
 
+        // one FFT plan and set of spectrum buffers for all axes, cached between calls
+        fft_workspace::plan_t *plan = fft_workspace::get_plan(config->fft_length);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
         float *feature_out = output_matrix->buffer;
         const float *feature_out_ori = feature_out;
         for (size_t row = 0; row < input_matrix->rows; row++) {
@@ -446,33 +521,34 @@ public:
             if (config->implementation_version == 4) {
 
                 size_t fft_out_size = config->fft_length / 2 + 1;
-                ei_vector<float> fft_out(fft_out_size);
-                EI_TRY(numpy::welch_max_hold(
+                float *fft_out = plan->max_hold;
+                EI_TRY(fft_workspace::welch_max_hold(
+                    plan,
                     data_window,
                     data_size,
-                    fft_out.data(),
+                    fft_out,
                     0,
                     fft_out_size,
-                    config->fft_length,
                     config->do_fft_overlap));
 
-                matrix_t x(1, fft_out.size(), const_cast<float *>(fft_out.data()));
-                matrix_t out(1, 1);
+                float moment;
+                matrix_t x(1, fft_out_size, fft_out);
+                matrix_t out(1, 1, &moment);
 
-                *feature_out++ = (numpy::skew(&x, &out) == EIDSP_OK) ? (out.get_row_ptr(0)[0]) : 0.0f;
-                *feature_out++ = (numpy::kurtosis(&x, &out) == EIDSP_OK) ? (out.get_row_ptr(0)[0]) : 0.0f;
+                *feature_out++ = (numpy::skew(&x, &out) == EIDSP_OK) ? moment : 0.0f;
+                *feature_out++ = (numpy::kurtosis(&x, &out) == EIDSP_OK) ? moment : 0.0f;
 
                 for (size_t i = start_bin; i < stop_bin; i++) {
                     feature_out[i - start_bin] = fft_out[i];
                 }
             } else {
-                EI_TRY(numpy::welch_max_hold(
+                EI_TRY(fft_workspace::welch_max_hold(
+                    plan,
                     data_window,
                     data_size,
                     feature_out,
                     start_bin,
                     stop_bin,
-                    config->fft_length,
                     config->do_fft_overlap));
             }
             if (config->do_log) {
@@ -490,10 +566,16 @@ public:
         matrix_t *input_matrix,
         matrix_t *output_matrix,
         ei_dsp_config_spectral_analysis_t *config,
-        const float sampling_freq)
+        const float sampling_freq,
+        const bool transpose_and_scale_input = true)
     {
-        size_t n_features =
-            extract_spec_features(input_matrix, output_matrix, config, sampling_freq);
+        size_t n_features = extract_spec_features(
+            input_matrix,
+            output_matrix,
+            config,
+            sampling_freq,
+            true,
+            transpose_and_scale_input);
         return n_features == output_matrix->cols ? EIDSP_OK : EIDSP_MATRIX_SIZE_MISMATCH;
     }
 
@@ -572,10 +654,14 @@ public:
 
         const size_t out_size = signal::get_decimated_size(input_matrix->cols, ratio);
 
+        // one filter object for all axes, the state is reloaded for every row
+        signal::sosfilt sosfilt(sos, sos_zi, 4);
         for (size_t row = 0; row < input_matrix->rows; row++) {
             const float *x = input_matrix->get_row_ptr(row);
             float *y = output_matrix->get_row_ptr(row);
-            signal::sosfilt sosfilt(sos, sos_zi, 4);
+            if (row > 0) {
+                sosfilt.update(sos, sos_zi);
+            }
             signal::decimate_simple(
                 x,
                 input_matrix->cols,
@@ -592,21 +678,34 @@ public:
         matrix_t *input_matrix,
         matrix_t *output_matrix,
         ei_dsp_config_spectral_analysis_t *config_p,
-        const float sampling_freq)
+        const float sampling_freq,
+        const bool transpose_and_scale_input = true)
     {
         auto config_copy = *config_p;
         auto config = &config_copy;
         if (strcmp(config->analysis_type, "Wavelet") == 0) {
-            return wavelet::extract_wavelet_features(input_matrix, output_matrix, config, sampling_freq);
+            return wavelet::extract_wavelet_features(
+                input_matrix,
+                output_matrix,
+                config,
+                sampling_freq,
+                transpose_and_scale_input);
         }
         else if (config->extra_low_freq == false && config->input_decimation_ratio == 1) {
-            size_t n_features =
-                extract_spec_features(input_matrix, output_matrix, config, sampling_freq);
+            size_t n_features = extract_spec_features(
+                input_matrix,
+                output_matrix,
+                config,
+                sampling_freq,
+                true,
+                transpose_and_scale_input);
             return n_features == output_matrix->cols ? EIDSP_OK : EIDSP_MATRIX_SIZE_MISMATCH;
         }
         else {
-            numpy::transpose_in_place(input_matrix);
-            EI_TRY(numpy::scale(input_matrix, config->scale_axes));
+            if (transpose_and_scale_input) {
+                numpy::transpose_in_place(input_matrix);
+                EI_TRY(numpy::scale(input_matrix, config->scale_axes));
+            }
 
             if (config->input_decimation_ratio > 1) {
                 ei_vector<int> ratio_combo = get_ratio_combo(config->input_decimation_ratio);
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+#ifndef _EIDSP_SPECTRAL_FFT_WORKSPACE_H_
+#define _EIDSP_SPECTRAL_FFT_WORKSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include "../numpy.hpp"
+#include "../memory.hpp"
+#include "../returntypes.hpp"
+
+namespace ei {
+namespace spectral {
+
+/**
+ * FFT scratch memory shared by all axes (and all frames) of a spectral analysis
+ * or speechpy block. Holds the kissfft plan, the zero padded FFT input, the complex output
+ * and two power spectrum buffers, in one allocation per FFT length. Up to
+ * EIDSP_FFT_WORKSPACE_CACHE_SIZE lengths stay cached (least recently used goes first),
+ * so an impulse whose blocks use different FFT lengths does not reallocate per block.
+ */
+class fft_workspace {
+public:
+    typedef struct {
+        size_t fft_length;
+        kiss_fftr_cfg cfg;          // nullptr when kissfft is not compiled in
+        float *fft_input;           // fft_length entries
+        fft_complex_t *fft_output;  // fft_length / 2 + 1 entries
+        float *spectrum;            // fft_length / 2 + 1 entries, power of the current frame
+        float *max_hold;            // fft_length / 2 + 1 entries, free for the caller
+        size_t mem_size;
+    } plan_t;
+
+    /**
+     * Bytes held by the workspace for a given FFT length
+     */
+    static size_t get_size(size_t fft_length)
+    {
+        size_t offsets[5];
+        return get_layout(fft_length, offsets);
+    }
+
+    /**
+     * Get the cached workspace for an FFT length, allocated if that length is not cached
+     * @returns nullptr if out of memory
+     */
+    static plan_t *get_plan(size_t fft_length)
+    {
+        plan_t **cache = plan_ref();
+        const size_t slots = EIDSP_FFT_WORKSPACE_CACHE_SIZE;
+
+        // most recently used first
+        size_t ix = 0;
+        while (ix < slots && cache[ix] && cache[ix]->fft_length != fft_length) {
+            ix++;
+        }
+        if (ix < slots && cache[ix]) {
+            plan_t *plan = cache[ix];
+            memmove(cache + 1, cache, ix * sizeof(plan_t*));
+            cache[0] = plan;
+            return plan;
+        }
+
+        size_t offsets[5];
+        const size_t mem_size = get_layout(fft_length, offsets);
+        uint8_t *mem = (uint8_t*)ei_dsp_calloc(mem_size, 1);
+        if (!mem && cache[slots - 1]) {
+            // make room, the least recently used length goes anyway
+            release(cache[slots - 1]);
+            cache[slots - 1] = nullptr;
+            mem = (uint8_t*)ei_dsp_calloc(mem_size, 1);
+        }
+        if (!mem) {
+            return nullptr;
+        }
+
+        plan_t *plan = reinterpret_cast<plan_t*>(mem);
+        plan->fft_length = fft_length;
+        plan->fft_input = reinterpret_cast<float*>(mem + offsets[0]);
+        plan->fft_output = reinterpret_cast<fft_complex_t*>(mem + offsets[1]);
+        plan->spectrum = reinterpret_cast<float*>(mem + offsets[2]);
+        plan->max_hold = reinterpret_cast<float*>(mem + offsets[3]);
+        plan->cfg = nullptr;
+        plan->mem_size = mem_size;
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+        size_t cfg_size = mem_size - offsets[4];
+        if (cfg_size > 0) {
+            plan->cfg = kiss_fftr_alloc(fft_length, 0, mem + offsets[4], &cfg_size);
+        }
+#endif
+
+        if (cache[slots - 1]) {
+            release(cache[slots - 1]);
+        }
+        memmove(cache + 1, cache, (slots - 1) * sizeof(plan_t*));
+        cache[0] = plan;
+        return plan;
+    }
+
+    /**
+     * Release every cached workspace, the next call to `get_plan` rebuilds it
+     */
+    static void free_plan()
+    {
+        plan_t **cache = plan_ref();
+        for (size_t ix = 0; ix < EIDSP_FFT_WORKSPACE_CACHE_SIZE; ix++) {
+            if (cache[ix]) {
+                release(cache[ix]);
+                cache[ix] = nullptr;
+            }
+        }
+    }
+
+    /**
+     * Power spectrum of one frame, see `numpy::power_spectrum`. Same results, but the
+     * plan and scratch buffers of the workspace are reused instead of allocated.
+     * @param plan Workspace from `get_plan`
+     * @param frame Frame, zero padded (or truncated) to the FFT length
+     * @param frame_size Number of samples in the frame
+     * @param output Output buffer, fft_length / 2 + 1 entries (can be plan->spectrum)
+     * @returns 0 if OK
+     */
+    static int power_spectrum(plan_t *plan, const float *frame, size_t frame_size, float *output)
+    {
+        const size_t fft_points = plan->fft_length;
+        const size_t fft_out_size = fft_points / 2 + 1;
+
+        EI_TRY(numpy::rfft(frame, frame_size, plan->fft_output, fft_points, plan->fft_input, plan->cfg));
+
+        // same operations as numpy::power_spectrum on top of the magnitude from numpy::rfft
+        for (size_t ix = 0; ix < fft_out_size; ix++) {
+            const fft_complex_t &c = plan->fft_output[ix];
+            float magnitude = numpy::sqrt(c.r * c.r + c.i * c.i);
+            output[ix] = (1.0 / static_cast<float>(fft_points)) * (magnitude * magnitude);
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Welch's method with max hold instead of averaging, see `numpy::welch_max_hold`.
+     * Gives the same results, but does not touch the input and does not allocate.
+     * @param plan Workspace from `get_plan`
+     * @param input Signal of one axis
+     * @param input_size Number of samples
+     * @param output Output buffer, stop_bin - start_bin entries
+     * @param start_bin First bin to keep
+     * @param stop_bin One past the last bin to keep
+     * @param do_overlap Use 50% overlapping frames
+     * @returns 0 if OK
+     */
+    static int welch_max_hold(
+        plan_t *plan,
+        const float *input,
+        size_t input_size,
+        float *output,
+        size_t start_bin,
+        size_t stop_bin,
+        bool do_overlap)
+    {
+        const size_t fft_points = plan->fft_length;
+        const size_t step = do_overlap ? fft_points / 2 : fft_points;
+
+        memset(output, 0, sizeof(float) * (stop_bin - start_bin));
+        for (size_t input_ix = 0; input_ix < input_size; input_ix += step) {
+            // Figure out if we need any zero padding
+            size_t n_input_points = input_ix + fft_points <= input_size ? fft_points
+                                                                        : input_size - input_ix;
+            EI_TRY(power_spectrum(plan, input + input_ix, n_input_points, plan->spectrum));
+
+            // keep the max of the last frame and everything before
+            for (size_t i = start_bin; i < stop_bin; i++) {
+                output[i - start_bin] = std::max(output[i - start_bin], plan->spectrum[i]);
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+private:
+    static plan_t **plan_ref()
+    {
+        static plan_t *cache[EIDSP_FFT_WORKSPACE_CACHE_SIZE] = { nullptr };
+        return cache;
+    }
+
+    static void release(plan_t *plan)
+    {
+        ei_dsp_free(plan, plan->mem_size);
+    }
+
+    static size_t align8(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+
+    static size_t get_layout(size_t fft_length, size_t offsets[5])
+    {
+        const size_t fft_out_size = fft_length / 2 + 1;
+
+        size_t mem_size = align8(sizeof(plan_t));
+        offsets[0] = mem_size; mem_size += align8(fft_length * sizeof(float));
+        offsets[1] = mem_size; mem_size += align8(fft_out_size * sizeof(fft_complex_t));
+        offsets[2] = mem_size; mem_size += align8(fft_out_size * sizeof(float));
+        offsets[3] = mem_size; mem_size += align8(fft_out_size * sizeof(float));
+        offsets[4] = mem_size;
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+        // kissfft only supports even lengths, leave the plan out otherwise (rfft reports the error)
+        if (fft_length % 2 == 0) {
+            size_t cfg_size = 0;
+            kiss_fftr_alloc(fft_length, 0, nullptr, &cfg_size);
+            mem_size += cfg_size;
+        }
+#endif
+        return mem_size;
+    }
+};
+
+} // namespace spectral
+} // namespace ei
+
+#endif // _EIDSP_SPECTRAL_FFT_WORKSPACE_H_
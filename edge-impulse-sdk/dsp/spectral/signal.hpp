@@ -173,14 +173,20 @@ public:
     {
         sos.init(input[0]);
 
-        fvec filtered(input_size);
-        sos.run(input, input_size, filtered.data());
-
         size_t expected_size = get_decimated_size(input_size, factor);
         assert(output_size >= expected_size);
 
-        for (size_t ix = 0; ix < expected_size; ix++) {
-            output[ix] = filtered[ix * factor];
+        // the recursion needs every sample to go through all sections, but the
+        // cascade runs over small blocks on the stack instead of a filtered copy of
+        // the whole input and only the retained outputs are stored (output can be
+        // the same as input)
+        float block[64];
+        for (size_t start = 0; start < input_size; start += 64) {
+            const size_t n = input_size - start < 64 ? input_size - start : 64;
+            sos.run(input + start, n, block);
+            for (size_t ix = (factor - start % factor) % factor; ix < n; ix += factor) {
+                output[(start + ix) / factor] = block[ix];
+            }
         }
     }
 
@@ -261,51 +267,32 @@ public:
         assert(down > 0);
         assert(h.size() > 0);
 
-#if 0 // bug in optimized version
-        const int N = (h.size() - 1) / 2;
+        // polyphase: only the retained outputs are computed, and only the taps that
+        // land on input samples (the zeros of the upsampled signal are skipped).
+        // The remaining products are accumulated in the same order as a full
+        // convolution of the zero stuffed signal would, so results are identical.
+        const int nx = x_size;
+        const int nh = h.size();
+        const int skip = (nh - 1) / 2;
+        const float *hp = h.data();
 
-        for (size_t n = 0; n < y.size(); n++) {
-            float acc = 0.0f;
-            for (size_t k = 0; k < h.size(); k += up) {
-                const size_t x_ind = n * down + k - N;
-                if (x_ind >= 0 && x_ind < x.size()) {
-                    acc += h[k] * x[x_ind];
-                }
-            }
-            y[n] = acc;
-        }
-#else
-        int nx = x_size;
-        int nh = h.size();
-
-        // Upsample the input signal by inserting zeros
-        fvec r(up * nx);
-        for (int i = 0; i < nx; i++)
-        {
-            r[i * up] = x[i];
-        }
-
-        // Filter the upsampled signal using the given filter coefficients
-        fvec z(nh + up * nx - 1);
-        for (int i = 0; i < up * nx; i++)
+        for (size_t i = 0; i < y.size(); i++)
         {
-            for (int j = 0; j < nh; j++)
+            // index into the upsampled and filtered signal
+            const int z_ix = i * down + skip;
+            float acc = 0.0f;
+            if (z_ix < up * nx)
             {
-                if (i - j >= 0 && i - j < up * nx)
+                const int last_tap = z_ix < nh - 1 ? z_ix : nh - 1;
+                int x_ix = (z_ix - (z_ix % up)) / up;
+                for (int j = z_ix % up; j <= last_tap; j += up)
                 {
-                    z[i] += r[i - j] * h[j];
+                    acc += x[x_ix--] * hp[j];
                 }
             }
+            y[i] = acc;
         }
 
-        // Downsample the filtered signal by skipping samples
-        int skip = (nh - 1) / 2;
-        for (size_t i = 0; i < y.size(); i++)
-        {
-            y[i] = z[i * down + skip];
-        }
-#endif
-
     }
 
     /**
@@ -72,223 +72,288 @@ inline void histo(const fvec &x, size_t nbins, fvec &h, bool normalize = false)
 class wavelet {
 
     static constexpr size_t NUM_FEATHERS_PER_COMP = 14;
+    static constexpr size_t MAX_FILTER_SIZE = 20;
+    static constexpr size_t HISTOGRAM_BINS = 100;
+
+    // sums over a coefficient vector that are gathered while the vector is produced
+    typedef struct {
+        float sum;
+        float sum_squares;
+        float min;
+        float max;
+        size_t zero_crossings;
+    } first_pass_t;
 
     template <size_t wave_size>
-    static void get_filter(const std::array<std::array<float, wave_size>, 2> wav, fvec &h, fvec &g)
+    static size_t get_filter(const std::array<std::array<float, wave_size>, 2> &wav, float *h, float *g)
     {
-        size_t n = wav[0].size();
-        h.resize(n);
-        g.resize(n);
-        for (size_t i = 0; i < n; i++) {
-            h[i] = wav[0][n - i - 1];
-            g[i] = wav[1][n - i - 1];
+        for (size_t i = 0; i < wave_size; i++) {
+            h[i] = wav[0][wave_size - i - 1];
+            g[i] = wav[1][wave_size - i - 1];
         }
+        return wave_size;
     }
 
-    static void find_filter(const char *wav, fvec &h, fvec &g)
+    /**
+     * Decomposition filters of a wavelet, reversed for the dot products in `dwt`
+     * @param h Low pass filter, MAX_FILTER_SIZE entries
+     * @param g High pass filter, MAX_FILTER_SIZE entries
+     * @returns filter length, 0 if the wavelet is unknown
+     */
+    static size_t find_filter(const char *wav, float *h, float *g)
     {
-        if (strcmp(wav, "bior1.3") == 0) get_filter<6>(bior1p3, h, g);
-        else if (strcmp(wav, "bior1.5") == 0) get_filter<10>(bior1p5, h, g);
-        else if (strcmp(wav, "bior2.2") == 0) get_filter<6>(bior2p2, h, g);
-        else if (strcmp(wav, "bior2.4") == 0) get_filter<10>(bior2p4, h, g);
-        else if (strcmp(wav, "bior2.6") == 0) get_filter<14>(bior2p6, h, g);
-        else if (strcmp(wav, "bior2.8") == 0) get_filter<18>(bior2p8, h, g);
-        else if (strcmp(wav, "bior3.1") == 0) get_filter<4>(bior3p1, h, g);
-        else if (strcmp(wav, "bior3.3") == 0) get_filter<8>(bior3p3, h, g);
-        else if (strcmp(wav, "bior3.5") == 0) get_filter<12>(bior3p5, h, g);
-        else if (strcmp(wav, "bior3.7") == 0) get_filter<16>(bior3p7, h, g);
-        else if (strcmp(wav, "bior3.9") == 0) get_filter<20>(bior3p9, h, g);
-        else if (strcmp(wav, "bior4.4") == 0) get_filter<10>(bior4p4, h, g);
-        else if (strcmp(wav, "bior5.5") == 0) get_filter<12>(bior5p5, h, g);
-        else if (strcmp(wav, "bior6.8") == 0) get_filter<18>(bior6p8, h, g);
-        else if (strcmp(wav, "coif1") == 0) get_filter<6>(coif1, h, g);
-        else if (strcmp(wav, "coif2") == 0) get_filter<12>(coif2, h, g);
-        else if (strcmp(wav, "coif3") == 0) get_filter<18>(coif3, h, g);
-        else if (strcmp(wav, "db2") == 0) get_filter<4>(db2, h, g);
-        else if (strcmp(wav, "db3") == 0) get_filter<6>(db3, h, g);
-        else if (strcmp(wav, "db4") == 0) get_filter<8>(db4, h, g);
-        else if (strcmp(wav, "db5") == 0) get_filter<10>(db5, h, g);
-        else if (strcmp(wav, "db6") == 0) get_filter<12>(db6, h, g);
-        else if (strcmp(wav, "db7") == 0) get_filter<14>(db7, h, g);
-        else if (strcmp(wav, "db8") == 0) get_filter<16>(db8, h, g);
-        else if (strcmp(wav, "db9") == 0) get_filter<18>(db9, h, g);
-        else if (strcmp(wav, "db10") == 0) get_filter<20>(db10, h, g);
-        else if (strcmp(wav, "haar") == 0) get_filter<2>(haar, h, g);
-        else if (strcmp(wav, "rbio1.3") == 0) get_filter<6>(rbio1p3, h, g);
-        else if (strcmp(wav, "rbio1.5") == 0) get_filter<10>(rbio1p5, h, g);
-        else if (strcmp(wav, "rbio2.2") == 0) get_filter<6>(rbio2p2, h, g);
-        else if (strcmp(wav, "rbio2.4") == 0) get_filter<10>(rbio2p4, h, g);
-        else if (strcmp(wav, "rbio2.6") == 0) get_filter<14>(rbio2p6, h, g);
-        else if (strcmp(wav, "rbio2.8") == 0) get_filter<18>(rbio2p8, h, g);
-        else if (strcmp(wav, "rbio3.1") == 0) get_filter<4>(rbio3p1, h, g);
-        else if (strcmp(wav, "rbio3.3") == 0) get_filter<8>(rbio3p3, h, g);
-        else if (strcmp(wav, "rbio3.5") == 0) get_filter<12>(rbio3p5, h, g);
-        else if (strcmp(wav, "rbio3.7") == 0) get_filter<16>(rbio3p7, h, g);
-        else if (strcmp(wav, "rbio3.9") == 0) get_filter<20>(rbio3p9, h, g);
-        else if (strcmp(wav, "rbio4.4") == 0) get_filter<10>(rbio4p4, h, g);
-        else if (strcmp(wav, "rbio5.5") == 0) get_filter<12>(rbio5p5, h, g);
-        else if (strcmp(wav, "rbio6.8") == 0) get_filter<18>(rbio6p8, h, g);
-        else if (strcmp(wav, "sym2") == 0) get_filter<4>(sym2, h, g);
-        else if (strcmp(wav, "sym3") == 0) get_filter<6>(sym3, h, g);
-        else if (strcmp(wav, "sym4") == 0) get_filter<8>(sym4, h, g);
-        else if (strcmp(wav, "sym5") == 0) get_filter<10>(sym5, h, g);
-        else if (strcmp(wav, "sym6") == 0) get_filter<12>(sym6, h, g);
-        else if (strcmp(wav, "sym7") == 0) get_filter<14>(sym7, h, g);
-        else if (strcmp(wav, "sym8") == 0) get_filter<16>(sym8, h, g);
-        else if (strcmp(wav, "sym9") == 0) get_filter<18>(sym9, h, g);
-        else if (strcmp(wav, "sym10") == 0) get_filter<20>(sym10, h, g);
-        else assert(0); // wavelet not in the list
+        if (strcmp(wav, "bior1.3") == 0) return get_filter<6>(bior1p3, h, g);
+        if (strcmp(wav, "bior1.5") == 0) return get_filter<10>(bior1p5, h, g);
+        if (strcmp(wav, "bior2.2") == 0) return get_filter<6>(bior2p2, h, g);
+        if (strcmp(wav, "bior2.4") == 0) return get_filter<10>(bior2p4, h, g);
+        if (strcmp(wav, "bior2.6") == 0) return get_filter<14>(bior2p6, h, g);
+        if (strcmp(wav, "bior2.8") == 0) return get_filter<18>(bior2p8, h, g);
+        if (strcmp(wav, "bior3.1") == 0) return get_filter<4>(bior3p1, h, g);
+        if (strcmp(wav, "bior3.3") == 0) return get_filter<8>(bior3p3, h, g);
+        if (strcmp(wav, "bior3.5") == 0) return get_filter<12>(bior3p5, h, g);
+        if (strcmp(wav, "bior3.7") == 0) return get_filter<16>(bior3p7, h, g);
+        if (strcmp(wav, "bior3.9") == 0) return get_filter<20>(bior3p9, h, g);
+        if (strcmp(wav, "bior4.4") == 0) return get_filter<10>(bior4p4, h, g);
+        if (strcmp(wav, "bior5.5") == 0) return get_filter<12>(bior5p5, h, g);
+        if (strcmp(wav, "bior6.8") == 0) return get_filter<18>(bior6p8, h, g);
+        if (strcmp(wav, "coif1") == 0) return get_filter<6>(coif1, h, g);
+        if (strcmp(wav, "coif2") == 0) return get_filter<12>(coif2, h, g);
+        if (strcmp(wav, "coif3") == 0) return get_filter<18>(coif3, h, g);
+        if (strcmp(wav, "db2") == 0) return get_filter<4>(db2, h, g);
+        if (strcmp(wav, "db3") == 0) return get_filter<6>(db3, h, g);
+        if (strcmp(wav, "db4") == 0) return get_filter<8>(db4, h, g);
+        if (strcmp(wav, "db5") == 0) return get_filter<10>(db5, h, g);
+        if (strcmp(wav, "db6") == 0) return get_filter<12>(db6, h, g);
+        if (strcmp(wav, "db7") == 0) return get_filter<14>(db7, h, g);
+        if (strcmp(wav, "db8") == 0) return get_filter<16>(db8, h, g);
+        if (strcmp(wav, "db9") == 0) return get_filter<18>(db9, h, g);
+        if (strcmp(wav, "db10") == 0) return get_filter<20>(db10, h, g);
+        if (strcmp(wav, "haar") == 0) return get_filter<2>(haar, h, g);
+        if (strcmp(wav, "rbio1.3") == 0) return get_filter<6>(rbio1p3, h, g);
+        if (strcmp(wav, "rbio1.5") == 0) return get_filter<10>(rbio1p5, h, g);
+        if (strcmp(wav, "rbio2.2") == 0) return get_filter<6>(rbio2p2, h, g);
+        if (strcmp(wav, "rbio2.4") == 0) return get_filter<10>(rbio2p4, h, g);
+        if (strcmp(wav, "rbio2.6") == 0) return get_filter<14>(rbio2p6, h, g);
+        if (strcmp(wav, "rbio2.8") == 0) return get_filter<18>(rbio2p8, h, g);
+        if (strcmp(wav, "rbio3.1") == 0) return get_filter<4>(rbio3p1, h, g);
+        if (strcmp(wav, "rbio3.3") == 0) return get_filter<8>(rbio3p3, h, g);
+        if (strcmp(wav, "rbio3.5") == 0) return get_filter<12>(rbio3p5, h, g);
+        if (strcmp(wav, "rbio3.7") == 0) return get_filter<16>(rbio3p7, h, g);
+        if (strcmp(wav, "rbio3.9") == 0) return get_filter<20>(rbio3p9, h, g);
+        if (strcmp(wav, "rbio4.4") == 0) return get_filter<10>(rbio4p4, h, g);
+        if (strcmp(wav, "rbio5.5") == 0) return get_filter<12>(rbio5p5, h, g);
+        if (strcmp(wav, "rbio6.8") == 0) return get_filter<18>(rbio6p8, h, g);
+        if (strcmp(wav, "sym2") == 0) return get_filter<4>(sym2, h, g);
+        if (strcmp(wav, "sym3") == 0) return get_filter<6>(sym3, h, g);
+        if (strcmp(wav, "sym4") == 0) return get_filter<8>(sym4, h, g);
+        if (strcmp(wav, "sym5") == 0) return get_filter<10>(sym5, h, g);
+        if (strcmp(wav, "sym6") == 0) return get_filter<12>(sym6, h, g);
+        if (strcmp(wav, "sym7") == 0) return get_filter<14>(sym7, h, g);
+        if (strcmp(wav, "sym8") == 0) return get_filter<16>(sym8, h, g);
+        if (strcmp(wav, "sym9") == 0) return get_filter<18>(sym9, h, g);
+        if (strcmp(wav, "sym10") == 0) return get_filter<20>(sym10, h, g);
+        assert(0); // wavelet not in the list
+        return 0;
     }
 
-    static void calculate_entropy(const fvec &y, fvec &features)
+    static size_t get_percentile_index(size_t size, float percentile)
     {
-        fvec h;
-        histo(y, 100, h, true);
-        // entropy = -sum(prob * log(prob)
-        float entropy = 0.0f;
-        for (size_t i = 0; i < h.size(); i++) {
-            if (h[i] > 0.0f) {
-                entropy -= h[i] * log(h[i]);
-            }
+        // adding 0.5 is a trick to get rounding out of C flooring behavior during cast
+        return (size_t) ((percentile * (size - 1)) + 0.5);
+    }
+
+    static void accumulate(first_pass_t &stats, const float *y, size_t i)
+    {
+        const float v = y[i];
+        stats.sum += v;
+        stats.sum_squares += v * v;
+        if (i == 0) {
+            stats.min = v;
+            stats.max = v;
+            return;
+        }
+        stats.min = std::min(stats.min, v);
+        stats.max = std::max(stats.max, v);
+        if (v * y[i - 1] < 0) {
+            stats.zero_crossings++;
         }
-        features.push_back(entropy);
     }
 
-    static float get_percentile_from_sorted(const fvec &sorted, float percentile)
+    /**
+     * Symmetric padding (default in PyWavelet) around the nx samples that start at
+     * buf + nh - 2, the buffer needs nx + 2 * nh - 2 entries
+     */
+    static void pad(float *buf, size_t nx, size_t nh)
     {
-        // adding 0.5 is a trick to get rounding out of C flooring behavior during cast
-        size_t index = (size_t) ((percentile * (sorted.size()-1)) + 0.5);
-        return sorted[index];
+        float *x = buf + nh - 2;
+        for (size_t i = 0; i < nh - 2; i++)
+            buf[i] = x[nh - 3 - i];
+        for (size_t i = 0; i < nh; i++)
+            x[nx + i] = x[nx - 1 - i];
     }
 
-    static void calculate_statistics(const fvec &y, fvec &features, float mean)
+    /**
+     * One decomposition level. Only the kept (every other) convolution outputs are
+     * computed, and the first pass statistics of the detail coefficients are
+     * gathered on the way.
+     * @param x Padded level input, see `pad`
+     * @param ny Number of output coefficients, (nx + nh - 1) / 2
+     * @param a Approximation coefficients out, must not overlap x
+     * @param d Detail coefficients out
+     */
+    static void dwt(
+        const float *x,
+        size_t ny,
+        const float *h,
+        const float *g,
+        size_t nh,
+        float *a,
+        float *d,
+        first_pass_t &d_stats)
     {
-        fvec sorted = y;
-        std::sort(sorted.begin(), sorted.end());
-        features.push_back(get_percentile_from_sorted(sorted,0.05));
-        features.push_back(get_percentile_from_sorted(sorted,0.25));
-        features.push_back(get_percentile_from_sorted(sorted,0.75));
-        features.push_back(get_percentile_from_sorted(sorted,0.95));
-        features.push_back(get_percentile_from_sorted(sorted,0.5));
-
-        matrix_t x(1, y.size(), const_cast<float *>(y.data()));
-        matrix_t out(1, 1);
-
-        features.push_back(mean);
-        if (numpy::stdev(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        features.push_back(numpy::variance(const_cast<float *>(y.data()), y.size()));
-        if (numpy::rms(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        if (numpy::skew(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        if (numpy::kurtosis(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
+        d_stats = first_pass_t();
+        for (size_t i = 0; i < ny; i++) {
+            const float av = dot(x + 2 * i, h, nh);
+            const float dv = dot(x + 2 * i, g, nh);
+            // same as numpy::underflow_handling
+            a[i] = fabs(av) < 1e-07f ? 0.0f : av;
+            d[i] = fabs(dv) < 1e-07f ? 0.0f : dv;
+            accumulate(d_stats, d, i);
+        }
     }
 
-    static void calculate_crossings(const fvec &y, fvec &features, float mean)
+    /**
+     * The NUM_FEATHERS_PER_COMP features of one coefficient vector: entropy, zero and
+     * mean crossings, percentiles, mean, stdev, variance, rms, skew and kurtosis.
+     * Everything that depends on the mean comes out of a single second pass.
+     * @param scratch y_size entries, used to select the percentiles
+     */
+    static void extract_features(
+        const float *y,
+        size_t y_size,
+        const first_pass_t &stats,
+        float *scratch,
+        float *features)
     {
-        size_t zc = 0;
-        for (size_t i = 1; i < y.size(); i++) {
-            if (y[i] * y[i - 1] < 0) {
-                zc++;
+        const float n = static_cast<float>(y_size);
+        const float mean = stats.sum / y_size;
+        const float step = (stats.max - stats.min) / HISTOGRAM_BINS;
+
+        uint32_t histogram[HISTOGRAM_BINS] = { 0 };
+        size_t mean_crossings = 0;
+        float m_2 = 0.0f;
+        float m_3 = 0.0f;
+        float m_4 = 0.0f;
+        float prev_diff = 0.0f;
+        for (size_t i = 0; i < y_size; i++) {
+            size_t bin = (y[i] - stats.min) / step;
+            if (bin >= HISTOGRAM_BINS)
+                bin = HISTOGRAM_BINS - 1;
+            histogram[bin]++;
+
+            const float diff = y[i] - mean;
+            const float square_diff = diff * diff;
+            m_2 += square_diff;
+            m_3 += square_diff * diff;
+            m_4 += square_diff * square_diff;
+            if (i > 0 && diff * prev_diff < 0) {
+                mean_crossings++;
             }
+            prev_diff = diff;
         }
-        features.push_back(zc / (float)y.size());
 
-        size_t mc = 0;
-        for (size_t i = 1; i < y.size(); i++) {
-            if ((y[i] - mean) * (y[i - 1] - mean) < 0) {
-                mc++;
+        // entropy = -sum(prob * log(prob)
+        float entropy = 0.0f;
+        for (size_t i = 0; i < HISTOGRAM_BINS; i++) {
+            if (histogram[i] > 0) {
+                float prob = histogram[i] / n;
+                entropy -= prob * log(prob);
             }
         }
-        features.push_back(mc / (float)y.size());
-    }
-
-    static void
-    dwt(const float *x, size_t nx, const float *h, const float *g, size_t nh, fvec &a, fvec &d)
-    {
-        assert(nh <= 20 && nh > 0 && nx > 0);
-        size_t nx_padded = nx + nh * 2 - 2;
-        fvec x_padded(nx_padded);
-
-        // symmetric padding (default in PyWavelet)
-        for (size_t i = 0; i < nh - 2; i++)
-            x_padded[i] = x[nh - 3 - i];
-        for (size_t i = 0; i < nx; i++)
-            x_padded[i + nh - 2] = x[i];
-        for (size_t i = 0; i < nh; i++)
-            x_padded[i + nx + nh - 2] = x[nx - 1 - i];
-
-        size_t ny = (nx + nh - 1) / 2;
-        a.resize(ny);
-        d.resize(ny);
 
-        // decimate and filter
-        const float *xx = x_padded.data();
-        for (size_t i = 0; i < ny; i++) {
-            a[i] = dot(xx + 2 * i, h, nh);
-            d[i] = dot(xx + 2 * i, g, nh);
+        // percentiles in increasing order, each selection only looks above the previous one
+        const float percentiles[] = { 0.05f, 0.25f, 0.5f, 0.75f, 0.95f };
+        float percentile_values[5];
+        memcpy(scratch, y, y_size * sizeof(float));
+        size_t lower = 0;
+        for (size_t i = 0; i < 5; i++) {
+            size_t index = get_percentile_index(y_size, percentiles[i]);
+            std::nth_element(scratch + lower, scratch + index, scratch + y_size);
+            percentile_values[i] = scratch[index];
+            lower = index;
         }
 
-        numpy::underflow_handling(d.data(), d.size());
-        numpy::underflow_handling(a.data(), a.size());
+        float variance = m_2 / y_size;
+        float skew_denominator = numpy::sqrt(variance * variance * variance);
+
+        *features++ = entropy;
+        *features++ = stats.zero_crossings / n;
+        *features++ = mean_crossings / n;
+        *features++ = percentile_values[0];
+        *features++ = percentile_values[1];
+        *features++ = percentile_values[3];
+        *features++ = percentile_values[4];
+        *features++ = percentile_values[2];
+        *features++ = mean;
+        *features++ = numpy::sqrt(m_2 / y_size);
+        *features++ = m_2 / (y_size - 1);
+        *features++ = numpy::sqrt(stats.sum_squares / n);
+        *features++ = skew_denominator == 0.0f ? 0.0f : (m_3 / y_size) / skew_denominator;
+        *features++ = (variance * variance) == 0.0f ? -3.0f : ((m_4 / y_size) / (variance * variance)) - 3.0f;
     }
 
-    static void extract_features(fvec& y, fvec &features)
+    /**
+     * Workspace of `dwt_features`, in floats: two ping-pong buffers for the padded
+     * level input, the detail coefficients and the percentile scratch
+     */
+    static size_t get_workspace_floats(size_t len, size_t nh)
     {
-        matrix_t x(1, y.size(), const_cast<float *>(y.data()));
-        matrix_t out(1, 1);
-        if (numpy::mean(&x, &out) != EIDSP_OK)
-            assert(0);
-        float mean = out.get_row_ptr(0)[0];
-
-        calculate_entropy(y, features);
-        calculate_crossings(y, features, mean);
-        calculate_statistics(y, features, mean);
+        const size_t ny = (len + nh - 1) / 2;
+        return (len + 2 * nh - 2) + (ny + 2 * nh - 2) + 2 * ny;
     }
 
-    static void
-    wavedec_features(const float *x, int len, const char *wav, int level, fvec &features)
+    static int dwt_features(
+        const float *x,
+        size_t len,
+        const float *h,
+        const float *g,
+        size_t nh,
+        int level,
+        float *workspace,
+        float *features)
     {
         assert(level > 0 && level < 8);
-
-        fvec h;
-        fvec g;
-        find_filter(wav, h, g);
-
-        features.clear();
-        fvec a;
-        fvec d;
-        dwt(x, len, h.data(), g.data(), h.size(), a, d);
-        extract_features(d, features);
-
-        for (int l = 1; l < level; l++) {
-            dwt(a.data(), a.size(), h.data(), g.data(), h.size(), a, d);
-            extract_features(d, features);
+        assert(nh <= MAX_FILTER_SIZE && nh > 0 && len >= nh);
+
+        const size_t ny_max = (len + nh - 1) / 2;
+        float *buf[2] = { workspace, workspace + len + 2 * nh - 2 };
+        float *d = buf[1] + ny_max + 2 * nh - 2;
+        float *scratch = d + ny_max;
+
+        memcpy(buf[0] + nh - 2, x, len * sizeof(float));
+        pad(buf[0], len, nh);
+
+        // components are stored approximation first, then details from the last level
+        // down to the first one, to match python results
+        first_pass_t stats;
+        size_t nx = len;
+        for (int l = 0; l < level; l++) {
+            const size_t ny = (nx + nh - 1) / 2;
+            float *next = buf[(l + 1) % 2];
+            dwt(buf[l % 2], ny, h, g, nh, next + nh - 2, d, stats);
+            extract_features(d, ny, stats, scratch, features + (level - l) * NUM_FEATHERS_PER_COMP);
+            pad(next, ny, nh);
+            nx = ny;
         }
 
-        extract_features(a, features);
-
-        for (int l = 0; l <= level / 2; l++) { // reverse order to match python results.
-            for (int i = 0; i < (int)NUM_FEATHERS_PER_COMP; i++) {
-                std::swap(
-                    features[l * NUM_FEATHERS_PER_COMP + i],
-                    features[(level - l) * NUM_FEATHERS_PER_COMP + i]);
-            }
+        const float *a = buf[level % 2] + nh - 2;
+        stats = first_pass_t();
+        for (size_t i = 0; i < nx; i++) {
+            accumulate(stats, a, i);
         }
-    }
-
-    static int dwt_features(const float *x, int len, const char *wav, int level, fvec &features)
-    {
-        assert(level <= 7);
-
-        assert(features.size() == 0); // make sure features is empty
-        features.reserve((level + 1) * NUM_FEATHERS_PER_COMP);
-
-        wavedec_features(x, len, wav, level, features);
+        extract_features(a, nx, stats, scratch, features);
 
-        return features.size();
+        return (level + 1) * NUM_FEATHERS_PER_COMP;
     }
 
     static bool check_min_size(int len, int level)
@@ -298,17 +363,33 @@ class wavelet {
     }
 
 public:
+    /**
+     * Bytes of working memory `extract_wavelet_features` allocates (shared by all axes)
+     * @param wav Wavelet name
+     * @param len Number of samples per axis
+     */
+    static size_t get_workspace_size(const char *wav, size_t len)
+    {
+        float h[MAX_FILTER_SIZE];
+        float g[MAX_FILTER_SIZE];
+        size_t nh = find_filter(wav, h, g);
+        return nh > 0 ? get_workspace_floats(len, nh) * sizeof(float) : 0;
+    }
+
     static int extract_wavelet_features(
         matrix_t *input_matrix,
         matrix_t *output_matrix,
         ei_dsp_config_spectral_analysis_t *config,
-        const float sampling_freq)
+        const float sampling_freq,
+        const bool transpose_and_scale_input = true)
     {
-        // transpose the matrix so we have one row per axis
-        numpy::transpose_in_place(input_matrix);
+        if (transpose_and_scale_input) {
+            // transpose the matrix so we have one row per axis
+            numpy::transpose_in_place(input_matrix);
 
-        // func tests for scale of 1 and does a no op in that case
-        EI_TRY(numpy::scale(input_matrix, config->scale_axes));
+            // func tests for scale of 1 and does a no op in that case
+            EI_TRY(numpy::scale(input_matrix, config->scale_axes));
+        }
 
         // apply filter, if enabled
         // "zero" order filter allowed.  will still remove unwanted fft bins later
@@ -333,26 +414,36 @@ public:
 
         EI_TRY(processing::subtract_mean(input_matrix));
 
-        int out_idx = 0;
-        for (size_t row = 0; row < input_matrix->rows; row++) {
-            float *data_window = input_matrix->get_row_ptr(row);
-            size_t data_size = input_matrix->cols;
+        size_t data_size = input_matrix->cols;
+        if (!check_min_size(data_size, config->wavelet_level))
+            EIDSP_ERR(EIDSP_BUFFER_SIZE_MISMATCH);
 
-            if (!check_min_size(data_size, config->wavelet_level))
-                EIDSP_ERR(EIDSP_BUFFER_SIZE_MISMATCH);
+        float h[MAX_FILTER_SIZE];
+        float g[MAX_FILTER_SIZE];
+        size_t nh = find_filter(config->wavelet, h, g);
+        if (nh == 0)
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
 
-            fvec features;
-            size_t num_features = dwt_features(
-                data_window,
+        const size_t num_features = (config->wavelet_level + 1) * NUM_FEATHERS_PER_COMP;
+        assert(num_features == output_matrix->cols / input_matrix->rows);
+        if (num_features * input_matrix->rows > output_matrix->rows * output_matrix->cols)
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+
+        // one workspace for all levels of all axes
+        matrix_t workspace(1, get_workspace_floats(data_size, nh));
+        if (!workspace.buffer)
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+
+        for (size_t row = 0; row < input_matrix->rows; row++) {
+            dwt_features(
+                input_matrix->get_row_ptr(row),
                 data_size,
-                config->wavelet,
+                h,
+                g,
+                nh,
                 config->wavelet_level,
-                features);
-
-            assert(num_features == output_matrix->cols / input_matrix->rows);
-            for (size_t i = 0; i < num_features; i++) {
-                output_matrix->buffer[out_idx++] = features[i];
-            }
+                workspace.buffer,
+                output_matrix->buffer + row * num_features);
         }
         return EIDSP_OK;
     }
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+
+#ifndef _EIDSP_SPEECHPY_DCT_PLAN_H_
+#define _EIDSP_SPEECHPY_DCT_PLAN_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "../config.hpp"
+#include "../numpy.hpp"
+#include "../memory.hpp"
+#include "../returntypes.hpp"
+
+namespace ei {
+namespace speechpy {
+
+/**
+ * Type II DCT for the case where only the first few coefficients are needed
+ * (MFCC keeps num_cepstral out of num_filters). Same result as `numpy::dct2`
+ * on those coefficients, within float rounding.
+ * Depending on the sizes the coefficients come either from a truncated DCT matrix
+ * (only the kept rows) or from a real FFT of the reordered input, with the kissfft
+ * plan and the per-bin twiddles stored. Either way the plan is computed once and
+ * cached for as long as the sizes do not change, a frame does not allocate.
+ */
+class dct_plan {
+public:
+    typedef struct {
+        uint16_t length;         // N, input length
+        uint16_t num_out;        // coefficients kept
+        DCT_NORMALIZATION_MODE normalization;
+        bool use_fft;
+        float *matrix;           // num_out x length, scaling included (matrix mode)
+        float *input;            // length entries, copy of the frame (both modes)
+        float *fft_scratch;      // length entries, scratch for rfft (fft mode)
+        fft_complex_t *fft_output; // length / 2 + 1 entries (fft mode)
+        float *twiddle_cos;      // num_out entries, scaling included (fft mode)
+        float *twiddle_sin;      // num_out entries, scaling included (fft mode)
+        kiss_fftr_cfg cfg;       // nullptr if kissfft is not compiled in
+        size_t mem_size;
+    } plan_t;
+
+    /**
+     * Type II DCT of every row of a matrix, in place. Only the first `num_out`
+     * columns of every row are valid afterwards.
+     * @param matrix Input / output, one transform per row
+     * @param num_out Number of coefficients to keep (clamped to the row length)
+     * @param normalization Same as `numpy::dct2`
+     * @returns EIDSP_OK if OK
+     */
+    static int dct2(matrix_t *matrix, size_t num_out,
+        DCT_NORMALIZATION_MODE normalization = DCT_NORMALIZATION_NONE)
+    {
+        const size_t len = matrix->cols;
+        if (len == 0 || matrix->rows == 0) {
+            return EIDSP_OK;
+        }
+        if (num_out > len) {
+            num_out = len;
+        }
+        if (len > UINT16_MAX) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        plan_t *plan = get_plan(len, num_out, normalization);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        for (size_t row = 0; row < matrix->rows; row++) {
+            float *x = matrix->get_row_ptr(row);
+            int ret = plan->use_fft ? run_fft(plan, x) : run_matrix(plan, x);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Release the cached plan, the next call to `dct2` rebuilds it
+     */
+    static void free_plan()
+    {
+        plan_t **plan = plan_ref();
+        if (*plan) {
+            ei_dsp_free(*plan, (*plan)->mem_size);
+            *plan = nullptr;
+        }
+    }
+
+private:
+    static plan_t **plan_ref()
+    {
+        static plan_t *plan = nullptr;
+        return &plan;
+    }
+
+    static size_t align8(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+
+    /**
+     * Rough multiply count per frame. The matrix needs num_out * len, the FFT route
+     * about 2.5 * len * log2(len) for the half length complex FFT plus its split,
+     * and a handful per output bin.
+     */
+    static bool prefer_fft(size_t len, size_t num_out)
+    {
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+        if (len % 2 != 0 || len < 8) {
+            return false;
+        }
+        size_t log2_len = 0;
+        while ((static_cast<size_t>(1) << (log2_len + 1)) <= len) {
+            log2_len++;
+        }
+        const size_t fft_cost = (5 * len * log2_len) / 2 + 2 * len + 4 * num_out;
+        return fft_cost < num_out * len;
+#else
+        (void)len;
+        (void)num_out;
+        return false;
+#endif
+    }
+
+    /**
+     * Scale of output bin k: the 2x of numpy::dct2 and the optional ortho normalization
+     */
+    static double get_scale(size_t k, size_t len, DCT_NORMALIZATION_MODE normalization)
+    {
+        if (normalization != DCT_NORMALIZATION_ORTHO) {
+            return 2.0;
+        }
+        return 2.0 * ::sqrt(1.0 / static_cast<double>((k == 0 ? 4 : 2) * len));
+    }
+
+    static plan_t *get_plan(size_t len, size_t num_out, DCT_NORMALIZATION_MODE normalization)
+    {
+        plan_t **cached = plan_ref();
+        plan_t *plan = *cached;
+        if (plan && plan->length == len && plan->num_out == num_out &&
+            plan->normalization == normalization) {
+            return plan;
+        }
+        free_plan();
+
+        const bool use_fft = prefer_fft(len, num_out);
+        const size_t fft_out_size = len / 2 + 1;
+
+        size_t offsets[6];
+        size_t cfg_size = 0;
+        size_t mem_size = align8(sizeof(plan_t));
+        offsets[0] = mem_size; mem_size += align8(len * sizeof(float));
+        if (use_fft) {
+            offsets[1] = mem_size; mem_size += align8(len * sizeof(float));
+            offsets[2] = mem_size; mem_size += align8(fft_out_size * sizeof(fft_complex_t));
+            offsets[3] = mem_size; mem_size += align8(num_out * sizeof(float));
+            offsets[4] = mem_size; mem_size += align8(num_out * sizeof(float));
+            offsets[5] = mem_size;
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+            kiss_fftr_alloc(len, 0, nullptr, &cfg_size);
+#endif
+            mem_size += cfg_size;
+        }
+        else {
+            offsets[1] = mem_size; mem_size += num_out * len * sizeof(float);
+        }
+
+        uint8_t *mem = (uint8_t*)ei_dsp_calloc(mem_size, 1);
+        if (!mem) {
+            return nullptr;
+        }
+
+        plan = reinterpret_cast<plan_t*>(mem);
+        plan->length = len;
+        plan->num_out = num_out;
+        plan->normalization = normalization;
+        plan->use_fft = use_fft;
+        plan->input = reinterpret_cast<float*>(mem + offsets[0]);
+        plan->matrix = nullptr;
+        plan->fft_scratch = nullptr;
+        plan->fft_output = nullptr;
+        plan->twiddle_cos = nullptr;
+        plan->twiddle_sin = nullptr;
+        plan->cfg = nullptr;
+        plan->mem_size = mem_size;
+
+        if (use_fft) {
+            plan->fft_scratch = reinterpret_cast<float*>(mem + offsets[1]);
+            plan->fft_output = reinterpret_cast<fft_complex_t*>(mem + offsets[2]);
+            plan->twiddle_cos = reinterpret_cast<float*>(mem + offsets[3]);
+            plan->twiddle_sin = reinterpret_cast<float*>(mem + offsets[4]);
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+            plan->cfg = kiss_fftr_alloc(len, 0, mem + offsets[5], &cfg_size);
+#endif
+            for (size_t k = 0; k < num_out; k++) {
+                const double angle = k * M_PI / (2.0 * len);
+                const double scale = get_scale(k, len, normalization);
+                plan->twiddle_cos[k] = static_cast<float>(::cos(angle) * scale);
+                plan->twiddle_sin[k] = static_cast<float>(::sin(angle) * scale);
+            }
+        }
+        else {
+            plan->matrix = reinterpret_cast<float*>(mem + offsets[1]);
+            for (size_t k = 0; k < num_out; k++) {
+                const double scale = get_scale(k, len, normalization);
+                float *row = plan->matrix + k * len;
+                for (size_t n = 0; n < len; n++) {
+                    // X[k] = scale * sum(x[n] * cos(pi * k * (2n + 1) / (2N)))
+                    row[n] = static_cast<float>(
+                        scale * ::cos(M_PI * k * (2 * n + 1) / (2.0 * len)));
+                }
+            }
+        }
+
+        *cached = plan;
+        return plan;
+    }
+
+    static int run_matrix(plan_t *plan, float *x)
+    {
+        const size_t len = plan->length;
+        memcpy(plan->input, x, len * sizeof(float));
+        for (size_t k = 0; k < plan->num_out; k++) {
+            const float *row = plan->matrix + k * len;
+            float sum = 0.0f;
+            for (size_t n = 0; n < len; n++) {
+                sum += row[n] * plan->input[n];
+            }
+            x[k] = sum;
+        }
+        return EIDSP_OK;
+    }
+
+    static int run_fft(plan_t *plan, float *x)
+    {
+        const size_t len = plan->length;
+        const size_t half_len = len / 2;
+
+        // even samples ascending, odd samples descending (see numpy::dct_transform)
+        for (size_t i = 0; i < half_len; i++) {
+            plan->input[i] = x[i * 2];
+            plan->input[len - 1 - i] = x[i * 2 + 1];
+        }
+
+        EI_TRY(numpy::rfft(plan->input, len, plan->fft_output, len,
+            plan->fft_scratch, plan->cfg));
+
+        for (size_t k = 0; k < plan->num_out; k++) {
+            if (k <= half_len) {
+                const fft_complex_t &c = plan->fft_output[k];
+                x[k] = c.r * plan->twiddle_cos[k] + c.i * plan->twiddle_sin[k];
+            }
+            else {
+                // upper bins are the conjugate of the lower half
+                const fft_complex_t &c = plan->fft_output[len - k];
+                x[k] = c.r * plan->twiddle_cos[k] - c.i * plan->twiddle_sin[k];
+            }
+        }
+        return EIDSP_OK;
+    }
+};
+
+} // namespace speechpy
+} // namespace ei
+
+#endif // _EIDSP_SPEECHPY_DCT_PLAN_H_
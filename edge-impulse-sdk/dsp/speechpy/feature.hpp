@@ -36,6 +36,8 @@
 #include "../ei_utils.h"
 #include "functions.hpp"
 #include "processing.hpp"
+#include "dct_plan.hpp"
+#include "../spectral/fft_workspace.hpp"
 #include "../memory.hpp"
 #include "../returntypes.hpp"
 #include "../ei_vector.h"
@@ -193,6 +195,67 @@ public:
         return static_cast<int>(floor((fft_size + 1) * hertz / sampling_freq));
     }
 
+    /**
+     * @brief Calculate the fft bins that bound each mel filter, as used by `mfe`
+     *
+     * @param mels Scratch buffer of num_filters + 2 floats, holds the bins
+     *     (as uint16_t) on return
+     * @param low_frequency In Hz, 0 means 300 Hz before version 4
+     * @param high_frequency In Hz, 0 means sampling_frequency / 2
+     */
+    static void calculate_mel_bins(float *mels, uint16_t num_filters, uint16_t fft_length,
+        uint32_t sampling_frequency, uint32_t low_frequency, uint32_t high_frequency,
+        uint16_t version)
+    {
+        if (high_frequency == 0) {
+            high_frequency = sampling_frequency / 2;
+        }
+
+        if (version<4) {
+            if (low_frequency == 0) {
+                low_frequency = 300;
+            }
+        }
+
+        // Computing the Mel filterbank
+        // converting the upper and lower frequencies to Mels.
+        // num_filter + 2 is because for num_filter filterbanks we need
+        // num_filter+2 point.
+        const int MELS_SIZE = num_filters + 2;
+        const uint16_t power_spectrum_frame_size = (fft_length / 2 + 1);
+        uint16_t* bins = reinterpret_cast<uint16_t*>(mels); // alias the mels array so we can reuse the space
+
+        numpy::linspace(
+            functions::frequency_to_mel(static_cast<float>(low_frequency)),
+            functions::frequency_to_mel(static_cast<float>(high_frequency)),
+            num_filters + 2,
+            mels);
+
+        uint16_t max_bin = version >= 4 ? fft_length : power_spectrum_frame_size; // preserve a bug in v<4
+        // go to -1 size b/c special handling, see after
+        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
+            mels[ix] = functions::mel_to_frequency(mels[ix]);
+            if (mels[ix] < low_frequency) {
+                mels[ix] = low_frequency;
+            }
+            if (mels[ix] > high_frequency) {
+                mels[ix] = high_frequency;
+            }
+            bins[ix] = get_fft_bin_from_hertz(max_bin, mels[ix], sampling_frequency);
+        }
+
+        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
+        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
+        // thus calculating the bucket to 64, not 65.
+        // we're adjusting this here a tiny bit to ensure we have the same result
+        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
+        if (mels[MELS_SIZE-1] > high_frequency) {
+            mels[MELS_SIZE-1] = high_frequency;
+        }
+        mels[MELS_SIZE-1] -= 0.001;
+        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(max_bin, mels[MELS_SIZE-1], sampling_frequency);
+    }
+
     /**
      * Compute Mel-filterbank energy features from an audio signal.
      * @param out_features Use `calculate_mfe_buffer_size` to allocate the right matrix.
@@ -223,21 +286,9 @@ public:
     {
         int ret = 0;
 
-        if (high_frequency == 0) {
-            high_frequency = sampling_frequency / 2;
-        }
-
-        if (version<4) {
-            if (low_frequency == 0) {
-                low_frequency = 300;
-            }
-        }
-
-        stack_frames_info_t stack_frame_info = { 0 };
-        stack_frame_info.signal = signal;
-
-        ret = processing::stack_frames(
-            &stack_frame_info,
+        processing::frame_reader frames;
+        ret = frames.init(
+            signal,
             sampling_frequency,
             frame_length,
             frame_stride,
@@ -248,7 +299,7 @@ public:
             EIDSP_ERR(ret);
         }
 
-        if (stack_frame_info.frame_ixs.size() != out_features->rows) {
+        if (frames.size() != out_features->rows) {
             EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
         }
 
@@ -257,7 +308,7 @@ public:
         }
 
         if (out_energies) {
-            if (stack_frame_info.frame_ixs.size() != out_energies->rows || out_energies->cols != 1) {
+            if (frames.size() != out_energies->rows || out_energies->cols != 1) {
                 EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
             }
         }
@@ -267,87 +318,42 @@ public:
         }
 
         const size_t power_spectrum_frame_size = (fft_length / 2 + 1);
-        // Computing the Mel filterbank
-        // converting the upper and lower frequencies to Mels.
-        // num_filter + 2 is because for num_filter filterbanks we need
-        // num_filter+2 point.
-        float *mels;
         const int MELS_SIZE = num_filters + 2;
         const size_t mem_size = MELS_SIZE * sizeof(float);
-        mels = (float*)ei_dsp_calloc(MELS_SIZE, sizeof(float));
+        float *mels = (float*)ei_dsp_calloc(MELS_SIZE, sizeof(float));
         EI_ERR_AND_RETURN_ON_NULL(mels, EIDSP_OUT_OF_MEM);
         ei_unique_ptr_t __ptr__(mels,[mem_size](void* ptr){ei::ei_dsp_free_func(ptr, mem_size);});
         uint16_t* bins = reinterpret_cast<uint16_t*>(mels); // alias the mels array so we can reuse the space
 
-        numpy::linspace(
-            functions::frequency_to_mel(static_cast<float>(low_frequency)),
-            functions::frequency_to_mel(static_cast<float>(high_frequency)),
-            num_filters + 2,
-            mels);
-
-        uint16_t max_bin = version >= 4 ? fft_length : power_spectrum_frame_size; // preserve a bug in v<4
-        // go to -1 size b/c special handling, see after
-        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
-            mels[ix] = functions::mel_to_frequency(mels[ix]);
-            if (mels[ix] < low_frequency) {
-                mels[ix] = low_frequency;
-            }
-            if (mels[ix] > high_frequency) {
-                mels[ix] = high_frequency;
-            }
-            bins[ix] = get_fft_bin_from_hertz(max_bin, mels[ix], sampling_frequency);
-        }
-
-        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
-        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
-        // thus calculating the bucket to 64, not 65.
-        // we're adjusting this here a tiny bit to ensure we have the same result
-        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
-        if (mels[MELS_SIZE-1] > high_frequency) {
-            mels[MELS_SIZE-1] = high_frequency;
-        }
-        mels[MELS_SIZE-1] -= 0.001;
-        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(max_bin, mels[MELS_SIZE-1], sampling_frequency);
+        calculate_mel_bins(mels, num_filters, fft_length, sampling_frequency,
+            low_frequency, high_frequency, version);
 
-        EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
-        if (!power_spectrum_frame.buffer) {
+        // FFT plan and power spectrum buffer are reused for every frame
+        spectral::fft_workspace::plan_t *plan = spectral::fft_workspace::get_plan(fft_length);
+        if (!plan) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
+        float *power_spectrum_frame = plan->spectrum;
 
-        // get signal data from the audio file
-        EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
-
-        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
-            // don't read outside of the audio buffer... we'll automatically zero pad then
-            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
-            size_t signal_length = stack_frame_info.frame_length;
-            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
-                signal_length = signal_length -
-                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
-            }
-
-            ret = stack_frame_info.signal->get_data(
-                signal_offset,
-                signal_length,
-                signal_frame.buffer
-            );
+        for (size_t ix = 0; ix < frames.size(); ix++) {
+            float *signal_frame;
+            ret = frames.read(ix, &signal_frame);
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
 
-            ret = numpy::power_spectrum(
-                signal_frame.buffer,
-                stack_frame_info.frame_length,
-                power_spectrum_frame.buffer,
-                power_spectrum_frame_size,
-                fft_length
+            ret = spectral::fft_workspace::power_spectrum(
+                plan,
+                signal_frame,
+                frames.frame_length(),
+                power_spectrum_frame
             );
 
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
 
-            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
+            float energy = numpy::sum(power_spectrum_frame, power_spectrum_frame_size);
             if (energy == 0) {
                 energy = 1e-10;
             }
@@ -368,19 +374,19 @@ public:
 
                 // middle always has weight of 1.0
                 // since we skip left and right, if left = middle we need to handle that
-                row_ptr[i] = power_spectrum_frame.buffer[middle];
+                row_ptr[i] = power_spectrum_frame[middle];
 
                 for (size_t bin = left+1; bin < right; bin++) {
                     if (bin < middle) {
                         row_ptr[i] +=
                             ((static_cast<float>(bin) - left) / (middle - left)) * // weight *
-                            power_spectrum_frame.buffer[bin];
+                            power_spectrum_frame[bin];
                     }
                     // intentionally skip middle, handled above
                     if (bin > middle) {
                         row_ptr[i] +=
                             ((right - static_cast<float>(bin)) / (right - middle)) * // weight *
-                            power_spectrum_frame.buffer[bin];
+                            power_spectrum_frame[bin];
                     }
                 }
             }
@@ -433,11 +439,9 @@ public:
             low_frequency = 300;
         }
 
-        stack_frames_info_t stack_frame_info = { 0 };
-        stack_frame_info.signal = signal;
-
-        ret = processing::stack_frames(
-            &stack_frame_info,
+        processing::frame_reader frames;
+        ret = frames.init(
+            signal,
             sampling_frequency,
             frame_length,
             frame_stride,
@@ -448,7 +452,7 @@ public:
             EIDSP_ERR(ret);
         }
 
-        if (stack_frame_info.frame_ixs.size() != out_features->rows) {
+        if (frames.size() != out_features->rows) {
             EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
         }
 
@@ -457,7 +461,7 @@ public:
         }
 
         if (out_energies) {
-            if (stack_frame_info.frame_ixs.size() != out_energies->rows || out_energies->cols != 1) {
+            if (frames.size() != out_energies->rows || out_energies->cols != 1) {
                 EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
             }
         }
@@ -484,47 +488,34 @@ public:
         if (ret != 0) {
             EIDSP_ERR(ret);
         }
-        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
-            size_t power_spectrum_frame_size = (fft_length / 2 + 1);
 
-            EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
-            if (!power_spectrum_frame.buffer) {
-                EIDSP_ERR(EIDSP_OUT_OF_MEM);
-            }
-
-            // get signal data from the audio file
-            EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
-
-            // don't read outside of the audio buffer... we'll automatically zero pad then
-            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
-            size_t signal_length = stack_frame_info.frame_length;
-            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
-                signal_length = signal_length -
-                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
-            }
+        // FFT plan and power spectrum buffer are reused for every frame
+        spectral::fft_workspace::plan_t *plan = spectral::fft_workspace::get_plan(fft_length);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        const size_t power_spectrum_frame_size = coefficients;
+        float *power_spectrum_frame = plan->spectrum;
 
-            ret = stack_frame_info.signal->get_data(
-                signal_offset,
-                signal_length,
-                signal_frame.buffer
-            );
+        for (size_t ix = 0; ix < frames.size(); ix++) {
+            float *signal_frame;
+            ret = frames.read(ix, &signal_frame);
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
 
-            ret = numpy::power_spectrum(
-                signal_frame.buffer,
-                stack_frame_info.frame_length,
-                power_spectrum_frame.buffer,
-                power_spectrum_frame_size,
-                fft_length
+            ret = spectral::fft_workspace::power_spectrum(
+                plan,
+                signal_frame,
+                frames.frame_length(),
+                power_spectrum_frame
             );
 
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
 
-            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
+            float energy = numpy::sum(power_spectrum_frame, power_spectrum_frame_size);
             if (energy == 0) {
                 energy = 1e-10;
             }
@@ -536,7 +527,7 @@ public:
             // calculate the out_features directly here
             ret = numpy::dot_by_row(
                 ix,
-                power_spectrum_frame.buffer,
+                power_spectrum_frame,
                 power_spectrum_frame_size,
                 &filterbanks,
                 out_features
@@ -573,11 +564,9 @@ public:
     {
         int ret = 0;
 
-        stack_frames_info_t stack_frame_info = { 0 };
-        stack_frame_info.signal = signal;
-
-        ret = processing::stack_frames(
-            &stack_frame_info,
+        processing::frame_reader frames;
+        ret = frames.init(
+            signal,
             sampling_frequency,
             frame_length,
             frame_stride,
@@ -588,7 +577,7 @@ public:
             EIDSP_ERR(ret);
         }
 
-        if (stack_frame_info.frame_ixs.size() != out_features->rows) {
+        if (frames.size() != out_features->rows) {
             EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
         }
 
@@ -602,23 +591,14 @@ public:
             *(out_features->buffer + i) = 0;
         }
 
-        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
-            // get signal data from the audio file
-            EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
-
-            // don't read outside of the audio buffer... we'll automatically zero pad then
-            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
-            size_t signal_length = stack_frame_info.frame_length;
-            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
-                signal_length = signal_length -
-                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
-            }
+        spectral::fft_workspace::plan_t *plan = spectral::fft_workspace::get_plan(fft_length);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
 
-            ret = stack_frame_info.signal->get_data(
-                signal_offset,
-                signal_length,
-                signal_frame.buffer
-            );
+        for (size_t ix = 0; ix < frames.size(); ix++) {
+            float *signal_frame;
+            ret = frames.read(ix, &signal_frame);
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
@@ -627,27 +607,27 @@ public:
             if (version == 3) {
                 // it might be that everything is already normalized here...
                 bool all_between_min_1_and_1 = true;
-                for (size_t ix = 0; ix < signal_frame.rows * signal_frame.cols; ix++) {
-                    if (signal_frame.buffer[ix] < -1.0f || signal_frame.buffer[ix] > 1.0f) {
+                for (size_t ix = 0; ix < frames.frame_length(); ix++) {
+                    if (signal_frame[ix] < -1.0f || signal_frame[ix] > 1.0f) {
                         all_between_min_1_and_1 = false;
                         break;
                     }
                 }
 
                 if (!all_between_min_1_and_1) {
-                    ret = numpy::scale(&signal_frame, 1.0f / 32768.0f);
+                    matrix_t frame_matrix(1, frames.frame_length(), signal_frame);
+                    ret = numpy::scale(&frame_matrix, 1.0f / 32768.0f);
                     if (ret != 0) {
                         EIDSP_ERR(ret);
                     }
                 }
             }
 
-            ret = numpy::power_spectrum(
-                signal_frame.buffer,
-                stack_frame_info.frame_length,
-                out_features->buffer + (ix * coefficients),
-                coefficients,
-                fft_length
+            ret = spectral::fft_workspace::power_spectrum(
+                plan,
+                signal_frame,
+                frames.frame_length(),
+                out_features->buffer + (ix * coefficients)
             );
 
             if (ret != 0) {
@@ -762,8 +742,8 @@ public:
             EIDSP_ERR(ret);
         }
 
-        // now do DST type 2
-        ret = numpy::dct2(&features_matrix, DCT_NORMALIZATION_ORTHO);
+        // now do DCT type 2, only the coefficients we keep
+        ret = dct_plan::dct2(&features_matrix, num_cepstral, DCT_NORMALIZATION_ORTHO);
         if (ret != EIDSP_OK) {
             EIDSP_ERR(ret);
         }
@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+
+#ifndef _EIDSP_SPEECHPY_FEATURE_Q15_H_
+#define _EIDSP_SPEECHPY_FEATURE_Q15_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "../config.hpp"
+#include "feature.hpp"
+#include "processing.hpp"
+#include "../memory.hpp"
+#include "../returntypes.hpp"
+
+namespace ei {
+namespace speechpy {
+
+/**
+ * Fixed-point MFE front end for quantized models (implementation version 3 and up).
+ * Computes what `feature::mfe` on the pre-emphasized signal followed by
+ * `processing::mfe_normalization` and the int8 quantization of the model input
+ * computes, without going through float features:
+ * pre-emphasis in Q15, each frame normalized to Q15 with one shift per frame, a
+ * radix-2 real FFT in int32 with Q15 twiddles, the filterbank accumulated in 64 bits
+ * with Q15 weights, log2 from a 257 entry table and the normalization folded into one
+ * multiply-add that gives the 1/256 step straight away. A 257 entry table maps the
+ * step to the quantized model input.
+ * The signal has to hold int16 audio samples (as floats), like the float path assumes
+ * when it rescales by 1/32768.
+ * The twiddles, bit reversal table, filter weights and log2 table are computed once
+ * and cached for as long as the configuration does not change, a frame does not allocate.
+ */
+class feature_q15 {
+public:
+    typedef struct {
+        uint16_t fft_length;
+        uint16_t num_filters;
+        uint32_t sampling_frequency;
+        uint32_t low_frequency;
+        uint32_t high_frequency;
+        uint16_t version;
+        uint8_t log2_n;
+        int16_t *twiddles;       // cos, -sin pairs for k < fft_length / 2
+        uint16_t *bitrev;        // fft_length / 2 entries
+        uint16_t *filter_start;  // first bin of filter i, num_filters entries
+        uint16_t *weight_offset; // first weight of filter i, num_filters + 1 entries
+        uint16_t *weights;       // Q15 (32768 = 1.0), every bin of every filter
+        uint32_t *log2_table;    // log2(1 + i / 256) in Q16, 257 entries
+        float *samples;          // fft_length + 1 entries, previous sample + frame
+        int32_t *work;           // fft_length entries, complex half length fft
+        uint64_t *power;         // fft_length / 2 + 1 entries
+        size_t mem_size;
+    } plan_t;
+
+    /**
+     * Normalized MFE features, quantized.
+     * @param out_features Output, frames x num_filters (see `feature::calculate_mfe_buffer_size`)
+     * @param signal Audio signal, not pre-emphasized (pre-emphasis is done here, shift 1, 0.98)
+     * @param noise_floor_db Noise floor of `processing::mfe_normalization`
+     * @param quantize_table Model input for every normalized value v / 256, v = 0..256
+     * Other parameters as `feature::mfe`.
+     * @returns EIDSP_OK if OK
+     */
+    static int mfe(matrix_i8_t *out_features,
+        signal_t *signal,
+        uint32_t sampling_frequency,
+        float frame_length, float frame_stride, uint16_t num_filters,
+        uint16_t fft_length, uint32_t low_frequency, uint32_t high_frequency,
+        uint16_t version, int noise_floor_db, const int8_t *quantize_table
+        )
+    {
+        if (!is_supported(fft_length, noise_floor_db) || version < 3) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+        if (!signal || !signal->get_data || signal->total_length == 0) {
+            EIDSP_ERR(EIDSP_SIGNAL_SIZE_MISMATCH);
+        }
+
+        plan_t *plan = get_plan(num_filters, fft_length, sampling_frequency,
+            low_frequency, high_frequency, version);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        // the first sample is pre-emphasized against the last one, see processing::preemphasis
+        float last_sample;
+        int ret = signal->get_data(signal->total_length - 1, 1, &last_sample);
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        // frame_layout trims the length, keep the caller's signal as it is
+        signal_t framed = *signal;
+        int frame_sample_length;
+        size_t stride;
+        const size_t num_frames = processing::frame_layout(&framed, sampling_frequency,
+            frame_length, frame_stride, false, version, &frame_sample_length, &stride);
+
+        if (num_frames != out_features->rows || num_filters != out_features->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        // the frame is truncated or zero padded to the fft length, like numpy::rfft does
+        const size_t frame_size = static_cast<size_t>(frame_sample_length) < fft_length ?
+            static_cast<size_t>(frame_sample_length) : fft_length;
+
+        // v = round(256 * (10 * log10(mel) + noise) / (noise + 12)), with log2(mel) in Q16
+        const double noise = static_cast<double>(-noise_floor_db);
+        const int64_t v_scale = llround(256.0 * 10.0 * log10(2.0) / (noise + 12.0) * 65536.0);
+        const int64_t v_offset = llround(256.0 * noise / (noise + 12.0) * 4294967296.0) + (1LL << 31);
+        // numpy::zero_handling turns an empty filter into 1e-10
+        const int64_t log2_zero = llround(log2(1e-10) * 65536.0);
+
+        for (size_t ix = 0; ix < num_frames; ix++) {
+            const size_t offset = ix * stride;
+            size_t length = frame_size;
+            if (offset + length > framed.total_length) {
+                length = offset < framed.total_length ? framed.total_length - offset : 0;
+            }
+
+            if (offset == 0) {
+                plan->samples[0] = last_sample;
+                ret = length > 0 ? signal->get_data(0, length, plan->samples + 1) : 0;
+            }
+            else {
+                ret = signal->get_data(offset - 1, length + 1, plan->samples);
+            }
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            // mel[i] == acc[i] * 2^-(2 * exponent + log2_n)
+            const int exponent = power_spectrum(plan, length);
+
+            int8_t *row_ptr = out_features->buffer + ix * num_filters;
+            for (size_t i = 0; i < num_filters; i++) {
+                const uint16_t *w = plan->weights + plan->weight_offset[i];
+                const uint16_t *w_end = plan->weights + plan->weight_offset[i + 1];
+                const uint64_t *p = plan->power + plan->filter_start[i];
+                uint64_t acc = 0;
+                while (w < w_end) {
+                    acc += (*p++ >> 15) * *w++;
+                }
+
+                int64_t log2_mel = acc == 0 ? log2_zero :
+                    log2_q16(plan->log2_table, acc) - (static_cast<int64_t>(2 * exponent + plan->log2_n) << 16);
+                int64_t v = (v_scale * log2_mel + v_offset) >> 32;
+                if (v < 0) v = 0;
+                else if (v > 256) v = 256;
+                row_ptr[i] = quantize_table[v];
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Whether `mfe` can run with these parameters: fft length a power of 2 (at least 4),
+     * and a noise floor that `processing::mfe_normalization` can scale by
+     */
+    static bool is_supported(uint16_t fft_length, int noise_floor_db)
+    {
+        return fft_length >= 4 && (fft_length & (fft_length - 1)) == 0 && -noise_floor_db + 12 > 0;
+    }
+
+    /**
+     * Get the cached plan, rebuilt if the configuration changed
+     * @returns nullptr if out of memory, or if a filter ends past the last fft bin
+     */
+    static plan_t *get_plan(uint16_t num_filters, uint16_t fft_length,
+        uint32_t sampling_frequency, uint32_t low_frequency, uint32_t high_frequency,
+        uint16_t version)
+    {
+        plan_t **cached = plan_ref();
+        plan_t *plan = *cached;
+        if (plan && plan->num_filters == num_filters && plan->fft_length == fft_length &&
+            plan->sampling_frequency == sampling_frequency && plan->low_frequency == low_frequency &&
+            plan->high_frequency == high_frequency && plan->version == version) {
+            return plan;
+        }
+        free_plan();
+
+        const size_t half = fft_length / 2;
+        const size_t power_spectrum_frame_size = half + 1;
+        const size_t mels_size = num_filters + 2;
+
+        // mel bins first, the amount of weights depends on them
+        float *mels = (float*)ei_dsp_calloc(mels_size, sizeof(float));
+        if (!mels) {
+            return nullptr;
+        }
+        feature::calculate_mel_bins(mels, num_filters, fft_length, sampling_frequency,
+            low_frequency, high_frequency, version);
+        const uint16_t *bins = reinterpret_cast<uint16_t*>(mels);
+
+        size_t weight_count = 0;
+        for (size_t i = 0; i < num_filters; i++) {
+            if (bins[i + 2] >= power_spectrum_frame_size || bins[i + 1] < bins[i] ||
+                bins[i + 2] < bins[i + 1]) {
+                ei_dsp_free(mels, mels_size * sizeof(float));
+                return nullptr;
+            }
+            weight_count += filter_end(bins, i) - filter_start(bins, i) + 1;
+        }
+
+        // one allocation for the whole plan, arrays are laid out back to back
+        size_t offsets[9];
+        size_t mem_size = align8(sizeof(plan_t));
+        offsets[0] = mem_size; mem_size += align8(half * 2 * sizeof(int16_t));
+        offsets[1] = mem_size; mem_size += align8(half * sizeof(uint16_t));
+        offsets[2] = mem_size; mem_size += align8(num_filters * sizeof(uint16_t));
+        offsets[3] = mem_size; mem_size += align8((num_filters + 1) * sizeof(uint16_t));
+        offsets[4] = mem_size; mem_size += align8(weight_count * sizeof(uint16_t));
+        offsets[5] = mem_size; mem_size += align8(257 * sizeof(uint32_t));
+        offsets[6] = mem_size; mem_size += align8((fft_length + 1) * sizeof(float));
+        offsets[7] = mem_size; mem_size += align8(fft_length * sizeof(int32_t));
+        offsets[8] = mem_size; mem_size += power_spectrum_frame_size * sizeof(uint64_t);
+
+        uint8_t *mem = (uint8_t*)ei_dsp_calloc(mem_size, 1);
+        if (!mem) {
+            ei_dsp_free(mels, mels_size * sizeof(float));
+            return nullptr;
+        }
+
+        plan = reinterpret_cast<plan_t*>(mem);
+        plan->fft_length = fft_length;
+        plan->num_filters = num_filters;
+        plan->sampling_frequency = sampling_frequency;
+        plan->low_frequency = low_frequency;
+        plan->high_frequency = high_frequency;
+        plan->version = version;
+        plan->twiddles = reinterpret_cast<int16_t*>(mem + offsets[0]);
+        plan->bitrev = reinterpret_cast<uint16_t*>(mem + offsets[1]);
+        plan->filter_start = reinterpret_cast<uint16_t*>(mem + offsets[2]);
+        plan->weight_offset = reinterpret_cast<uint16_t*>(mem + offsets[3]);
+        plan->weights = reinterpret_cast<uint16_t*>(mem + offsets[4]);
+        plan->log2_table = reinterpret_cast<uint32_t*>(mem + offsets[5]);
+        plan->samples = reinterpret_cast<float*>(mem + offsets[6]);
+        plan->work = reinterpret_cast<int32_t*>(mem + offsets[7]);
+        plan->power = reinterpret_cast<uint64_t*>(mem + offsets[8]);
+        plan->mem_size = mem_size;
+
+        plan->log2_n = 0;
+        while ((1U << plan->log2_n) < fft_length) {
+            plan->log2_n++;
+        }
+
+        for (size_t k = 0; k < half; k++) {
+            double phase = 2.0 * M_PI * static_cast<double>(k) / static_cast<double>(fft_length);
+            plan->twiddles[2 * k] = to_q15(cos(phase));
+            plan->twiddles[2 * k + 1] = to_q15(-sin(phase));
+        }
+
+        // the complex fft runs over fft_length / 2 points
+        const uint8_t bits = plan->log2_n - 1;
+        for (size_t k = 0; k < half; k++) {
+            uint16_t r = 0;
+            for (uint8_t b = 0; b < bits; b++) {
+                r |= ((k >> b) & 1) << (bits - 1 - b);
+            }
+            plan->bitrev[k] = r;
+        }
+
+        // same weights as the float filterbank in feature::mfe
+        size_t w_ix = 0;
+        for (size_t i = 0; i < num_filters; i++) {
+            const uint16_t left = bins[i];
+            const uint16_t middle = bins[i + 1];
+            const uint16_t right = bins[i + 2];
+            plan->filter_start[i] = filter_start(bins, i);
+            plan->weight_offset[i] = w_ix;
+            for (size_t bin = filter_start(bins, i); bin <= filter_end(bins, i); bin++) {
+                float weight = 0.0f;
+                if (bin == middle) {
+                    weight = 1.0f;
+                }
+                else if (bin < middle) {
+                    weight = (static_cast<float>(bin) - left) / (middle - left);
+                }
+                else if (bin < right) {
+                    weight = (right - static_cast<float>(bin)) / (right - middle);
+                }
+                plan->weights[w_ix++] = static_cast<uint16_t>(weight * 32768.0f + 0.5f);
+            }
+        }
+        plan->weight_offset[num_filters] = w_ix;
+
+        for (size_t i = 0; i <= 256; i++) {
+            plan->log2_table[i] = static_cast<uint32_t>(lround(log2(1.0 + i / 256.0) * 65536.0));
+        }
+
+        ei_dsp_free(mels, mels_size * sizeof(float));
+
+        *cached = plan;
+        return plan;
+    }
+
+    /**
+     * Release the cached plan, the next call to `mfe` rebuilds it
+     */
+    static void free_plan()
+    {
+        plan_t **plan = plan_ref();
+        if (*plan) {
+            ei_dsp_free(*plan, (*plan)->mem_size);
+            *plan = nullptr;
+        }
+    }
+
+private:
+    static plan_t **plan_ref()
+    {
+        static plan_t *plan = nullptr;
+        return &plan;
+    }
+
+    static size_t align8(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+
+    // first and last bin with a (possibly) non-zero weight for filter i, left and
+    // right have zero weight but the middle bin always carries a weight of 1
+    static size_t filter_start(const uint16_t *bins, size_t i)
+    {
+        return bins[i + 1] > bins[i] ? bins[i] + 1 : bins[i];
+    }
+
+    static size_t filter_end(const uint16_t *bins, size_t i)
+    {
+        size_t end = bins[i + 2] > 0 ? bins[i + 2] - 1 : 0;
+        return end > bins[i + 1] ? end : bins[i + 1];
+    }
+
+    static int16_t to_q15(double v)
+    {
+        long q = lround(v * 32768.0);
+        return static_cast<int16_t>(q > 32767 ? 32767 : (q < -32768 ? -32768 : q));
+    }
+
+    static int32_t to_int16(float v)
+    {
+        long q = lrintf(v);
+        return static_cast<int32_t>(q > 32767 ? 32767 : (q < -32768 ? -32768 : q));
+    }
+
+    /**
+     * log2(value) in Q16, value > 0. Linear interpolation in the table, 16 bits of
+     * mantissa below the leading one.
+     */
+    static int64_t log2_q16(const uint32_t *table, uint64_t value)
+    {
+        int msb = 0;
+        for (int step = 32; step > 0; step >>= 1) {
+            if (value >> (msb + step)) {
+                msb += step;
+            }
+        }
+        const uint32_t mantissa = static_cast<uint32_t>(msb >= 16 ?
+            value >> (msb - 16) : value << (16 - msb)) & 0xffff;
+        const uint32_t ix = mantissa >> 8;
+        const uint32_t frac = mantissa & 0xff;
+        return (static_cast<int64_t>(msb) << 16) + table[ix] +
+            (((table[ix + 1] - table[ix]) * frac + 128) >> 8);
+    }
+
+    /**
+     * Pre-emphasis and power spectrum of the frame in plan->samples (previous sample,
+     * then `length` samples) into plan->power.
+     * @returns exponent so that power[k] == |rfft(frame)[k]|^2 * 2^(2 * exponent), frame
+     *     pre-emphasized and rescaled to [-1, 1] like processing::preemphasis
+     */
+    static int power_spectrum(plan_t *plan, size_t length)
+    {
+        const size_t n = plan->fft_length;
+        const size_t half = n / 2;
+        int32_t *z = plan->work;
+
+        // y = s - 0.98 * s_prev in Q15 of the int16 samples, |y| < 2^31
+        const int32_t cof_q15 = 32113; // round(0.98 * 2^15)
+        int32_t prev = to_int16(plan->samples[0]);
+        uint32_t max_abs = 0;
+        for (size_t i = 0; i < length; i++) {
+            const int32_t now = to_int16(plan->samples[i + 1]);
+            const int32_t y = now * 32768 - cof_q15 * prev;
+            const uint32_t a = static_cast<uint32_t>(y < 0 ? -static_cast<int64_t>(y) : y);
+            if (a > max_abs) {
+                max_abs = a;
+            }
+            z[i] = y;
+            prev = now;
+        }
+        memset(z + length, 0, (n - length) * sizeof(int32_t));
+
+        if (max_abs == 0) {
+            memset(plan->power, 0, (half + 1) * sizeof(uint64_t));
+            return 0;
+        }
+
+        // normalize to Q15 (peak in [2^14, 2^15)), one shift for the whole frame
+        int bits = 0;
+        while (bits < 32 && (max_abs >> bits) != 0) {
+            bits++;
+        }
+        const int shift = bits - 15;
+        // a complex fft over M points grows by at most M, leave log2(M) bits of headroom
+        const int headroom = 15 - (plan->log2_n - 1);
+        for (size_t i = 0; i < length; i++) {
+            int32_t q15;
+            if (shift > 0) {
+                int64_t r = (static_cast<int64_t>(z[i]) + (1LL << (shift - 1))) >> shift;
+                q15 = static_cast<int32_t>(r > 32767 ? 32767 : (r < -32768 ? -32768 : r));
+            }
+            else {
+                q15 = z[i] * (1 << -shift);
+            }
+            z[i] = q15 * (1 << headroom);
+        }
+
+        // even / odd samples are the real / imaginary parts, into bit reversed order
+        for (size_t k = 0; k < half; k++) {
+            const size_t j = plan->bitrev[k];
+            if (j > k) {
+                int32_t t0 = z[2 * k], t1 = z[2 * k + 1];
+                z[2 * k] = z[2 * j];
+                z[2 * k + 1] = z[2 * j + 1];
+                z[2 * j] = t0;
+                z[2 * j + 1] = t1;
+            }
+        }
+
+        // radix 2 decimation in time
+        for (size_t size = 2; size <= half; size <<= 1) {
+            const size_t span = size / 2;
+            const size_t tw_step = n / size;
+            for (size_t start = 0; start < half; start += size) {
+                for (size_t j = 0; j < span; j++) {
+                    const int64_t wr = plan->twiddles[2 * j * tw_step];
+                    const int64_t wi = plan->twiddles[2 * j * tw_step + 1];
+                    int32_t *a = z + 2 * (start + j);
+                    int32_t *b = z + 2 * (start + j + span);
+                    const int32_t tr = static_cast<int32_t>((b[0] * wr - b[1] * wi + (1 << 14)) >> 15);
+                    const int32_t ti = static_cast<int32_t>((b[0] * wi + b[1] * wr + (1 << 14)) >> 15);
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+
+        // split the half length complex fft into the real spectrum, |X| <= 2^31
+        int64_t out[4];
+        for (size_t k = 0; k <= half / 2; k++) {
+            split(plan, k, out);
+            plan->power[k] = power(out[0], out[1]);
+            plan->power[half - k] = power(out[2], out[3]);
+        }
+
+        // frame sample == y * 2^(30 - shift + headroom), y rescaled to [-1, 1]
+        return 30 - shift + headroom;
+    }
+
+    /**
+     * 2 * X[k] and 2 * X[M - k] (M = fft_length / 2) from the half length complex fft,
+     * as { re(k), im(k), re(M - k), im(M - k) }
+     */
+    static void split(const plan_t *plan, size_t k, int64_t *out)
+    {
+        const size_t half = plan->fft_length / 2;
+        const size_t mk = (half - k) & (half - 1);
+        const int32_t *z = plan->work;
+        const int64_t zr = z[2 * k], zi = z[2 * k + 1];
+        const int64_t cr = z[2 * mk], ci = z[2 * mk + 1];
+
+        // even part E = Z[k] + conj(Z[M-k]), odd part O = -i * (Z[k] - conj(Z[M-k]))
+        const int64_t e_r = zr + cr, e_i = zi - ci;
+        const int64_t o_r = zi + ci, o_i = cr - zr;
+
+        const int64_t wr = plan->twiddles[2 * k];
+        const int64_t wi = plan->twiddles[2 * k + 1];
+        const int64_t tr = (o_r * wr - o_i * wi + (1 << 14)) >> 15;
+        const int64_t ti = (o_r * wi + o_i * wr + (1 << 14)) >> 15;
+
+        // X[k] = E + W^k O and X[M-k] = conj(E - W^k O), k == 0 gives X[0] and X[M]
+        out[0] = e_r + tr;
+        out[1] = e_i + ti;
+        out[2] = e_r - tr;
+        out[3] = ti - e_i;
+    }
+
+    // |X|^2 from 2 * X
+    static uint64_t power(int64_t re2, int64_t im2)
+    {
+        const int64_t re = (re2 + 1) >> 1;
+        const int64_t im = (im2 + 1) >> 1;
+        return static_cast<uint64_t>(re * re) + static_cast<uint64_t>(im * im);
+    }
+};
+
+} // namespace speechpy
+} // namespace ei
+
+#endif // _EIDSP_SPEECHPY_FEATURE_Q15_H_
@@ -260,28 +260,20 @@ namespace processing {
     }
 
     /**
-     * Frame a signal into overlapping frames.
-     * @param info This is both the base object and where we'll store our results.
-     * @param sampling_frequency (int): The sampling frequency of the signal.
-     * @param frame_length (float): The length of the frame in second.
-     * @param frame_stride (float): The stride between frames.
-     * @param zero_padding (bool): If the samples is not a multiple of
-     *        frame_length(number of frames sample), zero padding will
-     *        be done for generating last frame.
-     * @returns EIDSP_OK if OK
+     * Frame layout shared by stack_frames and frame_reader, frame k starts at k * stride.
+     * Trims signal->total_length to the framed length.
+     * @returns Number of frames
      */
-    static int stack_frames(stack_frames_info_t *info,
-                            float sampling_frequency,
-                            float frame_length,
-                            float frame_stride,
-                            bool zero_padding,
-                            uint16_t version)
+    static size_t frame_layout(signal_t *signal,
+                               float sampling_frequency,
+                               float frame_length,
+                               float frame_stride,
+                               bool zero_padding,
+                               uint16_t version,
+                               int *frame_sample_length_out,
+                               size_t *stride_out)
     {
-        if (!info->signal || !info->signal->get_data || info->signal->total_length == 0) {
-            EIDSP_ERR(EIDSP_SIGNAL_SIZE_MISMATCH);
-        }
-
-        size_t length_signal = info->signal->total_length;
+        size_t length_signal = signal->total_length;
         int frame_sample_length;
         int length;
         if (version == 1) {
@@ -306,27 +298,62 @@ namespace processing {
 
             // Zero padding
             len_sig = static_cast<int>(static_cast<float>(numframes) * frame_stride) + frame_sample_length;
-
-            info->signal->total_length = static_cast<size_t>(len_sig);
         }
         else {
             numframes = static_cast<int>(
                 floor(static_cast<float>(length_signal - length) / frame_stride));
             len_sig = static_cast<int>(
                 (static_cast<float>(numframes - 1) * frame_stride + frame_sample_length));
-
-            info->signal->total_length = static_cast<size_t>(len_sig);
         }
 
-        info->frame_ixs.clear();
-        info->frame_ixs.reserve(numframes); //limit the memory allocation
+        signal->total_length = static_cast<size_t>(len_sig);
 
+        // count the frames that start inside the framed signal
+        size_t stride = static_cast<size_t>(frame_stride);
+        size_t count = 0;
         int frame_count = 0;
-
-        for (size_t ix = 0; ix < static_cast<uint32_t>(len_sig); ix += static_cast<size_t>(frame_stride)) {
+        for (size_t ix = 0; ix < static_cast<uint32_t>(len_sig); ix += stride) {
             if (++frame_count > numframes) break;
+            count++;
+        }
+
+        *frame_sample_length_out = frame_sample_length;
+        *stride_out = stride;
+        return count;
+    }
+
+    /**
+     * Frame a signal into overlapping frames.
+     * @param info This is both the base object and where we'll store our results.
+     * @param sampling_frequency (int): The sampling frequency of the signal.
+     * @param frame_length (float): The length of the frame in second.
+     * @param frame_stride (float): The stride between frames.
+     * @param zero_padding (bool): If the samples is not a multiple of
+     *        frame_length(number of frames sample), zero padding will
+     *        be done for generating last frame.
+     * @returns EIDSP_OK if OK
+     */
+    static int stack_frames(stack_frames_info_t *info,
+                            float sampling_frequency,
+                            float frame_length,
+                            float frame_stride,
+                            bool zero_padding,
+                            uint16_t version)
+    {
+        if (!info->signal || !info->signal->get_data || info->signal->total_length == 0) {
+            EIDSP_ERR(EIDSP_SIGNAL_SIZE_MISMATCH);
+        }
 
-            info->frame_ixs.push_back(ix);
+        int frame_sample_length;
+        size_t stride;
+        size_t numframes = frame_layout(info->signal, sampling_frequency, frame_length, frame_stride,
+            zero_padding, version, &frame_sample_length, &stride);
+
+        info->frame_ixs.clear();
+        info->frame_ixs.reserve(numframes); //limit the memory allocation
+
+        for (size_t ix = 0; ix < numframes; ix++) {
+            info->frame_ixs.push_back(ix * stride);
         }
 
         info->frame_length = frame_sample_length;
@@ -334,6 +361,100 @@ namespace processing {
         return EIDSP_OK;
     }
 
+    /**
+     * Streaming counterpart of stack_frames. Frame offsets are computed on the fly
+     * and every frame is read into a single reusable buffer, so no offset table or
+     * per-frame allocation is needed. Yields exactly the frames of stack_frames.
+     */
+    class frame_reader {
+public:
+        frame_reader() : _signal(nullptr), _frame(nullptr), _frame_length(0), _stride(0), _num_frames(0)
+        {
+        }
+
+        ~frame_reader() {
+            if (_frame) {
+                ei_dsp_free(_frame, _frame_length * sizeof(float));
+            }
+        }
+
+        /**
+         * Frame a signal, see stack_frames for the parameters.
+         * Like stack_frames this trims signal->total_length to the framed length.
+         * @returns EIDSP_OK if OK
+         */
+        int init(signal_t *signal,
+                 float sampling_frequency,
+                 float frame_length,
+                 float frame_stride,
+                 bool zero_padding,
+                 uint16_t version)
+        {
+            if (!signal || !signal->get_data || signal->total_length == 0) {
+                EIDSP_ERR(EIDSP_SIGNAL_SIZE_MISMATCH);
+            }
+            if (_frame) {
+                ei_dsp_free(_frame, _frame_length * sizeof(float));
+                _frame = nullptr;
+            }
+
+            int frame_sample_length;
+            _num_frames = frame_layout(signal, sampling_frequency, frame_length, frame_stride,
+                zero_padding, version, &frame_sample_length, &_stride);
+            _frame_length = static_cast<size_t>(frame_sample_length);
+            _signal = signal;
+
+            _frame = (float*)ei_dsp_calloc(_frame_length * sizeof(float), 1);
+            if (!_frame) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+
+            return EIDSP_OK;
+        }
+
+        size_t size() const {
+            return _num_frames;
+        }
+
+        size_t frame_length() const {
+            return _frame_length;
+        }
+
+        /**
+         * Read frame `ix` into the frame buffer. Samples past the end of the
+         * signal are zero.
+         * @param frame Set to the frame buffer, valid until the next read
+         * @returns EIDSP_OK if OK
+         */
+        int read(size_t ix, float **frame) {
+            if (ix >= _num_frames) {
+                EIDSP_ERR(EIDSP_OUT_OF_BOUNDS);
+            }
+
+            size_t offset = ix * _stride;
+            size_t length = _frame_length;
+            if (offset + length > _signal->total_length) {
+                length = offset < _signal->total_length ? _signal->total_length - offset : 0;
+                memset(_frame + length, 0, (_frame_length - length) * sizeof(float));
+            }
+
+            int ret = _signal->get_data(offset, length, _frame);
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            *frame = _frame;
+            return EIDSP_OK;
+        }
+
+private:
+        signal_t *_signal;
+        float *_frame;
+        size_t _frame_length;
+        size_t _stride;
+        size_t _num_frames;
+    };
+
     /**
      * Calculate the number of stack frames for the settings provided.
      * This is needed to allocate the right buffer size for the output of f.e. the MFE
@@ -486,6 +607,156 @@ namespace processing {
         return EIDSP_OK;
     }
 
+    /**
+     * Row of a matrix extended on both sides by symmetric reflection (as
+     * numpy::pad_1d_symmetric does) at position `k` of the extended matrix,
+     * k can be negative or past the last row
+     */
+    static inline int32_t reflected_row(int32_t k, int32_t rows)
+    {
+        if (k >= 0 && k < rows) {
+            return k;
+        }
+        // the reflection repeats every 2 * rows: 0, 1, .., rows - 1, rows - 1, .., 0
+        const int32_t j = (k < 0 ? -k - 1 : k - rows) % (2 * rows);
+        const int32_t bounce = j < rows ? j : 2 * rows - 1 - j;
+        return k < 0 ? bounce : rows - 1 - bounce;
+    }
+
+    /**
+     * Sliding window sums over the reflected rows of one column, as taken by
+     * cmvnw: the sum for row i covers extended rows i - pad .. i - pad + win_size - 1.
+     * Kept in double so that adding the row entering and removing the row leaving
+     * the window does not accumulate rounding errors.
+     */
+    typedef struct {
+        const float *buffer;
+        size_t first_row;   // window row 0 is buffer row first_row, the rows wrap around
+        int32_t rows;
+        size_t cols;
+
+        float at(int32_t row, size_t col) const {
+            size_t ix = first_row + (size_t)reflected_row(row, rows);
+            if (ix >= (size_t)rows) {
+                ix -= rows;
+            }
+            return buffer[ix * cols + col];
+        }
+    } cmvnw_rows_t;
+
+    /**
+     * Windowed cepstral mean and variance normalization of a feature window
+     * that is stored as a ring of rows, written out of place. Gives the same
+     * output as copying the window in order and running cmvnw() on the copy,
+     * but the window sums are updated by one row entering and one leaving the
+     * reflected window, so the cost is linear in rows * cols whatever win_size.
+     * @param input rows * cols values, row r of the window is input row (first_row + r) % rows
+     * @param first_row Row of the input that holds the oldest features
+     * @param output Output matrix, rows x cols
+     * @param win_size The size of sliding window for local normalization
+     * @param variance_normalization If the variance normilization should
+     *   be performed or not.
+     * @param scale Scale output to 0..1
+     * @returns 0 if OK
+     */
+    static int cmvnw_ring(const float *input, size_t first_row, matrix_t *output, uint16_t win_size = 301,
+        bool variance_normalization = false, bool scale = false)
+    {
+        const int32_t rows = static_cast<int32_t>(output->rows);
+        const size_t cols = output->cols;
+
+        if (rows == 0) {
+            EIDSP_ERR(EIDSP_INPUT_MATRIX_EMPTY);
+        }
+
+        const cmvnw_rows_t in = { input, first_row % rows, rows, cols };
+
+        if (win_size == 0) {
+            for (int32_t ix = 0; ix < rows; ix++) {
+                for (size_t col = 0; col < cols; col++) {
+                    output->buffer[ix * cols + col] = in.at(ix, col);
+                }
+            }
+            return EIDSP_OK;
+        }
+
+        const int32_t pad_size = (win_size - 1) / 2;
+        const double win_scale = 1.0 / static_cast<double>(win_size);
+
+        // running sums per column, followed by those of the squares if needed
+        const size_t sums_size = cols * sizeof(double) * (variance_normalization ? 2 : 1);
+        double *sum = (double *)ei_dsp_calloc(sums_size, 1);
+        if (!sum) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        ei_unique_ptr_t __ptr__(sum, [sums_size](void *ptr) { ei_dsp_free_func(ptr, sums_size); });
+        double *sum_sq = sum + cols;
+
+        // mean normalization, window sums of the original values
+        for (size_t col = 0; col < cols; col++) {
+            sum[col] = 0.0;
+            for (int32_t k = -pad_size; k < win_size - pad_size; k++) {
+                sum[col] += in.at(k, col);
+            }
+        }
+        for (int32_t ix = 0; ix < rows; ix++) {
+            float *row = output->buffer + ix * cols;
+            for (size_t col = 0; col < cols; col++) {
+                row[col] = in.at(ix, col) - static_cast<float>(sum[col] * win_scale);
+                sum[col] += static_cast<double>(in.at(ix - pad_size + win_size, col)) - in.at(ix - pad_size, col);
+            }
+        }
+
+        if (variance_normalization == true) {
+            // std over the same windows of the mean normalized values, all of
+            // them are needed until the last window so the divisors are kept apart
+            EI_DSP_MATRIX(window_std, output->rows, cols);
+            if (!window_std.buffer) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+
+            const cmvnw_rows_t norm = { output->buffer, 0, rows, cols };
+            for (size_t col = 0; col < cols; col++) {
+                sum[col] = 0.0;
+                sum_sq[col] = 0.0;
+                for (int32_t k = -pad_size; k < win_size - pad_size; k++) {
+                    const double v = norm.at(k, col);
+                    sum[col] += v;
+                    sum_sq[col] += v * v;
+                }
+            }
+            for (int32_t ix = 0; ix < rows; ix++) {
+                float *std_row = window_std.buffer + ix * cols;
+                for (size_t col = 0; col < cols; col++) {
+                    const double mean = sum[col] * win_scale;
+                    double variance = sum_sq[col] * win_scale - mean * mean;
+                    if (variance < 0.0) {
+                        variance = 0.0;
+                    }
+                    std_row[col] = static_cast<float>(sqrt(variance));
+
+                    const double enter = norm.at(ix - pad_size + win_size, col);
+                    const double leave = norm.at(ix - pad_size, col);
+                    sum[col] += enter - leave;
+                    sum_sq[col] += enter * enter - leave * leave;
+                }
+            }
+
+            for (size_t ix = 0; ix < output->rows * cols; ix++) {
+                output->buffer[ix] = output->buffer[ix] / (window_std.buffer[ix] + 1e-10);
+            }
+        }
+
+        if (scale) {
+            int ret = numpy::normalize(output);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
     /**
      * Perform normalization for MFE frames, this converts the signal to dB,
      * then add a hard filter, and quantize / dequantize the output
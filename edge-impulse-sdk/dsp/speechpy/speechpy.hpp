@@ -32,7 +32,9 @@
 #define _EIDSP_SPEECHPY_SPEECHPY_H_
 
 #include "../config.hpp"
+#include "dct_plan.hpp"
 #include "feature.hpp"
+#include "feature_q15.hpp"
 #include "functions.hpp"
 #include "processing.hpp"
 
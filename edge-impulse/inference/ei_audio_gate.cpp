@@ -0,0 +1,220 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_audio_gate.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/* Constants --------------------------------------------------------------- */
+#define GATE_READ_CHUNK     128
+
+/* Private variables ------------------------------------------------------- */
+static ei_audio_gate_config_t gate_config;
+static ei_audio_gate_stats_t gate_stats;
+
+static uint16_t warmup_left = 0;
+static uint16_t hangover_left = 0;
+static bool gate_open = false;
+static float dc_offset = 0.0f;
+static float floor_db = 0.0f;
+static float slice_cost_us = 0.0f;
+
+/* Public functions -------------------------------------------------------- */
+
+void ei_audio_gate_get_default_config(ei_audio_gate_config_t *config)
+{
+    config->open_ratio = 2.0f;      // +6 dB over the noise floor
+    config->min_rms = 64.0f;
+    config->floor_fall = 0.5f;
+    config->floor_rise = 0.05f;
+    config->zcr_ratio = 1.4f;       // +3 dB over the noise floor
+    config->zcr_min = 0.0f;        // disabled, broadband noise crosses zero as often as fricatives
+    config->hangover_slices = 4;
+}
+
+/**
+ * @brief      Reset the gate, the first `warmup_slices` are always processed
+ *             while the noise floor settles and the feature window fills up
+ */
+void ei_audio_gate_start(const ei_audio_gate_config_t *config, uint16_t warmup_slices)
+{
+    if (config) {
+        gate_config = *config;
+    }
+    else {
+        ei_audio_gate_get_default_config(&gate_config);
+    }
+
+    memset(&gate_stats, 0, sizeof(gate_stats));
+    warmup_left = warmup_slices;
+    hangover_left = 0;
+    gate_open = true;
+    dc_offset = 0.0f;
+    floor_db = 0.0f;
+    slice_cost_us = 0.0f;
+}
+
+/**
+ * @brief      Decide whether a slice should be classified
+ *
+ * @param      signal  The slice, samples in int16 scale
+ * @param[in]  debug   Print gate transitions
+ *
+ * @return     true to run the classifier on this slice, false to skip it
+ */
+bool ei_audio_gate_update(ei::signal_t *signal, bool debug)
+{
+    const uint64_t start_us = ei_read_timer_us();
+    float buffer[GATE_READ_CHUNK];
+    float sum = 0.0f;
+    float sum_sq = 0.0f;
+    uint32_t crossings = 0;
+    bool positive = true;
+
+    for (size_t offset = 0; offset < signal->total_length; offset += GATE_READ_CHUNK) {
+        size_t length = signal->total_length - offset;
+        if (length > GATE_READ_CHUNK) {
+            length = GATE_READ_CHUNK;
+        }
+        if (signal->get_data(offset, length, buffer) != 0) {
+            // can't tell, let the classifier see it
+            return true;
+        }
+        for (size_t i = 0; i < length; i++) {
+            const float v = buffer[i] - dc_offset;
+            sum += buffer[i];
+            sum_sq += v * v;
+            const bool p = v >= 0.0f;
+            if (offset + i > 0 && p != positive) {
+                crossings++;
+            }
+            positive = p;
+        }
+    }
+
+    const size_t n = signal->total_length > 0 ? signal->total_length : 1;
+    const float rms = sqrtf(sum_sq / n);
+    const float zcr = static_cast<float>(crossings) / n;
+    // DC offset of the microphone, used for the next slice
+    dc_offset = sum / n;
+
+    // the noise floor is tracked in dB, it follows quieter slices quickly and
+    // louder ones slowly so a short burst of speech barely moves it, while a
+    // lasting change of the background is picked up after a few seconds
+    const float rms_db = 20.0f * log10f(fmaxf(rms, 1.0f));
+    if (gate_stats.slices == 0) {
+        floor_db = rms_db;
+    }
+    const float floor = powf(10.0f, floor_db / 20.0f);
+
+    const float threshold = fmaxf(floor * gate_config.open_ratio, gate_config.min_rms);
+    bool active = rms > threshold;
+    if (!active && gate_config.zcr_min > 0.0f) {
+        active = rms > fmaxf(floor * gate_config.zcr_ratio, gate_config.min_rms)
+            && zcr >= gate_config.zcr_min;
+    }
+
+    if (rms_db < floor_db || (warmup_left > 0 && !active)) {
+        floor_db += gate_config.floor_fall * (rms_db - floor_db);
+    }
+    else {
+        floor_db += gate_config.floor_rise * (rms_db - floor_db);
+    }
+    gate_stats.noise_floor = powf(10.0f, floor_db / 20.0f);
+
+    // the `hangover_slices` inactive slices after an active one are still processed
+    bool hangover = false;
+    if (active) {
+        hangover_left = gate_config.hangover_slices;
+    }
+    else if (hangover_left > 0) {
+        hangover_left--;
+        hangover = true;
+    }
+
+    bool open = active || hangover || warmup_left > 0;
+    if (warmup_left > 0) {
+        warmup_left--;
+    }
+
+    if (open && !gate_open) {
+        gate_stats.opens++;
+    }
+    if (debug && open != gate_open) {
+        ei_printf("Audio gate %s (rms %.1f, floor %.1f, zcr %.2f)\n",
+            open ? "open" : "closed", rms, floor, zcr);
+    }
+    gate_open = open;
+
+    gate_stats.slices++;
+    if (!open) {
+        gate_stats.slices_skipped++;
+        gate_stats.saved_us += static_cast<uint64_t>(slice_cost_us);
+    }
+    gate_stats.gate_us += ei_read_timer_us() - start_us;
+
+    return open;
+}
+
+/**
+ * @brief      Report the DSP and inference time of a processed slice, the
+ *             average is used to estimate the time saved by skipped slices
+ */
+void ei_audio_gate_report_processed(uint64_t slice_us)
+{
+    if (slice_cost_us == 0.0f) {
+        slice_cost_us = static_cast<float>(slice_us);
+    }
+    else {
+        slice_cost_us += 0.1f * (static_cast<float>(slice_us) - slice_cost_us);
+    }
+}
+
+void ei_audio_gate_get_stats(ei_audio_gate_stats_t *stats)
+{
+    *stats = gate_stats;
+}
+
+void ei_audio_gate_print_stats(void)
+{
+    ei_printf("Audio gate: skipped %lu of %lu slices, opened %lu times, noise floor %.1f\n",
+        (unsigned long)gate_stats.slices_skipped, (unsigned long)gate_stats.slices,
+        (unsigned long)gate_stats.opens, gate_stats.noise_floor);
+    ei_printf("Audio gate: saved ~%lu ms of DSP and inference, spent %lu ms gating\n",
+        (unsigned long)(gate_stats.saved_us / 1000), (unsigned long)(gate_stats.gate_us / 1000));
+}
@@ -0,0 +1,85 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_AUDIO_GATE_H
+#define EI_AUDIO_GATE_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+
+/**
+ * Energy gate in front of continuous audio classification. A slice opens the
+ * gate when its RMS rises above an adaptive noise floor (or, with the zero
+ * crossing rate check enabled, when a weaker slice looks like unvoiced speech).
+ * The gate stays open for `hangover_slices` after the last active slice so word
+ * endings are still classified. Skipped slices are handed to
+ * run_classifier_continuous_skip() which keeps the feature window warm.
+ *
+ * Opt-in: the gate changes which slices are classified, so it is off by
+ * default. Enable it with -DEI_AUDIO_GATE_ENABLED=1, e.g. next to the other
+ * add_definitions() in main/CMakeLists.txt.
+ */
+#ifndef EI_AUDIO_GATE_ENABLED
+#define EI_AUDIO_GATE_ENABLED   0
+#endif
+
+typedef struct {
+    float open_ratio;           // active when RMS > noise floor * open_ratio
+    float min_rms;              // never active below this RMS, samples are int16 scale
+    float floor_fall;           // noise floor (dB) tracking speed towards a quieter slice, 0..1
+    float floor_rise;           // noise floor (dB) tracking speed towards a louder slice, 0..1
+    float zcr_ratio;            // active when RMS > noise floor * zcr_ratio and the
+    float zcr_min;              // zero crossing rate (per sample) >= zcr_min, 0 disables
+    uint16_t hangover_slices;
+} ei_audio_gate_config_t;
+
+typedef struct {
+    uint32_t slices;
+    uint32_t slices_skipped;
+    uint32_t opens;
+    float noise_floor;
+    uint64_t gate_us;           // time spent deciding
+    uint64_t saved_us;          // skipped slices times the average cost of a processed slice
+} ei_audio_gate_stats_t;
+
+void ei_audio_gate_get_default_config(ei_audio_gate_config_t *config);
+void ei_audio_gate_start(const ei_audio_gate_config_t *config, uint16_t warmup_slices);
+bool ei_audio_gate_update(ei::signal_t *signal, bool debug);
+void ei_audio_gate_report_processed(uint64_t slice_us);
+void ei_audio_gate_get_stats(ei_audio_gate_stats_t *stats);
+void ei_audio_gate_print_stats(void);
+
+#endif /* EI_AUDIO_GATE_H */
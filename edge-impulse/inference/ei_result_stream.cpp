@@ -0,0 +1,431 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_result_stream.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#endif
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/* Constants --------------------------------------------------------------- */
+#ifdef ESP_PLATFORM
+#define RESULT_STREAM_TASK_STACK_SIZE   3072
+#define RESULT_STREAM_TASK_PRIORITY     (tskIDLE_PRIORITY + 1)
+#endif
+
+#define RESULT_RECORD_MAX_SIZE (sizeof(ei_result_record_header_t) \
+    + EI_RESULT_RECORD_MAX_ENTRIES * sizeof(ei_result_record_entry_t) + sizeof(uint16_t))
+
+static_assert((EI_RESULT_STREAM_RING_SIZE & (EI_RESULT_STREAM_RING_SIZE - 1)) == 0,
+    "EI_RESULT_STREAM_RING_SIZE must be a power of 2");
+static_assert(sizeof(ei_result_record_header_t) == 24, "unexpected record header size");
+static_assert(sizeof(ei_result_record_entry_t) == 12, "unexpected record entry size");
+static_assert(sizeof(ei_result_error_record_t) == 16, "unexpected error record size");
+
+/* Private variables ------------------------------------------------------- */
+static ei_result_output_mode_t output_mode = EI_RESULT_OUTPUT_TEXT;
+
+/* single producer (inference loop), single consumer (UART task) */
+static uint8_t ring[EI_RESULT_STREAM_RING_SIZE];
+static std::atomic<uint32_t> ring_head(0);
+static std::atomic<uint32_t> ring_tail(0);
+
+static bool stream_started = false;
+
+static uint32_t records_written = 0;
+static uint32_t records_dropped = 0;
+static std::atomic<uint32_t> bytes_sent(0);
+
+/* record being assembled, kept out of the stack of the inference loop */
+static uint8_t record_buf[RESULT_RECORD_MAX_SIZE];
+
+/* Private functions ------------------------------------------------------- */
+static void stream_notify(void);
+
+static uint16_t crc16_ccitt(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static inline uint16_t saturate_u16(uint32_t value)
+{
+    return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+static inline uint32_t saturate_us(int64_t value)
+{
+    if (value < 0) {
+        return 0;
+    }
+    return value > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)value;
+}
+
+static inline uint16_t score_to_u16(float value)
+{
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 1.0f) {
+        return 0xFFFF;
+    }
+    return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+static uint8_t label_to_index(const char *label, const char **categories, uint16_t label_count)
+{
+    if (label == nullptr) {
+        return EI_RESULT_RECORD_LABEL_UNKNOWN;
+    }
+
+    // decoders store pointers into the categories array, so try that first
+    for (uint16_t ix = 0; ix < label_count && ix < EI_RESULT_RECORD_LABEL_UNKNOWN; ix++) {
+        if (categories[ix] == label) {
+            return (uint8_t)ix;
+        }
+    }
+    for (uint16_t ix = 0; ix < label_count && ix < EI_RESULT_RECORD_LABEL_UNKNOWN; ix++) {
+        if (strcmp(categories[ix], label) == 0) {
+            return (uint8_t)ix;
+        }
+    }
+
+    return EI_RESULT_RECORD_LABEL_UNKNOWN;
+}
+
+static bool ring_write(const uint8_t *data, uint32_t length)
+{
+    const uint32_t head = ring_head.load(std::memory_order_relaxed);
+    const uint32_t tail = ring_tail.load(std::memory_order_acquire);
+
+    if (EI_RESULT_STREAM_RING_SIZE - (head - tail) < length) {
+        return false;
+    }
+
+    const uint32_t offset = head & (EI_RESULT_STREAM_RING_SIZE - 1);
+    const uint32_t first = (EI_RESULT_STREAM_RING_SIZE - offset) < length ? (EI_RESULT_STREAM_RING_SIZE - offset) : length;
+
+    memcpy(&ring[offset], data, first);
+    memcpy(&ring[0], data + first, length - first);
+
+    // publish the whole record at once
+    ring_head.store(head + length, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief      Append the CRC to the `length` bytes in record_buf and queue the record
+ */
+static bool queue_record(size_t length)
+{
+    uint16_t crc = crc16_ccitt(record_buf + 2, length - 2);
+    record_buf[length++] = crc & 0xFF;
+    record_buf[length++] = crc >> 8;
+
+    if (!ring_write(record_buf, length)) {
+        records_dropped++;
+        return false;
+    }
+    records_written++;
+
+    if (stream_started) {
+        stream_notify();
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Hand everything queued so far to the UART
+ */
+static void drain_ring(void)
+{
+    uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+    uint32_t head = ring_head.load(std::memory_order_acquire);
+
+    while (tail != head) {
+        const uint32_t offset = tail & (EI_RESULT_STREAM_RING_SIZE - 1);
+        uint32_t length = head - tail;
+        if (length > EI_RESULT_STREAM_RING_SIZE - offset) {
+            length = EI_RESULT_STREAM_RING_SIZE - offset;
+        }
+
+        fwrite(&ring[offset], 1, length, stdout);
+
+        tail += length;
+        ring_tail.store(tail, std::memory_order_release);
+        bytes_sent.fetch_add(length, std::memory_order_relaxed);
+
+        head = ring_head.load(std::memory_order_acquire);
+    }
+    fflush(stdout);
+}
+
+#ifdef ESP_PLATFORM
+static TaskHandle_t stream_task = nullptr;
+
+static void result_stream_task(void *arg)
+{
+    (void)arg;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        drain_ring();
+    }
+}
+
+static void stream_notify(void)
+{
+    xTaskNotifyGive(stream_task);
+}
+
+static bool stream_task_start(void)
+{
+    BaseType_t ret = xTaskCreate(
+        result_stream_task,
+        "ei_result_stream",
+        RESULT_STREAM_TASK_STACK_SIZE,
+        nullptr,
+        RESULT_STREAM_TASK_PRIORITY,
+        &stream_task);
+
+    if (ret != pdPASS) {
+        stream_task = nullptr;
+        return false;
+    }
+
+    return true;
+}
+#else
+static pthread_mutex_t notify_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notify_cond = PTHREAD_COND_INITIALIZER;
+static bool notified = false;
+
+static void *result_stream_thread(void *arg)
+{
+    (void)arg;
+
+    while (true) {
+        pthread_mutex_lock(&notify_mutex);
+        while (!notified) {
+            pthread_cond_wait(&notify_cond, &notify_mutex);
+        }
+        notified = false;
+        pthread_mutex_unlock(&notify_mutex);
+        drain_ring();
+    }
+
+    return nullptr;
+}
+
+static void stream_notify(void)
+{
+    pthread_mutex_lock(&notify_mutex);
+    notified = true;
+    pthread_cond_signal(&notify_cond);
+    pthread_mutex_unlock(&notify_mutex);
+}
+
+static bool stream_task_start(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int ret = pthread_create(&thread, &attr, result_stream_thread, nullptr);
+    pthread_attr_destroy(&attr);
+
+    return ret == 0;
+}
+#endif
+
+/* Public functions -------------------------------------------------------- */
+
+void ei_result_stream_set_mode(ei_result_output_mode_t mode)
+{
+    output_mode = mode;
+}
+
+ei_result_output_mode_t ei_result_stream_get_mode(void)
+{
+    return output_mode;
+}
+
+/**
+ * @brief      Start the low priority task that drains the ring to the UART
+ *
+ * @return     false if the task could not be created
+ */
+bool ei_result_stream_start(void)
+{
+    if (stream_started) {
+        return true;
+    }
+
+    stream_started = stream_task_start();
+    return stream_started;
+}
+
+/**
+ * @brief      Serialize a result into a binary record and queue it for the UART task.
+ *             Never blocks, if the ring is full the record is dropped and counted.
+ *
+ * @param      result        Inference result
+ * @param      categories    Labels of the impulse, used to map labels to indices
+ * @param[in]  label_count   Number of labels
+ * @param[in]  frame_id      Frame counter
+ * @param[in]  timestamp_ms  Capture time of the frame
+ *
+ * @return     false if the record was dropped
+ */
+bool ei_result_stream_push(
+    const ei_impulse_result_t *result,
+    const char **categories,
+    uint16_t label_count,
+    uint32_t frame_id,
+    uint32_t timestamp_ms)
+{
+    ei_result_record_header_t *header = (ei_result_record_header_t *)record_buf;
+    ei_result_record_entry_t *entries = (ei_result_record_entry_t *)(record_buf + sizeof(ei_result_record_header_t));
+    uint32_t entry_count = 0;
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    for (uint32_t ix = 0; ix < result->bounding_boxes_count && entry_count < EI_RESULT_RECORD_MAX_ENTRIES; ix++) {
+        const ei_impulse_result_bounding_box_t *bb = &result->bounding_boxes[ix];
+        if (bb->value == 0) {
+            continue;
+        }
+        ei_result_record_entry_t *entry = &entries[entry_count++];
+        entry->label_ix = label_to_index(bb->label, categories, label_count);
+        entry->reserved = 0;
+        entry->score = score_to_u16(bb->value);
+        entry->x = saturate_u16(bb->x);
+        entry->y = saturate_u16(bb->y);
+        entry->width = saturate_u16(bb->width);
+        entry->height = saturate_u16(bb->height);
+    }
+#else
+    for (uint32_t ix = 0; ix < label_count && ix < EI_CLASSIFIER_LABEL_COUNT && entry_count < EI_RESULT_RECORD_MAX_ENTRIES; ix++) {
+        ei_result_record_entry_t *entry = &entries[entry_count++];
+        memset(entry, 0, sizeof(ei_result_record_entry_t));
+        entry->label_ix = (uint8_t)ix;
+        entry->score = score_to_u16(result->classification[ix].value);
+    }
+#endif
+
+    header->sync[0] = EI_RESULT_RECORD_SYNC_0;
+    header->sync[1] = EI_RESULT_RECORD_SYNC_1;
+    header->version = EI_RESULT_RECORD_VERSION;
+    header->entry_count = (uint8_t)entry_count;
+    header->frame_id = frame_id;
+    header->timestamp_ms = timestamp_ms;
+    header->dsp_us = saturate_us(result->timing.dsp_us);
+    header->classification_us = saturate_us(result->timing.classification_us);
+    header->anomaly_us = saturate_us(result->timing.anomaly_us);
+
+    return queue_record(sizeof(ei_result_record_header_t) + entry_count * sizeof(ei_result_record_entry_t));
+}
+
+/**
+ * @brief      Queue an error record for the UART task, used instead of an
+ *             "ERR:" text line while the binary stream is active
+ *
+ * @param[in]  code          What failed
+ * @param[in]  detail        Error code of the failing call, 0 if none
+ * @param[in]  frame_id      Frame counter
+ * @param[in]  timestamp_ms  Capture time of the frame
+ *
+ * @return     false if the record was dropped
+ */
+bool ei_result_stream_push_error(
+    ei_result_error_t code,
+    int32_t detail,
+    uint32_t frame_id,
+    uint32_t timestamp_ms)
+{
+    ei_result_error_record_t *record = (ei_result_error_record_t *)record_buf;
+
+    record->sync[0] = EI_RESULT_RECORD_SYNC_0;
+    record->sync[1] = EI_RESULT_RECORD_SYNC_1;
+    record->version = EI_RESULT_RECORD_VERSION | EI_RESULT_RECORD_ERROR;
+    record->code = (uint8_t)code;
+    record->frame_id = frame_id;
+    record->timestamp_ms = timestamp_ms;
+    record->detail = detail;
+
+    return queue_record(sizeof(ei_result_error_record_t));
+}
+
+/**
+ * @brief      Wait until all queued records have been handed to the UART
+ *
+ * @param[in]  timeout_ms  Maximum time to wait
+ */
+void ei_result_stream_flush(uint32_t timeout_ms)
+{
+    uint64_t start = ei_read_timer_ms();
+
+    while (ring_tail.load(std::memory_order_acquire) != ring_head.load(std::memory_order_acquire)) {
+        if (!stream_started || ei_read_timer_ms() - start > timeout_ms) {
+            break;
+        }
+        ei_sleep(1);
+    }
+}
+
+void ei_result_stream_get_stats(ei_result_stream_stats_t *stats)
+{
+    stats->records_written = records_written;
+    stats->records_dropped = records_dropped;
+    stats->bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,140 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_RESULT_STREAM_H
+#define EI_RESULT_STREAM_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+#include <cstddef>
+
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+
+/**
+ * Compact binary result record, all fields little endian:
+ *
+ *   header  (24 bytes) ei_result_record_header_t
+ *   entries (12 bytes each) ei_result_record_entry_t, `entry_count` of them
+ *   crc     (2 bytes) CRC-16/CCITT-FALSE over header and entries, sync bytes excluded
+ *
+ * For object detection models an entry is a bounding box, otherwise it is a
+ * classification score with a zero sized box. Scores are scaled to 0..65535.
+ *
+ * Failures while streaming are reported as an error record instead of text,
+ * so the stream stays parseable:
+ *
+ *   error   (16 bytes) ei_result_error_record_t, version has EI_RESULT_RECORD_ERROR set
+ *   crc     (2 bytes) CRC-16/CCITT-FALSE, as above
+ *
+ * See firmware-sdk/tools/result_stream.py for the host side decoder.
+ */
+#define EI_RESULT_RECORD_SYNC_0         0xEB
+#define EI_RESULT_RECORD_SYNC_1         0x90
+#define EI_RESULT_RECORD_VERSION        1
+#define EI_RESULT_RECORD_MAX_ENTRIES    255
+#define EI_RESULT_RECORD_LABEL_UNKNOWN  0xFF
+#define EI_RESULT_RECORD_ERROR          0x80
+
+/** Size of the ring between the inference loop and the UART task, power of 2 */
+#ifndef EI_RESULT_STREAM_RING_SIZE
+#define EI_RESULT_STREAM_RING_SIZE      4096
+#endif
+
+typedef struct __attribute__((packed)) {
+    uint8_t sync[2];
+    uint8_t version;
+    uint8_t entry_count;
+    uint32_t frame_id;
+    uint32_t timestamp_ms;
+    uint32_t dsp_us;
+    uint32_t classification_us;
+    uint32_t anomaly_us;
+} ei_result_record_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t label_ix;
+    uint8_t reserved;
+    uint16_t score;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+} ei_result_record_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t sync[2];
+    uint8_t version;    // EI_RESULT_RECORD_VERSION | EI_RESULT_RECORD_ERROR
+    uint8_t code;       // ei_result_error_t
+    uint32_t frame_id;  // frame the error belongs to
+    uint32_t timestamp_ms;
+    int32_t detail;     // e.g. EI_IMPULSE_ERROR for EI_RESULT_ERROR_IMPULSE
+} ei_result_error_record_t;
+
+typedef enum {
+    EI_RESULT_ERROR_CAPTURE = 1,
+    EI_RESULT_ERROR_ALLOC,
+    EI_RESULT_ERROR_DECODE,
+    EI_RESULT_ERROR_IMPULSE
+} ei_result_error_t;
+
+typedef enum {
+    EI_RESULT_OUTPUT_TEXT = 0,
+    EI_RESULT_OUTPUT_BINARY
+} ei_result_output_mode_t;
+
+typedef struct {
+    uint32_t records_written;
+    uint32_t records_dropped;
+    uint32_t bytes_sent;
+} ei_result_stream_stats_t;
+
+void ei_result_stream_set_mode(ei_result_output_mode_t mode);
+ei_result_output_mode_t ei_result_stream_get_mode(void);
+
+bool ei_result_stream_start(void);
+bool ei_result_stream_push(
+    const ei_impulse_result_t *result,
+    const char **categories,
+    uint16_t label_count,
+    uint32_t frame_id,
+    uint32_t timestamp_ms);
+bool ei_result_stream_push_error(
+    ei_result_error_t code,
+    int32_t detail,
+    uint32_t frame_id,
+    uint32_t timestamp_ms);
+void ei_result_stream_flush(uint32_t timeout_ms);
+void ei_result_stream_get_stats(ei_result_stream_stats_t *stats);
+
+#endif /* EI_RESULT_STREAM_H */
@@ -42,6 +42,7 @@
 #include "ei_microphone.h"
 #include "ei_device_espressif_esp32.h"
 #include "ei_run_impulse.h"
+#include "ei_audio_gate.h"
 
 typedef enum {
     INFERENCE_STOPPED,
@@ -71,6 +72,11 @@ void ei_run_impulse(void)
             ei_microphone_inference_reset_buffers();
             break;
         case INFERENCE_SAMPLING:
+            // in continuous mode hand the previous slice back and block until
+            // the I2S task signals the next one, overruns are reported there
+            if (continuous_mode == true) {
+                ei_microphone_inference_record();
+            }
             // wait for data to be collected through callback
             if (ei_microphone_inference_is_recording()) {
                 return;
@@ -88,11 +94,24 @@ void ei_run_impulse(void)
     signal.total_length = continuous_mode ? EI_CLASSIFIER_SLICE_SIZE : EI_CLASSIFIER_RAW_SAMPLE_COUNT;
     signal.get_data = &ei_microphone_inference_get_data;
 
+#if EI_AUDIO_GATE_ENABLED == 1
+    // silent slice: no DSP and no inference, only keep the feature window warm
+    if (continuous_mode == true && !ei_audio_gate_update(&signal, debug_mode)) {
+        run_classifier_continuous_skip();
+        state = INFERENCE_SAMPLING;
+        return;
+    }
+#endif
+
     // run the impulse: DSP, neural network and the Anomaly algorithm
     ei_impulse_result_t result = { 0 };
     EI_IMPULSE_ERROR ei_error;
     if(continuous_mode == true) {
+        uint64_t slice_start_us = ei_read_timer_us();
         ei_error = run_classifier_continuous(&signal, &result, debug_mode);
+#if EI_AUDIO_GATE_ENABLED == 1
+        ei_audio_gate_report_processed(ei_read_timer_us() - slice_start_us);
+#endif
     }
     else {
         ei_error = run_classifier(&signal, &result, debug_mode);
@@ -147,6 +166,10 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
         // only print when we run the complete maf buffer to prevent printing the same classification multiple times.
         print_results = -(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW);
         run_classifier_init();
+#if EI_AUDIO_GATE_ENABLED == 1
+        // process a full window before gating, the noise floor settles meanwhile
+        ei_audio_gate_start(nullptr, EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW);
+#endif
         state = INFERENCE_SAMPLING;
     }
     else {
@@ -179,6 +202,11 @@ void ei_stop_impulse(void)
         /* reset samples buffer */
         ei_microphone_inference_end();
         run_classifier_deinit();
+#if EI_AUDIO_GATE_ENABLED == 1
+        if (continuous_mode == true) {
+            ei_audio_gate_print_stats();
+        }
+#endif
     }
     state = INFERENCE_STOPPED;
 }
@@ -45,6 +45,7 @@
 #include "stdint.h"
 #include "ei_device_espressif_esp32.h"
 #include "ei_run_impulse.h"
+#include "ei_result_stream.h"
 
 #include "esp_timer.h"
 
@@ -72,6 +73,8 @@ static ei_device_snapshot_resolutions_t fb_resolution;
 static bool resize_required = false;
 static uint32_t inference_delay;
 
+static uint32_t frame_id = 0;
+
 static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
 {
     // we already have a RGB888 buffer, so recalculate offset into pixel index
@@ -92,6 +95,25 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     return 0;
 }
 
+/**
+ * @brief Report a failure of the inference loop. While the binary result stream
+ * is active this is an error record, text would corrupt the stream.
+ */
+static void report_error(ei_result_error_t code, int32_t detail, uint32_t capture_ts, const char *message)
+{
+    if (ei_result_stream_get_mode() == EI_RESULT_OUTPUT_BINARY) {
+        ei_result_stream_push_error(code, detail, frame_id++, capture_ts);
+        return;
+    }
+
+    if (detail != 0) {
+        ei_printf("ERR: %s (%d)\n", message, (int)detail);
+    }
+    else {
+        ei_printf("ERR: %s\n", message);
+    }
+}
+
 void ei_run_impulse(void)
 {
     switch(state) {
@@ -118,12 +140,16 @@ void ei_run_impulse(void)
     uint32_t jpeg_image_size = 0;
 
     EiCameraESP32 *camera = static_cast<EiCameraESP32*>(EiCameraESP32::get_camera());
+    const bool binary_output = (ei_result_stream_get_mode() == EI_RESULT_OUTPUT_BINARY);
 
-    ei_printf("Taking photo...\n");
+    if (!binary_output) {
+        ei_printf("Taking photo...\n");
+    }
 
+    uint32_t capture_ts = (uint32_t)ei_read_timer_ms();
 
     if(camera->ei_camera_capture_jpeg(&jpeg_image, &jpeg_image_size) == false) {
-        ei_printf("ERR: Failed to take a snapshot!\n");
+        report_error(EI_RESULT_ERROR_CAPTURE, 0, capture_ts, "Failed to take a snapshot!");
         return;
     }
 
@@ -133,12 +159,13 @@ void ei_run_impulse(void)
 
     // check if allocation was successful
     if(snapshot_buf == nullptr) {
-        ei_printf("ERR: Failed to allocate snapshot buffer!\n");
+        report_error(EI_RESULT_ERROR_ALLOC, 0, capture_ts, "Failed to allocate snapshot buffer!");
+        ei_free(jpeg_image);
         return;
     }
 
     if(camera->ei_camera_jpeg_to_rgb888(jpeg_image, jpeg_image_size, snapshot_buf) == false) {
-        ei_printf("ERR: Failed to decode JPEG image\n");
+        report_error(EI_RESULT_ERROR_DECODE, 0, capture_ts, "Failed to decode JPEG image");
         ei_free(snapshot_buf);
         ei_free(jpeg_image);
         return;
@@ -160,7 +187,7 @@ void ei_run_impulse(void)
     }
     int64_t fr_end = esp_timer_get_time();
 
-    if (debug_mode) {
+    if (debug_mode && !binary_output) {
         ei_printf("Time resizing: %d\n", (uint32_t)((fr_end - fr_start)/1000));
     }
 
@@ -184,12 +211,23 @@ void ei_run_impulse(void)
     ei_impulse_result_t result = { 0 };
 
     EI_IMPULSE_ERROR ei_error = run_classifier(&signal, &result, false);
+
+    ei_free(snapshot_buf);
+
     if (ei_error != EI_IMPULSE_OK) {
-        ei_printf("ERR: Failed to run impulse (%d)\n", ei_error);
-        ei_free(snapshot_buf);
+        report_error(EI_RESULT_ERROR_IMPULSE, ei_error, capture_ts, "Failed to run impulse");
+        return;
+    }
+
+    if (binary_output) {
+        ei_result_stream_push(
+            &result,
+            ei_classifier_inferencing_categories,
+            EI_CLASSIFIER_LABEL_COUNT,
+            frame_id++,
+            capture_ts);
         return;
     }
-    ei_free(snapshot_buf);
 
     display_results(&ei_default_impulse, &result);
 
@@ -210,6 +248,7 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
 
     debug_mode = debug;
     continuous_mode = continuous;
+    frame_id = 0;
 
     EiDeviceESP32* dev = static_cast<EiDeviceESP32*>(EiDeviceESP32::get_device());
     EiCameraESP32 *camera = static_cast<EiCameraESP32*>(EiCameraESP32::get_camera());
@@ -255,6 +294,11 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
         ei_sleep(100);
     }
 
+    if (ei_result_stream_get_mode() == EI_RESULT_OUTPUT_BINARY && !ei_result_stream_start()) {
+        ei_printf("ERR: Failed to start result stream, falling back to text output\n");
+        ei_result_stream_set_mode(EI_RESULT_OUTPUT_TEXT);
+    }
+
     while(!ei_user_invoke_stop()) {
         ei_run_impulse();
         ei_sleep(10);
@@ -262,6 +306,16 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
 
     ei_stop_impulse();
 
+    if (ei_result_stream_get_mode() == EI_RESULT_OUTPUT_BINARY) {
+        ei_result_stream_stats_t stats;
+
+        ei_result_stream_flush(1000);
+        ei_result_stream_get_stats(&stats);
+        ei_result_stream_set_mode(EI_RESULT_OUTPUT_TEXT);
+        ei_printf("\r\nResult stream: %u records, %u dropped, %u bytes\r\n",
+            (unsigned)stats.records_written, (unsigned)stats.records_dropped, (unsigned)stats.bytes_sent);
+    }
+
     if (use_max_uart_speed) {
         ei_printf("\r\nOK\r\n");
         ei_sleep(100);
@@ -190,6 +190,7 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
     ei_printf("\tSample length: %f ms.\n", sample_length);
     ei_printf("\tNo. of classes: %d\n", sizeof(ei_classifier_inferencing_categories) /
                                             sizeof(ei_classifier_inferencing_categories[0]));
+    ei_printf("\tDSP workspace: %u bytes\n", (unsigned int)run_classifier_dsp_workspace_size());
     ei_printf("Starting inferencing, press 'b' to break\n");
 
     if (continuous == true) {
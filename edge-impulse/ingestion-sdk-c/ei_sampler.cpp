@@ -35,6 +35,7 @@
 /* Include ----------------------------------------------------------------- */
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ei_sampler.h"
 #include "firmware-sdk/ei_device_info_lib.h"
@@ -44,6 +45,7 @@
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 
 #include "sensor_aq_mbedtls_hs256.h"
+#include "ei_sample_store.h"
 
 #include "esp_log.h"
 
@@ -57,6 +59,10 @@ extern int ei_inertial_read_data(void);
 extern void ei_printf(const char *format, ...);
 extern void ei_printf_float(float f);
 
+/* Constants --------------------------------------------------------------- */
+/** Samples are staged and CBOR encoded in batches, staging size in floats */
+#define SAMPLER_BATCH_FLOATS    192
+
 /* Forward declarations ---------------------------------------------------- */
 static size_t ei_write(const void *buffer, size_t size, size_t count, EI_SENSOR_AQ_STREAM *);
 static int ei_seek(EI_SENSOR_AQ_STREAM *, long int offset, int origin);
@@ -70,10 +76,15 @@ static uint32_t samples_required;
 static uint32_t current_sample;
 static uint32_t sample_buffer_size;
 static uint32_t headerOffset = 0;
-static uint8_t write_word_buf[4];
 static int write_addr = 0;
+static uint32_t sample_address = 0;
 EI_SENSOR_AQ_STREAM stream;
 
+static float batch_buf[SAMPLER_BATCH_FLOATS];
+static uint32_t batch_axes;
+static uint32_t batch_capacity;
+static uint32_t batch_samples;
+
 static unsigned char ei_mic_ctx_buffer[1024];
 static sensor_aq_signing_ctx_t ei_mic_signing_ctx;
 static sensor_aq_mbedtls_hs256_ctx_t ei_mic_hs_ctx;
@@ -88,8 +99,7 @@ static sensor_aq_ctx ei_mic_ctx = {
 static const char *TAG = "Sampler";
 
 /**
- * @brief      Write sample data to FLASH
- * @details    Write size is always 4 bytes to keep alignment
+ * @brief      Append sample data to the sample being stored
  *
  * @param[in]  buffer     The buffer
  * @param[in]  size       The size
@@ -100,17 +110,9 @@ static const char *TAG = "Sampler";
  */
 static size_t ei_write(const void *buffer, size_t size, size_t count, EI_SENSOR_AQ_STREAM *)
 {
-    EiDeviceInfo* dev = EiDeviceInfo::get_device();
-    EiDeviceMemory* mem = dev->get_memory();
-    for (size_t i = 0; i < count; i++) {
-        write_word_buf[write_addr & 0x3] = *((char *)buffer + i);
-
-        if ((++write_addr & 0x03) == 0x00) {
+    ei_get_sample_store()->append((const uint8_t *)buffer, count);
+    write_addr += count;
 
-            mem->write_sample_data(write_word_buf, (write_addr - 4) + headerOffset, 4);
-        }
-    }
-    ESP_LOGD(TAG, "\nwriting %02x %02x %02x %02x\n", write_word_buf[0],  write_word_buf[1],  write_word_buf[2],  write_word_buf[3]);
     return count;
 }
 
@@ -133,30 +135,31 @@ static time_t ei_time(time_t *t)
 }
 
 /**
- * @brief      Write out remaining data in word buffer to FLASH.
- *             And append CBOR end character.
+ * @brief      Append CBOR end character and commit the sample to the store
  */
 static void ei_write_last_data(void)
 {
-    EiDeviceInfo* dev = EiDeviceInfo::get_device();
-    EiDeviceMemory* mem = dev->get_memory();
+    EiSampleStore *store = ei_get_sample_store();
 
-    uint8_t fill = ((uint8_t)write_addr & 0x03);
-    uint8_t insert_end_address = 0;
+    const uint8_t end_char = 0xFF;
+    store->append(&end_char, 1);
 
-    if (fill != 0x00) {
-        for (uint8_t i = fill; i < 4; i++) {
-            write_word_buf[i] = 0xFF;
-        }
-        mem->write_sample_data(write_word_buf, (write_addr & ~0x03) + headerOffset, 4);
-        insert_end_address = 4;
+    if (!store->commit()) {
+        ei_printf("Failed to store the sample in flash\n");
     }
+}
 
-    /* Write appending word for end character */
-    for (uint8_t i = 0; i < 4; i++) {
-        write_word_buf[i] = 0xFF;
+/**
+ * @brief      Sensor field of the stored sample, the axes it holds
+ */
+static void get_sensor_name(sensor_aq_payload_info *payload, char *name, size_t size)
+{
+    size_t length = 0;
+
+    name[0] = '\0';
+    for (int ix = 0; ix < EI_MAX_SENSOR_AXES && payload->sensors[ix].name != NULL && length + 1 < size; ix++) {
+        length += snprintf(name + length, size - length, ix ? "+%s" : "%s", payload->sensors[ix].name);
     }
-    mem->write_sample_data(write_word_buf, (write_addr & ~0x03) + headerOffset + insert_end_address, 4);
 }
 
 /**
@@ -185,6 +188,10 @@ bool ei_sampler_start_sampling(void *v_ptr_payload, starter_callback ei_sample_s
     sample_buffer_size = (samples_required * sample_size) * 2;
     current_sample = 0;
 
+    batch_axes = sample_size / sizeof(float);
+    batch_capacity = batch_axes ? SAMPLER_BATCH_FLOATS / batch_axes : 0;
+    batch_samples = 0;
+
     ei_printf("Samples req: %d\n", samples_required);
 
     // Minimum delay of 2000 ms for daemon
@@ -198,7 +205,12 @@ bool ei_sampler_start_sampling(void *v_ptr_payload, starter_callback ei_sample_s
                     ((sample_buffer_size / mem->block_size) + 1) * mem->block_erase_time);
     }
 
-    if(mem->erase_sample_data(0, sample_buffer_size) != (sample_buffer_size)) {
+    // sectors of older samples in the way are erased in the background
+    char sensor_name[EI_SAMPLE_STORE_SENSOR_LEN];
+    get_sensor_name(payload, sensor_name, sizeof(sensor_name));
+    if (!ei_get_sample_store()->begin(sensor_name, dev->get_sample_label().c_str(),
+            sample_buffer_size + sizeof(ei_mic_ctx_buffer), &sample_address)) {
+        ei_printf("Failed to reserve %u bytes in flash\n", sample_buffer_size);
         return false;
     }
     ESP_LOGD(TAG, "Done erasing\n");
@@ -247,7 +259,6 @@ bool ei_sampler_start_sampling(void *v_ptr_payload, starter_callback ei_sample_s
 static bool create_header(sensor_aq_payload_info *payload)
 {
     EiDeviceInfo* dev = EiDeviceInfo::get_device();
-    EiDeviceMemory* mem = dev->get_memory();
     sensor_aq_init_mbedtls_hs256_context(&ei_mic_signing_ctx, &ei_mic_hs_ctx, dev->get_sample_hmac_key().c_str());
 
     int tr = sensor_aq_init(&ei_mic_ctx, payload, NULL, true);
@@ -272,11 +283,10 @@ static bool create_header(sensor_aq_payload_info *payload)
     }
 
     // Write to blockdevice
-    tr = mem->write_sample_data((uint8_t*)ei_mic_ctx.cbor_buffer.ptr, 0, end_of_header_ix);
     ESP_LOGD(TAG, "Try to write %d bytes\r\n", end_of_header_ix);
 
-    if (tr != end_of_header_ix) {
-        ei_printf("Failed to write to header blockdevice (%d)\n", tr);
+    if (!ei_get_sample_store()->append((uint8_t*)ei_mic_ctx.cbor_buffer.ptr, end_of_header_ix)) {
+        ei_printf("Failed to write to header blockdevice\n");
         return false;
     }
 
@@ -299,7 +309,7 @@ static void finish_and_upload(char *filename, uint32_t sample_length_ms)
     ei_printf("Done sampling, total samples collected: %u\n", samples_required);
     ei_printf("[1/1] Uploading file to Edge Impulse...\n");
 
-    ei_printf("Not uploading file, not connected to WiFi. Used buffer, from=%d, to=%d.\n", 0, write_addr + headerOffset);
+    ei_printf("Not uploading file, not connected to WiFi. Used buffer, from=%d, to=%d.\n", sample_address, sample_address + write_addr + headerOffset);
 
     ei_printf("[1/1] Uploading file to Edge Impulse OK (took %d ms.)\n", 200);
 
@@ -316,7 +326,24 @@ static void finish_and_upload(char *filename, uint32_t sample_length_ms)
  */
 static bool sample_data_callback(const void *sample_buf, uint32_t byteLenght)
 {
-    sensor_aq_add_data(&ei_mic_ctx, (float *)sample_buf, byteLenght / sizeof(float));
+    uint32_t axes = byteLenght / sizeof(float);
+
+    if (batch_capacity == 0 || axes != batch_axes) {
+        // keep sample order, anything staged goes out first
+        if (batch_samples) {
+            sensor_aq_add_data_batch_f32(&ei_mic_ctx, batch_buf, batch_samples);
+            batch_samples = 0;
+        }
+        sensor_aq_add_data(&ei_mic_ctx, (float *)sample_buf, axes);
+    }
+    else {
+        // stage the sample, encode (and sign / write) a whole batch at once
+        memcpy(batch_buf + batch_samples * axes, sample_buf, axes * sizeof(float));
+        if (++batch_samples == batch_capacity || current_sample + 1 >= samples_required) {
+            sensor_aq_add_data_batch_f32(&ei_mic_ctx, batch_buf, batch_samples);
+            batch_samples = 0;
+        }
+    }
 
     if (++current_sample >= samples_required) {
         return true;
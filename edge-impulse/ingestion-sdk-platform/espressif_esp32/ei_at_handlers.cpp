@@ -46,6 +46,8 @@
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 
 #include "ei_run_impulse.h"
+#include "ei_result_stream.h"
+#include "ei_sample_store.h"
 
 #include "model-parameters/model_metadata.h"
 
@@ -55,7 +57,8 @@ using namespace std;
 EiDeviceESP32* dev = static_cast<EiDeviceESP32*>(EiDeviceESP32::get_device());
 EiDeviceMemory* mem = dev->get_memory();
 
-#define TRANSFER_BUF_LEN 128
+// chunk of AT+RUNIMPULSESTATIC, decoded while it arrives so it needs no buffer of its own
+#define TRANSFER_BUF_LEN 1024
 
 // Helper functions
 
@@ -207,7 +210,43 @@ bool at_clear_config(void)
 
 bool at_unlink_file(const char **argv, const int argc)
 {
-    ei_printf("\n");
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    uint32_t id = (uint32_t)atoi(argv[0]);
+
+    if (ei_get_sample_store()->remove(id)) {
+        ei_printf("OK\n");
+    }
+    else {
+        ei_printf("ERR: No sample with id %u\n", id);
+    }
+
+    return true;
+}
+
+bool at_list_files(void)
+{
+    EiSampleStore *store = ei_get_sample_store();
+
+    // id, sensor, label, then START,LENGTH as taken by AT+READBUFFER
+    for (uint32_t ix = 0; ix < store->count(); ix++) {
+        const ei_sample_info_t *info = store->at(ix);
+        ei_printf("%u,%s,%s,%u,%u\n", info->id, info->sensor, info->name, info->address, info->length);
+    }
+
+    return true;
+}
+
+bool at_clear_files(void)
+{
+    if (ei_get_sample_store()->format()) {
+        ei_printf("OK\n");
+    }
+    else {
+        ei_printf("ERR: Failed to clear the sample store\n");
+    }
 
     return true;
 }
@@ -224,9 +263,15 @@ bool at_read_buffer(const char **argv, const int argc)
     size_t length = (size_t)atoi(argv[1]);
 
     bool use_max_baudrate = false;
+    bool use_binary = false;
     if (argc >= 3 && argv[2][0] == 'y') {
         use_max_baudrate = true;
     }
+    // binary frames, always at the max baud rate
+    if (argc >= 3 && argv[2][0] == 'b') {
+        use_max_baudrate = true;
+        use_binary = true;
+    }
 
     if (use_max_baudrate) {
         ei_printf("\r\nOK");
@@ -235,7 +280,12 @@ bool at_read_buffer(const char **argv, const int argc)
         ei_sleep(100);
     }
 
-    success = read_encode_send_sample_buffer(start, length);
+    if (use_binary) {
+        success = read_send_sample_buffer_binary(start, length);
+    }
+    else {
+        success = read_encode_send_sample_buffer(start, length);
+    }
 
     if (use_max_baudrate) {
         ei_printf("\r\nOK\r\n");
@@ -356,6 +406,25 @@ bool at_run_impulse_cont(void)
     return true;
 }
 
+static bool run_impulse_binary(bool use_max_uart_speed)
+{
+    ei_result_stream_set_mode(EI_RESULT_OUTPUT_BINARY);
+    ei_start_impulse(true, false, use_max_uart_speed);
+    ei_result_stream_set_mode(EI_RESULT_OUTPUT_TEXT);
+
+    return true;
+}
+
+bool at_run_impulse_binary(void)
+{
+    return run_impulse_binary(false);
+}
+
+bool at_run_impulse_binary_args(const char **argv, const int argc)
+{
+    return run_impulse_binary(argc > 0 && argv[0][0] == 'y');
+}
+
 bool at_stop_impulse(void)
 {
     ei_stop_impulse();
@@ -439,8 +508,9 @@ bool at_take_snapshot(const char **argv, const int argc)
     if (argc >= 3 && argv[2][0] == 'y') {
         use_max_baudrate = true;
     }
+    bool use_binary = (argc >= 3 && argv[2][0] == 'b');
 
-    ei_camera_take_snapshot_output_on_serial(width, height, use_max_baudrate);
+    ei_camera_take_snapshot_output_on_serial(width, height, use_max_baudrate, use_binary);
 
     return true;
 }
@@ -460,8 +530,16 @@ bool at_snapshot_stream(const char **argv, const int argc)
     if (argc >= 3 && argv[2][0] == 'y') {
         use_max_baudrate = true;
     }
+    bool use_binary = (argc >= 3 && argv[2][0] == 'b');
 
-    if (ei_camera_start_snapshot_stream(width, height, use_max_baudrate) == false) {
+    // any 4th argument switches to JPEG frames, 0 (best) .. 3 (low) picks the quality
+    int jpeg_quality = EI_SNAPSHOT_FORMAT_RAW;
+    if (argc >= 4) {
+        jpeg_quality = (argv[3][0] >= '0' && argv[3][0] <= '3') ? argv[3][0] - '0'
+                                                                 : EI_SNAPSHOT_STREAM_JPEG_QUALITY;
+    }
+
+    if (ei_camera_start_snapshot_stream(width, height, use_max_baudrate, use_binary, jpeg_quality) == false) {
         return true;
     }
 
@@ -622,6 +700,20 @@ ATServer *ei_at_init(EiDeviceESP32 *device)
         nullptr,
         at_unlink_file,
         AT_UNLINKFILE_ARGS);
+    at->register_command(
+        AT_LISTFILES,
+        AT_LISTFILES_HELP_TEXT,
+        at_list_files,
+        nullptr,
+        nullptr,
+        nullptr);
+    at->register_command(
+        AT_CLEARFILES,
+        AT_CLEARFILES_HELP_TEXT,
+        at_clear_files,
+        nullptr,
+        nullptr,
+        nullptr);
     at->register_command(
         AT_RUNIMPULSE,
         AT_RUNIMPULSE_HELP_TEXT,
@@ -650,6 +742,13 @@ ATServer *ei_at_init(EiDeviceESP32 *device)
         nullptr,
         at_run_impulse_static_data,
         AT_RUNIMPULSESTATIC_ARGS);
+    at->register_command(
+        AT_RUNIMPULSEBIN,
+        AT_RUNIMPULSEBIN_HELP_TEXT,
+        at_run_impulse_binary,
+        nullptr,
+        at_run_impulse_binary_args,
+        AT_RUNIMPULSEBIN_ARGS);
     at->register_command(
         AT_SNAPSHOT,
         AT_SNAPSHOT_HELP_TEXT,
@@ -43,6 +43,9 @@
 #include "ei_config_types.h"
 #include "ei_microphone.h"
 #include "flash_memory.h"
+#include "ei_sample_store.h"
+#include "ei_device_lib.h"
+#include "ei_sample_scheduler.h"
 
 #include "esp_system.h"
 #include "driver/gpio.h"
@@ -50,7 +53,6 @@
 #include "esp_mac.h"
 
 #include <freertos/FreeRTOS.h>
-#include <freertos/timers.h>
 
 /* Constants --------------------------------------------------------------- */
 #define EI_RED_LED_OFF      gpio_set_level(GPIO_NUM_21, 0);
@@ -58,13 +60,6 @@
 #define EI_RED_LED_ON     gpio_set_level(GPIO_NUM_21, 1);
 #define EI_WHITE_LED_ON    gpio_set_level(GPIO_NUM_22, 1);
 
-/** Global objects */
-TimerHandle_t fusion_timer;
-void (*sample_cb_ptr)(void);
-
-/* Private function declarations ------------------------------------------- */
-void vTimerCallback(TimerHandle_t xTimer);
-
 /* Public functions -------------------------------------------------------- */
 
 EiDeviceESP32::EiDeviceESP32(EiDeviceMemory* mem)
@@ -129,6 +124,28 @@ EiDeviceInfo* EiDeviceInfo::get_device(void)
     return &dev;
 }
 
+EiSampleStore *ei_get_sample_store(void)
+{
+    static EiSampleStore store(EiDeviceInfo::get_device()->get_memory());
+    static bool mounted = false;
+
+    if (!mounted) {
+        mounted = store.mount();
+        if (!mounted) {
+            ei_printf("ERR: Failed to mount the sample store\n");
+        }
+    }
+
+    return &store;
+}
+
+size_t ei_get_sample_start(size_t address)
+{
+    const ei_sample_info_t *info = ei_get_sample_store()->find_address(address);
+
+    return info != nullptr ? info->address : address;
+}
+
 void EiDeviceESP32::clear_config(void)
 {
     EiDeviceInfo::clear_config();
@@ -291,15 +308,10 @@ void EiDeviceESP32::set_max_data_output_baudrate(void)
  */
 bool EiDeviceESP32::start_sample_thread(void (*sample_read_cb)(void), float sample_interval_ms)
 {
-    sample_cb_ptr = sample_read_cb;
-    fusion_timer = xTimerCreate(
-                        "Fusion sampler",
-                        (uint32_t)sample_interval_ms / portTICK_RATE_MS,
-                        pdTRUE,
-                        (void *) 0,
-                        vTimerCallback
-                    );
-    xTimerStart(fusion_timer, 0);
+    if (!ei_sample_scheduler_start(sample_read_cb, sample_interval_ms)) {
+        ei_printf("ERR: failed to start the sampler\n");
+        return false;
+    }
 
     return true;
 }
@@ -310,11 +322,7 @@ bool EiDeviceESP32::start_sample_thread(void (*sample_read_cb)(void), float samp
  */
 bool EiDeviceESP32::stop_sample_thread(void)
 {
-
-    if (xTimerStop(fusion_timer, 0) != pdPASS)
-    {
-        ei_printf("ERR: timer has not been stopped \n");
-    }
+    ei_sample_scheduler_stop();
 
     return true;
 }
@@ -376,6 +384,37 @@ char ei_get_serial_byte(void)
     return ch;
 }
 
+/**
+ * @brief      Write a block of characters to the serial port
+ *
+ * @param      data    characters to write
+ * @param[in]  length  number of characters
+ */
+void ei_write_string(char *data, int length)
+{
+    if (length > 0) {
+        fwrite(data, 1, length, stdout);
+    }
+}
+
+/**
+ * @brief      Read the characters already received on the serial port,
+ *             never blocks
+ *
+ * @param      data        buffer for the characters
+ * @param[in]  max_length  size of the buffer
+ *
+ * @return     number of characters read
+ */
+int ei_read_string(char *data, int max_length)
+{
+    // stdin is non blocking, fread stops at the first empty read and flags it
+    size_t length = fread(data, 1, max_length, stdin);
+    clearerr(stdin);
+
+    return (int)length;
+}
+
 char ei_getchar()
 {
 	char ch = getchar();
@@ -392,10 +431,3 @@ char ei_getchar()
     return ch;
 
 }
-
-/* Private functions ------------------------------------------------------- */
-
-void vTimerCallback(TimerHandle_t xTimer)
-{
-    sample_cb_ptr();
-}
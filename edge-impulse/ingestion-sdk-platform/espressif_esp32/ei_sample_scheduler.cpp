@@ -0,0 +1,326 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_sample_scheduler.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/* Constants --------------------------------------------------------------- */
+#ifndef EI_SAMPLE_SCHEDULER_TASK_STACK_SIZE
+#define EI_SAMPLE_SCHEDULER_TASK_STACK_SIZE 8192
+#endif
+
+#ifndef EI_SAMPLE_SCHEDULER_TASK_PRIORITY
+#define EI_SAMPLE_SCHEDULER_TASK_PRIORITY   (configMAX_PRIORITIES - 5)
+#endif
+
+/* Private variables ------------------------------------------------------- */
+static void (*sample_callback)(void) = nullptr;
+static std::atomic<bool> running(false);
+
+static int64_t start_us = 0;
+static uint64_t interval_ns = 0;
+static uint32_t next_tick = 0;              // index of the next deadline
+static int64_t sample_timestamp_us = 0;     // wake up time of the sample being taken
+
+static ei_sample_scheduler_stats_t stats;
+
+/* Private functions ------------------------------------------------------- */
+
+static int64_t deadline_of(uint32_t tick)
+{
+    return start_us + (int64_t)((tick * interval_ns) / 1000);
+}
+
+/**
+ * @brief      Move past the deadlines that already expired, they can no longer be met
+ */
+static void skip_expired_deadlines(int64_t now_us)
+{
+    while (deadline_of(next_tick) <= now_us) {
+        next_tick++;
+        stats.missed++;
+    }
+}
+
+static void run_sample(int64_t now_us, int64_t deadline_us)
+{
+    uint32_t jitter_us = now_us > deadline_us ? (uint32_t)(now_us - deadline_us) : 0;
+    uint32_t bin = jitter_us == 0 ? 0 : 32 - __builtin_clz(jitter_us);
+    if (bin >= EI_SAMPLE_SCHEDULER_JITTER_BINS) {
+        bin = EI_SAMPLE_SCHEDULER_JITTER_BINS - 1;
+    }
+
+    stats.jitter_histogram[bin]++;
+    stats.total_jitter_us += jitter_us;
+    if (jitter_us > stats.max_jitter_us) {
+        stats.max_jitter_us = jitter_us;
+    }
+    stats.samples++;
+
+    sample_timestamp_us = now_us;
+    sample_callback();
+}
+
+#ifdef ESP_PLATFORM
+static esp_timer_handle_t sample_timer = nullptr;
+static TaskHandle_t sample_task = nullptr;
+static std::atomic<bool> sample_pending(false);
+static int64_t pending_deadline_us = 0;
+
+static void sample_task_fn(void *arg)
+{
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (running) {
+            run_sample(esp_timer_get_time(), pending_deadline_us);
+        }
+        sample_pending = false;
+    }
+}
+
+static void arm_next_deadline(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    skip_expired_deadlines(now_us);
+    esp_timer_start_once(sample_timer, deadline_of(next_tick) - now_us);
+}
+
+/**
+ * @brief      Runs in the esp_timer task, only hands the sample over and re-arms
+ */
+static void sample_timer_cb(void *arg)
+{
+    if (!running) {
+        return;
+    }
+
+    if (sample_pending) {
+        // previous sample still running, don't queue up a burst behind it
+        stats.missed++;
+    }
+    else {
+        pending_deadline_us = deadline_of(next_tick);
+        sample_pending = true;
+        xTaskNotifyGive(sample_task);
+    }
+
+    next_tick++;
+    arm_next_deadline();
+}
+
+static int64_t now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+static bool backend_start(void)
+{
+    if (sample_task == nullptr) {
+        BaseType_t ret = xTaskCreate(
+            sample_task_fn,
+            "ei_sampler",
+            EI_SAMPLE_SCHEDULER_TASK_STACK_SIZE,
+            nullptr,
+            EI_SAMPLE_SCHEDULER_TASK_PRIORITY,
+            &sample_task);
+        if (ret != pdPASS) {
+            sample_task = nullptr;
+            return false;
+        }
+    }
+
+    if (sample_timer == nullptr) {
+        esp_timer_create_args_t args = { };
+        args.callback = sample_timer_cb;
+        args.name = "ei_sampler";
+        if (esp_timer_create(&args, &sample_timer) != ESP_OK) {
+            sample_timer = nullptr;
+            return false;
+        }
+    }
+
+    sample_pending = false;
+    arm_next_deadline();
+    return true;
+}
+
+static void backend_stop(void)
+{
+    if (sample_timer) {
+        esp_timer_stop(sample_timer);
+    }
+}
+#else
+static std::atomic<uint32_t> generation(0);
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *sample_thread_fn(void *arg)
+{
+    const uint32_t my_generation = (uint32_t)(uintptr_t)arg;
+
+    while (running && generation == my_generation) {
+        int64_t deadline_us = deadline_of(next_tick);
+        struct timespec ts;
+        ts.tv_sec = deadline_us / 1000000;
+        ts.tv_nsec = (deadline_us % 1000000) * 1000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) != 0) { }
+
+        if (!running || generation != my_generation) {
+            break;
+        }
+
+        run_sample(now_us(), deadline_us);
+        next_tick++;
+        skip_expired_deadlines(now_us());
+    }
+
+    return nullptr;
+}
+
+static bool backend_start(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    uint32_t my_generation = ++generation;
+    int ret = pthread_create(&thread, &attr, sample_thread_fn, (void *)(uintptr_t)my_generation);
+    pthread_attr_destroy(&attr);
+
+    return ret == 0;
+}
+
+static void backend_stop(void)
+{
+    // the thread sees the flag at its next deadline and exits
+}
+#endif
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief      Call sample_cb every sample_interval_ms, the first call one interval from now
+ *
+ * @param[in]  sample_cb           Sensor read callback, runs in the sampler task
+ * @param[in]  sample_interval_ms  Interval, fractional values are kept exactly on average
+ *
+ * @return     false if the task or timer could not be created
+ */
+bool ei_sample_scheduler_start(void (*sample_cb)(void), float sample_interval_ms)
+{
+    if (sample_cb == nullptr || sample_interval_ms <= 0.0f) {
+        return false;
+    }
+
+    ei_sample_scheduler_stop();
+
+    memset(&stats, 0, sizeof(stats));
+    interval_ns = (uint64_t)((double)sample_interval_ms * 1000000.0 + 0.5);
+    stats.interval_us = (uint32_t)((interval_ns + 500) / 1000);
+    sample_callback = sample_cb;
+    start_us = now_us();
+    next_tick = 1;
+    running = true;
+
+    if (!backend_start()) {
+        running = false;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Stop sampling, safe to call from the sample callback
+ */
+void ei_sample_scheduler_stop(void)
+{
+    running = false;
+    backend_stop();
+}
+
+bool ei_sample_scheduler_running(void)
+{
+    return running;
+}
+
+/**
+ * @brief      Time (in us) the current sample was taken, valid inside the sample callback
+ */
+int64_t ei_sample_scheduler_timestamp_us(void)
+{
+    return sample_timestamp_us;
+}
+
+void ei_sample_scheduler_get_stats(ei_sample_scheduler_stats_t *out)
+{
+    memcpy(out, &stats, sizeof(stats));
+}
+
+void ei_sample_scheduler_print_stats(void)
+{
+    ei_printf("Sampler: %u samples at %u us, %u missed, jitter avg %u us max %u us\n",
+        (unsigned)stats.samples,
+        (unsigned)stats.interval_us,
+        (unsigned)stats.missed,
+        (unsigned)(stats.samples ? stats.total_jitter_us / stats.samples : 0),
+        (unsigned)stats.max_jitter_us);
+
+    for (int i = 0; i < EI_SAMPLE_SCHEDULER_JITTER_BINS; i++) {
+        if (stats.jitter_histogram[i] == 0) {
+            continue;
+        }
+        ei_printf("  < %u us: %u\n", 1u << i, (unsigned)stats.jitter_histogram[i]);
+    }
+}
@@ -0,0 +1,68 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_SAMPLE_SCHEDULER_H
+#define EI_SAMPLE_SCHEDULER_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+
+/**
+ * Periodic sampling driven by a microsecond timer. Deadlines are absolute
+ * (start + k * interval), so rounding and late wake ups never accumulate into
+ * drift, and the sensor callback runs in a dedicated high priority task that
+ * the timer only notifies. On a host the same scheduler runs on a POSIX
+ * thread sleeping until each absolute deadline.
+ */
+
+/** Number of jitter histogram bins, bin 0 is < 1 us and bin n covers [2^(n-1), 2^n) us */
+#define EI_SAMPLE_SCHEDULER_JITTER_BINS 16
+
+typedef struct {
+    uint32_t interval_us;       // rounded, deadlines use the exact interval
+    uint32_t samples;           // callbacks run
+    uint32_t missed;            // deadlines skipped because the previous sample was still running
+    uint32_t max_jitter_us;     // worst lateness of a callback against its deadline
+    uint64_t total_jitter_us;
+    uint32_t jitter_histogram[EI_SAMPLE_SCHEDULER_JITTER_BINS];
+} ei_sample_scheduler_stats_t;
+
+bool ei_sample_scheduler_start(void (*sample_cb)(void), float sample_interval_ms);
+void ei_sample_scheduler_stop(void);
+bool ei_sample_scheduler_running(void);
+int64_t ei_sample_scheduler_timestamp_us(void);
+void ei_sample_scheduler_get_stats(ei_sample_scheduler_stats_t *stats);
+void ei_sample_scheduler_print_stats(void);
+
+#endif /* EI_SAMPLE_SCHEDULER_H */
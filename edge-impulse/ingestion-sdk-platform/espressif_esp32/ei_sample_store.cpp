@@ -0,0 +1,714 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_sample_store.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/* Constants --------------------------------------------------------------- */
+#define RECORD_MAGIC        0x31534945  // "EIS1"
+#define CHECKPOINT_MAGIC    0x314b4345  // "ECK1"
+#define NOT_DELETED         0xFFFFFFFF
+
+/* On flash structures ----------------------------------------------------- */
+
+/**
+ * Fields after header_crc stay erased (0xFF) until they are programmed, so a
+ * record can be committed or deleted without another erase.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t reserved;      // bytes of the log reserved by the record, sector multiple
+    char sensor[EI_SAMPLE_STORE_SENSOR_LEN];
+    char name[EI_SAMPLE_STORE_NAME_LEN];
+    uint32_t header_crc;    // fields above
+    uint32_t length;        // programmed on commit
+    uint32_t data_crc;
+    uint32_t commit_crc;    // id, length and data_crc, a torn commit never validates
+    uint32_t deleted;       // programmed to 0 when the sample is removed
+} record_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t head;
+    uint32_t next_id;
+    uint32_t count;
+    struct {
+        uint32_t record;
+        uint32_t id;
+    } entries[EI_SAMPLE_STORE_MAX_SAMPLES];
+    uint32_t crc;
+} checkpoint_t;
+
+#define RECORD_HEADER_SIZE  sizeof(record_header_t)
+
+static_assert(sizeof(record_header_t) == 80, "unexpected record header size");
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief      CRC32 (IEEE 802.3, same as zlib), chainable: pass the previous result as crc
+ */
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t length)
+{
+    static const uint32_t nibble_table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    crc = ~crc;
+    for (size_t ix = 0; ix < length; ix++) {
+        crc ^= bytes[ix];
+        crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+static uint32_t commit_crc_of(uint32_t id, uint32_t length, uint32_t data_crc)
+{
+    uint32_t fields[3] = { id, length, data_crc };
+
+    return crc32_update(0, fields, sizeof(fields));
+}
+
+static bool is_committed(const record_header_t *header)
+{
+    return header->commit_crc == commit_crc_of(header->id, header->length, header->data_crc)
+        && header->length <= header->reserved - RECORD_HEADER_SIZE;
+}
+
+static void copy_name(char *dst, const char *src, size_t size)
+{
+    memset(dst, 0, size);
+    if (src) {
+        strncpy(dst, src, size - 1);
+    }
+}
+
+static int compare_by_id(const void *a, const void *b)
+{
+    int32_t diff = (int32_t)(((const uint32_t *)a)[1] - ((const uint32_t *)b)[1]);
+
+    return diff < 0 ? -1 : (diff > 0 ? 1 : 0);
+}
+
+/* Public functions -------------------------------------------------------- */
+
+EiSampleStore::EiSampleStore(EiDeviceMemory *memory)
+    : memory(memory)
+    , mounted(false)
+    , n_index(0)
+    , head(0)
+    , next_id(1)
+    , erased_until(0)
+    , checkpoint_seq(0)
+    , commits_since_checkpoint(0)
+    , writing(false)
+    , write_failed(false)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool EiSampleStore::mount(void)
+{
+    mounted = false;
+    writing = false;
+    n_index = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    sector_size = memory->block_size;
+    if (sector_size == 0 || sizeof(checkpoint_t) > sector_size) {
+        return false;
+    }
+
+    uint32_t area = memory->get_available_sample_bytes();
+    log_start = 2 * sector_size;
+    log_end = area - area % sector_size;
+    if (log_end < log_start + 2 * sector_size) {
+        return false;
+    }
+
+    slot_size = 256;
+    while (slot_size < sizeof(checkpoint_t)) {
+        slot_size *= 2;
+    }
+    slots_per_sector = sector_size / slot_size;
+
+    head = log_start;
+    next_id = 1;
+
+    if (load_checkpoint()) {
+        replay();
+    }
+    else {
+        stats.full_scan = true;
+        if (!full_scan()) {
+            return false;
+        }
+    }
+
+    erased_until = head;
+    commits_since_checkpoint = 0;
+    mounted = true;
+
+    // next mount starts from here
+    if (stats.full_scan || stats.replayed) {
+        write_checkpoint();
+    }
+
+    return true;
+}
+
+bool EiSampleStore::format(void)
+{
+    if (!mounted) {
+        return false;
+    }
+
+    abort();
+    n_index = 0;
+
+    return write_checkpoint();
+}
+
+bool EiSampleStore::begin(const char *sensor, const char *name, uint32_t max_length, uint32_t *data_address)
+{
+    if (!mounted) {
+        return false;
+    }
+    abort();
+
+    if (max_length > log_end - log_start - RECORD_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t reserved = align(RECORD_HEADER_SIZE + max_length);
+
+    uint32_t start = head;
+    if (start + reserved > log_end) {
+        start = log_start;
+    }
+
+    // samples in the way are marked deleted first, a cut erase must not bring them back
+    evict_range(start, start + reserved, true);
+
+    // sectors left erased by the previous sample or erased ahead of time are reused as is
+    uint32_t erase_from = start;
+    if (start == head && erased_until > start) {
+        erase_from = erased_until < start + reserved ? erased_until : start + reserved;
+    }
+    if (erase_from < start + reserved) {
+        uint32_t n_bytes = start + reserved - erase_from;
+        if (memory->erase_sample_data(erase_from, n_bytes) != n_bytes) {
+            return false;
+        }
+    }
+    erased_until = start + reserved;
+
+    record_header_t header;
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = RECORD_MAGIC;
+    header.id = next_id++;
+    header.reserved = reserved;
+    copy_name(header.sensor, sensor, sizeof(header.sensor));
+    copy_name(header.name, name, sizeof(header.name));
+    header.header_crc = crc32_update(0, &header, offsetof(record_header_t, header_crc));
+
+    // whatever happens next, the following sample starts after this one
+    head = start + reserved;
+
+    uint32_t n_bytes = offsetof(record_header_t, length);
+    if (memory->write_sample_data((const uint8_t *)&header, start, n_bytes) != n_bytes) {
+        return false;
+    }
+
+    writing = true;
+    write_failed = false;
+    cur_id = header.id;
+    cur_record = start;
+    cur_reserved = reserved;
+    cur_length = 0;
+    cur_crc = 0;
+    memcpy(cur_sensor, header.sensor, sizeof(cur_sensor));
+    memcpy(cur_name, header.name, sizeof(cur_name));
+
+    if (data_address) {
+        *data_address = start + RECORD_HEADER_SIZE;
+    }
+
+    return true;
+}
+
+bool EiSampleStore::append(const uint8_t *data, uint32_t length)
+{
+    if (!writing || write_failed) {
+        return false;
+    }
+
+    if (length > cur_reserved - RECORD_HEADER_SIZE - cur_length
+        || memory->write_sample_data(data, cur_record + RECORD_HEADER_SIZE + cur_length, length) != length) {
+        write_failed = true;
+        return false;
+    }
+
+    cur_crc = crc32_update(cur_crc, data, length);
+    cur_length += length;
+
+    return true;
+}
+
+bool EiSampleStore::commit(ei_sample_info_t *info)
+{
+    if (!writing) {
+        return false;
+    }
+    writing = false;
+
+    // the data has to be on flash before the commit makes it valid
+    if (write_failed || memory->flush_data() != 0) {
+        return false;
+    }
+
+    record_header_t header;
+    memset(&header, 0xFF, sizeof(header));
+    header.id = cur_id;
+    memcpy(header.sensor, cur_sensor, sizeof(header.sensor));
+    memcpy(header.name, cur_name, sizeof(header.name));
+    header.length = cur_length;
+    header.data_crc = cur_crc;
+    header.commit_crc = commit_crc_of(cur_id, cur_length, cur_crc);
+
+    uint32_t n_bytes = offsetof(record_header_t, deleted) - offsetof(record_header_t, length);
+    if (memory->write_sample_data((const uint8_t *)&header.length, cur_record + offsetof(record_header_t, length), n_bytes) != n_bytes
+        || memory->flush_data() != 0) {
+        return false;
+    }
+
+    add_entry(&header, cur_record);
+    head = align(cur_record + RECORD_HEADER_SIZE + cur_length);
+
+    if (info) {
+        *info = index[n_index - 1];
+    }
+
+    if (++commits_since_checkpoint >= EI_SAMPLE_STORE_CHECKPOINT_INTERVAL) {
+        write_checkpoint();
+    }
+    preerase();
+
+    return true;
+}
+
+void EiSampleStore::abort(void)
+{
+    // the header stays without a commit, mount skips the reserved sectors
+    writing = false;
+}
+
+bool EiSampleStore::remove(uint32_t id)
+{
+    for (uint32_t ix = 0; ix < n_index; ix++) {
+        if (index[ix].id == id) {
+            const uint32_t deleted = 0;
+            uint32_t address = index[ix].record + offsetof(record_header_t, deleted);
+
+            if (memory->write_sample_data((const uint8_t *)&deleted, address, sizeof(deleted)) != sizeof(deleted)
+                || memory->flush_data() != 0) {
+                return false;
+            }
+            remove_entry(ix);
+
+            return write_checkpoint();
+        }
+    }
+
+    return false;
+}
+
+uint32_t EiSampleStore::count(void) const
+{
+    return n_index;
+}
+
+const ei_sample_info_t *EiSampleStore::at(uint32_t ix) const
+{
+    return ix < n_index ? &index[ix] : nullptr;
+}
+
+const ei_sample_info_t *EiSampleStore::find(uint32_t id) const
+{
+    for (uint32_t ix = 0; ix < n_index; ix++) {
+        if (index[ix].id == id) {
+            return &index[ix];
+        }
+    }
+
+    return nullptr;
+}
+
+const ei_sample_info_t *EiSampleStore::find_address(uint32_t address) const
+{
+    for (uint32_t ix = 0; ix < n_index; ix++) {
+        if (address >= index[ix].address && address - index[ix].address < index[ix].length) {
+            return &index[ix];
+        }
+    }
+
+    return nullptr;
+}
+
+uint32_t EiSampleStore::read(uint32_t id, uint32_t offset, uint8_t *data, uint32_t length)
+{
+    const ei_sample_info_t *info = find(id);
+
+    if (info == nullptr || offset >= info->length) {
+        return 0;
+    }
+    if (length > info->length - offset) {
+        length = info->length - offset;
+    }
+
+    return memory->read_sample_data(data, info->address + offset, length);
+}
+
+bool EiSampleStore::verify(uint32_t id)
+{
+    const ei_sample_info_t *info = find(id);
+    uint8_t buffer[128];
+    uint32_t crc = 0;
+
+    if (info == nullptr) {
+        return false;
+    }
+
+    for (uint32_t offset = 0; offset < info->length; offset += sizeof(buffer)) {
+        uint32_t n_bytes = info->length - offset < sizeof(buffer) ? info->length - offset : sizeof(buffer);
+        if (memory->read_sample_data(buffer, info->address + offset, n_bytes) != n_bytes) {
+            return false;
+        }
+        crc = crc32_update(crc, buffer, n_bytes);
+    }
+
+    return crc == info->crc;
+}
+
+uint32_t EiSampleStore::max_sample_length(void) const
+{
+    return mounted ? log_end - log_start - RECORD_HEADER_SIZE : 0;
+}
+
+void EiSampleStore::get_stats(ei_sample_store_stats_t *stats) const
+{
+    *stats = this->stats;
+}
+
+/* Private functions ------------------------------------------------------- */
+
+uint32_t EiSampleStore::align(uint32_t address) const
+{
+    return ((address + sector_size - 1) / sector_size) * sector_size;
+}
+
+/**
+ * @brief      Read a record header, true if it is a valid (not necessarily committed) record
+ */
+bool EiSampleStore::read_record(uint32_t record, void *header)
+{
+    record_header_t *h = (record_header_t *)header;
+
+    if (record < log_start || record + RECORD_HEADER_SIZE > log_end) {
+        return false;
+    }
+
+    stats.mount_reads++;
+    if (memory->read_sample_data((uint8_t *)h, record, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    return h->magic == RECORD_MAGIC
+        && h->header_crc == crc32_update(0, h, offsetof(record_header_t, header_crc))
+        && h->reserved >= RECORD_HEADER_SIZE
+        && h->reserved % sector_size == 0
+        && h->reserved <= log_end - record;
+}
+
+void EiSampleStore::add_entry(const void *header, uint32_t record)
+{
+    const record_header_t *h = (const record_header_t *)header;
+
+    if (n_index == EI_SAMPLE_STORE_MAX_SAMPLES) {
+        remove_entry(0);
+        stats.evicted++;
+    }
+
+    ei_sample_info_t *info = &index[n_index++];
+    info->id = h->id;
+    info->record = record;
+    info->address = record + RECORD_HEADER_SIZE;
+    info->length = h->length;
+    info->crc = h->data_crc;
+    memcpy(info->sensor, h->sensor, sizeof(info->sensor));
+    memcpy(info->name, h->name, sizeof(info->name));
+    info->sensor[sizeof(info->sensor) - 1] = '\0';
+    info->name[sizeof(info->name) - 1] = '\0';
+}
+
+void EiSampleStore::remove_entry(uint32_t ix)
+{
+    memmove(&index[ix], &index[ix + 1], (n_index - ix - 1) * sizeof(index[0]));
+    n_index--;
+}
+
+/**
+ * @brief      Drop the samples that overlap [start, end), they are about to be
+ *             overwritten. With mark the deletion is also programmed on flash.
+ */
+void EiSampleStore::evict_range(uint32_t start, uint32_t end, bool mark)
+{
+    for (uint32_t ix = 0; ix < n_index;) {
+        uint32_t record_end = align(index[ix].address + index[ix].length);
+
+        if (index[ix].record < end && start < record_end) {
+            if (mark) {
+                const uint32_t deleted = 0;
+                memory->write_sample_data((const uint8_t *)&deleted,
+                    index[ix].record + offsetof(record_header_t, deleted), sizeof(deleted));
+            }
+            remove_entry(ix);
+            stats.evicted++;
+        }
+        else {
+            ix++;
+        }
+    }
+}
+
+/**
+ * @brief      Apply a record found on flash, in id order: it overwrote whatever
+ *             it overlaps and the log continues after it
+ */
+void EiSampleStore::track_record(const void *header, uint32_t record)
+{
+    const record_header_t *h = (const record_header_t *)header;
+    bool committed = is_committed(h);
+    uint32_t end = committed ? align(record + RECORD_HEADER_SIZE + h->length) : record + h->reserved;
+
+    evict_range(record, end, false);
+    if (committed && h->deleted == NOT_DELETED) {
+        add_entry(h, record);
+    }
+
+    if ((int32_t)(h->id - next_id) >= 0) {
+        next_id = h->id + 1;
+        head = end;
+    }
+}
+
+bool EiSampleStore::load_checkpoint(void)
+{
+    checkpoint_t best;
+    checkpoint_t slot;
+    bool found = false;
+
+    for (uint32_t ix = 0; ix < 2 * slots_per_sector; ix++) {
+        uint32_t address = (ix / slots_per_sector) * sector_size + (ix % slots_per_sector) * slot_size;
+
+        stats.mount_reads++;
+        if (memory->read_sample_data((uint8_t *)&slot, address, sizeof(slot)) != sizeof(slot)) {
+            continue;
+        }
+        if (slot.magic != CHECKPOINT_MAGIC
+            || slot.crc != crc32_update(0, &slot, offsetof(checkpoint_t, crc))
+            || slot.count > EI_SAMPLE_STORE_MAX_SAMPLES
+            || slot.head < log_start || slot.head > log_end || slot.head % sector_size) {
+            continue;
+        }
+        if (!found || (int32_t)(slot.seq - best.seq) > 0) {
+            best = slot;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        // the first checkpoint opens (and erases) sector 0
+        checkpoint_seq = 2 * slots_per_sector - 1;
+        return false;
+    }
+
+    // continue in the other sector, slots after the newest one may hold a torn write
+    checkpoint_seq = (best.seq / slots_per_sector + 1) * slots_per_sector - 1;
+    head = best.head;
+    next_id = best.next_id;
+
+    for (uint32_t ix = 0; ix < best.count; ix++) {
+        record_header_t header;
+
+        if (read_record(best.entries[ix].record, &header)
+            && header.id == best.entries[ix].id
+            && is_committed(&header)
+            && header.deleted == NOT_DELETED) {
+            add_entry(&header, best.entries[ix].record);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Follow the records written after the checkpoint, the log either
+ *             continues at the head or wrapped to the start of the log
+ */
+void EiSampleStore::replay(void)
+{
+    uint32_t max_records = (log_end - log_start) / sector_size;
+
+    for (uint32_t n = 0; n < max_records; n++) {
+        record_header_t header;
+        uint32_t record = head;
+
+        bool found = read_record(record, &header) && header.id == next_id;
+        if (!found && record != log_start) {
+            record = log_start;
+            found = read_record(record, &header) && header.id == next_id;
+        }
+        if (!found) {
+            break;
+        }
+
+        track_record(&header, record);
+        stats.replayed++;
+    }
+}
+
+/**
+ * @brief      Rebuild the index from every sector of the log, only needed when
+ *             no checkpoint survived
+ */
+bool EiSampleStore::full_scan(void)
+{
+    uint32_t n_sectors = (log_end - log_start) / sector_size;
+    uint32_t (*found)[2] = (uint32_t (*)[2])malloc(n_sectors * sizeof(*found));
+    uint32_t n_found = 0;
+
+    if (found == nullptr) {
+        return false;
+    }
+
+    for (uint32_t record = log_start; record < log_end; record += sector_size) {
+        record_header_t header;
+        if (read_record(record, &header)) {
+            found[n_found][0] = record;
+            found[n_found][1] = header.id;
+            n_found++;
+        }
+    }
+
+    // newer records overwrote whatever older ones they overlap
+    qsort(found, n_found, sizeof(*found), compare_by_id);
+
+    for (uint32_t ix = 0; ix < n_found; ix++) {
+        record_header_t header;
+        if (read_record(found[ix][0], &header)) {
+            track_record(&header, found[ix][0]);
+        }
+    }
+
+    free(found);
+
+    return true;
+}
+
+bool EiSampleStore::write_checkpoint(void)
+{
+    checkpoint_t checkpoint;
+
+    memset(&checkpoint, 0xFF, sizeof(checkpoint));
+    checkpoint.magic = CHECKPOINT_MAGIC;
+    checkpoint.seq = ++checkpoint_seq;
+    checkpoint.head = head;
+    checkpoint.next_id = next_id;
+    checkpoint.count = n_index;
+    for (uint32_t ix = 0; ix < n_index; ix++) {
+        checkpoint.entries[ix].record = index[ix].record;
+        checkpoint.entries[ix].id = index[ix].id;
+    }
+    checkpoint.crc = crc32_update(0, &checkpoint, offsetof(checkpoint_t, crc));
+
+    uint32_t sector = ((checkpoint.seq / slots_per_sector) % 2) * sector_size;
+    uint32_t slot = checkpoint.seq % slots_per_sector;
+
+    // the sectors alternate, the other one keeps the previous checkpoints
+    if (slot == 0 && memory->erase_sample_data(sector, sector_size) != sector_size) {
+        return false;
+    }
+
+    if (memory->write_sample_data((const uint8_t *)&checkpoint, sector + slot * slot_size, sizeof(checkpoint)) != sizeof(checkpoint)
+        || memory->flush_data() != 0) {
+        return false;
+    }
+
+    stats.checkpoints++;
+    commits_since_checkpoint = 0;
+
+    return true;
+}
+
+/**
+ * @brief      Erase the sectors after the head in the background, without
+ *             touching samples that are still readable
+ */
+void EiSampleStore::preerase(void)
+{
+    uint32_t from = erased_until > head ? erased_until : head;
+    uint32_t end = align(head + EI_SAMPLE_STORE_PREERASE_BYTES);
+
+    if (end > log_end) {
+        end = log_end;
+    }
+    for (uint32_t ix = 0; ix < n_index; ix++) {
+        if (index[ix].record >= from && index[ix].record < end) {
+            end = index[ix].record;
+        }
+    }
+
+    if (end > from && memory->erase_sample_data(from, end - from) == end - from) {
+        erased_until = end;
+    }
+}
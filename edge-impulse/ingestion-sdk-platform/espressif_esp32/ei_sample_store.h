@@ -0,0 +1,191 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_SAMPLE_STORE_H
+#define EI_SAMPLE_STORE_H
+
+/* Include ----------------------------------------------------------------- */
+#include "firmware-sdk/ei_device_memory.h"
+
+/**
+ * Log structured sample store on top of the sample area of an EiDeviceMemory.
+ *
+ * Samples are appended back-to-back as records, each starting on a sector:
+ *
+ *   | ckpt A | ckpt B | rec 7 ... | rec 8 ... | rec 9 ... | (free) | rec 5 ... |
+ *                                                          ^ head
+ *
+ * The head moves through the whole partition and wraps, so every sector is
+ * erased once per lap and the oldest samples are overwritten first. A record
+ * header is written when a sample starts; length and CRC are programmed on
+ * commit, a sample cut by a power loss never validates. The two first sectors
+ * hold index checkpoints, mount loads the newest one and only replays the
+ * records written after it. Only when no checkpoint is found, every sector of
+ * the log is scanned.
+ */
+
+/* Constants --------------------------------------------------------------- */
+#ifndef EI_SAMPLE_STORE_MAX_SAMPLES
+#define EI_SAMPLE_STORE_MAX_SAMPLES         32
+#endif
+
+/** Commits between two index checkpoints, bounds the records replayed on mount */
+#ifndef EI_SAMPLE_STORE_CHECKPOINT_INTERVAL
+#define EI_SAMPLE_STORE_CHECKPOINT_INTERVAL 4
+#endif
+
+/** Bytes erased in the background after a commit, ready for the next sample */
+#ifndef EI_SAMPLE_STORE_PREERASE_BYTES
+#define EI_SAMPLE_STORE_PREERASE_BYTES      (16 * 1024)
+#endif
+
+#define EI_SAMPLE_STORE_SENSOR_LEN          16
+#define EI_SAMPLE_STORE_NAME_LEN            32
+
+typedef struct {
+    uint32_t id;
+    uint32_t record;    // sample area address of the record header
+    uint32_t address;   // sample area address of the data, as taken by AT+READBUFFER
+    uint32_t length;
+    uint32_t crc;       // CRC32 of the data
+    char sensor[EI_SAMPLE_STORE_SENSOR_LEN];
+    char name[EI_SAMPLE_STORE_NAME_LEN];
+} ei_sample_info_t;
+
+typedef struct {
+    bool full_scan;         // no checkpoint was found on the last mount
+    uint32_t mount_reads;   // record headers and checkpoint slots read by the last mount
+    uint32_t replayed;      // records replayed after the checkpoint
+    uint32_t evicted;       // samples overwritten by newer ones
+    uint32_t checkpoints;
+} ei_sample_store_stats_t;
+
+/**
+ * @brief Append-only store of samples, indexed in RAM. Not thread safe, but
+ * append() may run in a capture task while the caller waits for it.
+ */
+class EiSampleStore {
+public:
+    EiSampleStore(EiDeviceMemory *memory);
+
+    /**
+     * @brief Build the index from the newest checkpoint and the records after it
+     *
+     * @return false if the sample area is too small to hold a store
+     */
+    bool mount(void);
+
+    /**
+     * @brief Forget all samples, the sectors are erased lazily while the log moves on
+     */
+    bool format(void);
+
+    /**
+     * @brief Start a new sample, sectors of old samples in the way are evicted
+     * and erased in the background
+     *
+     * @param sensor sensor the sample comes from
+     * @param name sample label
+     * @param max_length upper bound of the sample size in bytes
+     * @param data_address sample area address the data will be stored at
+     */
+    bool begin(const char *sensor, const char *name, uint32_t max_length, uint32_t *data_address);
+    bool append(const uint8_t *data, uint32_t length);
+    bool commit(ei_sample_info_t *info = nullptr);
+    void abort(void);
+
+    bool remove(uint32_t id);
+
+    /** Samples in the index, oldest first */
+    uint32_t count(void) const;
+    const ei_sample_info_t *at(uint32_t ix) const;
+    const ei_sample_info_t *find(uint32_t id) const;
+    /** Sample whose stored data holds the sample area address */
+    const ei_sample_info_t *find_address(uint32_t address) const;
+
+    uint32_t read(uint32_t id, uint32_t offset, uint8_t *data, uint32_t length);
+    bool verify(uint32_t id);
+    uint32_t max_sample_length(void) const;
+    void get_stats(ei_sample_store_stats_t *stats) const;
+
+private:
+    EiDeviceMemory *memory;
+    bool mounted;
+
+    uint32_t sector_size;
+    uint32_t log_start;
+    uint32_t log_end;
+    uint32_t slot_size;
+    uint32_t slots_per_sector;
+
+    ei_sample_info_t index[EI_SAMPLE_STORE_MAX_SAMPLES];
+    uint32_t n_index;
+
+    uint32_t head;
+    uint32_t next_id;
+    uint32_t erased_until;      // [head, erased_until) is known to be erased
+    uint32_t checkpoint_seq;
+    uint32_t commits_since_checkpoint;
+
+    bool writing;
+    bool write_failed;
+    uint32_t cur_id;
+    uint32_t cur_record;
+    uint32_t cur_reserved;
+    uint32_t cur_length;
+    uint32_t cur_crc;
+    char cur_sensor[EI_SAMPLE_STORE_SENSOR_LEN];
+    char cur_name[EI_SAMPLE_STORE_NAME_LEN];
+
+    ei_sample_store_stats_t stats;
+
+    uint32_t align(uint32_t address) const;
+    bool read_record(uint32_t record, void *header);
+    void add_entry(const void *header, uint32_t record);
+    void remove_entry(uint32_t ix);
+    void evict_range(uint32_t start, uint32_t end, bool mark);
+    void track_record(const void *header, uint32_t record);
+    bool load_checkpoint(void);
+    void replay(void);
+    bool full_scan(void);
+    bool write_checkpoint(void);
+    void preerase(void);
+};
+
+/**
+ * @brief Store of the device, mounted on first use
+ */
+EiSampleStore *ei_get_sample_store(void);
+
+#endif /* EI_SAMPLE_STORE_H */
@@ -0,0 +1,384 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_write_behind_memory.h"
+
+#include <stdlib.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_pthread.h"
+#endif
+
+/* Constants --------------------------------------------------------------- */
+#ifndef EI_WRITE_BEHIND_TASK_STACK_SIZE
+#define EI_WRITE_BEHIND_TASK_STACK_SIZE 3072
+#endif
+
+#ifndef EI_WRITE_BEHIND_TASK_PRIORITY
+#define EI_WRITE_BEHIND_TASK_PRIORITY   5
+#endif
+
+/* Public functions -------------------------------------------------------- */
+
+EiWriteBehindMemory::EiWriteBehindMemory(
+    uint32_t config_size,
+    uint32_t erase_time,
+    uint32_t memory_size,
+    uint32_t block_size)
+    : EiDeviceMemory(config_size, erase_time, memory_size, block_size)
+    , next_seq(0)
+    , enabled(true)
+    , stopping(false)
+    , erase_next(0)
+    , erase_end(0)
+    , unreported_failed_bytes(0)
+{
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        buffers[ix].state = BUFFER_FREE;
+        buffers[ix].data = nullptr;
+    }
+    memset(&stats, 0, sizeof(stats));
+}
+
+EiWriteBehindMemory::~EiWriteBehindMemory()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+        queue_filling();
+    }
+    changed.notify_all();
+
+    // the worker drains the queue and pending erases before it exits
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        free(buffers[ix].data);
+    }
+}
+
+uint32_t EiWriteBehindMemory::read_sample_data(uint8_t *sample_data, uint32_t address, uint32_t sample_data_size)
+{
+    flush_data();
+
+    return EiDeviceMemory::read_sample_data(sample_data, address, sample_data_size);
+}
+
+uint32_t EiWriteBehindMemory::write_sample_data(const uint8_t *sample_data, uint32_t address, uint32_t sample_data_size)
+{
+    uint32_t offset = used_blocks * block_size + address;
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (!enabled || block_size == 0 || !allocate_buffers() || !start_worker()) {
+        guard.unlock();
+        return write_data(sample_data, offset, sample_data_size);
+    }
+
+    uint32_t remaining = sample_data_size;
+    while (remaining > 0) {
+        uint32_t sector = offset - offset % block_size;
+        uint32_t in_sector = offset - sector;
+        uint32_t chunk = remaining < block_size - in_sector ? remaining : block_size - in_sector;
+
+        sector_buffer *buf = get_buffer(guard, sector);
+        memcpy(buf->data + in_sector, sample_data, chunk);
+        if (in_sector < buf->lo) {
+            buf->lo = in_sector;
+        }
+        if (in_sector + chunk > buf->hi) {
+            buf->hi = in_sector + chunk;
+        }
+
+        // a complete sector does not have to wait for the writer to move on
+        if (buf->lo == 0 && buf->hi == block_size) {
+            buf->state = BUFFER_QUEUED;
+            changed.notify_all();
+        }
+
+        sample_data += chunk;
+        offset += chunk;
+        remaining -= chunk;
+    }
+
+    return sample_data_size;
+}
+
+uint32_t EiWriteBehindMemory::erase_sample_data(uint32_t address, uint32_t num_bytes)
+{
+    uint32_t offset = used_blocks * block_size + address;
+
+    // anything still in flight belongs to the previous sample
+    flush_data();
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (!enabled || block_size == 0 || !allocate_buffers() || !start_worker()) {
+        guard.unlock();
+        return erase_data(offset, num_bytes);
+    }
+
+    erase_next = offset - offset % block_size;
+    erase_end = ((offset + num_bytes + block_size - 1) / block_size) * block_size;
+    if (memory_size && erase_end > memory_size) {
+        erase_end = memory_size;
+    }
+    changed.notify_all();
+
+    return num_bytes;
+}
+
+uint32_t EiWriteBehindMemory::flush_data(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    queue_filling();
+    changed.wait(guard, [this] { return idle(); });
+
+    uint32_t failed = unreported_failed_bytes;
+    unreported_failed_bytes = 0;
+
+    return failed;
+}
+
+void EiWriteBehindMemory::set_write_behind(bool enable)
+{
+    flush_data();
+
+    std::lock_guard<std::mutex> guard(lock);
+    enabled = enable;
+}
+
+void EiWriteBehindMemory::get_stats(ei_write_behind_stats_t *stats)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    *stats = this->stats;
+}
+
+/* Private functions ------------------------------------------------------- */
+
+bool EiWriteBehindMemory::allocate_buffers(void)
+{
+    if (buffers[0].data != nullptr) {
+        return true;
+    }
+
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        buffers[ix].data = (uint8_t *)malloc(block_size);
+        if (buffers[ix].data == nullptr) {
+            for (int jx = 0; jx < ix; jx++) {
+                free(buffers[jx].data);
+                buffers[jx].data = nullptr;
+            }
+            // not enough RAM, keep writing straight to the device
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool EiWriteBehindMemory::start_worker(void)
+{
+    if (worker.joinable()) {
+        return true;
+    }
+
+#ifdef ESP_PLATFORM
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.thread_name = "ei_flush";
+    cfg.stack_size = EI_WRITE_BEHIND_TASK_STACK_SIZE;
+    cfg.prio = EI_WRITE_BEHIND_TASK_PRIORITY;
+    esp_pthread_set_cfg(&cfg);
+#endif
+
+    worker = std::thread(&EiWriteBehindMemory::worker_loop, this);
+
+#ifdef ESP_PLATFORM
+    cfg = esp_pthread_get_default_config();
+    esp_pthread_set_cfg(&cfg);
+#endif
+
+    return worker.joinable();
+}
+
+/**
+ * @brief Buffer collecting the writes to a sector. Starting a new sector queues
+ * the one being filled, when all buffers are busy the writer waits for the
+ * oldest program to finish.
+ */
+EiWriteBehindMemory::sector_buffer *EiWriteBehindMemory::get_buffer(std::unique_lock<std::mutex> &guard, uint32_t sector)
+{
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        if (buffers[ix].state == BUFFER_FILLING && buffers[ix].address == sector) {
+            return &buffers[ix];
+        }
+    }
+
+    queue_filling();
+
+    sector_buffer *buf = nullptr;
+    auto find_free = [this, &buf] {
+        for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+            if (buffers[ix].state == BUFFER_FREE) {
+                buf = &buffers[ix];
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (!find_free()) {
+        auto start = std::chrono::steady_clock::now();
+        changed.wait(guard, find_free);
+        uint32_t stall_us = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        stats.stalls++;
+        if (stall_us > stats.max_stall_us) {
+            stats.max_stall_us = stall_us;
+        }
+    }
+
+    buf->state = BUFFER_FILLING;
+    buf->address = sector;
+    buf->lo = block_size;
+    buf->hi = 0;
+    buf->seq = next_seq++;
+    memset(buf->data, 0xFF, block_size);
+
+    return buf;
+}
+
+EiWriteBehindMemory::sector_buffer *EiWriteBehindMemory::oldest_queued(void)
+{
+    sector_buffer *oldest = nullptr;
+
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        if (buffers[ix].state == BUFFER_QUEUED
+            && (oldest == nullptr || (int32_t)(buffers[ix].seq - oldest->seq) < 0)) {
+            oldest = &buffers[ix];
+        }
+    }
+
+    return oldest;
+}
+
+void EiWriteBehindMemory::queue_filling(void)
+{
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        if (buffers[ix].state == BUFFER_FILLING) {
+            buffers[ix].state = BUFFER_QUEUED;
+            changed.notify_all();
+        }
+    }
+}
+
+bool EiWriteBehindMemory::idle(void)
+{
+    for (int ix = 0; ix < EI_WRITE_BEHIND_SECTORS; ix++) {
+        if (buffers[ix].state != BUFFER_FREE) {
+            return false;
+        }
+    }
+
+    return erase_next >= erase_end;
+}
+
+/**
+ * @brief Erase the pending sectors up to and including sector, called by the
+ * worker only. The lock is released while the device is busy.
+ */
+void EiWriteBehindMemory::erase_through(std::unique_lock<std::mutex> &guard, uint32_t sector)
+{
+    while (erase_next < erase_end && erase_next <= sector) {
+        uint32_t address = erase_next;
+
+        guard.unlock();
+        uint32_t erased = erase_data(address, block_size);
+        guard.lock();
+
+        stats.erases++;
+        if (erased != block_size) {
+            stats.failed_bytes += block_size;
+            unreported_failed_bytes += block_size;
+        }
+        erase_next = address + block_size;
+    }
+}
+
+void EiWriteBehindMemory::worker_loop(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (true) {
+        changed.wait(guard, [this] { return stopping || oldest_queued() != nullptr || erase_next < erase_end; });
+
+        sector_buffer *buf = oldest_queued();
+        if (buf != nullptr) {
+            buf->state = BUFFER_FLUSHING;
+            erase_through(guard, buf->address);
+
+            // word aligned program of the written span, the padding is still 0xFF
+            uint32_t lo = buf->lo & ~0x3u;
+            uint32_t hi = (buf->hi + 3) & ~0x3u;
+            if (hi > block_size) {
+                hi = block_size;
+            }
+
+            guard.unlock();
+            uint32_t written = write_data(buf->data + lo, buf->address + lo, hi - lo);
+            guard.lock();
+
+            stats.programs++;
+            stats.program_bytes += hi - lo;
+            if (written != hi - lo) {
+                stats.failed_bytes += hi - lo;
+                unreported_failed_bytes += hi - lo;
+            }
+            buf->state = BUFFER_FREE;
+            changed.notify_all();
+        }
+        else if (erase_next < erase_end) {
+            // nothing to program, erase ahead of the write stream
+            erase_through(guard, erase_next);
+            changed.notify_all();
+        }
+        else if (stopping) {
+            break;
+        }
+    }
+}
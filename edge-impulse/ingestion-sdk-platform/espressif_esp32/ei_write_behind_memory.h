@@ -0,0 +1,212 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_WRITE_BEHIND_MEMORY_H
+#define EI_WRITE_BEHIND_MEMORY_H
+
+/* Include ----------------------------------------------------------------- */
+#include "firmware-sdk/ei_device_memory.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/** Number of sector sized RAM buffers sample writes are staged in */
+#ifndef EI_WRITE_BEHIND_SECTORS
+#define EI_WRITE_BEHIND_SECTORS 3
+#endif
+
+typedef struct {
+    uint32_t programs;          // program operations issued to the device
+    uint32_t program_bytes;
+    uint32_t erases;            // sectors erased
+    uint32_t stalls;            // writes that had to wait for a free buffer
+    uint32_t max_stall_us;
+    uint32_t failed_bytes;      // bytes the device failed to program or erase
+} ei_write_behind_stats_t;
+
+/**
+ * @brief Write-behind layer for sample data. Writes are copied into sector
+ * sized RAM buffers and programmed by a background task once the writer moves
+ * on to the next sector, so a slow program never stalls the sampling context.
+ * Erases of the sample area are deferred: sectors are erased in the background
+ * ahead of the write stream, and at the latest right before they are programmed.
+ * flush_data() is the barrier, it returns once every write and erase issued
+ * before it reached the device. Reads flush first, so they always see the data.
+ *
+ * Unwritten bytes of a buffer are 0xFF and only the written span of a sector is
+ * programmed, this relies on the NOR property that programming 1 bits is a no-op.
+ */
+class EiWriteBehindMemory : public EiDeviceMemory {
+public:
+    EiWriteBehindMemory(
+        uint32_t config_size,
+        uint32_t erase_time,
+        uint32_t memory_size,
+        uint32_t block_size);
+    virtual ~EiWriteBehindMemory();
+
+    uint32_t read_sample_data(uint8_t *sample_data, uint32_t address, uint32_t sample_data_size) override;
+    uint32_t write_sample_data(const uint8_t *sample_data, uint32_t address, uint32_t sample_data_size) override;
+    uint32_t erase_sample_data(uint32_t address, uint32_t num_bytes) override;
+
+    /**
+     * @brief Wait until all staged writes and pending erases reached the device
+     *
+     * @return uint32_t number of bytes that failed to program or erase since the
+     * previous flush, 0 if everything succeeded
+     */
+    uint32_t flush_data(void) override;
+
+    /**
+     * @brief Switch write-behind on or off, when off every call goes straight
+     * to the device (flushes first)
+     */
+    void set_write_behind(bool enable);
+    void get_stats(ei_write_behind_stats_t *stats);
+
+private:
+    enum buffer_state { BUFFER_FREE, BUFFER_FILLING, BUFFER_QUEUED, BUFFER_FLUSHING };
+
+    struct sector_buffer {
+        buffer_state state;
+        uint32_t address;       // absolute, sector aligned
+        uint32_t lo;            // written span within the sector
+        uint32_t hi;
+        uint32_t seq;           // programs are issued in queue order
+        uint8_t *data;
+    };
+
+    sector_buffer buffers[EI_WRITE_BEHIND_SECTORS];
+    uint32_t next_seq;
+    bool enabled;
+    bool stopping;
+
+    // sectors [erase_next, erase_end) still have to be erased
+    uint32_t erase_next;
+    uint32_t erase_end;
+
+    ei_write_behind_stats_t stats;
+    uint32_t unreported_failed_bytes;   // reported and cleared by flush_data()
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::thread worker;
+
+    bool start_worker(void);
+    void worker_loop(void);
+    bool allocate_buffers(void);
+    sector_buffer *get_buffer(std::unique_lock<std::mutex> &guard, uint32_t sector);
+    sector_buffer *oldest_queued(void);
+    void queue_filling(void);
+    bool idle(void);
+    void erase_through(std::unique_lock<std::mutex> &guard, uint32_t sector);
+};
+
+/**
+ * @brief RAM stand-in for a NOR flash, erase sets bytes to 0xFF and programming
+ * can only clear bits. Erase and program latency can be injected to measure the
+ * write-behind throughput and sampling jitter on a host.
+ */
+template <int BLOCK_SIZE = 4096, int MEMORY_BLOCKS = 16> class EiDeviceRAMLatency : public EiWriteBehindMemory {
+
+protected:
+    uint8_t ram_memory[MEMORY_BLOCKS * BLOCK_SIZE];
+    uint32_t erase_us;
+    uint32_t page_program_us;
+
+    static void busy(uint32_t us)
+    {
+        if (us) {
+            std::this_thread::sleep_for(std::chrono::microseconds(us));
+        }
+    }
+
+    uint32_t read_data(uint8_t *data, uint32_t address, uint32_t num_bytes) override
+    {
+        if (num_bytes > memory_size - address) {
+            num_bytes = memory_size - address;
+        }
+
+        memcpy(data, &ram_memory[address], num_bytes);
+
+        return num_bytes;
+    }
+
+    uint32_t write_data(const uint8_t *data, uint32_t address, uint32_t num_bytes) override
+    {
+        if (num_bytes > memory_size - address) {
+            num_bytes = memory_size - address;
+        }
+
+        for (uint32_t ix = 0; ix < num_bytes; ix++) {
+            ram_memory[address + ix] &= data[ix];
+        }
+        // a program covers at most one 256 byte page
+        busy(page_program_us * ((address % 256 + num_bytes + 255) / 256));
+
+        return num_bytes;
+    }
+
+    uint32_t erase_data(uint32_t address, uint32_t num_bytes) override
+    {
+        if (num_bytes > memory_size - address) {
+            num_bytes = memory_size - address;
+        }
+
+        memset(&ram_memory[address], 0xFF, num_bytes);
+        busy(erase_us * ((num_bytes + BLOCK_SIZE - 1) / BLOCK_SIZE));
+
+        return num_bytes;
+    }
+
+public:
+    EiDeviceRAMLatency(uint32_t config_size, uint32_t erase_us = 0, uint32_t page_program_us = 0)
+        : EiWriteBehindMemory(config_size, erase_us / 1000, BLOCK_SIZE * MEMORY_BLOCKS, BLOCK_SIZE)
+        , erase_us(erase_us)
+        , page_program_us(page_program_us)
+    {
+        memset(ram_memory, 0xFF, sizeof(ram_memory));
+    }
+
+    void set_latency(uint32_t erase_us, uint32_t page_program_us)
+    {
+        this->erase_us = erase_us;
+        this->page_program_us = page_program_us;
+        block_erase_time = erase_us / 1000;
+    }
+};
+
+#endif /* EI_WRITE_BEHIND_MEMORY_H */
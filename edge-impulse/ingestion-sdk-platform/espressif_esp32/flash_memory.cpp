@@ -81,7 +81,7 @@ uint32_t EiFlashMemory::erase_data(uint32_t address, uint32_t num_bytes)
 }
 
 EiFlashMemory::EiFlashMemory(uint32_t config_size):
-    EiDeviceMemory(config_size, ESP32_FS_BLOCK_ERASE_TIME_MS, 0, SPI_FLASH_SEC_SIZE)
+    EiWriteBehindMemory(config_size, ESP32_FS_BLOCK_ERASE_TIME_MS, 0, SPI_FLASH_SEC_SIZE)
 {
 
     // Find the partition map in the partition table
@@ -90,7 +90,8 @@ EiFlashMemory::EiFlashMemory(uint32_t config_size):
 
     ESP_LOGI(TAG, "Found partition '%s' at offset 0x%x with size 0x%x\n", partition->label, partition->address, partition->size);
 
-    memory_size = partition->size; 
+    memory_size = partition->size;
+    memory_blocks = memory_size / SPI_FLASH_SEC_SIZE;
 
     ESP_LOGI(TAG, "memory_size %d used_blocks %d\n", memory_size, used_blocks);
 
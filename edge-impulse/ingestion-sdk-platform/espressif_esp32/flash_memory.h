@@ -36,7 +36,7 @@
 #define EI_FLASH_MEMORY_H
 
 /* Include ----------------------------------------------------------------- */
-#include "firmware-sdk/ei_device_memory.h"
+#include "ei_write_behind_memory.h"
 
 #include "esp_partition.h"
 #include "esp_spi_flash.h"
@@ -46,10 +46,10 @@
 #define ESP32_FS_BLOCK_ERASE_TIME_MS 38
 
 /**
- * @brief
- *
+ * @brief Sample storage in the "storage" partition, sample writes and erases go
+ * through the write-behind layer so the sampling context never waits on the flash
  */
-class EiFlashMemory : public EiDeviceMemory {
+class EiFlashMemory : public EiWriteBehindMemory {
 protected:
     uint32_t read_data(uint8_t *data, uint32_t address, uint32_t num_bytes);
     uint32_t write_data(const uint8_t *data, uint32_t address, uint32_t num_bytes);
@@ -0,0 +1,311 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_AUDIO_RING_H
+#define EI_AUDIO_RING_H
+
+/* Include ----------------------------------------------------------------- */
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/**
+ * Single producer / single consumer ring of audio samples, sized in whole
+ * I2S DMA blocks. The I2S task reads straight into the next free block and
+ * publishes it with one index update, the inference task reads slices out of
+ * the ring and releases them when done. When the ring is full the block is
+ * dropped and counted instead of overwriting samples that are still in use.
+ *
+ * The capacity is a whole number of blocks, not rounded up to a power of 2,
+ * so head and tail run over [0, 2 * capacity) and wrap with a compare: the
+ * extra lap tells a full ring from an empty one.
+ *
+ * On the device the consumer is woken with a task notification, elsewhere a
+ * pthread condition variable is used so the ring can be exercised on a host.
+ */
+typedef struct {
+    int16_t *buffer;
+    uint32_t block_samples;
+    uint32_t capacity;                  // in samples, whole number of blocks
+    std::atomic<uint32_t> head;         // write position in [0, 2 * capacity), producer only
+    std::atomic<uint32_t> tail;         // release position in [0, 2 * capacity), consumer only
+    std::atomic<uint32_t> blocks_committed;
+    std::atomic<uint32_t> blocks_dropped;
+#if defined(ESP_PLATFORM)
+    std::atomic<TaskHandle_t> consumer;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+} ei_audio_ring_t;
+
+/**
+ * @brief      Allocate the ring
+ *
+ * @param      ring           Ring to initialize
+ * @param[in]  block_samples  Samples per DMA block
+ * @param[in]  min_samples    Minimum number of samples the ring must hold,
+ *                            rounded up to whole blocks
+ *
+ * @return     false if allocation failed
+ */
+static inline bool ei_audio_ring_init(ei_audio_ring_t *ring, uint32_t block_samples, uint32_t min_samples)
+{
+    const uint32_t blocks = min_samples > block_samples ? (min_samples + block_samples - 1) / block_samples : 1;
+    const uint32_t capacity = blocks * block_samples;
+
+    ring->buffer = (int16_t *)ei_malloc(capacity * sizeof(int16_t));
+    if (ring->buffer == nullptr) {
+        return false;
+    }
+
+    ring->block_samples = block_samples;
+    ring->capacity = capacity;
+    ring->head.store(0);
+    ring->tail.store(0);
+    ring->blocks_committed.store(0);
+    ring->blocks_dropped.store(0);
+#if defined(ESP_PLATFORM)
+    ring->consumer.store(nullptr);
+#else
+    pthread_mutex_init(&ring->lock, nullptr);
+    pthread_cond_init(&ring->cond, nullptr);
+#endif
+
+    return true;
+}
+
+static inline void ei_audio_ring_free(ei_audio_ring_t *ring)
+{
+    ei_free(ring->buffer);
+    ring->buffer = nullptr;
+#if !defined(ESP_PLATFORM)
+    pthread_cond_destroy(&ring->cond);
+    pthread_mutex_destroy(&ring->lock);
+#endif
+}
+
+/**
+ * @brief      Position `samples` after `pos`, both in [0, 2 * capacity)
+ */
+static inline uint32_t ei_audio_ring_advance(const ei_audio_ring_t *ring, uint32_t pos, uint32_t samples)
+{
+    pos += samples;
+    return pos >= 2 * ring->capacity ? pos - 2 * ring->capacity : pos;
+}
+
+/**
+ * @brief      Buffer index of a position
+ */
+static inline uint32_t ei_audio_ring_index(const ei_audio_ring_t *ring, uint32_t pos)
+{
+    return pos >= ring->capacity ? pos - ring->capacity : pos;
+}
+
+/**
+ * @brief      Samples between tail and head
+ */
+static inline uint32_t ei_audio_ring_distance(const ei_audio_ring_t *ring, uint32_t tail, uint32_t head)
+{
+    return head >= tail ? head - tail : head + 2 * ring->capacity - tail;
+}
+
+/**
+ * @brief      Producer: get the next free block
+ *
+ * @return     Pointer to block_samples samples, or nullptr if the ring is full
+ */
+static inline int16_t *ei_audio_ring_write_block(ei_audio_ring_t *ring)
+{
+    const uint32_t head = ring->head.load(std::memory_order_relaxed);
+    const uint32_t tail = ring->tail.load(std::memory_order_acquire);
+
+    if (ring->capacity - ei_audio_ring_distance(ring, tail, head) < ring->block_samples) {
+        return nullptr;
+    }
+
+    // capacity is a whole number of blocks, a block never straddles the end
+    return &ring->buffer[ei_audio_ring_index(ring, head)];
+}
+
+/**
+ * @brief      Producer: publish the block returned by ei_audio_ring_write_block
+ *             and wake up the consumer
+ */
+static inline void ei_audio_ring_commit_block(ei_audio_ring_t *ring)
+{
+    const uint32_t head = ring->head.load(std::memory_order_relaxed);
+    ring->head.store(ei_audio_ring_advance(ring, head, ring->block_samples), std::memory_order_release);
+    ring->blocks_committed.fetch_add(1, std::memory_order_relaxed);
+
+#if defined(ESP_PLATFORM)
+    // pairs with the fence in ei_audio_ring_wait: either this load sees the
+    // consumer or the consumer's next check sees the new head, never neither
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    TaskHandle_t consumer = ring->consumer.load(std::memory_order_acquire);
+    if (consumer != nullptr) {
+        xTaskNotifyGive(consumer);
+    }
+#else
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+#endif
+}
+
+/**
+ * @brief      Producer: count a block that did not fit in the ring
+ */
+static inline void ei_audio_ring_drop_block(ei_audio_ring_t *ring)
+{
+    ring->blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief      Consumer: number of committed samples that were not released yet
+ */
+static inline uint32_t ei_audio_ring_available(ei_audio_ring_t *ring)
+{
+    return ei_audio_ring_distance(ring,
+        ring->tail.load(std::memory_order_relaxed),
+        ring->head.load(std::memory_order_acquire));
+}
+
+/**
+ * @brief      Consumer: wait until at least `samples` samples are available
+ *
+ * @param[in]  timeout_ms  Maximum time to wait
+ *
+ * @return     false on timeout
+ */
+static inline bool ei_audio_ring_wait(ei_audio_ring_t *ring, uint32_t samples, uint32_t timeout_ms)
+{
+#if defined(ESP_PLATFORM)
+    ring->consumer.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    // the store above must be visible before head is read, see ei_audio_ring_commit_block
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    bool ready;
+
+    while (!(ready = (ei_audio_ring_available(ring) >= samples))) {
+        const TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+    }
+
+    ring->consumer.store(nullptr, std::memory_order_release);
+
+    return ready;
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    bool ready;
+    pthread_mutex_lock(&ring->lock);
+    while (!(ready = (ei_audio_ring_available(ring) >= samples))) {
+        if (pthread_cond_timedwait(&ring->cond, &ring->lock, &deadline) != 0) {
+            ready = (ei_audio_ring_available(ring) >= samples);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    return ready;
+#endif
+}
+
+/**
+ * @brief      Consumer: copy samples starting `offset` samples after the tail,
+ *             converted to float and multiplied by gain (saturated to int16 range)
+ */
+static inline void ei_audio_ring_read(ei_audio_ring_t *ring, uint32_t offset, size_t length, float *out_ptr, float gain)
+{
+    uint32_t ix = ei_audio_ring_index(ring, ei_audio_ring_advance(ring, ring->tail.load(std::memory_order_relaxed), offset));
+
+    while (length > 0) {
+        size_t chunk = ring->capacity - ix;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        const int16_t *in = &ring->buffer[ix];
+        for (size_t i = 0; i < chunk; i++) {
+            float v = (float)in[i] * gain;
+            out_ptr[i] = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+        }
+
+        out_ptr += chunk;
+        length -= chunk;
+        ix = (ix + chunk == ring->capacity) ? 0 : ix + (uint32_t)chunk;
+    }
+}
+
+/**
+ * @brief      Consumer: hand `samples` samples back to the producer
+ */
+static inline void ei_audio_ring_release(ei_audio_ring_t *ring, uint32_t samples)
+{
+    const uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    ring->tail.store(ei_audio_ring_advance(ring, tail, samples), std::memory_order_release);
+}
+
+/**
+ * @brief      Consumer: drop everything that was committed so far
+ */
+static inline void ei_audio_ring_discard(ei_audio_ring_t *ring)
+{
+    ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+#endif /* EI_AUDIO_RING_H */
@@ -90,7 +90,7 @@ ei_device_snapshot_resolutions_t EiCameraESP32::resolutions[] = {
         { .width = 480, .height = 320 }
     };
 
-EiCameraESP32::EiCameraESP32()
+EiCameraESP32::EiCameraESP32() : jpeg_fb(nullptr)
 {
 }
 
@@ -185,6 +185,8 @@ bool EiCameraESP32::init(uint16_t width, uint16_t height)
 
 bool EiCameraESP32::deinit()
 {
+    ei_camera_release_jpeg_frame();
+
     //deinitialize the camera
     esp_err_t err = esp_camera_deinit();
 
@@ -226,15 +228,19 @@ bool EiCameraESP32::ei_camera_capture_jpeg(uint8_t **image, uint32_t *image_size
 {
     camera_fb_t *fb = esp_camera_fb_get();
 
+    // no output here, the caller reports the failure (as text or as a binary
+    // error record when streaming results)
     if (!fb) {
-        ei_printf("ERR: Camera capture failed\n");
         return false;
     }
 
     ESP_LOGD(TAG, "fb res %d %d \n", fb->width, fb->height);
 
-    *image = nullptr;
     *image = (uint8_t*)ei_malloc(fb->len);
+    if (*image == nullptr) {
+        esp_camera_fb_return(fb);
+        return false;
+    }
 
     memcpy(*image, fb->buf, fb->len);
     memcpy(image_size, &fb->len, sizeof(uint32_t));
@@ -244,6 +250,39 @@ bool EiCameraESP32::ei_camera_capture_jpeg(uint8_t **image, uint32_t *image_size
     return true;
 }
 
+bool EiCameraESP32::ei_camera_get_jpeg_frame(const uint8_t **jpeg, size_t *jpeg_size,
+                                             ei_device_snapshot_resolutions_t *res)
+{
+    ei_camera_release_jpeg_frame();
+
+    jpeg_fb = esp_camera_fb_get();
+
+    if (!jpeg_fb) {
+        ei_printf("ERR: Camera capture failed\n");
+        return false;
+    }
+
+    if (jpeg_fb->format != PIXFORMAT_JPEG) {
+        ei_camera_release_jpeg_frame();
+        return false;
+    }
+
+    *jpeg = jpeg_fb->buf;
+    *jpeg_size = jpeg_fb->len;
+    res->width = jpeg_fb->width;
+    res->height = jpeg_fb->height;
+
+    return true;
+}
+
+void EiCameraESP32::ei_camera_release_jpeg_frame(void)
+{
+    if (jpeg_fb) {
+        esp_camera_fb_return(jpeg_fb);
+        jpeg_fb = nullptr;
+    }
+}
+
 bool EiCameraESP32::ei_camera_jpeg_to_rgb888(uint8_t *jpeg_image, uint32_t jpeg_image_size,
                                              uint8_t *rgb88_image)
 {
@@ -37,6 +37,7 @@
 
 /* Include ----------------------------------------------------------------- */
 #include "firmware-sdk/ei_camera_interface.h"
+#include "esp_camera.h"
 
 #define CAMERA_MODEL_AI_THINKER
 
@@ -220,11 +221,15 @@ private:
 
     bool camera_present;
 
+    camera_fb_t *jpeg_fb;
+
 public:
     EiCameraESP32();
     bool init(uint16_t width, uint16_t height);
     bool deinit();
     bool ei_camera_capture_jpeg(uint8_t **image, uint32_t *image_size);
+    bool ei_camera_get_jpeg_frame(const uint8_t **jpeg, size_t *jpeg_size, ei_device_snapshot_resolutions_t *res);
+    void ei_camera_release_jpeg_frame(void);
     bool ei_camera_capture_rgb888_packed_big_endian(uint8_t *image, uint32_t image_size);
     bool ei_camera_jpeg_to_rgb888(uint8_t *jpeg_image, uint32_t jpeg_image_size,
                                   uint8_t *rgb88_image);
@@ -71,6 +71,10 @@ bool ei_inertial_init(void) {
     return true;
 }
 
+/**
+ * @brief One sample per call of the fusion sampler, read straight from the output
+ * registers. The driver's FIFO streaming (LIS3DHTR::enableFifo) is not used here.
+ */
 float *ei_fusion_inertial_read_data(int n_samples)
 {
     
@@ -49,14 +49,21 @@
 #include "ei_config_types.h"
 #include "sensor_aq_mbedtls_hs256.h"
 #include "firmware-sdk/sensor-aq/sensor_aq_none.h"
+#include "firmware-sdk/ei_sample_codec.h"
 #include "edge-impulse-sdk/dsp/numpy.hpp"
+#include "ei_audio_ring.h"
+#include "ei_sample_store.h"
+
+/* Store recordings with the lossless sample codec, they read back as raw int16 */
+#ifndef EI_MICROPHONE_COMPRESS_SAMPLES
+#define EI_MICROPHONE_COMPRESS_SAMPLES  0
+#endif
 
 typedef struct {
-    int16_t *buffers[2];
-    uint8_t buf_select;
-    uint8_t buf_ready;
-    uint32_t buf_count;
+    ei_audio_ring_t ring;
     uint32_t n_samples;
+    bool slice_held;
+    uint32_t reported_drops;
 } inference_t;
 
 /* Dummy functions for sensor_aq_ctx type */
@@ -75,9 +82,15 @@ static signed short *sampleBuffer;
 static bool is_uploaded = false;
 static int record_status = 0;
 static uint32_t headerOffset;
+static uint32_t sample_address;
 static uint32_t samples_required;
 static uint32_t current_sample;
 static uint32_t audio_sampling_frequency = 16000;
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+static ei_sample_encoder_t sample_encoder;
+static uint8_t *encodedBuffer;
+static uint32_t encoded_bytes;
+#endif
 
 static inference_t inference;
 
@@ -96,38 +109,96 @@ static sensor_aq_ctx ei_mic_ctx = {
 /* Audio thread setup */
 #define AUDIO_THREAD_STACK_SIZE 4096
 
+/* Samples per I2S DMA buffer, one ring block */
+#define I2S_DMA_BUF_LEN         512
+#define I2S_DMA_BUF_COUNT       8
+
+/* The microphone output is too quiet, scale it */
+#define AUDIO_GAIN              8
+
 static const char* TAG = "AUDIO_PROVIDER";
 
 /* Private functions ------------------------------------------------------- */
 
 static void audio_write_callback(uint32_t n_bytes)
 {
-    EiDeviceESP32* dev = static_cast<EiDeviceESP32*>(EiDeviceESP32::get_device());
-    EiDeviceMemory* mem = dev->get_memory();
-
-    mem->write_sample_data((const uint8_t *)sampleBuffer, headerOffset + current_sample, n_bytes);
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+    int encoded = ei_sample_encode(&sample_encoder, sampleBuffer, n_bytes / sizeof(int16_t),
+        encodedBuffer, EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(AUDIO_THREAD_STACK_SIZE / sizeof(int16_t)));
+    if (encoded > 0) {
+        ei_get_sample_store()->append(encodedBuffer, encoded);
+        encoded_bytes += encoded;
+    }
+#else
+    ei_get_sample_store()->append((const uint8_t *)sampleBuffer, n_bytes);
+#endif
 
+    // signed as uploaded, the codec is lossless
     ei_mic_ctx.signature_ctx->update(ei_mic_ctx.signature_ctx, (uint8_t*)sampleBuffer, n_bytes);
 
     current_sample += n_bytes;
     if(current_sample >= (samples_required << 1)) {
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+        encoded = ei_sample_encode_finish(&sample_encoder, encodedBuffer,
+            EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(AUDIO_THREAD_STACK_SIZE / sizeof(int16_t)));
+        if (encoded > 0) {
+            ei_get_sample_store()->append(encodedBuffer, encoded);
+            encoded_bytes += encoded;
+        }
+        ei_free(encodedBuffer);
+#endif
         i2s_deinit();
         record_status = false;
-        free(sampleBuffer);
+        ei_free(sampleBuffer);
     }
 }
 
-static void audio_inference_callback(uint32_t n_bytes)
+static void apply_gain(int16_t *samples, size_t n_samples)
+{
+    for (size_t ix = 0; ix < n_samples; ix++) {
+        int32_t v = (int32_t)samples[ix] * AUDIO_GAIN;
+        samples[ix] = (int16_t)(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+    }
+}
+
+/**
+ * I2S task for inference, reads whole DMA blocks straight into the ring.
+ * The gain is applied by the consumer while converting to float.
+ */
+static void capture_inference_samples(void* arg)
 {
-    for(int i = 0; i < n_bytes>>1; i++) {
-        inference.buffers[inference.buf_select][inference.buf_count++] = sampleBuffer[i];
+    ei_audio_ring_t *ring = &inference.ring;
+    const size_t block_bytes = ring->block_samples * sizeof(int16_t);
+
+    while (record_status == 2) {
+        int16_t *block = ei_audio_ring_write_block(ring);
+        bool dropped = (block == nullptr);
+        if (dropped) {
+            // consumer is behind, read into the scratch buffer so the DMA keeps running
+            block = sampleBuffer;
+        }
 
-        if(inference.buf_count >= inference.n_samples) {
-            inference.buf_select ^= 1;
-            inference.buf_count = 0;
-            inference.buf_ready = 1;
+        size_t filled = 0;
+        while (filled < block_bytes && record_status == 2) {
+            size_t bytes_read = 0;
+            i2s_read((i2s_port_t)1, (uint8_t*)block + filled, block_bytes - filled, &bytes_read, 100);
+            if (bytes_read == 0) {
+                ESP_LOGE(TAG, "Error in I2S read : %d", bytes_read);
+            }
+            filled += bytes_read;
+        }
+        if (filled < block_bytes) {
+            break;
+        }
+
+        if (dropped) {
+            ei_audio_ring_drop_block(ring);
+        }
+        else {
+            ei_audio_ring_commit_block(ring);
         }
     }
+    vTaskDelete(NULL);
 }
 
 static void capture_samples(void* arg) {
@@ -149,18 +220,12 @@ static void capture_samples(void* arg) {
         }
 
         // scale the data (otherwise the sound is too quiet)
-        for (int x = 0; x < i2s_bytes_to_read/2; x++) {
-            sampleBuffer[x] = (int16_t)(sampleBuffer[x]) * 8;
-        }
+        apply_gain(sampleBuffer, i2s_bytes_to_read / 2);
 
         // see if are recording samples for ingestion
-        // or inference and send them their way
         if (record_status == 1) {
             audio_write_callback(i2s_bytes_to_read);
         }
-        else if (record_status == 2) {
-            audio_inference_callback(i2s_bytes_to_read);
-        }
         else {
             break;
         }
@@ -176,12 +241,15 @@ static void finish_and_upload(char *filename, uint32_t sample_length_ms) {
     EiDeviceMemory* mem = dev->get_memory();
 
     ei_printf("Done sampling, total bytes collected: %u\n", current_sample*2);
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+    ei_printf("Stored %u bytes of samples in %u bytes\n", current_sample, encoded_bytes);
+#endif
 
     dev->set_state(eiStateUploading);
 
     ei_printf("[1/1] Uploading file to Edge Impulse...\n");
 
-    ei_printf("Not uploading file, not connected to WiFi. Used buffer, from=%lu, to=%lu.\n", 0, current_sample + headerOffset);
+    ei_printf("Not uploading file, not connected to WiFi. Used buffer, from=%lu, to=%lu.\n", sample_address, sample_address + current_sample + headerOffset);
 
     ei_printf("[1/1] Uploading file to Edge Impulse OK (took %d ms.)\n", 0);
 
@@ -216,7 +284,6 @@ static bool create_header(void)
 {
 
     EiDeviceESP32* dev = static_cast<EiDeviceESP32*>(EiDeviceESP32::get_device());
-    EiDeviceMemory* mem = dev->get_memory();
     sensor_aq_init_mbedtls_hs256_context(&ei_mic_signing_ctx, &ei_mic_hs_ctx, dev->get_sample_hmac_key().c_str());
 
     sensor_aq_payload_info payload = {
@@ -259,11 +326,21 @@ static bool create_header(void)
 
     end_of_header_ix += ref_size;
 
-    // Write to blockdevice
-    int ret = mem->write_sample_data((uint8_t*)ei_mic_ctx.cbor_buffer.ptr, 0, end_of_header_ix);
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+    // the container keeps the header raw, the samples after it are encoded
+    uint8_t codec_header[EI_SAMPLE_CODEC_HEADER_SIZE];
+    ei_sample_encode_header(codec_header, end_of_header_ix, 1);
+    ei_sample_encoder_init(&sample_encoder, 1);
+    encoded_bytes = 0;
+    if (!ei_get_sample_store()->append(codec_header, sizeof(codec_header))) {
+        ei_printf("Failed to write to header blockdevice\n");
+        return false;
+    }
+#endif
 
-    if (ret != end_of_header_ix) {
-        ei_printf("Failed to write to header blockdevice (%d)\n", ret);
+    // Write to blockdevice
+    if (!ei_get_sample_store()->append((uint8_t*)ei_mic_ctx.cbor_buffer.ptr, end_of_header_ix)) {
+        ei_printf("Failed to write to header blockdevice\n");
         return false;
     }
 
@@ -278,7 +355,6 @@ static bool create_header(void)
 bool ei_microphone_record(uint32_t sample_length_ms, uint32_t start_delay_ms, bool print_start_messages)
 {
     EiDeviceESP32* dev = static_cast<EiDeviceESP32*>(EiDeviceESP32::get_device());
-    EiDeviceMemory* mem = dev->get_memory();
 
     start_delay_ms = start_delay_ms < 2000 ? 2000 : start_delay_ms;
 
@@ -286,7 +362,17 @@ bool ei_microphone_record(uint32_t sample_length_ms, uint32_t start_delay_ms, bo
         ei_printf("Starting in %lu ms... (or until all flash was erased)\n", start_delay_ms);
     }
 
-    if(mem->erase_sample_data(0, (samples_required << 1) + 4096) != ((samples_required << 1) + 4096)) {
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+    // worst case, the samples may not compress at all
+    uint32_t max_length = EI_SAMPLE_CODEC_HEADER_SIZE + EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(samples_required) + 4096;
+#else
+    uint32_t max_length = (samples_required << 1) + 4096;
+#endif
+
+    // sectors of older samples in the way are erased in the background
+    if (!ei_get_sample_store()->begin("microphone", dev->get_sample_label().c_str(),
+            max_length, &sample_address)) {
+        ei_printf("Failed to reserve %u bytes in flash\n", max_length);
         return false;
     }
 
@@ -307,33 +393,23 @@ bool ei_microphone_record(uint32_t sample_length_ms, uint32_t start_delay_ms, bo
 
 bool ei_microphone_inference_start(uint32_t n_samples, float interval_ms)
 {
-
-    inference.buffers[0] = (int16_t *)ei_malloc(n_samples * sizeof(int16_t));
-
-    if(inference.buffers[0] == NULL) {
-        return false;
-    }
-
-    inference.buffers[1] = (int16_t *)ei_malloc(n_samples * sizeof(int16_t));
-
-    if(inference.buffers[1] == NULL) {
-        ei_free(inference.buffers[0]);
+    // room for the slice being classified, the next one and the block in flight,
+    // rounded up to whole DMA blocks (2 * n_samples + 1..2 blocks)
+    if (!ei_audio_ring_init(&inference.ring, I2S_DMA_BUF_LEN, 2 * n_samples + I2S_DMA_BUF_LEN)) {
         return false;
     }
 
-    uint32_t sample_buffer_size = (n_samples / 100) * sizeof(int16_t);
-    sampleBuffer = (int16_t *)ei_malloc(sample_buffer_size);
+    // scratch block, only used when the ring is full
+    sampleBuffer = (int16_t *)ei_malloc(I2S_DMA_BUF_LEN * sizeof(int16_t));
 
     if(sampleBuffer == NULL) {
-        ei_free(inference.buffers[0]);
-        ei_free(inference.buffers[1]);
+        ei_audio_ring_free(&inference.ring);
         return false;
     }
 
-    inference.buf_select = 0;
-    inference.buf_count  = 0;
-    inference.n_samples  = n_samples;
-    inference.buf_ready  = 0;
+    inference.n_samples = n_samples;
+    inference.slice_held = false;
+    inference.reported_drops = 0;
 
     // Calculate sample rate from sample interval
     audio_sampling_frequency = (uint32_t)(1000.f / interval_ms);
@@ -346,40 +422,60 @@ bool ei_microphone_inference_start(uint32_t n_samples, float interval_ms)
 
     record_status = 2;
 
-    xTaskCreate(capture_samples, "CaptureSamples", 1024 * 32, (void*)sample_buffer_size, 10, NULL);
+    xTaskCreate(capture_inference_samples, "CaptureSamples", 1024 * 4, NULL, 10, NULL);
 
     return true;
 
 }
 
 /**
- * @brief      Wait for a full buffer
+ * @brief      Take the next slice out of the ring if it is complete
+ */
+static bool acquire_slice(void)
+{
+    if (!inference.slice_held && ei_audio_ring_available(&inference.ring) >= inference.n_samples) {
+        inference.slice_held = true;
+    }
+    return inference.slice_held;
+}
+
+/**
+ * @brief      Release the slice that was classified and wait for the next one
  *
- * @return     In case of an buffer overrun return false
+ * @return     In case of an buffer overrun (or if no slice arrived) return false
  */
 bool ei_microphone_inference_record(void)
 {
     bool ret = true;
 
-    if (inference.buf_ready == 1) {
+    if (inference.slice_held) {
+        ei_audio_ring_release(&inference.ring, inference.n_samples);
+        inference.slice_held = false;
+    }
+
+    uint32_t drops = inference.ring.blocks_dropped.load(std::memory_order_relaxed);
+    if (drops != inference.reported_drops) {
         ei_printf(
-            "Error sample buffer overrun. Decrease the number of slices per model window "
-            "(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW)\n");
+            "Error sample buffer overrun (%u blocks dropped). Decrease the number of slices per model window "
+            "(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW)\n", (unsigned)(drops - inference.reported_drops));
+        inference.reported_drops = drops;
         ret = false;
     }
 
-    while (inference.buf_ready == 0) {
-        vTaskDelay(1 / portTICK_RATE_MS);
+    // a slice takes n_samples / frequency seconds to arrive, allow twice that
+    uint32_t timeout_ms = 2000 * inference.n_samples / audio_sampling_frequency + 100;
+    if (!ei_audio_ring_wait(&inference.ring, inference.n_samples, timeout_ms)) {
+        return false;
     }
 
-    inference.buf_ready = 0;
+    acquire_slice();
 
     return ret;
 }
 
 bool ei_microphone_inference_is_recording(void)
 {
-    return inference.buf_ready == 0;
+    return !acquire_slice();
 }
 
 /**
@@ -387,8 +483,10 @@ bool ei_microphone_inference_is_recording(void)
  */
 void ei_microphone_inference_reset_buffers(void)
 {
-    inference.buf_ready = 0;
-    inference.buf_count = 0;
+    inference.slice_held = false;
+    ei_audio_ring_discard(&inference.ring);
+    // blocks dropped while nobody was listening are not an overrun
+    inference.reported_drops = inference.ring.blocks_dropped.load(std::memory_order_relaxed);
 }
 
 /**
@@ -396,17 +494,26 @@ void ei_microphone_inference_reset_buffers(void)
  */
 int ei_microphone_inference_get_data(size_t offset, size_t length, float *out_ptr)
 {
-    return ei::numpy::int16_to_float(&inference.buffers[inference.buf_select ^ 1][offset], out_ptr, length);
+    ei_audio_ring_read(&inference.ring, offset, length, out_ptr, AUDIO_GAIN);
+    return 0;
 }
 
+/**
+ * @brief      Counters of the inference audio ring, for monitoring
+ */
+void ei_microphone_inference_get_stats(ei_microphone_stats_t *stats)
+{
+    stats->blocks_committed = inference.ring.blocks_committed.load(std::memory_order_relaxed);
+    stats->blocks_dropped = inference.ring.blocks_dropped.load(std::memory_order_relaxed);
+    stats->samples_buffered = ei_audio_ring_available(&inference.ring);
+}
 
 bool ei_microphone_inference_end(void)
 {
     record_status = 0;
     ei_sleep(100);
     i2s_deinit();
-    ei_free(inference.buffers[0]);
-    ei_free(inference.buffers[1]);
+    ei_audio_ring_free(&inference.ring);
     ei_free(sampleBuffer);
     return 0;
 }
@@ -446,6 +553,15 @@ bool ei_microphone_sample_start(void)
         return false;
     }
 
+#if EI_MICROPHONE_COMPRESS_SAMPLES == 1
+    encodedBuffer = (uint8_t *)ei_malloc(EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(AUDIO_THREAD_STACK_SIZE / sizeof(int16_t)));
+
+    if (encodedBuffer == NULL) {
+        ei_free(sampleBuffer);
+        return false;
+    }
+#endif
+
     // Calculate sample rate from sample interval
     audio_sampling_frequency = (uint32_t)(1000.f / dev->get_sample_interval_ms());
 
@@ -463,6 +579,11 @@ bool ei_microphone_sample_start(void)
         //vTaskDelay(10 / portTICK_RATE_MS);
     };
 
+    // the flash is written behind the capture task, commit waits until it caught up
+    if (!ei_get_sample_store()->commit()) {
+        ei_printf("Failed to store the sample in flash\n");
+    }
+
     int ctx_err = ei_mic_ctx.signature_ctx->finish(ei_mic_ctx.signature_ctx, ei_mic_ctx.hash_buffer.buffer);
     if (ctx_err != 0) {
         ei_printf("Failed to finish signature (%d)\n", ctx_err);
@@ -483,8 +604,8 @@ int i2s_init(uint32_t sampling_rate) {
       .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
       .communication_format = I2S_COMM_FORMAT_I2S,
       .intr_alloc_flags = 0,
-      .dma_buf_count = 8,
-      .dma_buf_len = 512,
+      .dma_buf_count = I2S_DMA_BUF_COUNT,
+      .dma_buf_len = I2S_DMA_BUF_LEN,
       .use_apll = false,
       .tx_desc_auto_clear = false,
       .fixed_mclk = -1,
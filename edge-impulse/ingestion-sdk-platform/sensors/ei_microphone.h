@@ -40,6 +40,12 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+typedef struct {
+    uint32_t blocks_committed;
+    uint32_t blocks_dropped;
+    uint32_t samples_buffered;
+} ei_microphone_stats_t;
+
 /* Function prototypes ----------------------------------------------------- */
 bool ei_microphone_inference_start(uint32_t n_samples, float interval_ms);
 
@@ -48,6 +54,7 @@ bool ei_microphone_inference_record(void);
 bool ei_microphone_inference_is_recording(void);
 void ei_microphone_inference_reset_buffers(void);
 int ei_microphone_inference_get_data(size_t offset, size_t length, float *out_ptr);
+void ei_microphone_inference_get_stats(ei_microphone_stats_t *stats);
 bool ei_microphone_inference_end(void);
 
 int i2s_init(uint32_t sampling_rate);
@@ -44,7 +44,7 @@
  * If you are adding or modifying OPTIONAL commands,
  * just upgrade the release version.
  */
-#define AT_COMMAND_VERSION "1.8.0"
+#define AT_COMMAND_VERSION "1.8.1"
 
 /*************************************************************************************************/
 /* Required commands by Edge Impulse CLI Tools        */
@@ -73,7 +73,7 @@
 #define AT_READFILE_HELP_TEXT        "Read a specific file (as base64)"
 #define AT_READBUFFER                "READBUFFER"
 #define AT_READBUFFER_ARGS           "START,LENGTH,[USEMAXRATE]"
-#define AT_READBUFFER_HELP_TEXT      "Read from the temporary buffer (as base64)"
+#define AT_READBUFFER_HELP_TEXT      "Read from the temporary buffer (as base64, USEMAXRATE=b for binary frames)"
 #define AT_UNLINKFILE                "UNLINKFILE"
 #define AT_UNLINKFILE_ARGS           "FILE"
 #define AT_UNLINKFILE_HELP_TEXT      "Unlink a specific file"
@@ -105,9 +105,9 @@
 #define AT_SCANWIFI_HELP_TEXT       "Scans for WiFi networks"
 #define AT_SNAPSHOT                 "SNAPSHOT"
 #define AT_SNAPSHOT_ARGS            "WIDTH,HEIGHT,[USEMAXRATE]"
-#define AT_SNAPSHOT_HELP_TEXT       "Take a snapshot"
+#define AT_SNAPSHOT_HELP_TEXT       "Take a snapshot (USEMAXRATE=b for binary frames)"
 #define AT_SNAPSHOTSTREAM           "SNAPSHOTSTREAM"
-#define AT_SNAPSHOTSTREAM_ARGS      "WIDTH,HEIGHT,[USEMAXRATE]"
+#define AT_SNAPSHOTSTREAM_ARGS      "WIDTH,HEIGHT,[USEMAXRATE],[JPEGQUALITY]"
 #define AT_SNAPSHOTSTREAM_HELP_TEXT "Take a stream of snapshot stream"
 #define AT_CLEARFILES               "CLEARFILES"
 #define AT_CLEARFILES_HELP_TEXT     "Clears all files from the file system, this does not clear config"
@@ -126,6 +126,9 @@
 #define AT_BOOTMODE_HELP_TEXT       "Jump to bootloader"
 #define AT_INFO                     "INFO"
 #define AT_INFO_HELP_TEXT           "Prints details about compiled firmware and ML model"
+#define AT_RUNIMPULSEBIN            "RUNIMPULSEBIN"
+#define AT_RUNIMPULSEBIN_ARGS       "USEMAXRATE"
+#define AT_RUNIMPULSEBIN_HELP_TEXT  "Run the impulse continuously with binary result records"
 
 /*************************************************************************************************/
 /* HELP is not necessary as it is built-in into ATServer and
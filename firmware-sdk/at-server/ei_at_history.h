@@ -34,47 +34,63 @@
 
 #ifndef AT_HISTORY_H
 #define AT_HISTORY_H
-#include <string>
-#include <vector>
+#include "ei_line_buffer.h"
+#include <cstring>
+
+/** Upper bound for the history size passed to the AT server */
+#ifndef AT_HISTORY_MAX_SIZE
+#define AT_HISTORY_MAX_SIZE 10
+#endif
 
 class ATHistory {
 private:
-    std::vector<std::string> history;
+    // ring of the last lines, oldest one at history_start
+    char history[AT_HISTORY_MAX_SIZE][AT_LINE_BUFFER_SIZE + 1];
     const size_t history_max_size;
+    size_t history_start;
+    size_t history_size;
     size_t history_position;
 
+    const char *entry(size_t ix)
+    {
+        return history[(history_start + ix) % history_max_size];
+    }
+
 public:
     ATHistory(size_t max_size = 10)
-        : history_max_size(max_size)
+        : history_max_size(
+              max_size == 0 ? 1 : (max_size > AT_HISTORY_MAX_SIZE ? AT_HISTORY_MAX_SIZE : max_size))
+        , history_start(0)
+        , history_size(0)
         , history_position(0) {};
 
-    std::string go_back(void)
+    const char *go_back(void)
     {
         if (!is_at_begin()) {
             history_position--;
         }
 
-        if (history.size() == 0) {
-            return std::string("");
+        if (history_size == 0) {
+            return "";
         }
         else {
-            return history[history_position];
+            return entry(history_position);
         }
     }
 
-    std::string go_next(void)
+    const char *go_next(void)
     {
-        if (++history_position >= history.size()) {
-            history_position = history.size();
-            return std::string("");
+        if (++history_position >= history_size) {
+            history_position = history_size;
+            return "";
         }
 
-        return history[history_position];
+        return entry(history_position);
     }
 
     bool is_at_end(void)
     {
-        return history_position == history.size();
+        return history_position == history_size;
     }
 
     bool is_at_begin(void)
@@ -82,21 +98,29 @@ public:
         return history_position == 0;
     }
 
-    void add(std::string &entry)
+    void add(const char *entry)
     {
         // don't add empty entries
-        if (entry == "") {
+        if (entry[0] == '\0') {
             return;
         }
 
-        history.push_back(entry);
-
-        if (history.size() > history_max_size) {
-            history.erase(history.begin());
+        char *slot;
+        if (history_size < history_max_size) {
+            slot = history[(history_start + history_size) % history_max_size];
+            history_size++;
+        }
+        else {
+            // overwrite the oldest one
+            slot = history[history_start];
+            history_start = (history_start + 1) % history_max_size;
         }
 
-        history_position = history.size();
+        strncpy(slot, entry, AT_LINE_BUFFER_SIZE);
+        slot[AT_LINE_BUFFER_SIZE] = '\0';
+
+        history_position = history_size;
     }
 };
 
-#endif /* AT_HISTORY_H */
\ No newline at end of file
+#endif /* AT_HISTORY_H */
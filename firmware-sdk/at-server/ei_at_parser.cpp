@@ -33,83 +33,72 @@
  */
 
 #include "ei_at_parser.h"
-
-using namespace std;
+#include <cstring>
 
 void ATParser::init_result(void)
 {
     last_result.type = AT_UNKNOWN;
-    last_result.command.clear();
-    last_result.arguments.clear();
-    last_result.max_arg_len = 0;
+    last_result.command = "";
+    last_result.argument_count = 0;
 }
 
-const ATParseResult_t &ATParser::parse(string input)
+/**
+ * @brief Parse a command line. The line is split in place, command and
+ * arguments in the result point into it, so it has to outlive the result.
+ */
+const ATParseResult_t &ATParser::parse(char *input)
 {
-    string tmp;
-    size_t pos = string::npos;
-    size_t delim1 = string::npos;
-    size_t delim2 = string::npos;
-
     this->init_result();
 
-    if (input.size() == 0) {
-        last_result.type = AT_UNKNOWN;
-        return last_result;
-    }
-
     // trim leading whitespaces
-    input = input.substr(input.find_first_not_of(" \t"));
+    input += strspn(input, " \t");
 
-    if (input.rfind("AT+", 0) != 0) {
+    if (strncmp(input, "AT+", 3) != 0) {
         last_result.type = AT_UNKNOWN;
         return last_result;
     }
 
     //remove "AT+"
-    input = input.substr(3);
+    input += 3;
 
     // trim spaces, newline and CR at the end
-    input = input.erase(input.find_last_not_of(" \r\n") + 1);
+    size_t length = strlen(input);
+    while (length > 0 && strchr(" \r\n", input[length - 1]) != nullptr) {
+        input[--length] = '\0';
+    }
 
     // extract command itself
-    pos = input.find_first_of("?=");
-    last_result.command = input.substr(0, pos);
+    char *delim = strpbrk(input, "?=");
+    last_result.command = input;
 
-    if (pos == string::npos) {
+    if (delim == nullptr) {
         last_result.type = AT_RUN;
+        return last_result;
     }
-    else if (input.at(pos) == '=') {
-        last_result.type = AT_WRITE;
-    }
-    else if (input.at(pos) == '?') {
-        last_result.type = AT_READ;
-    }
-    else {
-        last_result.type = AT_UNKNOWN;
+
+    last_result.type = (*delim == '=') ? AT_WRITE : AT_READ;
+    *delim = '\0';
+
+    if (last_result.type != AT_WRITE) {
+        return last_result;
     }
 
-    // check if command has arguments and extract them
-    if (pos != string::npos && input.at(pos) == '=') {
-        delim1 = pos;
-        delim2 = input.find_first_of(",", pos);
-        // we have arguments, let's extract them
-        while (delim2 != string::npos) {
-            //TODO: support args in a quote
-            tmp = string(input, delim1 + 1, delim2 - delim1 - 1);
-            last_result.arguments.push_back(tmp);
-            if (tmp.size() > last_result.max_arg_len) {
-                last_result.max_arg_len = tmp.size();
-            }
-            delim1 = delim2;
-            delim2 = input.find_first_of(",", delim1 + 1);
+    // split the arguments, an empty line after '=' is one empty argument
+    char *arg = delim + 1;
+    while (true) {
+        //TODO: support args in a quote
+        char *comma = strchr(arg, ',');
+
+        if (last_result.argument_count < AT_MAX_ARGUMENTS) {
+            last_result.arguments[last_result.argument_count] = arg;
         }
-        //there is one more argument, behind last comma so, get it until end of command
-        tmp = string(input, delim1 + 1);
-        last_result.arguments.push_back(tmp);
-        if (tmp.size() > last_result.max_arg_len) {
-            last_result.max_arg_len = tmp.size();
+        last_result.argument_count++;
+
+        if (comma == nullptr) {
+            break;
         }
+        *comma = '\0';
+        arg = comma + 1;
     }
 
     return last_result;
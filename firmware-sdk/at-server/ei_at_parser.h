@@ -34,8 +34,11 @@
 
 #ifndef AT_PARSER_H
 #define AT_PARSER_H
-#include <string>
-#include <vector>
+
+/** Most arguments passed to a write handler */
+#ifndef AT_MAX_ARGUMENTS
+#define AT_MAX_ARGUMENTS 16
+#endif
 
 enum ATCommandType_t
 {
@@ -47,9 +50,10 @@ enum ATCommandType_t
 
 typedef struct {
     ATCommandType_t type;
-    std::string command;
-    std::vector<std::string> arguments;
-    unsigned int max_arg_len;
+    const char *command;
+    const char *arguments[AT_MAX_ARGUMENTS];
+    // all arguments found in the line, only the first AT_MAX_ARGUMENTS are stored
+    unsigned int argument_count;
 } ATParseResult_t;
 
 class ATParser {
@@ -60,7 +64,7 @@ private:
 public:
     ATParser() {};
     ~ATParser() {};
-    const ATParseResult_t &parse(std::string command);
+    const ATParseResult_t &parse(char *command);
 };
 
-#endif /* AT_PARSER_H */
\ No newline at end of file
+#endif /* AT_PARSER_H */
@@ -38,12 +38,34 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
 #include <cstring>
 #include <functional>
 #include <vector>
 
 using namespace std;
 
+#define AT_COMMAND_INDEX_EMPTY      0xffff
+// seeds tried for a collision free table before it is doubled
+#define AT_COMMAND_INDEX_MAX_SEEDS  256
+// longest escape sequence after 0x1b, eg. "[3~"
+#define AT_CONTROL_SEQUENCE_MAX     8
+
+/**
+ * @brief FNV-1a of the command name, the seed changes the offset basis
+ */
+static uint32_t command_hash(const char *command, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+
+    while (*command) {
+        hash ^= (uint8_t)*(command++);
+        hash *= 16777619u;
+    }
+
+    return hash ^ (hash >> 16);
+}
+
 // fake handler (will never be called) just to make it
 // possible to register HELP command
 static bool print_help_handler(void)
@@ -53,12 +75,16 @@ static bool print_help_handler(void)
 
 ATServer::ATServer()
     : history(default_history_size)
+    , command_index_seed(0)
+    , command_index_valid(false)
 {
     register_default_commands();
 }
 
 ATServer::ATServer(ATCommand_t *commands, size_t length, size_t max_history_size)
     : history(max_history_size)
+    , command_index_seed(0)
+    , command_index_valid(false)
 {
     if (length == 0 || commands == nullptr) {
         register_default_commands();
@@ -95,6 +121,69 @@ void ATServer::register_default_commands(void)
     tmp.run_handler = at_info;
 
     this->registered_commands.push_back(tmp);
+    this->command_index_valid = false;
+}
+
+/**
+ * @brief Find a seed that puts every command name in its own slot of the
+ * index, doubling the table if none of the seeds does
+ */
+void ATServer::build_command_index(void)
+{
+    size_t count = this->registered_commands.size();
+    size_t index_size = 8;
+
+    while (index_size < 4 * count) {
+        index_size <<= 1;
+    }
+
+    while (true) {
+        this->command_index.assign(index_size, AT_COMMAND_INDEX_EMPTY);
+
+        for (uint32_t seed = 0; seed < AT_COMMAND_INDEX_MAX_SEEDS; seed++) {
+            bool collision = false;
+
+            std::fill(this->command_index.begin(), this->command_index.end(), AT_COMMAND_INDEX_EMPTY);
+            for (size_t ix = 0; ix < count; ix++) {
+                uint16_t &slot = this->command_index
+                    [command_hash(this->registered_commands[ix].command.c_str(), seed) & (index_size - 1)];
+                if (slot != AT_COMMAND_INDEX_EMPTY) {
+                    collision = true;
+                    break;
+                }
+                slot = ix;
+            }
+
+            if (!collision) {
+                this->command_index_seed = seed;
+                this->command_index_valid = true;
+                return;
+            }
+        }
+
+        index_size <<= 1;
+    }
+}
+
+/**
+ * @brief Look up a registered command by name, without allocating
+ *
+ * @return ATCommand_t* or nullptr if no such command
+ */
+ATCommand_t *ATServer::find_command(const char *command)
+{
+    if (!this->command_index_valid) {
+        this->build_command_index();
+    }
+
+    uint16_t ix = this->command_index
+        [command_hash(command, this->command_index_seed) & (this->command_index.size() - 1)];
+
+    if (ix == AT_COMMAND_INDEX_EMPTY || this->registered_commands[ix].command != command) {
+        return nullptr;
+    }
+
+    return &this->registered_commands[ix];
 }
 
 /**
@@ -123,6 +212,7 @@ bool ATServer::register_command(ATCommand_t &command)
     }
 
     this->registered_commands.push_back(command);
+    this->command_index_valid = false;
 
     return true;
 }
@@ -156,21 +246,22 @@ bool ATServer::register_handlers(
     bool (*write_handler)(const char **, const int),
     const char *write_handler_args_list)
 {
-    for (auto it = registered_commands.begin(); it != registered_commands.end(); ++it) {
-        if (it->command.compare(cmd) == 0) {
-            //TODO: add sanity checks?
-            it->run_handler = run_handler;
-            it->read_handler = read_handler;
-            it->write_handler = write_handler;
-            //TODO: parse write_handler_args_list and update write_handler_arg_count
-            if (write_handler_args_list != nullptr) {
-                it->write_handler_args_list = string(write_handler_args_list);
-            }
-            return true;
-        }
+    ATCommand_t *it = this->find_command(cmd);
+
+    if (it == nullptr) {
+        return false;
     }
 
-    return false;
+    //TODO: add sanity checks?
+    it->run_handler = run_handler;
+    it->read_handler = read_handler;
+    it->write_handler = write_handler;
+    //TODO: parse write_handler_args_list and update write_handler_arg_count
+    if (write_handler_args_list != nullptr) {
+        it->write_handler_args_list = string(write_handler_args_list);
+    }
+
+    return true;
 }
 
 bool ATServer::print_help(void)
@@ -225,46 +316,53 @@ void ATServer::print_prompt(void)
 
 void ATServer::handle(char c)
 {
-    string tmp;
+    const char *tmp;
     bool print_new_prompt = true;
     static bool in_ctrl_char = false;
-    static vector<char> control_sequence;
+    static char control_sequence[AT_CONTROL_SEQUENCE_MAX];
+    static size_t control_sequence_len = 0;
 
     // control characters start with 0x1b and end with a-zA-Z
     // typically \x1b[<LETTER> eg. \x1b[A
     if (in_ctrl_char) {
-        control_sequence.push_back(c);
+        // too long to be one we know, drop it
+        if (control_sequence_len == AT_CONTROL_SEQUENCE_MAX) {
+            in_ctrl_char = false;
+            control_sequence_len = 0;
+            return;
+        }
+        control_sequence[control_sequence_len++] = c;
         // if a-zA-Z then it's the last one in the control char...
         if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c == 0x7e)) {
             in_ctrl_char = false;
             // up: \x1b[A
-            if (control_sequence.size() == 2 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x41) {
+            if (control_sequence_len == 2 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x41) {
 
                 ei_printf("\x1b[u"); // restore current position
                 tmp = history.go_back();
                 // ei_printf("\r\x1b[K> %s", tmp.c_str());
-                ei_printf("\x1b[2K\r> %s", tmp.c_str());
+                ei_printf("\x1b[2K\r> %s", tmp);
                 buffer.clear();
                 buffer.add(tmp);
             }
             // down: \x1b[B
             else if (
-                control_sequence.size() == 2 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x42) {
+                control_sequence_len == 2 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x42) {
 
                 ei_printf("\x1b[u"); // restore current position
                 tmp = history.go_next();
                 // reset cursor to 0, do \r, then write the new command...
                 // ei_printf("\r\x1b[K> %s", tmp.c_str());
-                ei_printf("\x1b[2K\r> %s", tmp.c_str());
+                ei_printf("\x1b[2K\r> %s", tmp);
                 buffer.clear();
                 buffer.add(tmp);
             }
             // left: \x1b[D
             else if (
-                control_sequence.size() == 2 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x44) {
+                control_sequence_len == 2 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x44) {
 
                 size_t curr = buffer.get_position();
 
@@ -276,15 +374,15 @@ void ATServer::handle(char c)
                 else {
                     buffer.set_position(curr - 1);
                     ei_putchar('\x1b');
-                    for (size_t ix = 0; ix < control_sequence.size(); ix++) {
+                    for (size_t ix = 0; ix < control_sequence_len; ix++) {
                         ei_putchar(control_sequence[ix]);
                     }
                 }
             }
             // right: \x1b[C
             else if (
-                control_sequence.size() == 2 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x43) {
+                control_sequence_len == 2 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x43) {
 
                 size_t curr = buffer.get_position();
 
@@ -295,55 +393,55 @@ void ATServer::handle(char c)
                 else {
                     buffer.set_position(curr + 1);
                     ei_putchar('\x1b');
-                    for (size_t ix = 0; ix < control_sequence.size(); ix++) {
+                    for (size_t ix = 0; ix < control_sequence_len; ix++) {
                         ei_putchar(control_sequence[ix]);
                     }
                 }
             }
             // HOME key: \x1b[H
             else if (
-                control_sequence.size() == 2 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x48) {
+                control_sequence_len == 2 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x48) {
                 // move to begining of the buffer...
                 buffer.set_position(0);
                 // ...and the line
                 ei_printf(
                     "\r\x1b[K> %s\x1b[%uG",
-                    buffer.get_string().c_str(),
+                    buffer.c_str(),
                     (unsigned int)buffer.get_position() + 3);
             }
             // END key: \x1b[F
             else if (
-                control_sequence.size() == 2 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x46) {
+                control_sequence_len == 2 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x46) {
                 // move to end of the buffer...
                 buffer.set_position(buffer.size());
                 // ...and the line
                 ei_printf(
                     "\r\x1b[K> %s\x1b[%uG",
-                    buffer.get_string().c_str(),
+                    buffer.c_str(),
                     (unsigned int)buffer.get_position() + 3);
             }
             // DELETE key: \x1b[3\x7e
             else if (
-                control_sequence.size() == 3 && control_sequence.at(0) == 0x5b &&
-                control_sequence.at(1) == 0x33 && control_sequence.at(2) == 0x7e) {
+                control_sequence_len == 3 && control_sequence[0] == 0x5b &&
+                control_sequence[1] == 0x33 && control_sequence[2] == 0x7e) {
                 if (buffer.do_delete()) {
                     ei_printf(
                         "\r\x1b[K> %s\x1b[%uG",
-                        buffer.get_string().c_str(),
+                        buffer.c_str(),
                         (unsigned int)buffer.get_position() + 3);
                 }
             }
             else {
                 // not up/down? execute original control sequence
                 ei_putchar('\x1b');
-                for (size_t ix = 0; ix < control_sequence.size(); ix++) {
+                for (size_t ix = 0; ix < control_sequence_len; ix++) {
                     ei_putchar(control_sequence[ix]);
                 }
             }
 
-            control_sequence.clear();
+            control_sequence_len = 0;
         }
         return;
     }
@@ -354,11 +452,9 @@ void ATServer::handle(char c)
     case '\r': /* want to run the buffer */
         ei_putchar(c);
         ei_putchar('\n');
-        tmp = buffer.get_string();
-
-        history.add(tmp);
+        history.add(buffer.c_str());
 
-        print_new_prompt = execute(tmp);
+        print_new_prompt = execute(buffer.c_str());
 
         buffer.clear();
 
@@ -371,7 +467,7 @@ void ATServer::handle(char c)
         if (buffer.do_backspace() == false) {
             break;
         }
-        ei_printf("\r\x1b[K> %s\x1b[%uG", buffer.get_string().c_str(), (unsigned int)buffer.get_position() + 3);
+        ei_printf("\r\x1b[K> %s\x1b[%uG", buffer.c_str(), (unsigned int)buffer.get_position() + 3);
         break;
     case 0x1b: /* control character */
         // start processing characters as they are control sequence
@@ -380,74 +476,71 @@ void ATServer::handle(char c)
         break;
     default:
         if (c >= 0x20 && c <= 0x7e) {
-            buffer.add(c);
+            // line full, no echo so the user sees the character was dropped
+            if (!buffer.add(c)) {
+                break;
+            }
             if (buffer.is_at_end()) {
                 ei_putchar(c);
             }
             else {
-                ei_printf("\r> %s\x1b[%uG", buffer.get_string().c_str(), (unsigned int)buffer.get_position() + 3);
+                ei_printf("\r> %s\x1b[%uG", buffer.c_str(), (unsigned int)buffer.get_position() + 3);
             }
         }
         break;
     }
 }
 
-bool ATServer::execute(string &input)
+bool ATServer::execute(const char *input)
 {
     bool new_prompt_required = false;
-    char **args = nullptr;
-    ATParseResult_t res;
+    ATCommand_t *cmd;
+
+    strncpy(this->command_line, input, AT_LINE_BUFFER_SIZE);
+    this->command_line[AT_LINE_BUFFER_SIZE] = '\0';
 
-    res = parser.parse(input);
+    const ATParseResult_t &res = parser.parse(this->command_line);
     if (res.type == AT_UNKNOWN) {
-        ei_printf("Not a valid AT command (%s)\n", input.c_str());
+        ei_printf("Not a valid AT command (%s)\n", input);
         return true;
     }
 
     // exception for HELP command which is built-in
-    if (res.command == AT_HELP && res.type == AT_RUN) {
+    if (strcmp(res.command, AT_HELP) == 0 && res.type == AT_RUN) {
         return this->print_help();
     }
 
     // find a command to execute
-    for (auto it = this->registered_commands.begin(); it != this->registered_commands.end(); ++it) {
-        if (it->command == res.command) {
-            // we've got a hit!
-            if (res.type == AT_RUN && it->run_handler) {
-                // simple command like AT+HELP
-                new_prompt_required = it->run_handler();
-            }
-            else if (res.type == AT_READ && it->read_handler) {
-                // read command like AT+CONFIG?
-                new_prompt_required = it->read_handler();
-            }
-            else if (res.type == AT_WRITE && it->write_handler) {
-                // write command like AT+DEVICEID=abcde
-                args = (char **)ei_malloc(res.arguments.size() * sizeof(char *));
-                for (unsigned int i = 0; i < res.arguments.size(); i++) {
-                    // one more byte for null terminator (in case of zero-length = empty argument eg. AT+RUN=123,,5)
-                    args[i] = (char *)ei_malloc(res.max_arg_len + 1);
-                    strncpy(args[i], res.arguments.at(i).c_str(), res.max_arg_len + 1);
-                }
-
-                new_prompt_required =
-                    it->write_handler((const char **)args, (int)res.arguments.size());
+    cmd = this->find_command(res.command);
+    if (cmd == nullptr) {
+        ei_printf("Command not found! (AT+%s)\n", res.command);
+        return true;
+    }
 
-                // now we are freeing the memory
-                for (unsigned int i = 0; i < res.arguments.size(); i++) {
-                    ei_free(args[i]);
-                }
-                ei_free(args);
-            }
-            else {
-                ei_printf("No handler for command! (%s)\n", input.c_str());
-                return true;
-            }
-            return new_prompt_required;
+    // we've got a hit!
+    if (res.type == AT_RUN && cmd->run_handler) {
+        // simple command like AT+HELP
+        new_prompt_required = cmd->run_handler();
+    }
+    else if (res.type == AT_READ && cmd->read_handler) {
+        // read command like AT+CONFIG?
+        new_prompt_required = cmd->read_handler();
+    }
+    else if (res.type == AT_WRITE && cmd->write_handler) {
+        // write command like AT+DEVICEID=abcde
+        if (res.argument_count > AT_MAX_ARGUMENTS) {
+            ei_printf("Too many arguments, max %d (%s)\n", AT_MAX_ARGUMENTS, input);
+            return true;
         }
+        // arguments point into command_line, nothing to allocate or free
+        const char *args[AT_MAX_ARGUMENTS];
+        std::copy_n(res.arguments, res.argument_count, args);
+        new_prompt_required = cmd->write_handler(args, (int)res.argument_count);
+    }
+    else {
+        ei_printf("No handler for command! (%s)\n", input);
+        return true;
     }
 
-    // we shouldn't be here!
-    ei_printf("Command not found! (AT+%s)\n", res.command.c_str());
-    return true;
+    return new_prompt_required;
 }
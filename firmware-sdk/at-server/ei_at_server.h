@@ -37,6 +37,7 @@
 #include "ei_at_history.h"
 #include "ei_at_parser.h"
 #include "ei_line_buffer.h"
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -62,14 +63,23 @@ private:
     std::vector<ATCommand_t> registered_commands;
     LineBuffer buffer;
     ATParser parser;
+    // copy of the line being executed, split in place by the parser
+    char command_line[AT_LINE_BUFFER_SIZE + 1];
+    // perfect hash of the command names into registered_commands, built
+    // once after registration so a lookup is a single probe
+    std::vector<uint16_t> command_index;
+    uint32_t command_index_seed;
+    bool command_index_valid;
     void register_default_commands(void);
+    void build_command_index(void);
+    ATCommand_t *find_command(const char *command);
 
 protected:
     ATServer();
     ATServer(ATCommand_t *commands, size_t length, size_t max_history_size = default_history_size);
     ~ATServer();
     bool print_help(void);
-    bool execute(std::string &command);
+    bool execute(const char *command);
 
 public:
     ATServer(ATServer &other) = delete;
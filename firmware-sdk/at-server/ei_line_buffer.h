@@ -35,44 +35,65 @@
 #ifndef LINEBUFFER_H
 #define LINEBUFFER_H
 
-#include <string>
+#include <cstddef>
+#include <cstring>
+
+/** Longest command line the AT server accepts, further characters are dropped */
+#ifndef AT_LINE_BUFFER_SIZE
+#define AT_LINE_BUFFER_SIZE 256
+#endif
 
 class LineBuffer {
 private:
-    std::string buffer;
+    char buffer[AT_LINE_BUFFER_SIZE + 1];
+    size_t length;
     size_t position;
 
 public:
     LineBuffer()
-        : buffer("")
-        , position(0) {};
+        : length(0)
+        , position(0)
+    {
+        buffer[0] = '\0';
+    };
 
     void clear()
     {
-        buffer.clear();
+        buffer[0] = '\0';
+        length = 0;
         position = 0;
     }
 
-    void add(std::string &s)
+    /**
+     * @brief Insert characters at the cursor, as many as fit
+     *
+     * @return false if the line is full and some characters were dropped
+     */
+    bool add(const char *s, size_t size)
     {
-        if (position == buffer.size()) {
-            buffer.append(s);
-        }
-        else {
-            buffer.insert(position, s);
+        bool fits = true;
+
+        if (size > AT_LINE_BUFFER_SIZE - length) {
+            size = AT_LINE_BUFFER_SIZE - length;
+            fits = false;
         }
-        position += s.size();
+
+        memmove(&buffer[position + size], &buffer[position], length - position + 1);
+        memcpy(&buffer[position], s, size);
+        length += size;
+        position += size;
+
+        return fits;
     }
 
-    void add(const char c)
+    bool add(const char *s)
     {
-        if (position == buffer.size()) {
-            buffer.append(&c, 1);
-        }
-        else {
-            buffer.insert(position, &c, 1);
-        }
-        position++;
+        return add(s, strlen(s));
+    }
+
+    bool add(const char c)
+    {
+        return add(&c, 1);
     }
 
     bool do_backspace(void)
@@ -81,7 +102,8 @@ public:
             return false;
         }
 
-        buffer.erase(position - 1, 1);
+        memmove(&buffer[position - 1], &buffer[position], length - position + 1);
+        length--;
         position--;
 
         return true;
@@ -93,7 +115,8 @@ public:
             return false;
         }
 
-        buffer.erase(position, 1);
+        memmove(&buffer[position], &buffer[position + 1], length - position);
+        length--;
 
         return true;
     }
@@ -105,15 +128,20 @@ public:
 
     bool is_at_end(void)
     {
-        return position == buffer.size();
+        return position == length;
     }
 
     bool is_empty(void)
     {
-        return buffer.size() == 0;
+        return length == 0;
+    }
+
+    bool is_full(void)
+    {
+        return length == AT_LINE_BUFFER_SIZE;
     }
 
-    std::string get_string()
+    const char *c_str()
     {
         return buffer;
     }
@@ -125,8 +153,8 @@ public:
 
     void set_position(int pos)
     {
-        if (pos > (int)buffer.size()) {
-            position = buffer.size();
+        if (pos > (int)length) {
+            position = length;
         }
         else if (pos < 0) {
             position = 0;
@@ -138,8 +166,8 @@ public:
 
     size_t size()
     {
-        return buffer.size();
+        return length;
     }
 };
 
-#endif /* LINEBUFFER_H */
\ No newline at end of file
+#endif /* LINEBUFFER_H */
@@ -75,89 +75,215 @@ static const char *base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                                   "0123456789+/";
 
 /**
- * @brief Base64 encode and write to a putc function
+ * @brief Base64 characters for every 12-bit input value, so one lookup
+ * produces two output characters
+ */
+struct base64_pair_table_t {
+    char pair[4096][2];
+
+    constexpr base64_pair_table_t() : pair()
+    {
+        const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                             "abcdefghijklmnopqrstuvwxyz"
+                             "0123456789+/";
+
+        for (int ix = 0; ix < 4096; ix++) {
+            pair[ix][0] = chars[ix >> 6];
+            pair[ix][1] = chars[ix & 0x3f];
+        }
+    }
+};
+
+static constexpr base64_pair_table_t base64_pairs;
+
+#define BASE64_VALUE_SKIP       0xfe
+#define BASE64_VALUE_PAD        0xfd
+#define BASE64_VALUE_INVALID    0xff
+
+/**
+ * @brief Sextet value of every input character, whitespace is skipped so
+ * line breaks between chunks do not matter
+ */
+struct base64_value_table_t {
+    uint8_t value[256];
+
+    constexpr base64_value_table_t() : value()
+    {
+        const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                             "abcdefghijklmnopqrstuvwxyz"
+                             "0123456789+/";
+
+        for (int ix = 0; ix < 256; ix++) {
+            value[ix] = BASE64_VALUE_INVALID;
+        }
+        for (int ix = 0; ix < 64; ix++) {
+            value[(uint8_t)chars[ix]] = ix;
+        }
+        value[(uint8_t)'\r'] = BASE64_VALUE_SKIP;
+        value[(uint8_t)'\n'] = BASE64_VALUE_SKIP;
+        value[(uint8_t)' '] = BASE64_VALUE_SKIP;
+        value[(uint8_t)'='] = BASE64_VALUE_PAD;
+    }
+};
+
+static constexpr base64_value_table_t base64_values;
+
+/**
+ * @brief Encode complete 3 byte groups, output has to hold input_size / 3 * 4 bytes
  *
+ * @return size_t number of characters written
+ */
+static size_t base64_encode_groups(const uint8_t *input, size_t input_size, char *output)
+{
+    char *out = output;
+
+    for (; input_size >= 3; input_size -= 3, input += 3, out += 4) {
+        uint32_t v = ((uint32_t)input[0] << 16) | ((uint32_t)input[1] << 8) | input[2];
+
+        memcpy(&out[0], base64_pairs.pair[v >> 12], 2);
+        memcpy(&out[2], base64_pairs.pair[v & 0xfff], 2);
+    }
+
+    return out - output;
+}
+
+/**
+ * @brief Encode the last 1 or 2 bytes with padding, output has to hold 4 bytes
+ */
+static size_t base64_encode_tail(const uint8_t *input, size_t input_size, char *output)
+{
+    if (input_size == 0) {
+        return 0;
+    }
+
+    uint32_t v = (uint32_t)input[0] << 16;
+    if (input_size > 1) {
+        v |= (uint32_t)input[1] << 8;
+    }
+
+    memcpy(&output[0], base64_pairs.pair[v >> 12], 2);
+    memcpy(&output[2], base64_pairs.pair[v & 0xfff], 2);
+    if (input_size == 1) {
+        output[2] = '=';
+    }
+    output[3] = '=';
+
+    return 4;
+}
+
+void base64_encoder_init(base64_encoder_t *encoder)
+{
+    encoder->leftover_size = 0;
+}
+
+/**
+ * @brief Encode next part of a stream into output buffer. Bytes not forming
+ * a complete 3 byte group are kept in the encoder for the next call.
+ *
+ * @param encoder stream state
  * @param input
  * @param input_size
- * @param putc_f pointer to putc function
+ * @param output
+ * @param output_size has to be at least BASE64_ENCODE_BLOCK_SIZE(input_size)
+ * @return int number of characters in output buffer, negative if output is too small
  */
-void base64_encode(const char *input, size_t input_size, void (*putc_f)(char))
+int base64_encode_block(base64_encoder_t *encoder, const uint8_t *input, size_t input_size, char *output, size_t output_size)
 {
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-
-    while (input_size--) {
-        char_array_3[i++] = *(input++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for (i = 0; (i < 4); i++) {
-                putc_f(base64_chars[char_array_4[i]]);
-            }
-            i = 0;
-        }
+    if (output_size < BASE64_ENCODE_BLOCK_SIZE(input_size)) {
+        return -10;
     }
 
-    if (i) {
-        for (j = i; j < 3; j++) {
-            char_array_3[j] = '\0';
+    size_t output_ix = 0;
+
+    // complete the group left over from the previous call
+    if (encoder->leftover_size > 0) {
+        while (encoder->leftover_size < 3 && input_size > 0) {
+            encoder->leftover[encoder->leftover_size++] = *(input++);
+            input_size--;
+        }
+        if (encoder->leftover_size < 3) {
+            return 0;
         }
+        output_ix += base64_encode_groups(encoder->leftover, 3, output);
+        encoder->leftover_size = 0;
+    }
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+    size_t groups_size = input_size - input_size % 3;
+    output_ix += base64_encode_groups(input, groups_size, &output[output_ix]);
 
-        for (j = 0; (j < i + 1); j++) {
-            putc_f(base64_chars[char_array_4[j]]);
-        }
+    encoder->leftover_size = input_size - groups_size;
+    memcpy(encoder->leftover, &input[groups_size], encoder->leftover_size);
+
+    return output_ix;
+}
+
+/**
+ * @brief Flush the bytes kept in the encoder (with padding)
+ *
+ * @param encoder stream state
+ * @param output has to hold 4 bytes
+ * @return int number of characters in output buffer
+ */
+int base64_encode_block_finish(base64_encoder_t *encoder, char *output)
+{
+    int output_ix = base64_encode_tail(encoder->leftover, encoder->leftover_size, output);
+    encoder->leftover_size = 0;
 
-        while ((i++ < 3)) {
-            putc_f('=');
+    return output_ix;
+}
+
+/**
+ * @brief Base64 encode and write to a putc function
+ *
+ * @param input
+ * @param input_size
+ * @param putc_f pointer to putc function
+ */
+void base64_encode(const char *input, size_t input_size, void (*putc_f)(char))
+{
+    char output[192];
+    const uint8_t *in = (const uint8_t *)input;
+
+    while (input_size >= 3) {
+        size_t block_size = std::min(input_size - input_size % 3, (size_t)144);
+        size_t output_size = base64_encode_groups(in, block_size, output);
+
+        for (size_t ix = 0; ix < output_size; ix++) {
+            putc_f(output[ix]);
         }
+        in += block_size;
+        input_size -= block_size;
+    }
+
+    size_t output_size = base64_encode_tail(in, input_size, output);
+    for (size_t ix = 0; ix < output_size; ix++) {
+        putc_f(output[ix]);
     }
 }
 
 void base64_encode_chunk(const char *input, size_t input_size, void (*putc_f)(char))
 {
-    static char leftover[3];
-    static uint8_t leftover_size = 0;
+    static base64_encoder_t encoder = { { 0 }, 0 };
+    char output[192];
+    const uint8_t *in = (const uint8_t *)input;
 
     if (input == nullptr) {
-        base64_encode(leftover, leftover_size, putc_f);
-        leftover_size = 0;
+        int output_size = base64_encode_block_finish(&encoder, output);
+        for (int ix = 0; ix < output_size; ix++) {
+            putc_f(output[ix]);
+        }
         return;
     }
 
-    // if we have leftover bytes, try to get N bytes from input
-    // to fulfill 3 bytes chunk from base64 encoder
-    if (leftover_size > 0) {
-        // in case input_size is 1B and we have 1B leftover
-        uint8_t to_copy = std::min((size_t)(3 - leftover_size), input_size);
-        memcpy(&leftover[leftover_size], input, to_copy);
-        leftover_size += to_copy;
-        // if we hve not enough data to encode, break
-        if (leftover_size < 3) {
-            return;
-        }
-        base64_encode(leftover, leftover_size, putc_f);
-        leftover_size = 0;
-        input_size -= to_copy;
-        input += to_copy;
-    }
+    while (input_size > 0) {
+        size_t block_size = std::min(input_size, (size_t)141);
+        int output_size = base64_encode_block(&encoder, in, block_size, output, sizeof(output));
 
-    if (input_size % 3 == 0) {
-        base64_encode(input, input_size, putc_f);
-    }
-    else {
-        leftover_size = input_size % 3;
-        base64_encode(input, input_size - leftover_size, putc_f);
-        memcpy(leftover, &input[input_size - leftover_size], leftover_size);
+        for (int ix = 0; ix < output_size; ix++) {
+            putc_f(output[ix]);
+        }
+        in += block_size;
+        input_size -= block_size;
     }
 }
 
@@ -185,46 +311,104 @@ int base64_encode_buffer(const char *input, size_t input_size, char *output, siz
         return -10;
     }
 
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    size_t output_ix = 0;
-
-    while (input_size--) {
-        char_array_3[i++] = *(input++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
+    const uint8_t *in = (const uint8_t *)input;
+    size_t groups_size = input_size - mod;
+    size_t output_ix = base64_encode_groups(in, groups_size, output);
 
-            for (i = 0; (i < 4); i++) {
-                output[output_ix++] = base64_chars[char_array_4[i]];
-            }
-            i = 0;
-        }
+    if (mod) {
+        // padding is written only as far as the caller's buffer allows
+        char tail[4];
+        size_t tail_size = std::min(base64_encode_tail(&in[groups_size], mod, tail), output_size - output_ix);
+        memcpy(&output[output_ix], tail, tail_size);
+        output_ix += tail_size;
     }
 
-    if (i) {
-        for (j = i; j < 3; j++) {
-            char_array_3[j] = '\0';
-        }
+    return output_ix;
+}
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+void base64_decoder_init(base64_decoder_t *decoder)
+{
+    decoder->bits = 0;
+    decoder->sextets = 0;
+}
 
-        for (j = 0; (j < i + 1); j++) {
-            output[output_ix++] = base64_chars[char_array_4[j]];
+/**
+ * @brief Decode next part of a stream into output buffer. Characters not
+ * forming a complete 4 character group are kept in the decoder for the next
+ * call, padding flushes the group so concatenated streams decode as well.
+ *
+ * @param decoder stream state
+ * @param input
+ * @param input_size
+ * @param output
+ * @param output_size decoded bytes past this are dropped
+ * @return int number of bytes in output buffer, negative on invalid character
+ */
+int base64_decode_block(base64_decoder_t *decoder, const char *input, size_t input_size, uint8_t *output, size_t output_size)
+{
+    const uint8_t *in = (const uint8_t *)input;
+    const uint8_t *in_end = in + input_size;
+    size_t output_ix = 0;
+    uint32_t bits = decoder->bits;
+    uint8_t sextets = decoder->sextets;
+
+    while (in < in_end) {
+        // whole groups straight from the input while aligned
+        if (sextets == 0) {
+            while (in_end - in >= 4 && output_size - output_ix >= 3) {
+                uint8_t a = base64_values.value[in[0]];
+                uint8_t b = base64_values.value[in[1]];
+                uint8_t c = base64_values.value[in[2]];
+                uint8_t d = base64_values.value[in[3]];
+                if ((a | b | c | d) & 0xc0) {
+                    break;
+                }
+                output[output_ix++] = (a << 2) | (b >> 4);
+                output[output_ix++] = (b << 4) | (c >> 2);
+                output[output_ix++] = (c << 6) | d;
+                in += 4;
+            }
+            if (in == in_end) {
+                break;
+            }
         }
 
-        while ((i++ < 3)) {
-            output[output_ix++] = '=';
+        uint8_t value = base64_values.value[*(in++)];
+
+        if (value < 64) {
+            bits = (bits << 6) | value;
+            if (++sextets < 4) {
+                continue;
+            }
+            uint8_t group[3] = { (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits };
+            size_t copy = std::min((size_t)3, output_size - output_ix);
+            memcpy(&output[output_ix], group, copy);
+            output_ix += copy;
+            bits = 0;
+            sextets = 0;
+        }
+        else if (value == BASE64_VALUE_PAD) {
+            // 2 or 3 sextets carry 1 or 2 bytes, further padding is ignored
+            if (sextets >= 2) {
+                bits <<= 6 * (4 - sextets);
+                uint8_t group[2] = { (uint8_t)(bits >> 16), (uint8_t)(bits >> 8) };
+                size_t copy = std::min((size_t)(sextets - 1), output_size - output_ix);
+                memcpy(&output[output_ix], group, copy);
+                output_ix += copy;
+            }
+            bits = 0;
+            sextets = 0;
+        }
+        else if (value == BASE64_VALUE_INVALID) {
+            decoder->bits = bits;
+            decoder->sextets = sextets;
+            return BASE64_DECODE_ERR_INVALID_CHAR;
         }
     }
 
+    decoder->bits = bits;
+    decoder->sextets = sextets;
+
     return output_ix;
 }
 
@@ -62,15 +62,40 @@
 
 */
 
+#include <cstdint>
 #include <cstdlib>
 #include <string>
 #include <vector>
 
+/* Constants --------------------------------------------------------------- */
+/** Worst case output of base64_encode_block for input_size bytes */
+#define BASE64_ENCODE_BLOCK_SIZE(input_size)    ((((input_size) + 2) / 3) * 4)
+/** Error codes of base64_decode_block */
+#define BASE64_DECODE_ERR_INVALID_CHAR          (-1)
+
+/* Typedefs ---------------------------------------------------------------- */
+/** State of a streamed base64 encoding, bytes not forming a full 3 byte group yet */
+typedef struct {
+    uint8_t leftover[3];
+    uint8_t leftover_size;
+} base64_encoder_t;
+
+/** State of a streamed base64 decoding, sextets not forming a full group yet */
+typedef struct {
+    uint32_t bits;
+    uint8_t sextets;
+} base64_decoder_t;
+
 /* Function prototypes ----------------------------------------------------- */
+void base64_encoder_init(base64_encoder_t *encoder);
+int base64_encode_block(base64_encoder_t *encoder, const uint8_t *input, size_t input_size, char *output, size_t output_size);
+int base64_encode_block_finish(base64_encoder_t *encoder, char *output);
 void base64_encode(const char *input, size_t input_size, void (*putc_f)(char));
 void base64_encode_chunk(const char *input, size_t input_size, void (*putc_f)(char));
 void base64_encode_finish(void (*putc_f)(char));
 int base64_encode_buffer(const char *input, size_t input_size, char *output, size_t output_size);
 std::vector<unsigned char> base64_decode(std::string const&);
+void base64_decoder_init(base64_decoder_t *decoder);
+int base64_decode_block(base64_decoder_t *decoder, const char *input, size_t input_size, uint8_t *output, size_t output_size);
 
 #endif /* EI_AT_BASE64_LIB_H */
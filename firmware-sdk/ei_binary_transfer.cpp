@@ -0,0 +1,349 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_binary_transfer.h"
+#include "ei_device_interface.h"
+
+#include <cstring>
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/* Constants --------------------------------------------------------------- */
+#define FRAME_CRC_SIZE      sizeof(uint32_t)
+#define FRAME_MAX_SIZE      (sizeof(ei_binary_frame_header_t) + EI_BINARY_TRANSFER_MAX_PAYLOAD + FRAME_CRC_SIZE)
+#define START_PAYLOAD_SIZE  8
+#define END_PAYLOAD_SIZE    4
+#define HOST_LINE_SIZE      12
+
+static_assert(sizeof(ei_binary_frame_header_t) == 8, "unexpected frame header size");
+static_assert(EI_BINARY_TRANSFER_MAX_PAYLOAD <= 0xFFFF, "payload length is a 16 bit field");
+static_assert(EI_BINARY_TRANSFER_WINDOW > 0 && EI_BINARY_TRANSFER_WINDOW < 0x8000, "window out of range");
+
+/* Private types ----------------------------------------------------------- */
+typedef enum {
+    HOST_NONE = 0,
+    HOST_ACK,
+    HOST_NAK,
+    HOST_CANCEL
+} host_reply_t;
+
+typedef struct {
+    char line[HOST_LINE_SIZE];
+    uint8_t length;
+} host_parser_t;
+
+/* Private variables ------------------------------------------------------- */
+static ei_binary_transfer_stats_t last_stats;
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief      CRC32 (IEEE 802.3, same as zlib), chainable: pass the previous result as crc
+ */
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length)
+{
+    static const uint32_t nibble_table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+    for (size_t ix = 0; ix < length; ix++) {
+        crc ^= data[ix];
+        crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+static inline void put_u16(uint8_t *dst, uint16_t value)
+{
+    dst[0] = value & 0xFF;
+    dst[1] = value >> 8;
+}
+
+static inline void put_u32(uint8_t *dst, uint32_t value)
+{
+    put_u16(dst, value & 0xFFFF);
+    put_u16(dst + 2, value >> 16);
+}
+
+/**
+ * @brief Fill in header and CRC around the payload already placed in the frame
+ *
+ * @return size_t size of the whole frame
+ */
+static size_t finish_frame(uint8_t *frame, ei_binary_frame_type_t type, uint32_t seq, uint16_t length)
+{
+    frame[0] = EI_BINARY_TRANSFER_SYNC_0;
+    frame[1] = EI_BINARY_TRANSFER_SYNC_1;
+    frame[2] = type;
+    frame[3] = 0;
+    put_u16(&frame[4], seq & 0xFFFF);
+    put_u16(&frame[6], length);
+
+    const size_t crc_offset = sizeof(ei_binary_frame_header_t) + length;
+    put_u32(&frame[crc_offset], crc32_update(0, &frame[2], crc_offset - 2));
+
+    return crc_offset + FRAME_CRC_SIZE;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Consume available input, stops at the first complete reply
+ *
+ * @param parser line being assembled
+ * @param seq 16 bit sequence number carried by ACK/NAK
+ * @return host_reply_t HOST_NONE if no complete reply is available yet
+ */
+static host_reply_t poll_host(host_parser_t *parser, uint16_t *seq)
+{
+    char c;
+
+    while ((c = ei_getchar()) != 0) {
+        if (c == 'b' && parser->length == 0) {
+            return HOST_CANCEL;
+        }
+        if (c != '\r') {
+            if (parser->length < HOST_LINE_SIZE) {
+                parser->line[parser->length] = c;
+            }
+            parser->length++;
+            continue;
+        }
+
+        const char *line = parser->line;
+        uint8_t length = parser->length;
+        parser->length = 0;
+
+        if (length == 3 && memcmp(line, "CAN", 3) == 0) {
+            return HOST_CANCEL;
+        }
+        if (length != 8 || line[3] != ' ') {
+            continue;
+        }
+
+        uint32_t value = 0;
+        bool valid = true;
+        for (int ix = 4; ix < 8; ix++) {
+            int digit = hex_digit(line[ix]);
+            valid &= (digit >= 0);
+            value = (value << 4) | (digit & 0x0F);
+        }
+        if (!valid) {
+            continue;
+        }
+
+        *seq = (uint16_t)value;
+        if (memcmp(line, "ACK", 3) == 0) {
+            return HOST_ACK;
+        }
+        if (memcmp(line, "NAK", 3) == 0) {
+            return HOST_NAK;
+        }
+    }
+
+    return HOST_NONE;
+}
+
+static bool read_from_buffer(void *ctx, size_t offset, uint8_t *buffer, size_t length)
+{
+    memcpy(buffer, (const uint8_t *)ctx + offset, length);
+    return true;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Send length bytes as a binary framed transfer (see ei_binary_transfer.h)
+ *
+ * @param content what the data is, announced in the START frame
+ * @param length number of bytes
+ * @param read_f called for every DATA frame, including resends
+ * @param ctx passed to read_f
+ * @return true if the host acknowledged the END frame
+ * @return false on read error, cancel or when the host stopped answering
+ */
+bool ei_binary_transfer_send(
+    ei_binary_content_t content,
+    size_t length,
+    ei_binary_transfer_read_t read_f,
+    void *ctx)
+{
+    const uint32_t data_frames = (length + EI_BINARY_TRANSFER_MAX_PAYLOAD - 1) / EI_BINARY_TRANSFER_MAX_PAYLOAD;
+    const uint32_t end_seq = data_frames + 1;
+
+    uint8_t *frame = (uint8_t *)ei_malloc(FRAME_MAX_SIZE);
+    if (frame == nullptr) {
+        return false;
+    }
+
+    memset(&last_stats, 0, sizeof(last_stats));
+
+    host_parser_t parser = { { 0 }, 0 };
+    uint32_t base = 0;      // oldest frame not acknowledged yet
+    uint32_t next = 0;      // next frame to send
+    uint32_t sent = 0;      // frames below this were sent at least once
+    uint32_t data_crc = 0;  // CRC of frames 1..sent - 1
+    uint32_t retries = 0;
+    uint64_t progress_time = ei_read_timer_ms();
+    bool success = false;
+
+    while (true) {
+        if (next <= end_seq && next - base < EI_BINARY_TRANSFER_WINDOW) {
+            uint8_t *payload = &frame[sizeof(ei_binary_frame_header_t)];
+            size_t frame_size;
+
+            if (next == 0) {
+                put_u32(&payload[0], length);
+                put_u16(&payload[4], EI_BINARY_TRANSFER_MAX_PAYLOAD);
+                payload[6] = EI_BINARY_TRANSFER_WINDOW;
+                payload[7] = content;
+                frame_size = finish_frame(frame, EI_BINARY_FRAME_START, next, START_PAYLOAD_SIZE);
+            }
+            else if (next < end_seq) {
+                size_t offset = (size_t)(next - 1) * EI_BINARY_TRANSFER_MAX_PAYLOAD;
+                size_t payload_size = length - offset;
+                if (payload_size > EI_BINARY_TRANSFER_MAX_PAYLOAD) {
+                    payload_size = EI_BINARY_TRANSFER_MAX_PAYLOAD;
+                }
+                if (!read_f(ctx, offset, payload, payload_size)) {
+                    break;
+                }
+                if (next >= sent) {
+                    data_crc = crc32_update(data_crc, payload, payload_size);
+                }
+                frame_size = finish_frame(frame, EI_BINARY_FRAME_DATA, next, payload_size);
+            }
+            else {
+                put_u32(&payload[0], data_crc);
+                frame_size = finish_frame(frame, EI_BINARY_FRAME_END, next, END_PAYLOAD_SIZE);
+            }
+
+            ei_write_string((char *)frame, frame_size);
+
+            last_stats.frames_sent++;
+            if (next < sent) {
+                last_stats.frames_resent++;
+            }
+            next++;
+            if (next > sent) {
+                sent = next;
+            }
+        }
+
+        uint16_t seq16;
+        host_reply_t reply;
+        bool cancelled = false;
+
+        while ((reply = poll_host(&parser, &seq16)) != HOST_NONE) {
+            if (reply == HOST_CANCEL) {
+                cancelled = true;
+                break;
+            }
+
+            // expand the 16 bit number around the window, only frames already sent count
+            uint32_t seq = base + (uint16_t)(seq16 - (uint16_t)base);
+            if (seq > sent) {
+                continue;
+            }
+
+            if (seq > base) {
+                base = seq;
+                retries = 0;
+                progress_time = ei_read_timer_ms();
+            }
+            if (next < base) {
+                next = base;
+            }
+            if (reply == HOST_NAK) {
+                last_stats.naks++;
+                next = base;
+            }
+        }
+
+        if (cancelled) {
+            break;
+        }
+        if (base > end_seq) {
+            success = true;
+            break;
+        }
+
+        if (ei_read_timer_ms() - progress_time > EI_BINARY_TRANSFER_TIMEOUT_MS) {
+            if (++retries > EI_BINARY_TRANSFER_MAX_RETRIES) {
+                break;
+            }
+            last_stats.timeouts++;
+            next = base;
+            progress_time = ei_read_timer_ms();
+        }
+        else if (next > end_seq || next - base >= EI_BINARY_TRANSFER_WINDOW) {
+            // window is full, wait for the host
+            ei_sleep(1);
+        }
+    }
+
+    ei_free(frame);
+
+    return success;
+}
+
+/**
+ * @brief Send a buffer already in RAM as a binary framed transfer
+ */
+bool ei_binary_transfer_send_buffer(ei_binary_content_t content, const uint8_t *data, size_t length)
+{
+    return ei_binary_transfer_send(content, length, read_from_buffer, (void *)data);
+}
+
+/**
+ * @brief Counters of the last transfer
+ */
+void ei_binary_transfer_get_stats(ei_binary_transfer_stats_t *stats)
+{
+    *stats = last_stats;
+}
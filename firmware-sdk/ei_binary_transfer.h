@@ -0,0 +1,136 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_BINARY_TRANSFER_H
+#define EI_BINARY_TRANSFER_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Binary framed transfer, used instead of base64 text when the host passes
+ * 'b' as the USEMAXRATE argument (AT+READBUFFER, AT+SNAPSHOT, AT+SNAPSHOTSTREAM).
+ * The port switches to the max baud rate first, as with 'y'.
+ *
+ * Device -> host frame, all fields little endian:
+ *
+ *   sync    (2 bytes) 0xEB 0x91
+ *   type    (1 byte)  START, DATA or END
+ *   flags   (1 byte)  reserved, 0
+ *   seq     (2 bytes) START is 0, DATA 1..N, END N+1 (low 16 bits)
+ *   length  (2 bytes) payload size
+ *   payload (length bytes)
+ *   crc     (4 bytes) CRC32 (IEEE 802.3, same as zlib) over type..payload
+ *
+ * START payload: total length (u32), max payload (u16), window (u8), content (u8)
+ * END payload:   CRC32 of the whole transferred data (u32)
+ *
+ * Host -> device, ASCII lines terminated with '\r', hex in upper case:
+ *
+ *   "ACK xxxx" every frame before seq xxxx was received
+ *   "NAK xxxx" resend starting at seq xxxx (bad CRC or a gap)
+ *   "CAN"      abort the transfer ('b' is accepted as well)
+ *
+ * Up to EI_BINARY_TRANSFER_WINDOW frames are in flight. On a NAK, or when no
+ * ACK advanced within EI_BINARY_TRANSFER_TIMEOUT_MS, the device goes back to
+ * the oldest unacknowledged frame. Payloads are read again from the source on
+ * a resend, so nothing is kept for retransmission.
+ * See firmware-sdk/tools/binary_transfer.py for the host side client.
+ */
+#define EI_BINARY_TRANSFER_SYNC_0       0xEB
+#define EI_BINARY_TRANSFER_SYNC_1       0x91
+
+#ifndef EI_BINARY_TRANSFER_MAX_PAYLOAD
+#define EI_BINARY_TRANSFER_MAX_PAYLOAD  1024
+#endif
+
+/** Frames in flight, window * ACK line length has to fit the UART RX FIFO */
+#ifndef EI_BINARY_TRANSFER_WINDOW
+#define EI_BINARY_TRANSFER_WINDOW       8
+#endif
+
+#ifndef EI_BINARY_TRANSFER_TIMEOUT_MS
+#define EI_BINARY_TRANSFER_TIMEOUT_MS   250
+#endif
+
+/** Timeouts in a row without progress before the transfer is given up */
+#ifndef EI_BINARY_TRANSFER_MAX_RETRIES
+#define EI_BINARY_TRANSFER_MAX_RETRIES  8
+#endif
+
+typedef enum {
+    EI_BINARY_FRAME_START = 0x01,
+    EI_BINARY_FRAME_DATA = 0x02,
+    EI_BINARY_FRAME_END = 0x03
+} ei_binary_frame_type_t;
+
+typedef enum {
+    EI_BINARY_CONTENT_SAMPLE = 0,
+    EI_BINARY_CONTENT_SNAPSHOT = 1,
+    EI_BINARY_CONTENT_SNAPSHOT_JPEG = 2,
+    EI_BINARY_CONTENT_SAMPLE_PACKED = 3     // sample as stored by ei_sample_codec.h, decoded on the host
+} ei_binary_content_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t sync[2];
+    uint8_t type;
+    uint8_t flags;
+    uint16_t seq;
+    uint16_t length;
+} ei_binary_frame_header_t;
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t frames_resent;
+    uint32_t naks;
+    uint32_t timeouts;
+} ei_binary_transfer_stats_t;
+
+/**
+ * @brief Source of the transferred data, called again for frames that are resent
+ *
+ * @return true if length bytes from offset were copied to buffer
+ */
+typedef bool (*ei_binary_transfer_read_t)(void *ctx, size_t offset, uint8_t *buffer, size_t length);
+
+bool ei_binary_transfer_send(
+    ei_binary_content_t content,
+    size_t length,
+    ei_binary_transfer_read_t read_f,
+    void *ctx);
+bool ei_binary_transfer_send_buffer(ei_binary_content_t content, const uint8_t *data, size_t length);
+void ei_binary_transfer_get_stats(ei_binary_transfer_stats_t *stats);
+
+#endif /* EI_BINARY_TRANSFER_H */
@@ -36,6 +36,7 @@
 #define EI_CAMERA_INTERFACE_H
 
 #include <cstdint>
+#include <cstddef>
 
 typedef struct {
     uint16_t width;
@@ -82,6 +83,33 @@ public:
             return false;
         }
 
+    /**
+     * @brief Call to driver to return the next frame as the JPEG produced by
+     * the sensor, without decoding or copying it. The frame stays valid until
+     * ei_camera_release_jpeg_frame() is called.
+     *
+     * @param jpeg Pointer to the JPEG data
+     * @param jpeg_size Size of the JPEG data
+     * @param res Resolution of the frame
+     * @return true If successful
+     * @return false If the camera does not produce JPEG frames or capture failed
+     */
+    virtual bool ei_camera_get_jpeg_frame(
+        const uint8_t **jpeg,
+        size_t *jpeg_size,
+        ei_device_snapshot_resolutions_t *res)
+        {
+            // virtual. Provide an implementation if your camera outputs JPEG
+            return false;
+        }
+
+    /**
+     * @brief Give the frame returned by ei_camera_get_jpeg_frame() back to the driver
+     */
+    virtual void ei_camera_release_jpeg_frame(void)
+        {
+        }
+
     /**
      * @brief Get the min resolution supported by camera
      *
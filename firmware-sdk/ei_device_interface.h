@@ -48,6 +48,7 @@ void ei_write_string(char *data, int length);
 
 //TODO: move to a one header with all method requied by FW SDK
 char ei_getchar();
+int ei_read_string(char *data, int max_length);
 
 
 #endif /* EI_DEVICE_INTERFACE_H */
@@ -33,10 +33,13 @@
  */
 
 #include "at_base64_lib.h"
+#include "ei_binary_transfer.h"
 #include "ei_device_lib.h"
 #include "ei_device_info_lib.h"
 #include "ei_device_memory.h"
 #include "ei_device_interface.h"
+#include "ei_sample_codec.h"
+#include <algorithm>
 
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/classifier/ei_signal_with_axes.h"
@@ -46,6 +49,11 @@ extern "C" EI_IMPULSE_ERROR run_classifier(
     ei_impulse_result_t *result,
     bool debug = false);
 
+/** Characters taken from the serial port per read in run_impulse_static_data */
+#ifndef RUN_IMPULSE_STATIC_READ_BUF_LEN
+#define RUN_IMPULSE_STATIC_READ_BUF_LEN 256
+#endif
+
 float *features;
 extern char* ei_classifier_inferencing_categories[];
 
@@ -65,9 +73,66 @@ __attribute__((weak)) bool ei_user_invoke_stop_lib(void)
     }
 }
 
+static bool read_sample_chunk(void *ctx, size_t offset, uint8_t *buffer, size_t length)
+{
+    EiDeviceMemory *memory = EiDeviceInfo::get_device()->get_memory();
+    size_t address = *(const size_t *)ctx + offset;
+
+    return memory->read_sample_data(buffer, address, length) == length;
+}
+
+/**
+ * @brief Open a sample stored with ei_sample_codec.h, the caller frees the reader
+ *
+ * @param address address of the sample, as given by the sampler
+ * @return nullptr if the sample is stored raw
+ */
+static ei_sample_reader_t *open_packed_sample(size_t *address)
+{
+    ei_sample_reader_t *reader = (ei_sample_reader_t *)ei_malloc(sizeof(ei_sample_reader_t));
+
+    if (reader != nullptr && !ei_sample_reader_open(reader, read_sample_chunk, address)) {
+        ei_free(reader);
+        reader = nullptr;
+    }
+
+    return reader;
+}
+
+__attribute__((weak)) size_t ei_get_sample_start(size_t address)
+{
+    return address;
+}
+
+/**
+ * @brief Offsets into a packed sample count in decoded bytes, which do not
+ * map to addresses in flash. Reports an error for reads that do not start
+ * at the beginning of a packed sample.
+ *
+ * @return true if the read has to be rejected
+ */
+static bool is_packed_offset_read(size_t address)
+{
+    size_t start = ei_get_sample_start(address);
+    if (start == address) {
+        return false;
+    }
+
+    ei_sample_reader_t *packed = open_packed_sample(&start);
+    if (packed == nullptr) {
+        return false;
+    }
+    ei_free(packed);
+
+    ei_printf("ERR: Packed sample, read it from its start (%u)\r\n", (unsigned)start);
+    return true;
+}
+
 /**
  * @brief Helper function for sending a data from memory over the
- * serial port. Data are encoded into base64 on the fly.
+ * serial port. Data are encoded into base64 on the fly. Samples
+ * stored with ei_sample_codec.h are decoded, they are only read
+ * from their start.
  *
  * @param address address of samples
  * @param length number of samples (bytes)
@@ -76,107 +141,214 @@ __attribute__((weak)) bool ei_user_invoke_stop_lib(void)
  */
 __attribute__((weak)) bool read_encode_send_sample_buffer(size_t address, size_t length)
 {
+    if (is_packed_offset_read(address)) {
+        return false;
+    }
+
     EiDeviceInfo *dev = EiDeviceInfo::get_device();
     EiDeviceMemory *memory = dev->get_memory();
     // we are encoiding data into base64, so it needs to be divisible by 3
-    const int buffer_size = 513;
-    uint8_t* buffer = (uint8_t*)ei_malloc(buffer_size);
-
-    while (1) {
-        size_t bytes_to_read = buffer_size;
+    const size_t buffer_size = 1536;
+    const size_t encoded_size = BASE64_ENCODE_BLOCK_SIZE(buffer_size);
+    uint8_t *buffer = (uint8_t*)ei_malloc(buffer_size);
+    char *encoded = (char*)ei_malloc(encoded_size);
+    ei_sample_reader_t *packed = open_packed_sample(&address);
+    base64_encoder_t encoder;
+    bool success = true;
+    size_t offset = 0;
+
+    if (buffer == nullptr || encoded == nullptr) {
+        ei_free(buffer);
+        ei_free(encoded);
+        ei_free(packed);
+        return false;
+    }
 
-        if (bytes_to_read > length) {
-            bytes_to_read = length;
+    auto read_chunk = [&](size_t bytes) {
+        if (packed != nullptr) {
+            return ei_sample_reader_read(packed, offset, buffer, bytes) == bytes;
         }
+        return memory->read_sample_data(buffer, address + offset, bytes) == bytes;
+    };
+
+    base64_encoder_init(&encoder);
+
+    size_t bytes_read = std::min(buffer_size, length);
+    if (!read_chunk(bytes_read)) {
+        bytes_read = 0;
+        success = false;
+    }
+
+    while (bytes_read > 0) {
+        int output_size = base64_encode_block(&encoder, buffer, bytes_read, encoded, encoded_size);
+
+        offset += bytes_read;
+        length -= bytes_read;
+
+        // hand the whole block to the serial port and read the next chunk
+        // while the UART is still shifting out the tail of this one
+        ei_write_string(encoded, output_size);
 
-        if (bytes_to_read == 0) {
-            ei_free(buffer);
-            return true;
+        bytes_read = std::min(buffer_size, length);
+        if (bytes_read > 0 && !read_chunk(bytes_read)) {
+            success = false;
+            break;
         }
+    }
+
+    if (success) {
+        int output_size = base64_encode_block_finish(&encoder, encoded);
+        ei_write_string(encoded, output_size);
+    }
+
+    ei_free(buffer);
+    ei_free(encoded);
+    ei_free(packed);
+
+    return success;
+}
 
-        if (memory->read_sample_data(buffer, address, bytes_to_read) != bytes_to_read) {
-            ei_free(buffer);
+/**
+ * @brief Helper function for sending a data from memory over the
+ * serial port as binary frames, see ei_binary_transfer.h. Samples
+ * stored with ei_sample_codec.h are sent as stored, for the host
+ * to decode.
+ *
+ * @param address address of samples
+ * @param length number of samples (bytes)
+ * @return true if the host received everything
+ * @return false on read error or if the host aborted the transfer
+ */
+__attribute__((weak)) bool read_send_sample_buffer_binary(size_t address, size_t length)
+{
+    if (is_packed_offset_read(address)) {
+        return false;
+    }
+
+    ei_sample_reader_t *packed = open_packed_sample(&address);
+
+    if (packed != nullptr) {
+        size_t packed_length = ei_sample_reader_encoded_size(packed, length);
+        ei_free(packed);
+        if (packed_length == 0) {
             return false;
         }
+        return ei_binary_transfer_send(EI_BINARY_CONTENT_SAMPLE_PACKED, packed_length, read_sample_chunk, &address);
+    }
 
-        base64_encode((char *)buffer, bytes_to_read, ei_putchar);
+    return ei_binary_transfer_send(EI_BINARY_CONTENT_SAMPLE, length, read_sample_chunk, &address);
+}
+
+/**
+ * @brief      Read the characters already received on the serial port,
+ *             ports with a bulk read from the UART should override this
+ *
+ * @return     number of characters read
+ */
+__attribute__((weak)) int ei_read_string(char *data, int max_length)
+{
+    int length = 0;
+    char ch;
 
-        address += bytes_to_read;
-        length -= bytes_to_read;
+    while (length < max_length && (ch = ei_getchar()) != 0) {
+        data[length++] = ch;
     }
 
-    return true;
+    return length;
 }
 
+/**
+ * @brief      Receive base64 encoded features and run the impulse on them.
+ *             The host sends buf_len characters and waits for "OK <count>"
+ *             before the next chunk; characters are decoded as they arrive,
+ *             straight into the feature buffer.
+ *
+ * @param[in]  debug    run the classifier in debug mode
+ * @param[in]  length   number of features (floats)
+ * @param[in]  buf_len  chunk size in characters
+ *
+ * @return     false on timeout or malformed input
+ */
 bool run_impulse_static_data(bool debug, size_t length, size_t buf_len)
 {
-    size_t cur_pos = 0;
-    uint32_t buf_pos = 0;
-    uint64_t start_time = 0;
-
-    static float *data_pt = NULL;
-    static uint8_t *temp_buf = NULL;
+    char read_buf[RUN_IMPULSE_STATIC_READ_BUF_LEN];
+    base64_decoder_t decoder;
+    size_t decoded_size = 0;
+    size_t received_size = 0;
+    uint64_t decode_time_us = 0;
 
     if(buf_len < 6) {
         ei_printf("ERR: Minimum buffer length should be 6\r\n");
         return false;
     }
 
-    data_pt = (float*)ei_malloc(length*sizeof(float));
+    float *data_pt = (float*)ei_malloc(length*sizeof(float));
     if (data_pt == NULL) {
         ei_printf("ERR: Memory allocation for data buffer failed\r\n");
         return false;
     }
 
-    temp_buf = (uint8_t*)ei_calloc(buf_len + 1, sizeof(uint8_t));
-    if (temp_buf == NULL) {
-        ei_printf("ERR: Memory allocation for serial read buffer failed\r\n");
-        ei_free(data_pt);
-        data_pt = NULL;
-        return false;
-    }
+    base64_decoder_init(&decoder);
 
     ei_printf("OK CHUNK=%d\r\n", (int)buf_len);
 
-    while (cur_pos < length) {
+    const size_t data_size = length * sizeof(float);
+    const uint64_t transfer_start = ei_read_timer_ms();
+
+    while (decoded_size < data_size) {
+        size_t chunk_pos = 0;
+        uint64_t last_rx_time = ei_read_timer_ms();
+
+        while (chunk_pos < buf_len) {
+            int read_size = ei_read_string(read_buf, std::min(buf_len - chunk_pos, sizeof(read_buf)));
 
-        start_time = ei_read_timer_ms();
-        while (buf_pos < buf_len) {
-            if (ei_read_timer_ms() - start_time > 100) {
-                ei_printf("TIMEOUT\r\n");
+            if (read_size <= 0) {
+                if (ei_read_timer_ms() - last_rx_time > 100) {
+                    ei_printf("TIMEOUT\r\n");
+                    ei_free(data_pt);
+                    ei_printf("END OUTPUT\r\n");
+                    return false;
+                }
+                continue;
+            }
+            last_rx_time = ei_read_timer_ms();
+
+            uint64_t decode_start = ei_read_timer_us();
+            int out_size = base64_decode_block(
+                &decoder,
+                read_buf,
+                read_size,
+                (uint8_t*)data_pt + decoded_size,
+                data_size - decoded_size);
+            decode_time_us += ei_read_timer_us() - decode_start;
+
+            if (out_size < 0) {
+                ei_printf("ERR: Invalid base64 input\r\n");
                 ei_free(data_pt);
-                ei_free(temp_buf);
-                data_pt = NULL;
-                temp_buf = NULL;
                 ei_printf("END OUTPUT\r\n");
                 return false;
             }
-            uint8_t rec = ei_getchar();
-            if (rec != 0) {
-                temp_buf[buf_pos++] = rec;
-            }
+            decoded_size += out_size;
+            chunk_pos += read_size;
         }
 
-        std::vector<unsigned char> decoded = base64_decode((const char*)temp_buf);
-
-        int copylength = decoded.size() > (length - cur_pos) * sizeof(float)
-                       ? (length - cur_pos) * sizeof(float)
-                       : decoded.size();
-
-        memcpy((void*)(data_pt + cur_pos), decoded.data(), copylength);
-
-        cur_pos = cur_pos + copylength/sizeof(float);
-        buf_pos = 0;
-        ei_printf("OK %d \r\n", (int)cur_pos);
+        received_size += chunk_pos;
+        ei_printf("OK %d \r\n", (int)(decoded_size / sizeof(float)));
     }
 
+    uint32_t transfer_ms = (uint32_t)(ei_read_timer_ms() - transfer_start);
+    size_t cur_pos = decoded_size / sizeof(float);
+
     ei_printf("TRANSFER COMPLETED %d\r\n", (int)cur_pos);
+    ei_printf("TRANSFER STATS %u chars in %u ms (%u B/s), decode %u us (%u kB/s)\r\n",
+        (unsigned)received_size,
+        (unsigned)transfer_ms,
+        (unsigned)(transfer_ms ? (uint64_t)received_size * 1000 / transfer_ms : 0),
+        (unsigned)decode_time_us,
+        (unsigned)(decode_time_us ? (uint64_t)received_size * 1000 / decode_time_us : 0));
+
     uint32_t res = (uint32_t)ei_start_impulse_static_data(debug, data_pt, cur_pos);
-    cur_pos = 0;
     ei_free(data_pt);
-    ei_free(temp_buf);
-    data_pt = NULL;
-    temp_buf = NULL;
     ei_printf("RESULT %d\r\n", res);
     ei_printf("END OUTPUT\r\n");
 
@@ -47,6 +47,16 @@
  */
 bool ei_user_invoke_stop_lib(void);
 
+/**
+ * @brief Start of the stored sample that holds an address, ports with a
+ * sample index override this. Samples packed with ei_sample_codec.h can
+ * only be read from their start.
+ *
+ * @param address address in the sample area
+ * @return start address of the sample, address itself if unknown
+ */
+size_t ei_get_sample_start(size_t address);
+
 /**
  * @brief Helper function for sending a data from memory over the
  * serial port. Data are encoded into base64 on the fly.
@@ -58,6 +68,17 @@ bool ei_user_invoke_stop_lib(void);
  */
 bool read_encode_send_sample_buffer(size_t address, size_t length);
 
+/**
+ * @brief Helper function for sending a data from memory over the
+ * serial port as binary frames, see ei_binary_transfer.h
+ *
+ * @param address address of samples
+ * @param length number of samples (bytes)
+ * @return true if the host received everything
+ * @return false on read error or if the host aborted the transfer
+ */
+bool read_send_sample_buffer_binary(size_t address, size_t length);
+
 bool run_impulse_static_data(bool debug, size_t length, size_t buf_len);
 
 EI_IMPULSE_ERROR ei_start_impulse_static_data(bool debug, float* data, size_t size);
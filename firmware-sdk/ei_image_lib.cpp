@@ -44,13 +44,16 @@
 #endif
 
 #include <memory>
+#include <new>
 
 #include "edge-impulse-sdk/dsp/ei_utils.h"
 #include "edge-impulse-sdk/dsp/image/image.hpp"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "firmware-sdk/at_base64_lib.h"
+#include "firmware-sdk/ei_binary_transfer.h"
 #include "firmware-sdk/ei_device_interface.h"
 #include "firmware-sdk/ei_image_lib.h"
+#include "firmware-sdk/jpeg/encode_as_jpg.h"
 
 // *********************************** AT cmd functions ***************
 
@@ -75,7 +78,91 @@ static void change_to_normal_baud()
     ei_sleep(100);
 }
 
-static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size_t height)
+/* snapshot handed to the JPEG encoder, packed RGB888 or grayscale */
+static const uint8_t *jpeg_source = nullptr;
+static int jpeg_source_pixel_size = ei::image::processing::RGB888_B_SIZE;
+
+static int jpeg_source_get_data(size_t offset, size_t length, float *out_ptr)
+{
+    const uint8_t *pixel = &jpeg_source[offset * jpeg_source_pixel_size];
+
+    for (size_t ix = 0; ix < length; ix++, pixel += jpeg_source_pixel_size) {
+        out_ptr[ix] = (jpeg_source_pixel_size == ei::image::processing::RGB888_B_SIZE)
+            ? (float)((pixel[0] << 16) + (pixel[1] << 8) + pixel[2])
+            : (float)pixel[0];
+    }
+
+    return 0;
+}
+
+static bool output_snapshot(const uint8_t *data, size_t size, bool use_binary, ei_binary_content_t content)
+{
+    if (use_binary) {
+        return ei_binary_transfer_send_buffer(content, data, size);
+    }
+
+    base64_encode(reinterpret_cast<const char *>(data), size, ei_putchar);
+
+    return true;
+}
+
+/**
+ * @brief Encode the snapshot as JPEG and send it
+ */
+static bool output_snapshot_as_jpeg(
+    const uint8_t *image,
+    uint16_t width,
+    uint16_t height,
+    int pixel_size_B,
+    bool use_binary,
+    int jpeg_quality)
+{
+    using namespace ei::image::processing;
+
+    ei::signal_t signal;
+    signal.total_length = width * height;
+    signal.get_data = &jpeg_source_get_data;
+
+    jpeg_source = image;
+    jpeg_source_pixel_size = pixel_size_B;
+
+    int rc;
+    if (!use_binary) {
+        // straight from the encoder into base64, no output buffer needed
+        rc = (pixel_size_B == RGB888_B_SIZE)
+            ? encode_rgb888_signal_as_jpg_and_output_base64(&signal, width, height, jpeg_quality)
+            : encode_bw_signal_as_jpg_and_output_base64(&signal, width, height, jpeg_quality);
+        if (rc != 0) {
+            ei_printf("ERR: Failed to encode frame as JPEG (%d)\n", rc);
+        }
+        return rc == 0;
+    }
+
+    // the START frame carries the length, so the JPEG has to be complete first
+    size_t out_buffer_size = width * height * pixel_size_B + 1024;
+    std::unique_ptr<uint8_t[]> out_buffer(new (std::nothrow) uint8_t[out_buffer_size]);
+    if (!out_buffer) {
+        ei_printf("ERR: Cannot allocate memory for JPEG\n");
+        return false;
+    }
+
+    size_t out_size = 0;
+    rc = (pixel_size_B == RGB888_B_SIZE)
+        ? encode_rgb888_signal_as_jpg(&signal, width, height, out_buffer.get(), out_buffer_size, &out_size, jpeg_quality)
+        : encode_bw_signal_as_jpg(&signal, width, height, out_buffer.get(), out_buffer_size, &out_size, jpeg_quality);
+    if (rc != 0) {
+        ei_printf("ERR: Failed to encode frame as JPEG (%d)\n", rc);
+        return false;
+    }
+
+    return output_snapshot(out_buffer.get(), out_size, true, EI_BINARY_CONTENT_SNAPSHOT_JPEG);
+}
+
+static bool ei_camera_take_snapshot_encode_and_output_no_init(
+    size_t width,
+    size_t height,
+    bool use_binary,
+    int jpeg_quality = EI_SNAPSHOT_FORMAT_RAW)
 {
     using namespace ei::image::processing;
 
@@ -103,6 +190,23 @@ static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size
         height = fb_resoluton.height;
     }
 
+    // the sensor already produced a JPEG of the requested size, forward it as is
+    if (jpeg_quality != EI_SNAPSHOT_FORMAT_RAW && !needs_a_resize) {
+        const uint8_t *jpeg;
+        size_t jpeg_size;
+        ei_device_snapshot_resolutions_t jpeg_res;
+
+        if (camera->ei_camera_get_jpeg_frame(&jpeg, &jpeg_size, &jpeg_res)) {
+            if (jpeg_res.width == width && jpeg_res.height == height) {
+                bool isOK = output_snapshot(jpeg, jpeg_size, use_binary, EI_BINARY_CONTENT_SNAPSHOT_JPEG);
+                camera->ei_camera_release_jpeg_frame();
+                return isOK;
+            }
+            // sensor not in the mode we asked for, take the re-encode path
+            camera->ei_camera_release_jpeg_frame();
+        }
+    }
+
     uint32_t size = width * height * pixel_size_B;
 
 #if ALLIGNED_BUFFER
@@ -118,8 +222,10 @@ static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size
     // if the camera driver does not make it possible
     // then create our own second framebuffer
     uint8_t* image = nullptr;
+    // owns the buffer until the snapshot is sent
+    std::unique_ptr<uint8_t[]> image_p;
     if (!camera->get_fb_ptr(&image)) {
-        std::unique_ptr<uint8_t[]> image_p(new uint8_t[size]);
+        image_p.reset(new (std::nothrow) uint8_t[size]);
         if (!image_p) {
             ei_printf("ERR: Cannot allocate memory for framebuffer\n");
             return false;
@@ -185,17 +291,16 @@ static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size
     }
 #endif
 
-    // recalculate size b/c now we want to send just the interpolated bytes
-    base64_encode(
-        reinterpret_cast<char *>(image),
-        final_height * final_width * pixel_size_B,
-        ei_putchar);
+    if (jpeg_quality != EI_SNAPSHOT_FORMAT_RAW) {
+        return output_snapshot_as_jpeg(image, final_width, final_height, pixel_size_B, use_binary, jpeg_quality);
+    }
 
-    return true;
+    // recalculate size b/c now we want to send just the interpolated bytes
+    return output_snapshot(image, final_height * final_width * pixel_size_B, use_binary, EI_BINARY_CONTENT_SNAPSHOT);
 }
 
 extern bool
-ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_max_baudrate)
+ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_max_baudrate, bool use_binary)
 {
     auto camera = EiCamera::get_camera();
 
@@ -208,6 +313,9 @@ ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_m
         return false;
     }
 
+    // binary frames always go at the max baud rate
+    use_max_baudrate |= use_binary;
+
     if (use_max_baudrate) {
         respond_and_change_to_max_baud();
     }
@@ -215,7 +323,7 @@ ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_m
     // here we pass desired snapshot resolution
     // if it is different from camera sensor resolution
     // we will resize before sending out the image
-    bool isOK = ei_camera_take_snapshot_encode_and_output_no_init(width, height);
+    bool isOK = ei_camera_take_snapshot_encode_and_output_no_init(width, height, use_binary);
     camera->deinit();
 
     if (use_max_baudrate) {
@@ -228,7 +336,12 @@ ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_m
     return isOK;
 }
 
-extern bool ei_camera_start_snapshot_stream(size_t width, size_t height, bool use_max_baudrate)
+extern bool ei_camera_start_snapshot_stream(
+    size_t width,
+    size_t height,
+    bool use_max_baudrate,
+    bool use_binary,
+    int jpeg_quality)
 {
     bool isOK = true;
     ei_printf("Starting snapshot stream...\n");
@@ -239,12 +352,21 @@ extern bool ei_camera_start_snapshot_stream(size_t width, size_t height, bool us
         return false;
     }
 
+    use_max_baudrate |= use_binary;
+
     if (use_max_baudrate) {
         respond_and_change_to_max_baud();
     }
 
     while (!ei_user_invoke_stop_lib()) {
-        isOK &= ei_camera_take_snapshot_encode_and_output_no_init(width, height);
+        if (use_binary) {
+            // every snapshot is a transfer of its own, 'b' stops the stream in or between transfers
+            if (!ei_camera_take_snapshot_encode_and_output_no_init(width, height, true, jpeg_quality)) {
+                break;
+            }
+            continue;
+        }
+        isOK &= ei_camera_take_snapshot_encode_and_output_no_init(width, height, false, jpeg_quality);
         ei_printf("\r\n");
     }
     camera->deinit();
@@ -37,6 +37,14 @@
 
 #include "stdint.h"
 
+/** Snapshot stream sends raw pixels instead of JPEG */
+#define EI_SNAPSHOT_FORMAT_RAW              (-1)
+
+/** JPEG quality when the stream has to re-encode a resized frame, JPEG_Q_BEST (0) .. JPEG_Q_LOW (3) */
+#ifndef EI_SNAPSHOT_STREAM_JPEG_QUALITY
+#define EI_SNAPSHOT_STREAM_JPEG_QUALITY     1
+#endif
+
 // ********* Functions for AT commands
 
 /**
@@ -45,23 +53,35 @@
  * @param width Width in pixels
  * @param height Height in pixels
  * @param use_max_baudrate Use the fast baud rate for transfer
+ * @param use_binary Send binary frames instead of base64, see ei_binary_transfer.h
  * @return true If successful
  * @return false If failure
  */
-bool ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_max_baudrate);
+bool ei_camera_take_snapshot_output_on_serial(size_t width, size_t height, bool use_max_baudrate, bool use_binary = false);
 
 
 /**
  * @brief Use to output an image as base64, over and over.  Assign this to an AT command
  * Calls ei_camera_take_snapshot_encode_and_output() in a loop until a char is received on the UART
  *
+ * With a JPEG quality every frame is sent as JPEG: the sensor's own JPEG when it
+ * matches the requested resolution, otherwise the resized frame re-encoded at
+ * that quality.
+ *
  * @param width Width in pixels
  * @param height Height in pixels
  * @param use_max_baudrate Use the fast baud rate for transfer
+ * @param use_binary Send binary frames instead of base64, see ei_binary_transfer.h
+ * @param jpeg_quality EI_SNAPSHOT_FORMAT_RAW or JPEG_Q_BEST (0) .. JPEG_Q_LOW (3)
  * @return true If successful
  * @return false If failure
  */
-bool ei_camera_start_snapshot_stream(size_t width, size_t height, bool use_max_baudrate);
+bool ei_camera_start_snapshot_stream(
+    size_t width,
+    size_t height,
+    bool use_max_baudrate,
+    bool use_binary = false,
+    int jpeg_quality = EI_SNAPSHOT_FORMAT_RAW);
 
 
 
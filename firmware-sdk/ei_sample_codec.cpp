@@ -0,0 +1,497 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_sample_codec.h"
+
+#include <cstring>
+
+/* Constants --------------------------------------------------------------- */
+#define MAX_RICE_K          15
+#define MAX_SHIFT           3
+#define MAX_BLOCK_SIZE      (EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE + EI_SAMPLE_CODEC_BLOCK_SAMPLES * 2)
+
+/* Private functions ------------------------------------------------------- */
+
+typedef struct {
+    uint8_t *output;
+    size_t pos;
+    uint32_t acc;
+    uint32_t bits;
+} bit_writer_t;
+
+typedef struct {
+    const uint8_t *input;
+    size_t size;
+    size_t pos;
+    uint64_t acc;
+    uint32_t bits;
+} bit_reader_t;
+
+static inline void put_bits(bit_writer_t *w, uint32_t value, uint32_t n_bits)
+{
+    w->acc |= value << w->bits;
+    w->bits += n_bits;
+    while (w->bits >= 8) {
+        w->output[w->pos++] = (uint8_t)w->acc;
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+}
+
+static inline void flush_bits(bit_writer_t *w)
+{
+    if (w->bits > 0) {
+        w->output[w->pos++] = (uint8_t)w->acc;
+    }
+}
+
+static inline void refill(bit_reader_t *r)
+{
+    while (r->bits <= 48 && r->pos < r->size) {
+        r->acc |= (uint64_t)r->input[r->pos++] << r->bits;
+        r->bits += 8;
+    }
+}
+
+static inline uint32_t bit_width(uint32_t value)
+{
+    return value ? 32 - __builtin_clz(value) : 0;
+}
+
+static inline void put_u16(uint8_t *output, uint16_t value)
+{
+    output[0] = (uint8_t)value;
+    output[1] = (uint8_t)(value >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t *input)
+{
+    return (uint16_t)(input[0] | (input[1] << 8));
+}
+
+/**
+ * @brief Encode one block, four passes over the samples at most: deltas,
+ * their statistics, the Rice cost around the mean and the packing
+ *
+ * @return size of the encoded block
+ */
+static size_t encode_block(const int16_t *samples, size_t n_samples, size_t channels, uint8_t *output)
+{
+    uint16_t zigzag[EI_SAMPLE_CODEC_BLOCK_SAMPLES];
+    const size_t n_deltas = n_samples - 1;
+    uint32_t delta_bits = 0;
+    uint32_t all_bits = 0;
+    uint32_t sum = 0;
+
+    // wraps modulo 2^16, the decoder wraps the same way
+    for (size_t ix = 1; ix < n_samples; ix++) {
+        size_t ref = ix >= channels ? ix - channels : ix - 1;
+        zigzag[ix - 1] = (uint16_t)samples[ix] - (uint16_t)samples[ref];
+        delta_bits |= zigzag[ix - 1];
+    }
+
+    uint32_t shift = delta_bits ? __builtin_ctz(delta_bits) : 0;
+    if (shift > MAX_SHIFT) {
+        shift = MAX_SHIFT;
+    }
+
+    for (size_t ix = 0; ix < n_deltas; ix++) {
+        int16_t delta = (int16_t)zigzag[ix] >> shift;
+        uint16_t z = (uint16_t)(((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15));
+        zigzag[ix] = z;
+        all_bits |= z;
+        sum += z;
+    }
+
+    uint32_t width = bit_width(all_bits);
+    uint32_t best_cost = n_deltas * width;
+    uint8_t mode = (uint8_t)width;
+
+    if (n_deltas > 0 && width > 1) {
+        // optimal Rice parameter is close to log2 of the mean, try its neighbours too
+        uint32_t k_mid = bit_width(sum / n_deltas);
+        uint32_t k_lo = k_mid > 0 ? k_mid - 1 : 0;
+        uint32_t quotients[3] = { 0, 0, 0 };
+
+        for (size_t ix = 0; ix < n_deltas; ix++) {
+            quotients[0] += zigzag[ix] >> k_lo;
+            quotients[1] += zigzag[ix] >> (k_lo + 1);
+            quotients[2] += zigzag[ix] >> (k_lo + 2);
+        }
+        for (uint32_t ix = 0; ix < 3; ix++) {
+            uint32_t k = k_lo + ix;
+            uint32_t cost = quotients[ix] + n_deltas * (k + 1);
+            if (k <= MAX_RICE_K && cost < best_cost) {
+                best_cost = cost;
+                mode = EI_SAMPLE_CODEC_MODE_RICE | k;
+            }
+        }
+    }
+
+    bit_writer_t w = { output + EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE, 0, 0, 0 };
+
+    if (mode & EI_SAMPLE_CODEC_MODE_RICE) {
+        uint32_t k = mode & EI_SAMPLE_CODEC_MODE_BITS_MASK;
+        uint32_t low_mask = (1u << k) - 1;
+        for (size_t ix = 0; ix < n_deltas; ix++) {
+            uint32_t q = zigzag[ix] >> k;
+            while (q >= 16) {
+                put_bits(&w, 0xFFFF, 16);
+                q -= 16;
+            }
+            // q ones and the terminating zero
+            put_bits(&w, (1u << q) - 1, q + 1);
+            put_bits(&w, zigzag[ix] & low_mask, k);
+        }
+    }
+    else if (width > 0) {
+        for (size_t ix = 0; ix < n_deltas; ix++) {
+            put_bits(&w, zigzag[ix], width);
+        }
+    }
+    flush_bits(&w);
+
+    output[0] = mode | (uint8_t)(shift << EI_SAMPLE_CODEC_MODE_SHIFT_POS);
+    output[1] = (uint8_t)(n_samples - 1);
+    put_u16(&output[2], (uint16_t)samples[0]);
+    put_u16(&output[4], (uint16_t)w.pos);
+
+    return EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE + w.pos;
+}
+
+static bool valid_block_header(const uint8_t *header)
+{
+    uint8_t bits = header[0] & EI_SAMPLE_CODEC_MODE_BITS_MASK;
+    bool valid_mode = (header[0] & EI_SAMPLE_CODEC_MODE_RICE) ? bits <= MAX_RICE_K : bits <= 16;
+
+    return valid_mode
+        && header[1] + 1u <= (unsigned)EI_SAMPLE_CODEC_BLOCK_SAMPLES
+        && get_u16(&header[4]) <= EI_SAMPLE_CODEC_BLOCK_SAMPLES * 2;
+}
+
+/**
+ * @brief Move the reader to the block holding decoded offset, only the block
+ * headers are read on the way
+ */
+static bool seek_block(ei_sample_reader_t *reader, uint32_t offset)
+{
+    uint8_t header[EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE];
+
+    if (offset < reader->block_start) {
+        reader->block_offset = EI_SAMPLE_CODEC_HEADER_SIZE + reader->raw_length;
+        reader->block_start = reader->raw_length;
+        reader->block_count = 0;
+    }
+
+    while (true) {
+        if (reader->block_count == 0) {
+            if (!reader->read(reader->ctx, reader->block_offset, header, sizeof(header))
+                || !valid_block_header(header)) {
+                return false;
+            }
+            reader->block_count = header[1] + 1;
+            reader->block_size = EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE + get_u16(&header[4]);
+            reader->decoded = false;
+        }
+        if (offset < reader->block_start + reader->block_count * sizeof(int16_t)) {
+            return true;
+        }
+        reader->block_offset += reader->block_size;
+        reader->block_start += reader->block_count * sizeof(int16_t);
+        reader->block_count = 0;
+    }
+}
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Write the container header, the raw bytes follow it
+ *
+ * @return EI_SAMPLE_CODEC_HEADER_SIZE
+ */
+size_t ei_sample_encode_header(uint8_t *output, uint16_t raw_length, uint8_t channels)
+{
+    uint32_t magic = EI_SAMPLE_CODEC_MAGIC;
+
+    for (size_t ix = 0; ix < 4; ix++) {
+        output[ix] = (uint8_t)(magic >> (8 * ix));
+    }
+    put_u16(&output[4], raw_length);
+    output[6] = EI_SAMPLE_CODEC_BLOCK_SAMPLES - 1;
+    output[7] = channels;
+
+    return EI_SAMPLE_CODEC_HEADER_SIZE;
+}
+
+/**
+ * @param channels interleaved channels (axes) of the samples, 1 for audio
+ */
+void ei_sample_encoder_init(ei_sample_encoder_t *encoder, uint8_t channels)
+{
+    encoder->count = 0;
+    encoder->channels = channels > 0 ? channels : 1;
+}
+
+/**
+ * @brief Encode the full blocks among the buffered and the new samples, the
+ * rest is buffered until the next call or ei_sample_encode_finish
+ *
+ * @param output_size at least EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(n_samples)
+ * @return bytes written to output, -1 if output is too small
+ */
+int ei_sample_encode(ei_sample_encoder_t *encoder, const int16_t *input, size_t n_samples, uint8_t *output, size_t output_size)
+{
+    size_t output_pos = 0;
+
+    while (n_samples > 0) {
+        const int16_t *block = input;
+        size_t taken = EI_SAMPLE_CODEC_BLOCK_SAMPLES;
+
+        if (encoder->count > 0 || n_samples < EI_SAMPLE_CODEC_BLOCK_SAMPLES) {
+            taken = EI_SAMPLE_CODEC_BLOCK_SAMPLES - encoder->count;
+            if (taken > n_samples) {
+                taken = n_samples;
+            }
+            memcpy(&encoder->block[encoder->count], input, taken * sizeof(int16_t));
+            encoder->count += taken;
+            if (encoder->count < EI_SAMPLE_CODEC_BLOCK_SAMPLES) {
+                break;
+            }
+            block = encoder->block;
+        }
+
+        if (output_size - output_pos < MAX_BLOCK_SIZE) {
+            return -1;
+        }
+        output_pos += encode_block(block, EI_SAMPLE_CODEC_BLOCK_SAMPLES, encoder->channels, &output[output_pos]);
+        encoder->count = 0;
+        input += taken;
+        n_samples -= taken;
+    }
+
+    return output_pos;
+}
+
+/**
+ * @brief Encode the buffered samples as a last, shorter block
+ *
+ * @return bytes written to output, -1 if output is too small
+ */
+int ei_sample_encode_finish(ei_sample_encoder_t *encoder, uint8_t *output, size_t output_size)
+{
+    if (encoder->count == 0) {
+        return 0;
+    }
+    if (output_size < MAX_BLOCK_SIZE) {
+        return -1;
+    }
+
+    size_t size = encode_block(encoder->block, encoder->count, encoder->channels, output);
+    encoder->count = 0;
+
+    return size;
+}
+
+/**
+ * @brief Decode one block
+ *
+ * @param output room for EI_SAMPLE_CODEC_BLOCK_SAMPLES samples
+ * @param n_samples samples decoded
+ * @return bytes of input used, -1 if the block is malformed or truncated
+ */
+int ei_sample_decode_block(const uint8_t *input, size_t input_size, uint8_t channels, int16_t *output, size_t *n_samples)
+{
+    if (input_size < EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE || !valid_block_header(input) || channels == 0) {
+        return -1;
+    }
+
+    const bool rice = input[0] & EI_SAMPLE_CODEC_MODE_RICE;
+    const uint32_t bits = input[0] & EI_SAMPLE_CODEC_MODE_BITS_MASK;
+    const uint32_t shift = (input[0] & ~EI_SAMPLE_CODEC_MODE_RICE) >> EI_SAMPLE_CODEC_MODE_SHIFT_POS;
+    const size_t count = input[1] + 1;
+    const size_t payload_size = get_u16(&input[4]);
+
+    if (input_size - EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE < payload_size) {
+        return -1;
+    }
+
+    bit_reader_t r = { input + EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE, payload_size, 0, 0, 0 };
+    output[0] = (int16_t)get_u16(&input[2]);
+    for (size_t ix = 1; ix < count; ix++) {
+        uint32_t z;
+
+        if (rice) {
+            const uint32_t k = bits;
+            uint32_t q = 0;
+            while (true) {
+                refill(&r);
+                if (r.bits == 0) {
+                    return -1;
+                }
+                uint64_t zeros = ~r.acc;
+                uint32_t ones = zeros ? __builtin_ctzll(zeros) : 64;
+                if (ones < r.bits) {
+                    q += ones;
+                    r.acc >>= ones + 1;
+                    r.bits -= ones + 1;
+                    break;
+                }
+                q += r.bits;
+                r.acc = 0;
+                r.bits = 0;
+            }
+            refill(&r);
+            if (r.bits < k || (q << k) > 0xFFFF) {
+                return -1;
+            }
+            z = (q << k) | (r.acc & ((1u << k) - 1));
+            r.acc >>= k;
+            r.bits -= k;
+        }
+        else {
+            refill(&r);
+            if (r.bits < bits) {
+                return -1;
+            }
+            z = r.acc & ((1u << bits) - 1);
+            r.acc >>= bits;
+            r.bits -= bits;
+        }
+
+        size_t ref = ix >= channels ? ix - channels : ix - 1;
+        output[ix] = (int16_t)(uint16_t)((uint16_t)output[ref] + (((z >> 1) ^ (0u - (z & 1))) << shift));
+    }
+
+    *n_samples = count;
+
+    return EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE + payload_size;
+}
+
+/**
+ * @brief Check the container header
+ *
+ * @param read Reads the container, eg. from the sample memory
+ * @return false if there is no container
+ */
+bool ei_sample_reader_open(ei_sample_reader_t *reader, ei_sample_codec_read_t read, void *ctx)
+{
+    uint8_t header[EI_SAMPLE_CODEC_HEADER_SIZE];
+
+    if (!read(ctx, 0, header, sizeof(header))) {
+        return false;
+    }
+
+    uint32_t magic = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+    if (magic != EI_SAMPLE_CODEC_MAGIC || header[6] + 1u > (unsigned)EI_SAMPLE_CODEC_BLOCK_SAMPLES || header[7] == 0) {
+        return false;
+    }
+
+    reader->read = read;
+    reader->ctx = ctx;
+    reader->raw_length = get_u16(&header[4]);
+    reader->channels = header[7];
+    reader->block_offset = EI_SAMPLE_CODEC_HEADER_SIZE + reader->raw_length;
+    reader->block_start = reader->raw_length;
+    reader->block_count = 0;
+    reader->block_size = 0;
+    reader->decoded = false;
+
+    return true;
+}
+
+/**
+ * @brief Read decoded bytes, the raw bytes and the samples as they were before encoding
+ *
+ * @return bytes read, less than length at the end of the data or on a read error
+ */
+uint32_t ei_sample_reader_read(ei_sample_reader_t *reader, uint32_t offset, uint8_t *data, uint32_t length)
+{
+    uint32_t done = 0;
+
+    if (offset < reader->raw_length) {
+        uint32_t n = reader->raw_length - offset;
+        if (n > length) {
+            n = length;
+        }
+        if (!reader->read(reader->ctx, EI_SAMPLE_CODEC_HEADER_SIZE + offset, data, n)) {
+            return 0;
+        }
+        done = n;
+    }
+
+    while (done < length) {
+        if (!seek_block(reader, offset + done)) {
+            break;
+        }
+
+        if (!reader->decoded) {
+            uint8_t encoded[MAX_BLOCK_SIZE];
+            size_t n_samples;
+            if (!reader->read(reader->ctx, reader->block_offset, encoded, reader->block_size)
+                || ei_sample_decode_block(encoded, reader->block_size, reader->channels, reader->block, &n_samples) < 0) {
+                reader->block_count = 0;
+                break;
+            }
+            reader->decoded = true;
+        }
+
+        uint32_t block_pos = offset + done - reader->block_start;
+        uint32_t n = reader->block_count * sizeof(int16_t) - block_pos;
+        if (n > length - done) {
+            n = length - done;
+        }
+        memcpy(&data[done], (const uint8_t *)reader->block + block_pos, n);
+        done += n;
+    }
+
+    return done;
+}
+
+/**
+ * @brief Size of the container holding the first length decoded bytes
+ *
+ * @return 0 if the container is shorter
+ */
+uint32_t ei_sample_reader_encoded_size(ei_sample_reader_t *reader, uint32_t length)
+{
+    if (length <= reader->raw_length) {
+        return EI_SAMPLE_CODEC_HEADER_SIZE + length;
+    }
+    if (!seek_block(reader, length - 1)) {
+        return 0;
+    }
+
+    return reader->block_offset + reader->block_size;
+}
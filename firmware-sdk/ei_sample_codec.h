@@ -0,0 +1,124 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_SAMPLE_CODEC_H
+#define EI_SAMPLE_CODEC_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Lossless codec for int16 sample streams (audio, raw IMU), block-wise so the
+ * encoder costs a fixed number of passes over each block in the sampling path.
+ *
+ * A sample encoded for flash is a container, readable as the original bytes:
+ *
+ *   | "EIZ1" | u16 raw length | u8 block samples - 1 | u8 channels | raw bytes | block | ...
+ *
+ * The raw bytes (eg. the CBOR header of the sample) are kept as they are, the
+ * int16 samples after them are stored as blocks:
+ *
+ *   | u8 mode | u8 samples - 1 | i16 first sample | u16 payload bytes | payload |
+ *
+ * The payload holds the first order deltas of the other samples, to the
+ * same channel of the previous frame for interleaved axes, zigzag mapped and either bit-packed with the smallest width (mode 0..16) or Rice
+ * coded (mode EI_SAMPLE_CODEC_MODE_RICE | k), whichever is shorter. Low bits
+ * that are zero in all deltas of the block, eg. after a gain of 8, are
+ * dropped, their count is in bits 5..6 of the mode. Deltas wrap modulo 2^16,
+ * a block is never longer than the raw samples plus its header. All fields
+ * are little endian.
+ */
+
+/* Constants --------------------------------------------------------------- */
+#ifndef EI_SAMPLE_CODEC_BLOCK_SAMPLES
+#define EI_SAMPLE_CODEC_BLOCK_SAMPLES       256
+#endif
+
+#define EI_SAMPLE_CODEC_MAGIC               0x315a4945  // "EIZ1"
+#define EI_SAMPLE_CODEC_HEADER_SIZE         8
+#define EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE   6
+#define EI_SAMPLE_CODEC_MODE_RICE           0x80
+#define EI_SAMPLE_CODEC_MODE_SHIFT_POS      5
+#define EI_SAMPLE_CODEC_MODE_BITS_MASK      0x1F
+
+/** Worst case output of ei_sample_encode for n_samples samples */
+#define EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(n_samples) \
+    ((((n_samples) + EI_SAMPLE_CODEC_BLOCK_SAMPLES - 1) / EI_SAMPLE_CODEC_BLOCK_SAMPLES + 1) \
+        * (EI_SAMPLE_CODEC_BLOCK_HEADER_SIZE + EI_SAMPLE_CODEC_BLOCK_SAMPLES * 2))
+
+static_assert(EI_SAMPLE_CODEC_BLOCK_SAMPLES >= 2 && EI_SAMPLE_CODEC_BLOCK_SAMPLES <= 256,
+    "block sample count is stored in a byte");
+
+/* Typedefs ---------------------------------------------------------------- */
+/** State of a streamed encoding, samples not forming a full block yet */
+typedef struct {
+    int16_t block[EI_SAMPLE_CODEC_BLOCK_SAMPLES];
+    uint16_t count;
+    uint8_t channels;
+} ei_sample_encoder_t;
+
+/**
+ * @brief Read from the encoded container
+ * @param ctx Context passed to ei_sample_reader_open
+ * @param offset Offset from the start of the container
+ */
+typedef bool (*ei_sample_codec_read_t)(void *ctx, size_t offset, uint8_t *data, size_t length);
+
+/** Random access to the decoded bytes of a container, cheapest when read in order */
+typedef struct {
+    ei_sample_codec_read_t read;
+    void *ctx;
+    uint16_t raw_length;
+    uint8_t channels;
+    uint32_t block_offset;      // container offset of the decoded block
+    uint32_t block_start;       // decoded offset of the decoded block
+    uint16_t block_count;       // samples in the decoded block, 0 if none
+    uint16_t block_size;        // encoded size of the decoded block
+    bool decoded;               // block holds its samples
+    int16_t block[EI_SAMPLE_CODEC_BLOCK_SAMPLES];
+} ei_sample_reader_t;
+
+/* Function prototypes ----------------------------------------------------- */
+size_t ei_sample_encode_header(uint8_t *output, uint16_t raw_length, uint8_t channels);
+void ei_sample_encoder_init(ei_sample_encoder_t *encoder, uint8_t channels);
+int ei_sample_encode(ei_sample_encoder_t *encoder, const int16_t *input, size_t n_samples, uint8_t *output, size_t output_size);
+int ei_sample_encode_finish(ei_sample_encoder_t *encoder, uint8_t *output, size_t output_size);
+int ei_sample_decode_block(const uint8_t *input, size_t input_size, uint8_t channels, int16_t *output, size_t *n_samples);
+
+bool ei_sample_reader_open(ei_sample_reader_t *reader, ei_sample_codec_read_t read, void *ctx);
+uint32_t ei_sample_reader_read(ei_sample_reader_t *reader, uint32_t offset, uint8_t *data, uint32_t length);
+uint32_t ei_sample_reader_encoded_size(ei_sample_reader_t *reader, uint32_t length);
+
+#endif /* EI_SAMPLE_CODEC_H */
@@ -48,7 +48,7 @@
 
 using namespace ei;
 
-int encode_as_jpg(uint8_t *framebuffer, size_t framebuffer_size, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
+inline int encode_as_jpg(uint8_t *framebuffer, size_t framebuffer_size, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
     static JPEGClass jpg;
     JPEGENCODE jpe;
 
@@ -82,21 +82,21 @@ int encode_as_jpg(uint8_t *framebuffer, size_t framebuffer_size, int width, int
     return 0;
 }
 
-int32_t jpeg_write_callback (JPEGFILE *pFile, uint8_t *pBuf, int32_t iLen) {
+inline int32_t jpeg_write_callback (JPEGFILE *pFile, uint8_t *pBuf, int32_t iLen) {
     base64_encode_chunk((const char *)pBuf, iLen, ei_putchar);
     return 0;
 }
 
-void jpeg_close_callback(JPEGFILE *pFile) {
+inline void jpeg_close_callback(JPEGFILE *pFile) {
     base64_encode_finish(ei_putchar);
 }
 
-void* jpeg_open_callback (const char *szFilename) {
+inline void* jpeg_open_callback (const char *szFilename) {
     // file handle isn't used in the internals, just return non NULL.
     return (void *)1;
 }
 
-static int encode_bw_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly) {
+static int encode_bw_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly, int quality) {
     static JPEGClass jpg;
     JPEGENCODE jpe;
     float *encode_buffer = NULL;
@@ -112,7 +112,7 @@ static int encode_bw_signal_as_jpg_common(signal_t *signal, int width, int heigh
         return rc;
     }
 
-    rc = jpg.encodeBegin(&jpe, width, height, JPEG_PIXEL_GRAYSCALE, JPEG_SUBSAMPLE_444, JPEG_Q_BEST);
+    rc = jpg.encodeBegin(&jpe, width, height, JPEG_PIXEL_GRAYSCALE, JPEG_SUBSAMPLE_444, quality);
     if (rc != JPEG_SUCCESS) {
         return rc;
     }
@@ -186,16 +186,16 @@ cleanup:
     return rc;
 }
 
-int encode_bw_signal_as_jpg(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
-    return encode_bw_signal_as_jpg_common(signal, width, height, out_buffer, out_buffer_size, out_size, false);
+inline int encode_bw_signal_as_jpg(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, int quality = JPEG_Q_BEST) {
+    return encode_bw_signal_as_jpg_common(signal, width, height, out_buffer, out_buffer_size, out_size, false, quality);
 }
 
-int encode_bw_signal_as_jpg_and_output_base64(signal_t *signal, int width, int height) {
-    return encode_bw_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true);
+inline int encode_bw_signal_as_jpg_and_output_base64(signal_t *signal, int width, int height, int quality = JPEG_Q_BEST) {
+    return encode_bw_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true, quality);
 }
 
 
-static int encode_rgb888_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly) {
+static int encode_rgb888_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly, int quality) {
     static JPEGClass jpg;
     JPEGENCODE jpe;
     float *encode_buffer = NULL;
@@ -211,7 +211,7 @@ static int encode_rgb888_signal_as_jpg_common(signal_t *signal, int width, int h
         return rc;
     }
 
-    rc = jpg.encodeBegin(&jpe, width, height, JPEG_PIXEL_RGB888, JPEG_SUBSAMPLE_444, JPEG_Q_BEST);
+    rc = jpg.encodeBegin(&jpe, width, height, JPEG_PIXEL_RGB888, JPEG_SUBSAMPLE_444, quality);
     if (rc != JPEG_SUCCESS) {
         return rc;
     }
@@ -296,15 +296,15 @@ cleanup:
     return rc;
 }
 
-int encode_rgb888_signal_as_jpg(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
-    return encode_rgb888_signal_as_jpg_common(signal, width, height, out_buffer, out_buffer_size, out_size, false);
+inline int encode_rgb888_signal_as_jpg(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, int quality = JPEG_Q_BEST) {
+    return encode_rgb888_signal_as_jpg_common(signal, width, height, out_buffer, out_buffer_size, out_size, false, quality);
 }
 
-int encode_rgb888_signal_as_jpg_and_output_base64(signal_t *signal, int width, int height) {
-    return encode_rgb888_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true);
+inline int encode_rgb888_signal_as_jpg_and_output_base64(signal_t *signal, int width, int height, int quality = JPEG_Q_BEST) {
+    return encode_rgb888_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true, quality);
 }
 
-static int encode_rgb565_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly) {
+static int encode_rgb565_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly, int quality) {
     static JPEGClass jpg;
     JPEGENCODE jpe;
     float *encode_buffer = NULL;
@@ -320,7 +320,7 @@ static int encode_rgb565_signal_as_jpg_common(signal_t *signal, int width, int h
         return rc;
     }
 
-    rc = jpg.encodeBegin(&jpe, width, height, JPEG_PIXEL_RGB565, JPEG_SUBSAMPLE_444, JPEG_Q_BEST);
+    rc = jpg.encodeBegin(&jpe, width, height, JPEG_PIXEL_RGB565, JPEG_SUBSAMPLE_444, quality);
     if (rc != JPEG_SUCCESS) {
         return rc;
     }
@@ -408,12 +408,12 @@ cleanup:
     return rc;
 }
 
-int encode_rgb565_signal_as_jpg(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
-    return encode_rgb565_signal_as_jpg_common(signal, width, height, out_buffer, out_buffer_size, out_size, false);
+inline int encode_rgb565_signal_as_jpg(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, int quality = JPEG_Q_BEST) {
+    return encode_rgb565_signal_as_jpg_common(signal, width, height, out_buffer, out_buffer_size, out_size, false, quality);
 }
 
-int encode_rgb565_signal_as_jpg_and_output_base64(signal_t *signal, int width, int height) {
-    return encode_rgb565_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true);
+inline int encode_rgb565_signal_as_jpg_and_output_base64(signal_t *signal, int width, int height, int quality = JPEG_Q_BEST) {
+    return encode_rgb565_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true, quality);
 }
 
 
@@ -141,6 +141,45 @@ int get_snapshot_frame_msg(uint8_t* buf, size_t buf_len, const char* frame)
     return encoded.len;
 }
 
+int write_snapshot_frame_msg(const remote_mgmt_writer_t* writer, const remote_mgmt_part_t* parts, size_t parts_count)
+{
+    // map(1), "snapshotFrame", byte string head: well below 32 bytes
+    uint8_t header[32];
+    UsefulBuf cbor_buf = {
+        .ptr = header,
+        .len = sizeof(header)
+    };
+    QCBOREncodeContext ec;
+    UsefulBufC encoded;
+    size_t frame_size = 0;
+
+    for (size_t ix = 0; ix < parts_count; ix++) {
+        frame_size += parts[ix].length;
+    }
+
+    QCBOREncode_Init(&ec, cbor_buf);
+    QCBOREncode_OpenMap(&ec);
+    // type and length only, the frame itself follows from the parts
+    QCBOREncode_AddBytesLenOnlyToMap(&ec, "snapshotFrame", (UsefulBufC){ nullptr, frame_size });
+    QCBOREncode_CloseMap(&ec);
+
+    if(QCBOREncode_Finish(&ec, &encoded)) {
+        return 0;
+    }
+
+    if (!writer->write((const uint8_t*)encoded.ptr, encoded.len, writer->ctx)) {
+        return 0;
+    }
+
+    for (size_t ix = 0; ix < parts_count; ix++) {
+        if (parts[ix].length > 0 && !writer->write(parts[ix].data, parts[ix].length, writer->ctx)) {
+            return 0;
+        }
+    }
+
+    return encoded.len + frame_size;
+}
+
 int get_hello_msg(uint8_t* buf, size_t buf_len, EiDeviceInfo* device)
 {
     UsefulBuf cbor_buf = {
@@ -116,6 +116,36 @@ public:
     }
 };
 
+/**
+ * @brief Consumer of a message handed over in parts, eg. a socket send
+ * @param data Next part of the message
+ * @param length Length of the part
+ * @param ctx Context from remote_mgmt_writer_t
+ * @return false to abort the message
+ */
+typedef bool (*remote_mgmt_write_t)(const uint8_t* data, size_t length, void* ctx);
+
+typedef struct {
+    remote_mgmt_write_t write;
+    void* ctx;
+} remote_mgmt_writer_t;
+
+/** One part of a payload that is not contiguous in memory */
+typedef struct {
+    const uint8_t* data;
+    size_t length;
+} remote_mgmt_part_t;
+
+/*
+ * All get_*_msg functions accept buf == NULL (with buf_len UINT32_MAX)
+ * to only calculate the message length.
+ *
+ * Only the snapshot message has a streaming (writer) variant: the frame is
+ * the one payload too large to copy. The other messages are a few dozen
+ * bytes (hello: the device strings and sensor list) and are built with
+ * their get_*_msg into the caller's buffer.
+ */
+
 /**
  * @brief This message should be sent after receiving SampleRequest (it is ack message)
  * @param buf Buffer to write the message to
@@ -177,6 +207,18 @@ int get_sample_finished_msg(uint8_t* buf, size_t buf_len);
  */
 int get_snapshot_frame_msg(uint8_t* buf, size_t buf_len, const char* frame);
 
+/**
+ * @brief Stream a snapshot message with the frame as a CBOR byte string
+ * (eg. the JPEG from EiCamera::ei_camera_get_jpeg_frame), no base64.
+ * Only the map and byte string headers are encoded, the frame parts are
+ * handed to the writer as they are, in order.
+ * @param writer Destination of the message
+ * @param parts Frame, in one or more parts
+ * @param parts_count Number of parts
+ * @return actual message length, 0 on error
+ */
+int write_snapshot_frame_msg(const remote_mgmt_writer_t* writer, const remote_mgmt_part_t* parts, size_t parts_count);
+
 /**
  * @brief Create a hello message (send as a first message to Remote Management Service)
  * @param buf Buffer to write the message to
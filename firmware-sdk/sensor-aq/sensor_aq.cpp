@@ -112,27 +112,150 @@ static int sensor_aq_update_sig_and_write_to_file(sensor_aq_ctx *ctx, uint8_t *p
     return AQ_OK;
 }
 
-static int sensor_aq_flush_buffer(sensor_aq_ctx *ctx) {
+/**
+ * Largest encoding of one value, a float that needs double precision (subnormals) takes 9 bytes
+ */
+#define AQ_CBOR_MAX_VALUE_SIZE   9
+#define AQ_CBOR_MAX_HEADER_SIZE  2
+
+/**
+ * Append a CBOR type + argument with the shortest encoding (same as QCBOR)
+ */
+static inline uint8_t *cbor_put_type(uint8_t *p, uint8_t major_type, uint32_t arg) {
+    if (arg < 24) {
+        *p++ = (major_type << 5) | arg;
+    }
+    else if (arg <= 0xff) {
+        *p++ = (major_type << 5) | 24;
+        *p++ = arg;
+    }
+    else if (arg <= 0xffff) {
+        *p++ = (major_type << 5) | 25;
+        *p++ = arg >> 8;
+        *p++ = arg;
+    }
+    else {
+        *p++ = (major_type << 5) | 26;
+        *p++ = arg >> 24;
+        *p++ = arg >> 16;
+        *p++ = arg >> 8;
+        *p++ = arg;
+    }
+    return p;
+}
+
+static inline uint8_t *cbor_put_int(uint8_t *p, int32_t value) {
+    if (value >= 0) {
+        return cbor_put_type(p, 0, (uint32_t)value);
+    }
+    return cbor_put_type(p, 1, (uint32_t)(-1 - value));
+}
+
+/**
+ * Append a float with the preferred serialization of QCBOREncode_AddDouble:
+ * half precision if that is lossless, single precision otherwise. Only float
+ * subnormals need double precision.
+ */
+static inline uint8_t *cbor_put_float(uint8_t *p, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = bits >> 31;
+    const uint32_t biased_exponent = (bits >> 23) & 0xff;
+    const uint32_t significand = bits & 0x7fffff;
+    const int32_t exponent = (int32_t)biased_exponent - 127;
+
+    uint16_t half;
+    if (biased_exponent == 0 && significand == 0) {
+        // +/- 0
+        half = sign << 15;
+    }
+    else if (biased_exponent == 0xff) {
+        // +/- infinity, NaN keeps only its quiet bit (payload bits don't fit)
+        half = (sign << 15) | 0x7c00;
+        if (significand) {
+            half |= (significand & 0x400000) ? 0x200 : 0x1;
+        }
+    }
+    else if (biased_exponent == 0) {
+        // subnormal float, is a normal double
+        double d = value;
+        uint64_t dbits;
+        memcpy(&dbits, &d, sizeof(dbits));
+        *p++ = 0xfb;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            *p++ = (uint8_t)(dbits >> shift);
+        }
+        return p;
+    }
+    else if (exponent >= -14 && exponent <= 15 && (significand & 0x1fff) == 0) {
+        half = (sign << 15) | ((exponent + 15) << 10) | (significand >> 13);
+    }
+    else {
+        *p++ = 0xfa;
+        *p++ = bits >> 24;
+        *p++ = bits >> 16;
+        *p++ = bits >> 8;
+        *p++ = bits;
+        return p;
+    }
+
+    *p++ = 0xf9;
+    *p++ = half >> 8;
+    *p++ = half;
+    return p;
+}
+
+/**
+ * Encode samples (sample major, axis_count values each) into the CBOR buffer, with the same
+ * bytes as adding them one by one: a single axis sample is a bare value, otherwise an array.
+ * The signature is updated and the stream written once per full CBOR buffer, and once at the end.
+ */
+template<typename T>
+static int sensor_aq_add_samples(sensor_aq_ctx *ctx, const T *values, size_t axis_count, size_t sample_count) {
     if (ctx->stream == NULL) {
         return AQ_STREAM_IS_NULL;
     }
 
-    UsefulBufC encoded = UsefulOutBuf_OutUBuf(&(ctx->encode_context.OutBuf));
-
-    QCBORError res = QCBOREncode_Finish(&ctx->encode_context, &encoded);
-    if (res != QCBOR_SUCCESS) {
-        return res;
+    const size_t max_sample_size = AQ_CBOR_MAX_HEADER_SIZE + axis_count * AQ_CBOR_MAX_VALUE_SIZE;
+    if (max_sample_size > ctx->cbor_buffer.len) {
+        return AQ_OUT_OF_MEM;
     }
 
-    int err = sensor_aq_update_sig_and_write_to_file(ctx, (uint8_t*)encoded.ptr, encoded.len);
-    if (err != AQ_OK) {
-        return err;
+    uint8_t *start = (uint8_t*)ctx->cbor_buffer.ptr;
+    uint8_t *end = start + ctx->cbor_buffer.len;
+    uint8_t *p = start;
+
+    for (size_t ix = 0; ix < sample_count; ix++) {
+        if ((size_t)(end - p) < max_sample_size) {
+            int err = sensor_aq_update_sig_and_write_to_file(ctx, start, p - start);
+            if (err != AQ_OK) {
+                return err;
+            }
+            p = start;
+        }
+
+        const T *sample = values + ix * axis_count;
+
+        // If we only have a single axis then emit flattened array (saves space)
+        if (axis_count != 1) {
+            p = cbor_put_type(p, 4, axis_count);
+        }
+        for (size_t axis = 0; axis < axis_count; axis++) {
+            if (sizeof(T) == sizeof(float)) {
+                p = cbor_put_float(p, (float)sample[axis]);
+            }
+            else {
+                p = cbor_put_int(p, (int32_t)sample[axis]);
+            }
+        }
     }
 
-    // re-initialize
-    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
+    if (p == start) {
+        return AQ_OK;
+    }
 
-    return AQ_OK;
+    return sensor_aq_update_sig_and_write_to_file(ctx, start, p - start);
 }
 
 /**
@@ -341,32 +464,7 @@ int sensor_aq_add_data(sensor_aq_ctx *ctx, float values[], size_t values_size) {
         return AQ_VALUES_SIZE_DOES_NOT_MATCH_AXIS_COUNT;
     }
 
-    if (ctx->stream == NULL) {
-        return AQ_STREAM_IS_NULL;
-    }
-
-    // clear memory
-    memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
-
-    // re-initialize
-    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
-
-    // If we only have a single axis then emit flattened array (saves space)
-    if (values_size == 1) {
-        QCBOREncode_AddDouble(&ctx->encode_context, values[0]);
-    }
-    else {
-        // otherwise create an array
-        QCBOREncode_OpenArray(&ctx->encode_context);
-
-        for (size_t ix = 0; ix < values_size; ix++) {
-            QCBOREncode_AddDouble(&ctx->encode_context, values[ix]);
-        }
-
-        QCBOREncode_CloseArray(&ctx->encode_context);
-    }
-
-    return sensor_aq_flush_buffer(ctx);
+    return sensor_aq_add_samples(ctx, values, values_size, 1);
 }
 
 /**
@@ -380,57 +478,9 @@ int sensor_aq_add_data_i16(sensor_aq_ctx *ctx, int16_t values[], size_t values_s
         return AQ_VALUES_SIZE_DOES_NOT_MATCH_AXIS_COUNT;
     }
 
-    if (ctx->stream == NULL) {
-        return AQ_STREAM_IS_NULL;
-    }
-
-    // clear memory
-    memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
-
-    // re-initialize
-    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
-
-    // If we only have a single axis then emit flattened array (saves space)
-    if (values_size == 1) {
-        QCBOREncode_AddInt64(&ctx->encode_context, values[0]);
-    }
-    else {
-        // otherwise create an array
-        QCBOREncode_OpenArray(&ctx->encode_context);
-
-        for (size_t ix = 0; ix < values_size; ix++) {
-            QCBOREncode_AddInt64(&ctx->encode_context, values[ix]);
-        }
-
-        QCBOREncode_CloseArray(&ctx->encode_context);
-    }
-
-    return sensor_aq_flush_buffer(ctx);
+    return sensor_aq_add_samples(ctx, values, values_size, 1);
 }
 
-/**
- * Add data to the sensor file for many intervals at the same time
- * This only works if there is only a single sensor
- * @param ctx The context
- * @param values Values
- * @param values_size Size of the values array
- */
-// int sensor_aq_add_data_batch(sensor_aq_ctx *ctx, float values[], size_t values_size) {
-//     if (ctx->axis_count != 1) {
-//         return AQ_BATCH_ONLY_SUPPORTS_SINGLE_AXIS;
-//     }
-
-//     for (size_t ix = 0; ix < values_size; ix++) {
-//         float new_values[1] = { values[ix] };
-//         int r = sensor_aq_add_data(ctx, new_values, 1);
-//         if (r != AQ_OK) {
-//             return r;
-//         }
-//     }
-
-//     return AQ_OK;
-// }
-
 /**
  * Add data to the sensor file for many intervals at the same time
  * This only works if there is only a single sensor
@@ -443,29 +493,30 @@ int sensor_aq_add_data_batch(sensor_aq_ctx *ctx, int16_t values[], size_t values
         return AQ_BATCH_ONLY_SUPPORTS_SINGLE_AXIS;
     }
 
-    if (ctx->stream == NULL) {
-        return AQ_STREAM_IS_NULL;
-    }
-
-    // clear memory
-    memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
-
-    // re-initialize
-    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
-
-    for (size_t ix = 0; ix < values_size; ix++) {
-        QCBOREncode_AddInt64(&ctx->encode_context, values[ix]);
+    return sensor_aq_add_samples(ctx, values, 1, values_size);
+}
 
-        // within 8 bytes of the size of the buffer...
-        if (ctx->encode_context.OutBuf.data_len >= ctx->cbor_buffer.len - 8) {
-            int fr = sensor_aq_flush_buffer(ctx);
-            if (fr != AQ_OK) {
-                return fr;
-            }
-        }
-    }
+/**
+ * Add data to the sensor file for many intervals at the same time, any number of axes.
+ * Gives the same file as calling sensor_aq_add_data for every interval, but the
+ * signature and the stream are updated once per filled CBOR buffer instead of once per interval.
+ * @param ctx The context
+ * @param values Values, sample_count intervals of axis_count values each
+ * @param sample_count Number of intervals
+ */
+int sensor_aq_add_data_batch_f32(sensor_aq_ctx *ctx, const float values[], size_t sample_count) {
+    return sensor_aq_add_samples(ctx, values, ctx->axis_count, sample_count);
+}
 
-    return sensor_aq_flush_buffer(ctx);
+/**
+ * Add data to the sensor file for many intervals at the same time, any number of axes.
+ * See sensor_aq_add_data_batch_f32
+ * @param ctx The context
+ * @param values Values, sample_count intervals of axis_count values each
+ * @param sample_count Number of intervals
+ */
+int sensor_aq_add_data_batch_i16(sensor_aq_ctx *ctx, const int16_t values[], size_t sample_count) {
+    return sensor_aq_add_samples(ctx, values, ctx->axis_count, sample_count);
 }
 
 int sensor_aq_finish(sensor_aq_ctx *ctx) {
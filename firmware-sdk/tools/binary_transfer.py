@@ -0,0 +1,345 @@
+import argparse
+import os
+import random
+import struct
+import sys
+import threading
+import time
+import tty
+import zlib
+
+SYNC = b"\xeb\x91"
+HEADER = struct.Struct("<2sBBHH")
+CRC = struct.Struct("<I")
+START = struct.Struct("<IHBB")
+END = struct.Struct("<I")
+
+FRAME_START = 0x01
+FRAME_DATA = 0x02
+FRAME_END = 0x03
+
+CONTENT_SAMPLE_PACKED = 3
+CONTENT_NAMES = {0: "sample", 1: "snapshot", 2: "JPEG snapshot", CONTENT_SAMPLE_PACKED: "packed sample"}
+
+# firmware-sdk/ei_sample_codec.h
+CODEC_MAGIC = b"EIZ1"
+CODEC_HEADER = struct.Struct("<4sHBB")
+CODEC_BLOCK_HEADER = struct.Struct("<BBhH")
+CODEC_MODE_RICE = 0x80
+
+
+def decode_sample(data):
+    """Bytes of a sample stored with ei_sample_codec.h, as they were recorded"""
+    magic, raw_length, _, channels = CODEC_HEADER.unpack_from(data)
+    if magic != CODEC_MAGIC:
+        raise ValueError("not an encoded sample")
+    pos = CODEC_HEADER.size + raw_length
+    out = bytearray(data[CODEC_HEADER.size:pos])
+    while pos + CODEC_BLOCK_HEADER.size <= len(data):
+        mode, count, first, payload_size = CODEC_BLOCK_HEADER.unpack_from(data, pos)
+        pos += CODEC_BLOCK_HEADER.size
+        bits = int.from_bytes(data[pos:pos + payload_size], "little")
+        pos += payload_size
+        width, shift = mode & 0x1F, (mode >> 5) & 0x3
+        samples = [first]
+        bit = 0
+        for ix in range(1, count + 1):
+            if mode & CODEC_MODE_RICE:
+                rest = bits >> bit
+                q = ((rest ^ (rest + 1)).bit_length() - 1)  # trailing ones
+                bit += q + 1
+                z = (q << width) | ((bits >> bit) & ((1 << width) - 1))
+            else:
+                z = (bits >> bit) & ((1 << width) - 1)
+            bit += width
+            delta = (z >> 1) ^ -(z & 1)
+            ref = samples[ix - channels] if ix >= channels else samples[ix - 1]
+            samples.append(((ref + (delta << shift) + 0x8000) & 0xFFFF) - 0x8000)
+        out += struct.pack("<{}h".format(len(samples)), *samples)
+    return bytes(out)
+
+
+def encode_frame(frame_type, seq, payload):
+    body = HEADER.pack(SYNC, frame_type, 0, seq & 0xFFFF, len(payload)) + payload
+    return body + CRC.pack(zlib.crc32(body[2:]))
+
+
+class Receiver:
+    """Host side of one transfer, feed it bytes read from the port and write back what it returns"""
+
+    def __init__(self):
+        self.buf = b""
+        self.expected = 0
+        self.nak_sent_for = None
+        self.total = None
+        self.content = None
+        self.data = bytearray()
+        self.done = False
+        self.crc_errors = 0
+        self.duplicates = 0
+        self.naks = 0
+
+    def _nak(self):
+        # one NAK per gap, the device times out if the resend is lost as well
+        if self.nak_sent_for == self.expected:
+            return b""
+        self.nak_sent_for = self.expected
+        self.naks += 1
+        return "NAK {:04X}\r".format(self.expected & 0xFFFF).encode()
+
+    def _ack(self):
+        return "ACK {:04X}\r".format(self.expected & 0xFFFF).encode()
+
+    def feed(self, data):
+        self.buf += data
+        replies = b""
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self.buf = self.buf[len(self.buf) - keep:]
+                return replies
+            self.buf = self.buf[start:]
+            if len(self.buf) < HEADER.size:
+                return replies
+            _, frame_type, _, seq16, length = HEADER.unpack_from(self.buf)
+            size = HEADER.size + length + CRC.size
+            if frame_type not in (FRAME_START, FRAME_DATA, FRAME_END) or length > 0xFFFF:
+                self.buf = self.buf[1:]
+                continue
+            if len(self.buf) < size:
+                return replies
+            (crc,) = CRC.unpack_from(self.buf, size - CRC.size)
+            if crc != zlib.crc32(self.buf[2:size - CRC.size]):
+                # corrupted frame or a false sync, look for the next marker
+                self.crc_errors += 1
+                self.buf = self.buf[1:]
+                replies += self._nak()
+                continue
+            payload = self.buf[HEADER.size:size - CRC.size]
+            self.buf = self.buf[size:]
+
+            delta = (seq16 - self.expected) & 0xFFFF
+            seq = self.expected + (delta - 0x10000 if delta >= 0x8000 else delta)
+            if seq < self.expected:
+                # our ACK got lost, repeat it
+                self.duplicates += 1
+                replies += self._ack()
+                continue
+            if seq > self.expected:
+                replies += self._nak()
+                continue
+
+            if frame_type == FRAME_START:
+                self.total, _, _, self.content = START.unpack(payload)
+            elif frame_type == FRAME_DATA:
+                self.data += payload
+            else:
+                (data_crc,) = END.unpack(payload)
+                if data_crc != zlib.crc32(self.data) or len(self.data) != self.total:
+                    raise IOError("transfer corrupted: length {} of {}, crc {:08x} != {:08x}".format(
+                        len(self.data), self.total, zlib.crc32(self.data), data_crc))
+                self.done = True
+            self.expected += 1
+            self.nak_sent_for = None
+            replies += self._ack()
+
+
+def receive(ser, receiver, timeout=5.0):
+    last_data = time.monotonic()
+    while not receiver.done:
+        data = ser.read(ser.in_waiting or 1)
+        if data:
+            last_data = time.monotonic()
+            replies = receiver.feed(data)
+            if replies:
+                ser.write(replies)
+        elif time.monotonic() - last_data > timeout:
+            raise IOError("device stopped sending")
+    # keep answering a resent END until the device confirms with OK
+    tail = b""
+    deadline = time.monotonic() + 1.0
+    while b"OK" not in tail and time.monotonic() < deadline:
+        data = ser.read(ser.in_waiting or 1)
+        replies = receiver.feed(data)
+        if replies:
+            ser.write(replies)
+        tail = (tail + data)[-64:]
+
+
+class Sender:
+    """Device side, go-back-N with the same rules as firmware-sdk/ei_binary_transfer.cpp"""
+
+    def __init__(self, data, content=0, max_payload=1024, window=8, timeout=0.25, error_rate=0.0, seed=1):
+        self.data = data
+        self.content = content
+        self.max_payload = max_payload
+        self.window = window
+        self.timeout = timeout
+        self.error_rate = error_rate
+        self.rand = random.Random(seed)
+        self.frames_sent = 0
+        self.frames_resent = 0
+        self.corrupted = 0
+
+    def frame(self, seq, end_seq):
+        if seq == 0:
+            return encode_frame(FRAME_START, seq, START.pack(len(self.data), self.max_payload, self.window, self.content))
+        if seq < end_seq:
+            offset = (seq - 1) * self.max_payload
+            return encode_frame(FRAME_DATA, seq, self.data[offset:offset + self.max_payload])
+        return encode_frame(FRAME_END, seq, END.pack(zlib.crc32(self.data)))
+
+    def damage(self, frame):
+        if self.rand.random() >= self.error_rate:
+            return frame
+        self.corrupted += 1
+        frame = bytearray(frame)
+        if self.rand.random() < 0.5:
+            frame[self.rand.randrange(len(frame))] ^= 1 << self.rand.randrange(8)
+        else:
+            # a dropped chunk, as with an RX FIFO overrun on the host
+            start = self.rand.randrange(len(frame))
+            del frame[start:start + self.rand.randrange(1, 64)]
+        return bytes(frame)
+
+    def run(self, ser):
+        end_seq = (len(self.data) + self.max_payload - 1) // self.max_payload + 1
+        base = next_seq = sent = 0
+        line = b""
+        progress = time.monotonic()
+        while base <= end_seq:
+            if next_seq <= end_seq and next_seq - base < self.window:
+                ser.write(self.damage(self.frame(next_seq, end_seq)))
+                self.frames_sent += 1
+                self.frames_resent += next_seq < sent
+                next_seq += 1
+                sent = max(sent, next_seq)
+            for c in ser.read(ser.in_waiting):
+                if c != 0x0D:
+                    line += bytes([c])
+                    continue
+                text, line = line.decode(errors="replace"), b""
+                if text == "CAN":
+                    return False
+                if len(text) != 8 or text[:3] not in ("ACK", "NAK"):
+                    continue
+                seq = base + ((int(text[4:], 16) - base) & 0xFFFF)
+                if seq > sent:
+                    continue
+                if seq > base:
+                    base, progress = seq, time.monotonic()
+                next_seq = max(next_seq, base)
+                if text[:3] == "NAK":
+                    next_seq = base
+            if time.monotonic() - progress > self.timeout:
+                next_seq, progress = base, time.monotonic()
+            elif next_seq > end_seq or next_seq - base >= self.window:
+                time.sleep(0.0005)
+        return True
+
+
+class PtyPort:
+    """Non-blocking end of a pseudo-terminal with the part of the pyserial API used here"""
+
+    def __init__(self, fd):
+        os.set_blocking(fd, False)
+        self.f = os.fdopen(fd, "r+b", buffering=0)
+        self.in_waiting = 4096
+
+    def read(self, size):
+        try:
+            return self.f.read(size) or b""
+        except BlockingIOError:
+            time.sleep(0.0005)
+            return b""
+
+    def write(self, data):
+        while data:
+            try:
+                data = data[self.f.write(data) or 0:]
+            except BlockingIOError:
+                time.sleep(0.0005)
+
+
+def self_test(size, error_rate, seed):
+    # device and host talking over a pseudo-terminal pair, no hardware needed
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    host = PtyPort(master)
+    device = PtyPort(slave)
+
+    payload = random.Random(seed).randbytes(size)
+    sender = Sender(payload, error_rate=error_rate, seed=seed)
+
+    def run_device():
+        sender.run(device)
+        device.write(b"\r\nOK\r\n")
+
+    thread = threading.Thread(target=run_device)
+    receiver = Receiver()
+    begin = time.monotonic()
+    thread.start()
+    receive(host, receiver)
+    elapsed = time.monotonic() - begin
+    thread.join()
+    ok = bytes(receiver.data) == payload
+    print("{} bytes in {:.2f} s ({:.0f} kB/s), data {}".format(size, elapsed, size / elapsed / 1000, "OK" if ok else "MISMATCH"))
+    print("frames sent {}, resent {}, corrupted {}; host CRC errors {}, NAKs {}, duplicates {}".format(
+        sender.frames_sent, sender.frames_resent, sender.corrupted, receiver.crc_errors, receiver.naks, receiver.duplicates))
+    return 0 if ok else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Receive binary framed transfers (USEMAXRATE=b)")
+    parser.add_argument("port", nargs="?", help="serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--max-baud", type=int, default=1000000, help="baud rate the device switches to")
+    parser.add_argument("--readbuffer", nargs=2, type=int, metavar=("START", "LENGTH"))
+    parser.add_argument("--snapshot", nargs=2, type=int, metavar=("WIDTH", "HEIGHT"))
+    parser.add_argument("-o", "--output", help="write the received data to this file")
+    parser.add_argument("--self-test", type=int, metavar="BYTES", help="run sender and receiver over a pty pair")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="share of corrupted frames in the self test")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    if args.self_test is not None:
+        return self_test(args.self_test, args.error_rate, args.seed)
+    if not args.port or not (args.readbuffer or args.snapshot):
+        parser.error("port and --readbuffer or --snapshot are required")
+
+    import serial
+
+    ser = serial.Serial(args.port, args.baud, timeout=0.1)
+    if args.readbuffer:
+        command = "AT+READBUFFER={},{},b\r".format(*args.readbuffer)
+    else:
+        command = "AT+SNAPSHOT={},{},b\r".format(*args.snapshot)
+    ser.write(command.encode())
+    # the device answers OK and switches to the max baud rate before the first frame
+    ser.read_until(b"OK")
+    time.sleep(0.1)
+    ser.baudrate = args.max_baud
+
+    receiver = Receiver()
+    begin = time.monotonic()
+    receive(ser, receiver)
+    elapsed = time.monotonic() - begin
+    ser.baudrate = args.baud
+    ser.close()
+
+    print("{} {} bytes in {:.2f} s ({:.0f} kB/s), CRC errors {}, NAKs {}".format(
+        CONTENT_NAMES.get(receiver.content, "data"), len(receiver.data), elapsed,
+        len(receiver.data) / elapsed / 1000, receiver.crc_errors, receiver.naks))
+    data = bytes(receiver.data)
+    if receiver.content == CONTENT_SAMPLE_PACKED:
+        # the last block may reach past the requested range
+        data = decode_sample(data)[:args.readbuffer[1]]
+        print("decoded to {} bytes".format(len(data)))
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(data)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,159 @@
+import argparse
+import struct
+import sys
+import time
+
+SYNC = b"\xeb\x90"
+VERSION = 1
+ERROR = 0x80
+HEADER = struct.Struct("<2sBBIIIII")
+ENTRY = struct.Struct("<BBHHHHH")
+ERROR_RECORD = struct.Struct("<2sBBIIi")
+CRC = struct.Struct("<H")
+
+ERROR_CODES = {1: "capture failed", 2: "allocation failed", 3: "JPEG decode failed", 4: "impulse failed"}
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_record(frame_id, timestamp_ms, timing, entries):
+    body = HEADER.pack(SYNC, VERSION, len(entries), frame_id, timestamp_ms, *timing)
+    for entry in entries:
+        body += ENTRY.pack(entry[0], 0, *entry[1:])
+    return body + CRC.pack(crc16_ccitt(body[2:]))
+
+
+def encode_error(code, frame_id, timestamp_ms, detail=0):
+    body = ERROR_RECORD.pack(SYNC, VERSION | ERROR, code, frame_id, timestamp_ms, detail)
+    return body + CRC.pack(crc16_ccitt(body[2:]))
+
+
+class Decoder:
+    """Incremental decoder, feed it any chunk of bytes read from the port.
+    Returns (fields, entries) tuples, entries is None for an error record and
+    fields is then (code, frame_id, timestamp_ms, detail)"""
+
+    def __init__(self):
+        self.buf = b""
+        self.crc_errors = 0
+        self.skipped = 0
+
+    def feed(self, data):
+        self.buf += data
+        records = []
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                # keep a trailing sync byte, it may be the first half of a marker
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self.skipped += len(self.buf) - keep
+                self.buf = self.buf[len(self.buf) - keep:]
+                return records
+            self.skipped += start
+            self.buf = self.buf[start:]
+            if len(self.buf) < 4:
+                return records
+            if self.buf[2] == VERSION | ERROR:
+                length = ERROR_RECORD.size + CRC.size
+                if len(self.buf) < length:
+                    return records
+                if self.check_crc(length):
+                    _, _, *fields = ERROR_RECORD.unpack_from(self.buf)
+                    records.append((fields, None))
+                    self.buf = self.buf[length:]
+                continue
+            if len(self.buf) < HEADER.size:
+                return records
+            _, version, count, *fields = HEADER.unpack_from(self.buf)
+            length = HEADER.size + count * ENTRY.size + CRC.size
+            if version != VERSION:
+                self.buf = self.buf[1:]
+                continue
+            if len(self.buf) < length:
+                return records
+            if not self.check_crc(length):
+                continue
+            entries = [ENTRY.unpack_from(self.buf, HEADER.size + i * ENTRY.size) for i in range(count)]
+            records.append((fields, entries))
+            self.buf = self.buf[length:]
+
+    def check_crc(self, length):
+        (crc,) = CRC.unpack_from(self.buf, length - CRC.size)
+        if crc != crc16_ccitt(self.buf[2:length - CRC.size]):
+            # false sync inside text or a corrupted record, resync on the next marker
+            self.crc_errors += 1
+            self.buf = self.buf[1:]
+            return False
+        return True
+
+
+def print_record(fields, entries, labels):
+    if entries is None:
+        code, frame_id, timestamp_ms, detail = fields
+        print("frame {} @ {} ms: ERR: {} ({})".format(
+            frame_id, timestamp_ms, ERROR_CODES.get(code, "error {}".format(code)), detail))
+        return
+    frame_id, timestamp_ms, dsp_us, classification_us, anomaly_us = fields
+    print("frame {} @ {} ms: DSP {} us, inference {} us, anomaly {} us".format(
+        frame_id, timestamp_ms, dsp_us, classification_us, anomaly_us))
+    for label_ix, _, score, x, y, width, height in entries:
+        label = labels[label_ix] if label_ix < len(labels) else str(label_ix)
+        print("  {} ({:.5f}) [ x: {}, y: {}, width: {}, height: {} ]".format(
+            label, score / 65535.0, x, y, width, height))
+
+
+def run_decoder(ser, labels, start):
+    if start:
+        ser.write(b"AT+RUNIMPULSEBIN\r")
+    decoder = Decoder()
+    try:
+        while True:
+            for fields, entries in decoder.feed(ser.read(ser.in_waiting or 1)):
+                print_record(fields, entries, labels)
+    except KeyboardInterrupt:
+        if start:
+            ser.write(b"b")
+    print("CRC errors: {}, skipped bytes: {}".format(decoder.crc_errors, decoder.skipped))
+
+
+def run_emitter(ser, count):
+    # produces synthetic records, useful to test the decoder over a pseudo-terminal pair
+    ser.write(b"Inferencing settings:\r\n")
+    for frame_id in range(count):
+        entries = [(frame_id % 2, 40000, 8 * frame_id % 96, 16, 8, 8)]
+        timestamp_ms = int(time.monotonic() * 1000) & 0xFFFFFFFF
+        if frame_id % 50 == 49:
+            ser.write(encode_error(4, frame_id, timestamp_ms, -5))
+        else:
+            ser.write(encode_record(frame_id, timestamp_ms, (1000, 20000, 0), entries))
+        time.sleep(0.01)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode binary result records (AT+RUNIMPULSEBIN)")
+    parser.add_argument("port", help="serial port or pseudo-terminal path")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--labels", default="", help="comma separated labels, in model order")
+    parser.add_argument("--no-start", action="store_true", help="do not send AT+RUNIMPULSEBIN")
+    parser.add_argument("--emit", type=int, metavar="N", help="write N synthetic records instead of decoding")
+    args = parser.parse_args()
+
+    # only needed for the port, the decoder is also used by the host tests
+    import serial
+    ser = serial.Serial(args.port, args.baud, timeout=1)
+    if args.emit is not None:
+        run_emitter(ser, args.emit)
+    else:
+        run_decoder(ser, [l for l in args.labels.split(",") if l], not args.no_start)
+    ser.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,14 +1,21 @@
+
+import argparse
 import time
-import serial
 import os
 import sys
 import struct
 import binascii
 
+verbose = False
+
+def log(*args):
+    if verbose:
+        print(*args)
+
 def encode_and_send(string, ser):
     array_to_write = (string.encode())
     ser.write(array_to_write)
-    print("Sent: {} Size: {}".format(array_to_write, len(array_to_write)))
+    log("Sent: {} Size: {}".format(array_to_write, len(array_to_write)))
 
 def await_response_exact(response, ser):
     data_in = b""
@@ -19,11 +26,12 @@ def await_response_exact(response, ser):
             break
     return data_in.decode()
 
-def await_response(response, ser):
+def await_response(response, ser, quiet=False):
     data_in = b""
     while not response.encode() in data_in:
         data_in = ser.readline()
-        print(data_in)
+        if not quiet:
+            print(data_in)
         if data_in == b"TIMEOUT\r\n":
             break
     return data_in.decode()
@@ -32,17 +40,17 @@ def base64_encode(features):
     feature_byte_array = struct.pack('@'+'f'*len(features), *features)
     res = binascii.b2a_base64(feature_byte_array, newline=False)
 
-    print(len(features))
-    print(len(features*4))
-    print(features)
-    print(str(res)[2:-1])
+    log(len(features))
+    log(len(features*4))
+    log(features)
+    log(str(res)[2:-1])
     return str(res)[2:-1]
 
-def send_uart(data, raw_data_len, ser, sim_timeout=False):
+def send_uart(data, raw_data_len, ser, sim_timeout=False, startup_delay=2):
 
     data_sent = 0
 
-    time.sleep(2)
+    time.sleep(startup_delay)
 
     encode_and_send("AT\r", ser)
     response = await_response_exact("> ", ser)
@@ -60,12 +68,13 @@ def send_uart(data, raw_data_len, ser, sim_timeout=False):
         data = data + "="*(chunk_size-data_modulo)
         print("Data size after padding {}".format(len(data)))
 
+    # the device acknowledges every chunk, that is all the flow control needed
+    start = time.monotonic()
     while data_sent < len(data):
         encode_and_send("{}".format(data[data_sent:data_sent + chunk_size]), ser)
-        time.sleep(0.01)
         data_sent += chunk_size
-        print("Total sent: {}".format(data_sent))
-        response = await_response("OK", ser)
+        log("Total sent: {}".format(data_sent))
+        response = await_response("OK", ser, quiet=not verbose)
 
         if sim_timeout:
             time.sleep(0.1)
@@ -73,17 +82,29 @@ def send_uart(data, raw_data_len, ser, sim_timeout=False):
             print("Data send time out. Terminating...")
             ser.close()
             sys.exit(1)
+    elapsed = time.monotonic() - start
+    print("Sent {} characters in {:.3f} s ({:.0f} B/s)".format(data_sent, elapsed, data_sent / elapsed))
 
     response = await_response_exact("END OUTPUT\r\n", ser)
     ser.close()
 
 if __name__ == "__main__":
-    ser = serial.Serial(sys.argv[2], 115200, timeout=0.050)
-    with open(sys.argv[1],'r') as f:
+    parser = argparse.ArgumentParser(description="Run the impulse on features from a file with AT+RUNIMPULSESTATIC")
+    parser.add_argument("features", help="features copied from the studio, comma separated")
+    parser.add_argument("port", help="serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("-v", "--verbose", action="store_true", help="print the data sent and every chunk reply")
+    args = parser.parse_args()
+    verbose = args.verbose
+
+    import serial
+
+    ser = serial.Serial(args.port, args.baud, timeout=0.050)
+    with open(args.features,'r') as f:
         data = f.read()
-        if 'image' in sys.argv[1]:
+        if 'image' in args.features:
             data = [float(int(num,16)) for num in data.split(',')]
         else:
             data = [float(num) for num in data.split(',')]
     encoded_data = base64_encode(data)
-    send_uart(encoded_data, len(data), ser, sim_timeout=False)
\ No newline at end of file
+    send_uart(encoded_data, len(data), ser, sim_timeout=False)
@@ -0,0 +1,172 @@
+/* Device side of test_binary_transfer.py: ei_binary_transfer.cpp with the serial
+ * hooks bound to one end of a pty, paced like a UART. Frames can be corrupted
+ * (bit flip or truncation) and ACK lines from the host dropped.
+ *
+ *   binary_transfer_device <pty> <data file> <bytes/s> <corrupt rate> <ack drop rate> <ack blackout ms> <seed>
+ *
+ * Prints the transfer result and stats as one line of key=value pairs */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ei_binary_transfer.h"
+#include "ei_device_interface.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+static int fd;
+static double bytes_per_s;
+static double corrupt_rate;
+static double ack_drop_rate;
+static uint64_t ack_blackout_until_ms;
+static std::mt19937 rng;
+static uint32_t corrupted, dropped_acks;
+
+static double uniform(void)
+{
+    return std::uniform_real_distribution<double>(0, 1)(rng);
+}
+
+/* Porting hooks, on the wall clock (the SDK's POSIX port times with the
+ * process CPU clock, which hardly moves while the device waits for ACKs) */
+uint64_t ei_read_timer_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ei_read_timer_ms(void)
+{
+    return ei_read_timer_us() / 1000;
+}
+
+void *ei_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void ei_free(void *ptr)
+{
+    free(ptr);
+}
+
+EI_IMPULSE_ERROR ei_sleep(int32_t time_ms)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(time_ms ? time_ms * 1000 : 200));
+    return EI_IMPULSE_OK;
+}
+
+static char read_char(void)
+{
+    char c;
+    if (read(fd, &c, 1) == 1) {
+        // the ESP32 console maps '\n' the same way
+        return c == '\n' ? '\r' : c;
+    }
+    return 0;
+}
+
+char ei_getchar(void)
+{
+    static bool line_start = true;
+    char c = read_char();
+
+    // drop a whole ACK line, waiting for the rest of it to arrive
+    while (c == 'A' && line_start
+        && (ei_read_timer_ms() < ack_blackout_until_ms || uniform() < ack_drop_rate)) {
+        dropped_acks++;
+        do {
+            c = read_char();
+            if (c == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        } while (c != '\r');
+        c = read_char();
+    }
+
+    if (c != 0) {
+        line_start = c == '\r';
+    }
+    return c;
+}
+
+void ei_write_string(char *data, int length)
+{
+    std::vector<char> frame(data, data + length);
+
+    if (length > 0 && uniform() < corrupt_rate) {
+        corrupted++;
+        if (uniform() < 0.5) {
+            frame[rng() % frame.size()] ^= 1 << (rng() % 8);
+        }
+        else {
+            const size_t start = rng() % frame.size();
+            frame.erase(frame.begin() + start, frame.begin() + std::min(frame.size(), start + 1 + rng() % 63));
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t offset = 0;
+    while (offset < frame.size()) {
+        const ssize_t written = write(fd, frame.data() + offset, frame.size() - offset);
+        if (written > 0) {
+            offset += written;
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    std::this_thread::sleep_until(start + std::chrono::microseconds((uint64_t)(frame.size() / bytes_per_s * 1e6)));
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 8) {
+        fprintf(stderr, "usage: %s pty data bytes_per_s corrupt_rate ack_drop_rate ack_blackout_ms seed\n", argv[0]);
+        return 2;
+    }
+
+    fd = open(argv[1], O_RDWR | O_NOCTTY);
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    tcsetattr(fd, TCSANOW, &t);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    FILE *f = fopen(argv[2], "rb");
+    std::vector<uint8_t> data;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        data.push_back((uint8_t)c);
+    }
+    fclose(f);
+
+    bytes_per_s = atof(argv[3]);
+    corrupt_rate = atof(argv[4]);
+    ack_drop_rate = atof(argv[5]);
+    ack_blackout_until_ms = ei_read_timer_ms() + atol(argv[6]);
+    rng.seed(atoi(argv[7]));
+
+    // as the AT command does before switching to the binary mode
+    const char *ok = "\r\nOK";
+    write(fd, ok, 4);
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool res = ei_binary_transfer_send_buffer(EI_BINARY_CONTENT_SAMPLE, data.data(), data.size());
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const char *end = "\r\nOK\r\n";
+    write(fd, end, 6);
+
+    ei_binary_transfer_stats_t stats;
+    ei_binary_transfer_get_stats(&stats);
+    printf("result=%d seconds=%.3f sent=%u resent=%u naks=%u timeouts=%u corrupted=%u dropped_acks=%u\n",
+        res, seconds, stats.frames_sent, stats.frames_resent, stats.naks, stats.timeouts, corrupted, dropped_acks);
+    return res ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+/* Keyword spotting impulse for the host tests of continuous classification:
+ * 16 kHz, 1 s window in 4 slices, one MFCC or MFE block and a learning block
+ * that records the normalized features it is given instead of running a model.
+ * Pulls in ei_run_classifier.h with the inferencing engine compiled out, the
+ * test links memory.cpp and kissfft (see CMakeLists.txt). */
+
+#ifndef EI_CONTINUOUS_IMPULSE_H
+#define EI_CONTINUOUS_IMPULSE_H
+
+#include <cstring>
+#include <vector>
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+// no model, whatever model is checked in
+#undef EI_CLASSIFIER_INFERENCING_ENGINE
+#define EI_CLASSIFIER_INFERENCING_ENGINE EI_CLASSIFIER_NONE
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+// referenced by model_variables.h
+TfLiteStatus tflite_learn_2888_init(void*(*)(size_t, size_t)) { return kTfLiteError; }
+TfLiteStatus tflite_learn_2888_input(int, TfLiteTensor*) { return kTfLiteError; }
+TfLiteStatus tflite_learn_2888_output(int, TfLiteTensor*) { return kTfLiteError; }
+TfLiteStatus tflite_learn_2888_invoke() { return kTfLiteError; }
+TfLiteStatus tflite_learn_2888_reset(void (*)(void*)) { return kTfLiteError; }
+EI_IMPULSE_ERROR run_nn_inference(const ei_impulse *, ei_feature_t *, uint32_t, uint32_t *, uint32_t,
+    ei_impulse_result_t *, void *, bool)
+{
+    return EI_IMPULSE_INFERENCE_ERROR;
+}
+
+#define KWS_FREQUENCY       16000
+#define KWS_WINDOW_SAMPLES  16000
+#define KWS_SLICES          4
+#define KWS_SLICE_SAMPLES   (KWS_WINDOW_SAMPLES / KWS_SLICES)
+
+/* Feature windows the learning block was given, one per inference */
+static std::vector<std::vector<float>> kws_captured;
+
+static EI_IMPULSE_ERROR kws_capture(const ei_impulse *, ei_feature_t *fmatrix, uint32_t, uint32_t *, uint32_t,
+    ei_impulse_result_t *result, void *, bool)
+{
+    const ei::matrix_t *m = fmatrix[0].matrix;
+    kws_captured.emplace_back(m->buffer, m->buffer + m->rows * m->cols);
+    result->classification[0].value = 1.0f;
+    return EI_IMPULSE_OK;
+}
+
+typedef enum { KWS_MFCC, KWS_MFE_V2, KWS_MFE_V4 } kws_block_t;
+
+static uint8_t kws_axes[] = { 0 };
+static const char *kws_categories[] = { "noise", "word" };
+static const uint32_t kws_learning_inputs[] = { 1 };
+
+static ei_dsp_config_mfcc_t kws_mfcc_config = {
+    1, 4, 1, nullptr, 0, 13, 0.02f, 0.02f, 32, 256, 101, 0, 0, 0.98f, 1
+};
+static ei_dsp_config_mfe_t kws_mfe_v2_config = {
+    1, 2, 1, nullptr, 0, 0.02f, 0.01f, 40, 256, 0, 0, 101, -52
+};
+static ei_dsp_config_mfe_t kws_mfe_v4_config = {
+    1, 4, 1, nullptr, 0, 0.032f, 0.016f, 40, 512, 0, 0, 101, -52
+};
+
+/* Features of one window of the block */
+static uint32_t kws_window_features(kws_block_t type)
+{
+    matrix_size_t size;
+    if (type == KWS_MFCC) {
+        size = speechpy::feature::calculate_mfcc_buffer_size(KWS_WINDOW_SAMPLES, KWS_FREQUENCY,
+            kws_mfcc_config.frame_length, kws_mfcc_config.frame_stride, kws_mfcc_config.num_cepstral,
+            kws_mfcc_config.implementation_version);
+    }
+    else {
+        const ei_dsp_config_mfe_t &c = type == KWS_MFE_V2 ? kws_mfe_v2_config : kws_mfe_v4_config;
+        size = speechpy::feature::calculate_mfe_buffer_size(KWS_WINDOW_SAMPLES, KWS_FREQUENCY,
+            c.frame_length, c.frame_stride, c.num_filters, c.implementation_version);
+    }
+    return size.rows * size.cols;
+}
+
+/* The impulse of a block type. Once per process: the continuous feature
+ * windows of ei_run_classifier.h are sized for the first impulse they see. */
+static const ei_impulse_t *kws_make_impulse(kws_block_t type)
+{
+    const uint32_t features = kws_window_features(type);
+    void *config = type == KWS_MFCC ? (void *)&kws_mfcc_config
+        : type == KWS_MFE_V2 ? (void *)&kws_mfe_v2_config : (void *)&kws_mfe_v4_config;
+    const uint16_t version = type == KWS_MFCC ? 4 : type == KWS_MFE_V2 ? 2 : 4;
+
+    static ei_model_dsp_t dsp_block;
+    dsp_block = {
+        1, features, type == KWS_MFCC ? &extract_mfcc_features : &extract_mfe_features,
+        config, kws_axes, 1, version, nullptr
+    };
+    static const ei_learning_block_t learning_block = {
+        2, false, &kws_capture, nullptr, EI_CLASSIFIER_IMAGE_SCALING_NONE, kws_learning_inputs, 1, 2
+    };
+
+    static const ei_impulse_t impulse = {
+        .project_id = 1,
+        .project_owner = "test",
+        .project_name = "kws",
+        .impulse_id = 1,
+        .impulse_name = "kws",
+        .deploy_version = 1,
+        .nn_input_frame_size = features,
+        .raw_sample_count = KWS_WINDOW_SAMPLES,
+        .raw_samples_per_frame = 1,
+        .dsp_input_frame_size = KWS_WINDOW_SAMPLES,
+        .input_width = 0,
+        .input_height = 0,
+        .input_frames = 0,
+        .interval_ms = 1000.0f / KWS_FREQUENCY,
+        .frequency = KWS_FREQUENCY,
+        .dsp_blocks_size = 1,
+        .dsp_blocks = &dsp_block,
+        .object_detection_count = 0,
+        .fomo_output_size = 0,
+        .visual_ad_grid_size_x = 0,
+        .visual_ad_grid_size_y = 0,
+        .tflite_output_features_count = 2,
+        .learning_blocks_size = 1,
+        .learning_blocks = &learning_block,
+        .postprocessing_blocks_size = 0,
+        .postprocessing_blocks = nullptr,
+        .inferencing_engine = EI_CLASSIFIER_NONE,
+        .sensor = EI_CLASSIFIER_SENSOR_MICROPHONE,
+        .fusion_string = "audio",
+        .slice_size = KWS_SLICE_SAMPLES,
+        .slices_per_model_window = KWS_SLICES,
+        .has_anomaly = EI_ANOMALY_TYPE_UNKNOWN,
+        .label_count = 2,
+        .categories = kws_categories,
+        .object_detection_nms = { 0.0f, 0.0f },
+    };
+    return &impulse;
+}
+
+/* signal_t over a slice of int16 audio */
+static const int16_t *kws_signal_audio;
+
+static int kws_get_data(size_t offset, size_t length, float *out_ptr)
+{
+    return ei::numpy::int16_to_float(kws_signal_audio + offset, out_ptr, length);
+}
+
+static signal_t kws_signal(const int16_t *audio, size_t length)
+{
+    kws_signal_audio = audio;
+    signal_t signal;
+    signal.total_length = length;
+    signal.get_data = &kws_get_data;
+    return signal;
+}
+
+#endif // EI_CONTINUOUS_IMPULSE_H
@@ -0,0 +1,190 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_FLASH_FILE_SIM_H
+#define EI_FLASH_FILE_SIM_H
+
+/* Include ----------------------------------------------------------------- */
+#include "firmware-sdk/ei_device_memory.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * @brief NOR flash simulated in a file, for running the sample store on a host.
+ * Erase sets bytes to 0xFF, programming can only clear bits. A power loss can
+ * be injected: the selected program or erase is cut at a random byte and every
+ * operation after it fails, as the device is gone. Reopen the file with a new
+ * instance to model the next boot.
+ */
+class EiFlashFileSim : public EiDeviceMemory {
+protected:
+    FILE *file;
+    uint32_t ops;
+    uint32_t cut_at_op;
+    unsigned int cut_seed;
+    bool powered;
+    uint32_t *erase_counts;
+
+    uint32_t read_data(uint8_t *data, uint32_t address, uint32_t num_bytes) override
+    {
+        if (num_bytes > memory_size - address) {
+            num_bytes = memory_size - address;
+        }
+        if (fseek(file, address, SEEK_SET) != 0) {
+            return 0;
+        }
+
+        return fread(data, 1, num_bytes, file);
+    }
+
+    uint32_t write_data(const uint8_t *data, uint32_t address, uint32_t num_bytes) override
+    {
+        uint8_t current[256];
+
+        if (num_bytes > memory_size - address) {
+            num_bytes = memory_size - address;
+        }
+        uint32_t n_apply = power_step(num_bytes);
+
+        for (uint32_t done = 0; done < n_apply;) {
+            uint32_t chunk = n_apply - done < sizeof(current) ? n_apply - done : sizeof(current);
+            read_data(current, address + done, chunk);
+            for (uint32_t ix = 0; ix < chunk; ix++) {
+                current[ix] &= data[done + ix];
+            }
+            fseek(file, address + done, SEEK_SET);
+            fwrite(current, 1, chunk, file);
+            done += chunk;
+        }
+        fflush(file);
+
+        return powered ? num_bytes : 0;
+    }
+
+    uint32_t erase_data(uint32_t address, uint32_t num_bytes) override
+    {
+        uint8_t erased[256];
+
+        memset(erased, 0xFF, sizeof(erased));
+        if (num_bytes > memory_size - address) {
+            num_bytes = memory_size - address;
+        }
+        uint32_t n_apply = power_step(num_bytes);
+
+        for (uint32_t done = 0; done < n_apply;) {
+            uint32_t chunk = n_apply - done < sizeof(erased) ? n_apply - done : sizeof(erased);
+            fseek(file, address + done, SEEK_SET);
+            fwrite(erased, 1, chunk, file);
+            done += chunk;
+        }
+        fflush(file);
+
+        for (uint32_t block = address / block_size; block * block_size < address + num_bytes; block++) {
+            erase_counts[block]++;
+        }
+
+        return powered ? num_bytes : 0;
+    }
+
+    /**
+     * @brief Bytes of the next operation that reach the flash
+     */
+    uint32_t power_step(uint32_t num_bytes)
+    {
+        if (!powered) {
+            return 0;
+        }
+        if (++ops == cut_at_op) {
+            powered = false;
+            return num_bytes ? rand_r(&cut_seed) % num_bytes : 0;
+        }
+
+        return num_bytes;
+    }
+
+public:
+    EiFlashFileSim(const char *path, uint32_t config_size, uint32_t block_size, uint32_t blocks)
+        : EiDeviceMemory(config_size, 0, block_size * blocks, block_size)
+        , ops(0)
+        , cut_at_op(0)
+        , cut_seed(0)
+        , powered(true)
+    {
+        erase_counts = (uint32_t *)calloc(blocks, sizeof(uint32_t));
+
+        file = fopen(path, "r+b");
+        if (file == nullptr) {
+            // blank chip
+            file = fopen(path, "w+b");
+            for (uint32_t ix = 0; ix < memory_size; ix++) {
+                fputc(0xFF, file);
+            }
+            fflush(file);
+        }
+    }
+
+    ~EiFlashFileSim()
+    {
+        fclose(file);
+        free(erase_counts);
+    }
+
+    /**
+     * @brief Cut the power during the n-th program or erase from now, 0 disables
+     */
+    void power_loss_after(uint32_t n_ops, unsigned int seed)
+    {
+        ops = 0;
+        cut_at_op = n_ops;
+        cut_seed = seed;
+    }
+
+    bool is_powered(void)
+    {
+        return powered;
+    }
+
+    uint32_t get_ops(void)
+    {
+        return ops;
+    }
+
+    uint32_t erase_count(uint32_t block)
+    {
+        return erase_counts[block];
+    }
+};
+
+#endif /* EI_FLASH_FILE_SIM_H */
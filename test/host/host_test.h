@@ -0,0 +1,21 @@
+/* Minimal checks for the host tests, a failed check is reported and counted */
+
+#ifndef EI_HOST_TEST_H
+#define EI_HOST_TEST_H
+
+#include <cstdio>
+
+static int host_test_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() \
+    (printf("%s\n", host_test_failures ? "FAILED" : "OK"), host_test_failures ? 1 : 0)
+
+#endif /* EI_HOST_TEST_H */
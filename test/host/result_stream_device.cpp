@@ -0,0 +1,116 @@
+/* Device side of test_result_stream.py: ei_result_stream.cpp with its stdout
+ * (the UART on the ESP32) on one end of a pty and the POSIX drain thread.
+ *
+ *   result_stream_device <pty> frames   results and error records, paced
+ *   result_stream_device <pty> burst    maximum size records as fast as possible
+ *
+ * frames pushes 200 frames: every 50th an error record, the others 0-4 boxes
+ * derived from the frame number (see expected_frame() in the test), frame 198
+ * a maximum size record of 255 boxes (300 detected). Some text goes out before the
+ * stream starts. burst pushes 100 records of 3086 bytes into the 4096 byte
+ * ring while the host is not reading, so most of them must be dropped whole.
+ * The stream statistics go to stderr as "written=.. dropped=.. bytes=.." */
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ei_result_stream.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+uint64_t ei_read_timer_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ei_read_timer_ms(void)
+{
+    return ei_read_timer_us() / 1000;
+}
+
+EI_IMPULSE_ERROR ei_sleep(int32_t time_ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(time_ms));
+    return EI_IMPULSE_OK;
+}
+
+static const char *categories[] = { "nam", "tram" };
+
+static void push_frame(uint32_t frame_id, uint32_t box_count)
+{
+    std::vector<ei_impulse_result_bounding_box_t> boxes(box_count);
+    ei_impulse_result_t result;
+    memset(&result, 0, sizeof(result));
+    for (uint32_t ix = 0; ix < box_count; ix++) {
+        ei_impulse_result_bounding_box_t &bb = boxes[ix];
+        bb.label = categories[(frame_id + ix) % 2];
+        bb.value = 0.5f + (float)((frame_id * 7 + ix) % 50) / 100.0f;
+        bb.x = (frame_id + ix * 8) % 96;
+        bb.y = ix % 96;
+        bb.width = 8 + ix % 4;
+        bb.height = 8;
+    }
+    result.bounding_boxes = boxes.data();
+    result.bounding_boxes_count = box_count;
+    result.timing.dsp_us = 1000 + frame_id;
+    result.timing.classification_us = 20000 + frame_id;
+    result.timing.anomaly_us = 0;
+
+    ei_result_stream_push(&result, categories, 2, frame_id, frame_id * 100);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s pty frames|burst\n", argv[0]);
+        return 2;
+    }
+
+    const int fd = open(argv[1], O_RDWR | O_NOCTTY);
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    tcsetattr(fd, TCSANOW, &t);
+    dup2(fd, STDOUT_FILENO);
+
+    printf("Inferencing settings:\r\n\tImage resolution: 96x96\r\n");
+    fflush(stdout);
+
+    ei_result_stream_set_mode(EI_RESULT_OUTPUT_BINARY);
+    if (!ei_result_stream_start()) {
+        fprintf(stderr, "failed to start the result stream\n");
+        return 1;
+    }
+
+    if (strcmp(argv[2], "burst") == 0) {
+        for (uint32_t frame_id = 0; frame_id < 100; frame_id++) {
+            push_frame(frame_id, EI_RESULT_RECORD_MAX_ENTRIES);
+        }
+    }
+    else {
+        for (uint32_t frame_id = 0; frame_id < 200; frame_id++) {
+            if (frame_id % 50 == 49) {
+                ei_result_stream_push_error(EI_RESULT_ERROR_IMPULSE, -5, frame_id, frame_id * 100);
+            }
+            else {
+                // more boxes than a record holds in frame 198, the record is capped
+                push_frame(frame_id, frame_id == 198 ? 300 : frame_id % 5);
+            }
+            ei_sleep(1);
+        }
+    }
+
+    ei_result_stream_flush(20000);
+    ei_result_stream_stats_t stats;
+    ei_result_stream_get_stats(&stats);
+    fprintf(stderr, "written=%u dropped=%u bytes=%u\n", stats.records_written, stats.records_dropped, stats.bytes_sent);
+    return 0;
+}
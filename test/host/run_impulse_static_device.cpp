@@ -0,0 +1,206 @@
+/* Device side of test_run_impulse_static.py: run_impulse_static_data() from
+ * ei_device_lib.cpp behind a minimal AT loop, with the serial hooks bound to one
+ * end of a pty and the reception paced like a UART. run_classifier() is a stand-in
+ * that prints a checksum of the features it is given.
+ *
+ *   run_impulse_static_device <pty> <chunk size> <bytes/s>
+ *
+ * Built twice: with the bulk ei_read_string() of the ESP32 port, and with
+ * RUN_IMPULSE_STATIC_GETCHAR on the weak ei_getchar() fallback */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ei_device_info_lib.h"
+#include "ei_device_interface.h"
+#include "ei_device_lib.h"
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "model-parameters/model_metadata.h"
+
+static int fd;
+static double bytes_per_s;
+static uint64_t rx_start_us;
+static size_t rx_total;
+
+/* Porting hooks, on the wall clock (the SDK's POSIX port times with the
+ * process CPU clock, which hardly moves while the device waits for the host) */
+uint64_t ei_read_timer_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ei_read_timer_ms(void)
+{
+    return ei_read_timer_us() / 1000;
+}
+
+void *ei_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *ei_calloc(size_t nitems, size_t size)
+{
+    return calloc(nitems, size);
+}
+
+void ei_free(void *ptr)
+{
+    free(ptr);
+}
+
+EI_IMPULSE_ERROR ei_sleep(int32_t time_ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(time_ms));
+    return EI_IMPULSE_OK;
+}
+
+void ei_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vdprintf(fd, format, args);
+    va_end(args);
+}
+
+void ei_printf_float(float f)
+{
+    ei_printf("%f", f);
+}
+
+void ei_write_string(char *data, int length)
+{
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+        if (written > 0) {
+            data += written;
+            length -= written;
+        }
+    }
+}
+
+/* Characters the simulated UART has delivered since the transfer started */
+static size_t rx_allowed(size_t wanted)
+{
+    const double allowed = (ei_read_timer_us() - rx_start_us) / 1e6 * bytes_per_s - rx_total;
+    return allowed < 1 ? 0 : std::min(wanted, (size_t)allowed);
+}
+
+char ei_getchar(void)
+{
+    char c;
+    if (rx_allowed(1) == 1 && read(fd, &c, 1) == 1) {
+        rx_total++;
+        // the ESP32 console maps '\n' the same way
+        return c == '\n' ? '\r' : c;
+    }
+    return 0;
+}
+
+#ifndef RUN_IMPULSE_STATIC_GETCHAR
+int ei_read_string(char *data, int max_length)
+{
+    const size_t allowed = rx_allowed(max_length);
+    const ssize_t length = allowed ? read(fd, data, allowed) : 0;
+
+    if (length <= 0) {
+        return 0;
+    }
+    rx_total += length;
+    return (int)length;
+}
+#endif
+
+EiDeviceInfo *EiDeviceInfo::get_device(void)
+{
+    return nullptr;
+}
+
+extern "C" EI_IMPULSE_ERROR run_classifier(ei::signal_t *signal, ei_impulse_result_t *result, bool debug)
+{
+    static ei_impulse_result_bounding_box_t boxes[EI_CLASSIFIER_OBJECT_DETECTION_COUNT] = {};
+    double sum = 0;
+    float values[64];
+
+    // weighted, so that misplaced features show up as well
+    for (size_t offset = 0; offset < signal->total_length; offset += 64) {
+        const size_t n = std::min<size_t>(64, signal->total_length - offset);
+        signal->get_data(offset, n, values);
+        for (size_t ix = 0; ix < n; ix++) {
+            sum += values[ix] * (double)((offset + ix) % 7 + 1);
+        }
+    }
+    ei_printf("CHECKSUM %.3f\r\n", sum);
+
+    for (auto &box : boxes) {
+        box.label = "none";
+    }
+    result->bounding_boxes = boxes;
+    result->bounding_boxes_count = 0;
+    return EI_IMPULSE_OK;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s pty chunk_size bytes_per_s\n", argv[0]);
+        return 2;
+    }
+
+    fd = open(argv[1], O_RDWR | O_NOCTTY);
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    tcsetattr(fd, TCSANOW, &t);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    const size_t chunk_size = atoi(argv[2]);
+    bytes_per_s = atof(argv[3]);
+
+    // just enough of the AT server for the host tool
+    std::string line;
+    for (;;) {
+        char c;
+        if (read(fd, &c, 1) != 1) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        if (c == '\n') {
+            continue;
+        }
+        if (c != '\r') {
+            line += c;
+            continue;
+        }
+
+        if (line == "AT") {
+            ei_printf("\r\n> ");
+        }
+        else if (line.rfind("AT+RUNIMPULSESTATIC=", 0) == 0) {
+            // AT+RUNIMPULSESTATIC=<debug y/n>,<number of features>
+            const bool debug = line[20] == 'y';
+            const size_t length = atoi(line.c_str() + 22);
+            rx_start_us = ei_read_timer_us();
+            rx_total = 0;
+            const bool res = run_impulse_static_data(debug, length, chunk_size);
+            printf("result=%d\n", res);
+            fflush(stdout);
+            ei_printf("> ");
+        }
+        else if (line == "QUIT") {
+            return 0;
+        }
+        line.clear();
+    }
+}
@@ -0,0 +1,285 @@
+/* Device side of test_sample_readback.py: the AT+READBUFFER helpers of
+ * ei_device_lib.cpp over an EiDeviceRAM holding the same recording twice, packed
+ * with ei_sample_codec.h as the microphone stores it and raw.
+ *
+ *   sample_readback_device <expected file> check
+ *   sample_readback_device <expected file> send <pty> <packed|raw> <length>
+ *
+ * Both write the recording, as the daemon has to receive it, to the expected
+ * file. check runs the base64 readback in process: whole samples, prefixes,
+ * offsets into the raw sample, and offset reads into the packed one, which
+ * must be refused. send runs the binary transfer over a pty */
+
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "at_base64_lib.h"
+#include "ei_device_info_lib.h"
+#include "ei_device_lib.h"
+#include "ei_sample_codec.h"
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+static int fd = -1;
+static bool capturing;
+static std::string console;
+static std::string serial;
+
+/* Porting hooks, on the wall clock (the SDK's POSIX port times with the
+ * process CPU clock, which hardly moves while the device waits for ACKs) */
+uint64_t ei_read_timer_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ei_read_timer_ms(void)
+{
+    return ei_read_timer_us() / 1000;
+}
+
+void *ei_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *ei_calloc(size_t nitems, size_t size)
+{
+    return calloc(nitems, size);
+}
+
+void ei_free(void *ptr)
+{
+    free(ptr);
+}
+
+EI_IMPULSE_ERROR ei_sleep(int32_t time_ms)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(time_ms ? time_ms * 1000 : 200));
+    return EI_IMPULSE_OK;
+}
+
+void ei_printf(const char *format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (capturing) {
+        console += buf;
+    }
+    else {
+        fputs(buf, stderr);
+    }
+}
+
+void ei_printf_float(float f)
+{
+    ei_printf("%f", f);
+}
+
+char ei_getchar(void)
+{
+    char c;
+    if (fd >= 0 && read(fd, &c, 1) == 1) {
+        return c == '\n' ? '\r' : c;
+    }
+    return 0;
+}
+
+void ei_write_string(char *data, int length)
+{
+    if (capturing) {
+        serial.append(data, length);
+        return;
+    }
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+        if (written > 0) {
+            data += written;
+            length -= written;
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+extern "C" EI_IMPULSE_ERROR run_classifier(ei::signal_t *signal, ei_impulse_result_t *result, bool debug)
+{
+    return EI_IMPULSE_OK;
+}
+
+class TestDevice : public EiDeviceInfo {
+public:
+    TestDevice(void)
+    {
+        memory = new EiDeviceRAM<4096, 256>(0);
+    }
+
+    void init_device_id(void) override
+    {
+    }
+};
+
+static TestDevice device;
+
+EiDeviceInfo *EiDeviceInfo::get_device(void)
+{
+    return &device;
+}
+
+static const size_t packed_address = 8192;
+static const size_t raw_address = 524288;
+static size_t packed_length;
+static size_t raw_length;
+
+/* What the sample store index resolves on the device */
+size_t ei_get_sample_start(size_t address)
+{
+    if (address >= packed_address && address < packed_address + packed_length) {
+        return packed_address;
+    }
+    if (address >= raw_address && address < raw_address + raw_length) {
+        return raw_address;
+    }
+    return address;
+}
+
+/* A CBOR header and 10 s of speech like audio at 16 kHz with the microphone gain of 8 */
+static std::vector<uint8_t> make_recording(std::vector<uint8_t> &header, std::vector<int16_t> &samples)
+{
+    std::mt19937 rng(5);
+    std::normal_distribution<double> noise(0, 20);
+    header.resize(77);
+    for (size_t ix = 0; ix < header.size(); ix++) {
+        header[ix] = 0xBF ^ ix;
+    }
+    samples.resize(160000);
+    double phase = 0;
+    for (size_t ix = 0; ix < samples.size(); ix++) {
+        const double t = ix / 16000.0;
+        phase += 2 * M_PI * (140 + 60 * sin(2 * M_PI * 0.7 * t)) / 16000.0;
+        const double v = std::max(0.0, sin(2 * M_PI * 3 * t)) * (900 * sin(phase) + 400 * sin(2 * phase)) + noise(rng);
+        samples[ix] = (int16_t)lround(v) * 8;
+    }
+
+    std::vector<uint8_t> recording(header);
+    recording.insert(recording.end(), (const uint8_t *)samples.data(), (const uint8_t *)(samples.data() + samples.size()));
+    return recording;
+}
+
+/* Packed as the microphone path does: container header, raw header, I2S reads of 2048 samples */
+static std::vector<uint8_t> pack(const std::vector<uint8_t> &header, const std::vector<int16_t> &samples)
+{
+    std::vector<uint8_t> out(EI_SAMPLE_CODEC_HEADER_SIZE);
+    ei_sample_encode_header(out.data(), header.size(), 1);
+    out.insert(out.end(), header.begin(), header.end());
+
+    ei_sample_encoder_t encoder;
+    ei_sample_encoder_init(&encoder, 1);
+    std::vector<uint8_t> buf(EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(2048));
+    for (size_t pos = 0; pos < samples.size(); pos += 2048) {
+        const int n = ei_sample_encode(&encoder, &samples[pos], std::min<size_t>(2048, samples.size() - pos), buf.data(), buf.size());
+        out.insert(out.end(), buf.begin(), buf.begin() + n);
+    }
+    const int n = ei_sample_encode_finish(&encoder, buf.data(), buf.size());
+    out.insert(out.end(), buf.begin(), buf.begin() + n);
+    return out;
+}
+
+static int failures;
+
+static void check(bool cond, const char *what)
+{
+    if (!cond) {
+        printf("check failed: %s\n", what);
+        failures++;
+    }
+}
+
+/* Base64 readback, returns the decoded bytes sent; console gets the text output */
+static bool read_base64(size_t address, size_t length, std::vector<uint8_t> &out)
+{
+    serial.clear();
+    console.clear();
+    const bool res = read_encode_send_sample_buffer(address, length);
+    out = base64_decode(serial);
+    return res;
+}
+
+static void run_checks(const std::vector<uint8_t> &expected)
+{
+    capturing = true;
+    std::vector<uint8_t> out;
+
+    check(read_base64(packed_address, expected.size(), out) && out == expected, "packed: whole sample");
+    check(read_base64(raw_address, expected.size(), out) && out == expected, "raw: whole sample");
+    check(read_base64(packed_address, 1000, out)
+        && out == std::vector<uint8_t>(expected.begin(), expected.begin() + 1000), "packed: prefix");
+    check(read_base64(raw_address + 4096, 1000, out)
+        && out == std::vector<uint8_t>(expected.begin() + 4096, expected.begin() + 5096), "raw: offset read");
+
+    // an offset into the decoded sample does not map to an address in flash
+    check(!read_base64(packed_address + 4096, 1000, out) && serial.empty()
+        && console.find("ERR: Packed sample") == 0, "packed: offset read refused");
+    console.clear();
+    check(!read_send_sample_buffer_binary(packed_address + 1, 1000)
+        && console.find("ERR: Packed sample") == 0, "packed: binary offset read refused");
+
+    capturing = false;
+    printf("stored %zu bytes packed for %zu, %s\n", packed_length, raw_length, failures ? "FAILED" : "OK");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || (strcmp(argv[2], "send") == 0 && argc != 6)) {
+        fprintf(stderr, "usage: %s expected_file check | send pty packed|raw length\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> header;
+    std::vector<int16_t> samples;
+    const std::vector<uint8_t> recording = make_recording(header, samples);
+    const std::vector<uint8_t> packed = pack(header, samples);
+    EiDeviceMemory *memory = device.get_memory();
+    packed_length = packed.size();
+    raw_length = recording.size();
+    memory->write_sample_data(packed.data(), packed_address, packed.size());
+    memory->write_sample_data(recording.data(), raw_address, recording.size());
+
+    FILE *f = fopen(argv[1], "wb");
+    fwrite(recording.data(), 1, recording.size(), f);
+    fclose(f);
+
+    if (strcmp(argv[2], "check") == 0) {
+        run_checks(recording);
+        return failures ? 1 : 0;
+    }
+
+    fd = open(argv[3], O_RDWR | O_NOCTTY);
+    struct termios t;
+    tcgetattr(fd, &t);
+    cfmakeraw(&t);
+    tcsetattr(fd, TCSANOW, &t);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    const size_t address = strcmp(argv[4], "packed") == 0 ? packed_address : raw_address;
+    const bool res = read_send_sample_buffer_binary(address, atoi(argv[5]));
+    const char *end = "\r\nOK\r\n";
+    ei_write_string((char *)end, 6);
+    return res ? 0 : 1;
+}
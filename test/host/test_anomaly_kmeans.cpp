@@ -0,0 +1,197 @@
+/* K-means anomaly scorer (inferencing_engines/anomaly.h) against the reference
+ * scorer it replaced: standard scaler, then the minimum over all clusters of
+ * sqrt(sum (x - c)^2) - max_error, starting at 1000. Random models with inputs
+ * near a cluster, between clusters and far outside the training range, so the
+ * early exit abandons most clusters and the int8 scorer has to fall back to
+ * float for saturated inputs.
+ * Built twice: test_anomaly_kmeans (float) and test_anomaly_kmeans_int8
+ * (EI_CLASSIFIER_ANOMALY_KMEANS_INT8=1) */
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+// the k-means scorer, whatever model is checked in
+#undef EI_CLASSIFIER_HAS_ANOMALY
+#define EI_CLASSIFIER_HAS_ANOMALY 1
+#undef EI_CLASSIFIER_INFERENCING_ENGINE
+#define EI_CLASSIFIER_INFERENCING_ENGINE EI_CLASSIFIER_NONE
+
+#include "edge-impulse-sdk/classifier/inferencing_engines/anomaly.h"
+#include "host_test.h"
+
+typedef struct {
+    std::vector<uint16_t> axis;
+    std::vector<std::vector<float>> centroids;
+    std::vector<ei_classifier_anom_cluster_t> clusters;
+    std::vector<float> scale;
+    std::vector<float> mean;
+    ei_learning_block_config_anomaly_kmeans_t config;
+} model_t;
+
+static void make_model(model_t &m, std::mt19937 &rng, size_t input_size, size_t cluster_count)
+{
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uniform(0.2f, 3.0f);
+
+    m.axis.resize(input_size);
+    m.scale.resize(input_size);
+    m.mean.resize(input_size);
+    for (size_t ix = 0; ix < input_size; ix++) {
+        m.axis[ix] = (uint16_t)ix;
+        m.scale[ix] = uniform(rng);
+        m.mean[ix] = normal(rng) * 5.0f;
+    }
+    m.centroids.assign(cluster_count, std::vector<float>(input_size));
+    m.clusters.resize(cluster_count);
+    for (size_t c = 0; c < cluster_count; c++) {
+        for (size_t ix = 0; ix < input_size; ix++) {
+            m.centroids[c][ix] = normal(rng) * 1.5f;
+        }
+        m.clusters[c].centroid = m.centroids[c].data();
+        m.clusters[c].max_error = uniform(rng) * 0.5f;
+    }
+
+    memset(&m.config, 0, sizeof(m.config));
+    m.config.implementation_version = 1;
+    m.config.anom_axis = m.axis.data();
+    m.config.anom_axes_size = (uint16_t)input_size;
+    m.config.anom_clusters = m.clusters.data();
+    m.config.anom_cluster_count = (uint16_t)cluster_count;
+    m.config.anom_scale = m.scale.data();
+    m.config.anom_mean = m.mean.data();
+}
+
+/* The scorer before the early exit, as it was in anomaly.h */
+static float reference_score(const model_t &m, const float *raw)
+{
+    const size_t input_size = m.axis.size();
+    std::vector<float> input(raw, raw + input_size);
+    for (size_t ix = 0; ix < input_size; ix++) {
+        input[ix] = (input[ix] - m.mean[ix]) / m.scale[ix];
+    }
+    float min = 1000.0f;
+    for (const ei_classifier_anom_cluster_t &cluster : m.clusters) {
+        float dist = 0.0f;
+        for (size_t ix = 0; ix < input_size; ix++) {
+            dist += pow(input[ix] - cluster.centroid[ix], 2);
+        }
+        dist = sqrt(dist) - cluster.max_error;
+        if (dist < min) {
+            min = dist;
+        }
+    }
+    return min;
+}
+
+/* Raw input at a random point around centroid c, spread in scaled units */
+static std::vector<float> raw_input(const model_t &m, std::mt19937 &rng, size_t c, float spread)
+{
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> raw(m.axis.size());
+    for (size_t ix = 0; ix < raw.size(); ix++) {
+        raw[ix] = (m.centroids[c][ix] + normal(rng) * spread) * m.scale[ix] + m.mean[ix];
+    }
+    return raw;
+}
+
+/* Scores through run_kmeans_anomaly() from a single feature matrix */
+static float run_score(const model_t &m, const std::vector<float> &raw)
+{
+    ei::matrix_t matrix(1, raw.size());
+    memcpy(matrix.buffer, raw.data(), raw.size() * sizeof(float));
+    ei_feature_t fmatrix[1] = { { &matrix, 0 } };
+    uint32_t input_block_ids[1] = { 0 };
+    ei_impulse_t impulse = {};
+    ei_impulse_result_t result;
+    memset(&result, 0, sizeof(result));
+    CHECK(run_kmeans_anomaly(&impulse, fmatrix, 0, input_block_ids, 1, &result, (void *)&m.config) == EI_IMPULSE_OK);
+    return result.anomaly;
+}
+
+/* Largest score error the scorer may make on a model: float rounding, or for
+ * int8 half a quantization step on every center and input value */
+static float tolerance(const model_t &m)
+{
+#if EI_CLASSIFIER_ANOMALY_KMEANS_INT8 == 1
+    float max_abs = 0.0f;
+    for (const std::vector<float> &centroid : m.centroids) {
+        for (float v : centroid) {
+            max_abs = std::max(max_abs, fabsf(v));
+        }
+    }
+    return sqrtf((float)m.axis.size()) * (max_abs / 127.0f) + 1e-3f;
+#else
+    (void)m;
+    return 1e-3f;
+#endif
+}
+
+static void test_random_models()
+{
+    std::mt19937 rng(29);
+    const size_t shapes[][2] = { { 1, 1 }, { 3, 4 }, { 7, 12 }, { 16, 32 }, { 33, 9 }, { 64, 50 } };
+    const float spreads[] = { 0.05f, 0.5f, 2.0f, 40.0f };
+    float max_error = 0.0f;
+    size_t scored = 0;
+
+    for (const auto &shape : shapes) {
+        for (int rep = 0; rep < 5; rep++) {
+            model_t m;
+            make_model(m, rng, shape[0], shape[1]);
+            const float tol = tolerance(m);
+            for (float spread : spreads) {
+                for (size_t c = 0; c < shape[1]; c++) {
+                    std::vector<float> raw = raw_input(m, rng, c, spread);
+                    const float ref = reference_score(m, raw.data());
+                    const float score = run_score(m, raw);
+                    const float err = fabsf(score - ref);
+                    max_error = std::max(max_error, err);
+                    if (!(err <= tol + fabsf(ref) * 1e-5f)) {
+                        printf("inputs %zu clusters %zu spread %.2f: score %f reference %f\n",
+                            shape[0], shape[1], spread, score, ref);
+                    }
+                    CHECK(err <= tol + fabsf(ref) * 1e-5f);
+                    scored++;
+                }
+            }
+            // the scorer is keyed on the config address, the next model may reuse it
+            ei_kmeans_scorer_deinit();
+        }
+    }
+    printf("%zu scores, largest difference to the reference %g\n", scored, max_error);
+}
+
+/* The scorer follows the config it is given and is released on deinit */
+static void test_switch_and_deinit()
+{
+    std::mt19937 rng(7);
+    model_t a, b;
+    make_model(a, rng, 10, 6);
+    make_model(b, rng, 20, 3);
+
+    std::vector<float> raw_a = raw_input(a, rng, 2, 0.5f);
+    std::vector<float> raw_b = raw_input(b, rng, 1, 0.5f);
+    CHECK(fabsf(run_score(a, raw_a) - reference_score(a, raw_a.data())) <= tolerance(a));
+    CHECK(kmeans_scorer.config == &a.config && kmeans_scorer.input_size == 10);
+    CHECK(fabsf(run_score(b, raw_b) - reference_score(b, raw_b.data())) <= tolerance(b));
+    CHECK(kmeans_scorer.config == &b.config && kmeans_scorer.input_size == 20);
+
+    ei_kmeans_scorer_deinit();
+    CHECK(kmeans_scorer.config == NULL);
+    CHECK(kmeans_scorer.input == NULL && kmeans_scorer.inv_scale == NULL && kmeans_scorer.max_error == NULL);
+
+    // built again on the next call
+    CHECK(fabsf(run_score(a, raw_a) - reference_score(a, raw_a.data())) <= tolerance(a));
+    ei_kmeans_scorer_deinit();
+}
+
+int main()
+{
+    test_random_models();
+    test_switch_and_deinit();
+    return TEST_RESULT();
+}
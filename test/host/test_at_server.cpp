@@ -0,0 +1,222 @@
+/* AT server replay: a scripted console session (write, read and run commands,
+ * unknown commands, backspace and cursor editing, history recall) goes through
+ * ATServer::handle() one character at a time, with the ESP32 command names
+ * registered. The console output and the write handler arguments must match
+ * at_server_session.txt byte for byte; that file was recorded with the
+ * std::string / std::vector server the hashed, allocation-free one replaced.
+ * Handling a line must not allocate.
+ *
+ *   test_at_server <session file> [record]
+ *
+ * With "record", the session file is written instead of compared */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "ei_at_server.h"
+#include "host_test.h"
+
+/* Count the heap allocations of the whole process (glibc) */
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nitems, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static bool counting;
+static size_t allocations;
+
+extern "C" void *malloc(size_t size)
+{
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t nitems, size_t size)
+{
+    allocations += counting;
+    return __libc_calloc(nitems, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocations += counting;
+    return __libc_realloc(ptr, size);
+}
+
+/* The console, kept while capturing, otherwise only counted */
+static bool capturing;
+static std::string console;
+static size_t console_bytes;
+
+static void console_write(const char *data, size_t length)
+{
+    console_bytes += length;
+    if (capturing) {
+        console.append(data, length);
+    }
+}
+
+void ei_printf(const char *format, ...)
+{
+    char buf[1024];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    console_write(buf, std::min<size_t>(length, sizeof(buf) - 1));
+}
+
+void ei_putchar(char c)
+{
+    console_write(&c, 1);
+}
+
+static bool run_handler(void)
+{
+    console_write("[run]", 5);
+    return true;
+}
+
+static bool read_handler(void)
+{
+    console_write("[read]", 6);
+    return true;
+}
+
+static bool write_handler(const char **argv, const int argc)
+{
+    char buf[32];
+    console_write(buf, snprintf(buf, sizeof(buf), "[write %d", argc));
+    for (int ix = 0; ix < argc; ix++) {
+        console_write("|", 1);
+        console_write(argv[ix], strlen(argv[ix]));
+    }
+    console_write("]", 1);
+    return true;
+}
+
+static const char *commands[] = {
+    "CONFIG", "SAMPLESETTINGS", "UPLOADSETTINGS", "UPLOADHOST", "SAMPLESTART", "READFILE",
+    "READBUFFER", "UNLINKFILE", "LISTFILES", "CLEARFILES", "RUNIMPULSE", "RUNIMPULSEDEBUG",
+    "RUNIMPULSECONT", "RUNIMPULSEBIN", "RUNIMPULSESTATIC", "SNAPSHOT", "SNAPSHOTSTREAM",
+    "DEVICEID", "DEVICETYPE", "INGESTIONCYCLESETTINGS", "INGESTIONCYCLESTART", "UPLOADSTREAM",
+    "MGMTSETTINGS",
+};
+
+static const char *script[] = {
+    "AT+CONFIG?\r",
+    "AT+SAMPLESETTINGS=label,10,1000,key\r",
+    "AT+SNAPSHOT=96,96,b\r",
+    "AT+SNAPSHOTSTREAM=160,120,y,2\r",
+    "AT+READBUFFER=0,16384\r",
+    "AT+RUNIMPULSE\r",
+    "  AT+DEVICEID=abcdef  \r",
+    "AT+UNKNOWNCMD\r",
+    "AT+LISTFILES\r",
+    "hello\r",
+    "AT+SAMPLESETTINGS=,,\r",
+    "AT+UPLOADSETTINGS=ei_0123456789abcdef0123456789abcdef,/api/training/data\r",
+    "AT+DEVICETYPE=a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p\r",
+    "AT+SNAPSHOX\x7f" "T=1,2\r",                   // backspace editing
+    "\x1b[A\r",                                      // recall the last line
+    "\x1b[A\x1b[A\x1b[A\x1b[B\r",                    // up three, down one
+    "\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\x1b[A\r", // past the oldest
+    "AT+CONFIG\x1b[D\x1b[D\x1b[3~X\r",               // cursor, delete, insert
+    "AT+SAMPLESTART=x\x1b[H\x1b[C\x1b[C\x1b[C\x7f\r",
+    "AT+HELP\r",
+    "AT+HELP?\r",
+};
+
+static void replay(ATServer *at)
+{
+    for (const char *line : script) {
+        for (const char *c = line; *c; c++) {
+            at->handle(*c);
+        }
+    }
+}
+
+/* at_info() prints the build date and time */
+static std::string strip_build_time(std::string s)
+{
+    for (const char *field : { "Firmware build date  : ", "Firmware build time  : " }) {
+        size_t pos = s.find(field);
+        while (pos != std::string::npos) {
+            const size_t start = pos + strlen(field);
+            s.erase(start, s.find('\n', start) - start);
+            pos = s.find(field, start);
+        }
+    }
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s session_file [record]\n", argv[0]);
+        return 2;
+    }
+    const bool record = argc > 2 && strcmp(argv[2], "record") == 0;
+
+    ATServer *at = ATServer::get_instance();
+    for (const char *command : commands) {
+        at->register_command(command, "Help text", run_handler, read_handler, write_handler, "ARG1,[ARG2]");
+    }
+
+    // a few rounds, so the history fills up and wraps
+    console.reserve(1 << 20);
+    capturing = true;
+    for (int round = 0; round < 3; round++) {
+        replay(at);
+    }
+    capturing = false;
+    console = strip_build_time(console);
+
+    if (record) {
+        FILE *f = fopen(argv[1], "wb");
+        fwrite(console.data(), 1, console.size(), f);
+        fclose(f);
+        printf("recorded %zu bytes of console output\n", console.size());
+        return 0;
+    }
+
+    std::string expected;
+    FILE *f = fopen(argv[1], "rb");
+    CHECK(f != nullptr);
+    if (f != nullptr) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            expected.append(buf, n);
+        }
+        fclose(f);
+    }
+    size_t diff = 0;
+    while (diff < console.size() && diff < expected.size() && console[diff] == expected[diff]) {
+        diff++;
+    }
+    printf("console output %zu bytes, recorded %zu bytes, first difference at %zu\n",
+        console.size(), expected.size(), diff);
+    CHECK(console == expected);
+
+    const int rounds = 20000;
+    const size_t lines = rounds * (sizeof(script) / sizeof(script[0]));
+    allocations = 0;
+    counting = true;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        replay(at);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    counting = false;
+
+    printf("%zu lines: %.3f us/line, %.2f heap allocations/line\n",
+        lines, std::chrono::duration<double, std::micro>(t1 - t0).count() / lines, (double)allocations / lines);
+    CHECK(allocations == 0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,318 @@
+/* Energy gate of continuous audio classification (ei_audio_gate.cpp) and the
+ * skip path behind it (run_classifier_continuous_skip), on synthetic 16 kHz
+ * audio: background noise, tone bursts standing in for words, a lasting change
+ * of the background and unvoiced (high zero crossing rate) slices.
+ *
+ * Gate: warmup slices always processed, closed on background, opened by a word
+ * and held open for the hangover, the noise floor following the background,
+ * min_rms, the zero crossing rate check, read errors and the saved time.
+ * Skip: the feature window advances by a repeat of the last slice, the partial
+ * frame carried between slices is dropped so the next slice is extracted as if
+ * it started the stream, and a gated run hands the classifier only complete
+ * windows. */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ei_continuous_impulse.h"
+#include "ei_audio_gate.h"
+#include "host_test.h"
+
+static std::mt19937 rng(33);
+
+/* Appends `seconds` of white noise of RMS `noise_rms`, plus a tone of RMS `tone_rms` */
+static void append(std::vector<int16_t> &audio, float seconds, float noise_rms, float tone_rms = 0.0f, float tone_hz = 800.0f)
+{
+    std::normal_distribution<float> noise(0.0f, noise_rms > 0.0f ? noise_rms : 1e-6f);
+    const size_t count = (size_t)(seconds * KWS_FREQUENCY);
+    for (size_t ix = 0; ix < count; ix++) {
+        const float t = (float)(audio.size()) / KWS_FREQUENCY;
+        float v = noise(rng) + tone_rms * sqrtf(2.0f) * sinf(2 * (float)M_PI * tone_hz * t);
+        audio.push_back((int16_t)std::max(-32768.0f, std::min(32767.0f, v)));
+    }
+}
+
+/* Gate decision of every slice */
+static std::vector<bool> gate_slices(const std::vector<int16_t> &audio, const ei_audio_gate_config_t *config)
+{
+    ei_audio_gate_start(config, KWS_SLICES);
+    std::vector<bool> open;
+    for (size_t offset = 0; offset + KWS_SLICE_SAMPLES <= audio.size(); offset += KWS_SLICE_SAMPLES) {
+        signal_t signal = kws_signal(audio.data() + offset, KWS_SLICE_SAMPLES);
+        open.push_back(ei_audio_gate_update(&signal, false));
+    }
+    return open;
+}
+
+static bool all_of(const std::vector<bool> &open, size_t first, size_t last, bool value)
+{
+    for (size_t ix = first; ix < last; ix++) {
+        if (open[ix] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* 3 s of background, a 0.5 s word, 3 s of background */
+static void test_open_close()
+{
+    std::vector<int16_t> audio;
+    append(audio, 3.0f, 100.0f);
+    append(audio, 0.5f, 100.0f, 2000.0f);
+    append(audio, 3.0f, 100.0f);
+
+    ei_audio_gate_config_t config;
+    ei_audio_gate_get_default_config(&config);
+    std::vector<bool> open = gate_slices(audio, &config);
+    ei_audio_gate_stats_t stats;
+    ei_audio_gate_get_stats(&stats);
+
+    CHECK(open.size() == 26);
+    CHECK(all_of(open, 0, KWS_SLICES, true));                        // warmup
+    CHECK(all_of(open, KWS_SLICES, 12, false));                      // background
+    CHECK(all_of(open, 12, 14, true));                               // the word
+    CHECK(all_of(open, 14, 14 + config.hangover_slices, true));      // hangover
+    CHECK(all_of(open, 14 + config.hangover_slices, open.size(), false));
+    CHECK(stats.slices == 26);
+    CHECK(stats.slices_skipped == 26 - KWS_SLICES - 2 - config.hangover_slices);
+    CHECK(stats.opens == 1);
+    // the word barely moves the floor
+    CHECK(stats.noise_floor > 80.0f && stats.noise_floor < 130.0f);
+    printf("word: %u of %u slices skipped, noise floor %.1f\n", stats.slices_skipped, stats.slices, stats.noise_floor);
+}
+
+/* The background gets 12 dB louder for good: the gate opens, then the floor
+ * catches up and it closes again */
+static void test_floor_follows_background()
+{
+    std::vector<int16_t> audio;
+    append(audio, 3.0f, 100.0f);
+    append(audio, 10.0f, 400.0f);
+
+    std::vector<bool> open = gate_slices(audio, nullptr);
+    ei_audio_gate_stats_t stats;
+    ei_audio_gate_get_stats(&stats);
+
+    CHECK(all_of(open, KWS_SLICES, 12, false));
+    CHECK(open[12]);
+    size_t closed_at = open.size();
+    for (size_t ix = 12; ix < open.size(); ix++) {
+        if (!open[ix]) {
+            closed_at = ix;
+            break;
+        }
+    }
+    printf("louder background: gate closed again after %.2f s, noise floor %.1f\n",
+        (closed_at - 12) * (float)KWS_SLICE_SAMPLES / KWS_FREQUENCY, stats.noise_floor);
+    CHECK(closed_at < open.size());
+    CHECK(all_of(open, closed_at, open.size(), false));
+    CHECK(stats.noise_floor > 250.0f);
+}
+
+/* Quiet tones on digital silence stay below min_rms */
+static void test_min_rms()
+{
+    std::vector<int16_t> audio;
+    append(audio, 2.0f, 0.0f);
+    append(audio, 1.0f, 0.0f, 40.0f);
+    append(audio, 1.0f, 0.0f);
+
+    std::vector<bool> open = gate_slices(audio, nullptr);
+    CHECK(all_of(open, KWS_SLICES, open.size(), false));
+}
+
+/* Unvoiced speech: broadband, only 1.6x the RMS of a low hum. Opens the gate
+ * with the zero crossing rate check, not without it */
+static void test_zero_crossing_rate()
+{
+    std::vector<int16_t> audio;
+    append(audio, 3.0f, 5.0f, 100.0f, 120.0f);
+    append(audio, 0.5f, 160.0f);
+    append(audio, 3.0f, 5.0f, 100.0f, 120.0f);
+
+    ei_audio_gate_config_t config;
+    ei_audio_gate_get_default_config(&config);
+    std::vector<bool> open = gate_slices(audio, &config);
+    CHECK(all_of(open, KWS_SLICES, open.size(), false));
+
+    config.zcr_min = 0.3f;
+    open = gate_slices(audio, &config);
+    CHECK(all_of(open, KWS_SLICES, 12, false));
+    CHECK(all_of(open, 12, 14 + config.hangover_slices, true));
+    CHECK(all_of(open, 14 + config.hangover_slices, open.size(), false));
+}
+
+static int failing_get_data(size_t, size_t, float *)
+{
+    return -1;
+}
+
+/* A slice that can't be read is classified, skipped slices are counted at the
+ * average cost of a processed one */
+static void test_read_error_and_saved_time()
+{
+    std::vector<int16_t> audio;
+    append(audio, 2.0f, 100.0f);
+
+    ei_audio_gate_start(nullptr, KWS_SLICES);
+    for (size_t offset = 0; offset + KWS_SLICE_SAMPLES <= audio.size(); offset += KWS_SLICE_SAMPLES) {
+        signal_t signal = kws_signal(audio.data() + offset, KWS_SLICE_SAMPLES);
+        if (ei_audio_gate_update(&signal, false)) {
+            ei_audio_gate_report_processed(1000);
+        }
+    }
+    ei_audio_gate_stats_t stats;
+    ei_audio_gate_get_stats(&stats);
+    CHECK(stats.slices_skipped == 8 - KWS_SLICES);
+    CHECK(stats.saved_us == stats.slices_skipped * 1000);
+
+    signal_t signal;
+    signal.total_length = KWS_SLICE_SAMPLES;
+    signal.get_data = &failing_get_data;
+    CHECK(ei_audio_gate_update(&signal, false));
+}
+
+/* Window of the MFCC block, oldest value first */
+static std::vector<float> window_features(const ei_impulse_t *impulse)
+{
+    const ei_feature_ring_t *ring = get_continuous_feature_rings(impulse);
+    std::vector<float> window(ring->window);
+    ei_feature_ring_copy(ring, window.data());
+    return window;
+}
+
+/* Each skip drops the oldest slice and repeats the last one, also when the
+ * repeat runs past the end of the ring buffer */
+static void test_skip_repeats_slice(const ei_impulse_t *impulse, const std::vector<int16_t> &audio)
+{
+    ei_impulse_handle_t handle(impulse);
+    run_classifier_init(&handle);
+    kws_captured.clear();
+    for (size_t slice = 0; slice < KWS_SLICES; slice++) {
+        signal_t signal = kws_signal(audio.data() + slice * KWS_SLICE_SAMPLES, KWS_SLICE_SAMPLES);
+        ei_impulse_result_t result;
+        CHECK(run_classifier_continuous(&handle, &signal, &result, false) == EI_IMPULSE_OK);
+    }
+    CHECK(kws_captured.size() == 1);
+
+    const ei_feature_ring_t *ring = get_continuous_feature_rings(impulse);
+    const size_t count = ring->slice;
+    CHECK(count > 0 && count % kws_mfcc_config.num_cepstral == 0);
+    for (int skip = 0; skip < 12; skip++) {
+        const std::vector<float> before = window_features(impulse);
+        const uint64_t written = classifier_continuous_features_written;
+        CHECK(run_classifier_continuous_skip(&handle) == EI_IMPULSE_OK);
+        const std::vector<float> after = window_features(impulse);
+
+        CHECK(classifier_continuous_features_written == written + count);
+        CHECK(ring->slice == count);
+        CHECK(ei_dsp_cont_current_frame_ix == 0);
+        CHECK(memcmp(after.data(), before.data() + count, (before.size() - count) * sizeof(float)) == 0);
+        CHECK(memcmp(after.data() + after.size() - count, before.data() + before.size() - count,
+            count * sizeof(float)) == 0);
+    }
+    // skipping runs no inference
+    CHECK(kws_captured.size() == 1);
+}
+
+/* The first slice after a skip is extracted as if it started the stream: no
+ * frame is joined to the audio before the gap */
+static void test_slice_after_skip(const ei_impulse_t *impulse, const std::vector<int16_t> &audio)
+{
+    ei_impulse_handle_t handle(impulse);
+    run_classifier_init(&handle);
+    for (size_t slice = 0; slice < KWS_SLICES; slice++) {
+        signal_t signal = kws_signal(audio.data() + slice * KWS_SLICE_SAMPLES, KWS_SLICE_SAMPLES);
+        ei_impulse_result_t result;
+        CHECK(run_classifier_continuous(&handle, &signal, &result, false) == EI_IMPULSE_OK);
+    }
+    CHECK(run_classifier_continuous_skip(&handle) == EI_IMPULSE_OK);
+
+    const int16_t *next = audio.data() + (KWS_SLICES + 1) * KWS_SLICE_SAMPLES;
+    signal_t signal = kws_signal(next, KWS_SLICE_SAMPLES);
+    ei_impulse_result_t result;
+    CHECK(run_classifier_continuous(&handle, &signal, &result, false) == EI_IMPULSE_OK);
+    const ei_feature_ring_t *ring = get_continuous_feature_rings(impulse);
+    const std::vector<float> window = window_features(impulse);
+    std::vector<float> gated(window.end() - ring->slice, window.end());
+
+    // the same slice from a cleared state, into a window of its own
+    const ei_model_dsp_t &block = impulse->dsp_blocks[0];
+    ei_dsp_clear_continuous_audio_state();
+    ei::matrix_t fresh(1, block.n_output_features);
+    matrix_size_t size;
+    signal = kws_signal(next, KWS_SLICE_SAMPLES);
+    CHECK(extract_mfcc_per_slice_features(&signal, &fresh, block.config, impulse->frequency, &size) == EIDSP_OK);
+    const size_t count = size.rows * size.cols;
+    CHECK(count == gated.size());
+    CHECK(memcmp(gated.data(), fresh.buffer + block.n_output_features - count, count * sizeof(float)) == 0);
+}
+
+/* The gate driving the classifier as ei_run_audio_impulse.cpp does: every
+ * inference gets a complete window, one per processed slice once it filled */
+static void test_gated_run(const ei_impulse_t *impulse)
+{
+    std::vector<int16_t> audio;
+    append(audio, 3.0f, 100.0f);
+    append(audio, 0.5f, 100.0f, 2000.0f);
+    append(audio, 3.0f, 100.0f);
+    append(audio, 0.25f, 100.0f, 3000.0f, 1500.0f);
+    append(audio, 2.0f, 100.0f);
+
+    ei_impulse_handle_t handle(impulse);
+    run_classifier_init(&handle);
+    ei_audio_gate_start(nullptr, KWS_SLICES);
+    kws_captured.clear();
+    size_t processed = 0;
+    for (size_t offset = 0; offset + KWS_SLICE_SAMPLES <= audio.size(); offset += KWS_SLICE_SAMPLES) {
+        signal_t signal = kws_signal(audio.data() + offset, KWS_SLICE_SAMPLES);
+        if (!ei_audio_gate_update(&signal, false)) {
+            CHECK(run_classifier_continuous_skip(&handle) == EI_IMPULSE_OK);
+            continue;
+        }
+        ei_impulse_result_t result;
+        CHECK(run_classifier_continuous(&handle, &signal, &result, false) == EI_IMPULSE_OK);
+        processed++;
+    }
+    ei_audio_gate_stats_t stats;
+    ei_audio_gate_get_stats(&stats);
+    printf("gated run: %u of %u slices skipped, %zu inferences\n",
+        stats.slices_skipped, stats.slices, kws_captured.size());
+
+    CHECK(processed == stats.slices - stats.slices_skipped);
+    CHECK(stats.opens == 2);
+    CHECK(kws_captured.size() == processed - (KWS_SLICES - 1));
+    for (const std::vector<float> &features : kws_captured) {
+        CHECK(features.size() == impulse->nn_input_frame_size);
+        bool finite = true;
+        for (float v : features) {
+            finite = finite && std::isfinite(v);
+        }
+        CHECK(finite);
+    }
+}
+
+int main()
+{
+    test_open_close();
+    test_floor_follows_background();
+    test_min_rms();
+    test_zero_crossing_rate();
+    test_read_error_and_saved_time();
+
+    const ei_impulse_t *impulse = kws_make_impulse(KWS_MFCC);
+    std::vector<int16_t> speech;
+    append(speech, 1.0f, 200.0f);
+    append(speech, 1.0f, 200.0f, 3000.0f);
+    append(speech, 1.0f, 200.0f, 1500.0f, 2000.0f);
+    test_skip_repeats_slice(impulse, speech);
+    test_slice_after_skip(impulse, speech);
+    test_gated_run(impulse);
+
+    run_classifier_deinit();
+    return TEST_RESULT();
+}
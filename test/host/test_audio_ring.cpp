@@ -0,0 +1,191 @@
+/* ei_audio_ring: a producer thread writes DMA sized blocks, the consumer reads
+ * slices that are not a multiple of the block size and checks every sample,
+ * with and without overruns */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include "edge-impulse/ingestion-sdk-platform/sensors/ei_audio_ring.h"
+#include "host_test.h"
+
+static const uint32_t block_samples = 512;
+
+// first sample of a block is its number, the others derive from it
+static inline int16_t block_sample(uint32_t block_no, uint32_t ix)
+{
+    return (int16_t)(ix == 0 ? block_no : (block_no * 31 + ix) & 0x7FFF);
+}
+
+static void producer(ei_audio_ring_t *ring, uint32_t blocks, uint32_t block_us, std::atomic<bool> *done)
+{
+    int16_t scratch[block_samples];
+
+    for (uint32_t b = 0; b < blocks; b++) {
+        int16_t *block = ei_audio_ring_write_block(ring);
+        const bool dropped = (block == nullptr);
+        if (dropped) {
+            block = scratch;
+        }
+        for (uint32_t ix = 0; ix < block_samples; ix++) {
+            block[ix] = block_sample(b, ix);
+        }
+        if (dropped) {
+            ei_audio_ring_drop_block(ring);
+        }
+        else {
+            ei_audio_ring_commit_block(ring);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(block_us));
+    }
+    done->store(true);
+}
+
+/**
+ * Read slices of n_samples until the producer is done, checking that the
+ * blocks come out whole and in order. Returns the number of slices read.
+ */
+static uint32_t consume(ei_audio_ring_t *ring, uint32_t n_samples, uint32_t work_us,
+    std::atomic<bool> *done, uint32_t *skipped_blocks)
+{
+    std::vector<float> slice(n_samples);
+    uint32_t position = 0; // samples consumed, blocks start at multiples of block_samples
+    int32_t block_no = -1;
+    uint32_t slices = 0;
+
+    *skipped_blocks = 0;
+    while (true) {
+        if (!ei_audio_ring_wait(ring, n_samples, 100)) {
+            if (done->load() && ei_audio_ring_available(ring) < n_samples) {
+                break;
+            }
+            continue;
+        }
+        CHECK(ei_audio_ring_available(ring) <= ring->capacity);
+
+        // read in two parts to exercise the offset
+        const uint32_t first = n_samples / 3;
+        ei_audio_ring_read(ring, 0, first, slice.data(), 1.0f);
+        ei_audio_ring_read(ring, first, n_samples - first, slice.data() + first, 1.0f);
+
+        for (uint32_t ix = 0; ix < n_samples; ix++, position++) {
+            const uint32_t offset = position % block_samples;
+            if (offset == 0) {
+                const int32_t next = (int32_t)slice[ix];
+                if (next <= block_no) {
+                    printf("block %d after block %d\n", next, block_no);
+                    CHECK(next > block_no);
+                    return slices;
+                }
+                *skipped_blocks += next - block_no - 1;
+                block_no = next;
+            }
+            else if ((int16_t)slice[ix] != block_sample(block_no, offset)) {
+                printf("block %d sample %u: %d\n", block_no, offset, (int)slice[ix]);
+                CHECK((int16_t)slice[ix] == block_sample(block_no, offset));
+                return slices;
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(work_us));
+        ei_audio_ring_release(ring, n_samples);
+        slices++;
+    }
+
+    return slices;
+}
+
+static void test_capacity()
+{
+    ei_audio_ring_t ring;
+
+    // whole blocks, not rounded up to a power of 2 (that would be 64 Ki samples)
+    CHECK(ei_audio_ring_init(&ring, block_samples, 2 * 16000 + block_samples));
+    CHECK(ring.capacity == 64 * block_samples);
+    ei_audio_ring_free(&ring);
+
+    CHECK(ei_audio_ring_init(&ring, block_samples, 2 * 4000 + block_samples));
+    CHECK(ring.capacity == 17 * block_samples);
+    ei_audio_ring_free(&ring);
+
+    CHECK(ei_audio_ring_init(&ring, block_samples, 1));
+    CHECK(ring.capacity == block_samples);
+    ei_audio_ring_free(&ring);
+}
+
+static void test_fill_and_wrap()
+{
+    ei_audio_ring_t ring;
+    CHECK(ei_audio_ring_init(&ring, block_samples, 3 * block_samples));
+
+    // fill, the fourth block does not fit
+    for (int b = 0; b < 3; b++) {
+        CHECK(ei_audio_ring_write_block(&ring) != nullptr);
+        ei_audio_ring_commit_block(&ring);
+    }
+    CHECK(ei_audio_ring_write_block(&ring) == nullptr);
+    CHECK(ei_audio_ring_available(&ring) == 3 * block_samples);
+
+    // many laps with a release size that is not a multiple of the block, head
+    // and tail cross the 2 * capacity wrap at different places
+    uint32_t committed = 3 * block_samples;
+    uint32_t released = 0;
+    for (int step = 0; step < 1000; step++) {
+        const uint32_t available = ei_audio_ring_available(&ring);
+        CHECK(available == committed - released);
+        CHECK(available <= ring.capacity);
+        CHECK(ring.head.load() < 2 * ring.capacity && ring.tail.load() < 2 * ring.capacity);
+
+        const uint32_t release = available < 700 ? available : 700;
+        ei_audio_ring_release(&ring, release);
+        released += release;
+
+        while (ei_audio_ring_write_block(&ring) != nullptr) {
+            ei_audio_ring_commit_block(&ring);
+            committed += block_samples;
+        }
+        CHECK(ring.capacity - ei_audio_ring_available(&ring) < block_samples);
+    }
+
+    ei_audio_ring_discard(&ring);
+    CHECK(ei_audio_ring_available(&ring) == 0);
+    ei_audio_ring_free(&ring);
+}
+
+static void test_threads(uint32_t work_us, bool expect_drops)
+{
+    // 4000 sample slices, 512 sample blocks
+    const uint32_t n_samples = 4000;
+    const uint32_t blocks = 400;
+    ei_audio_ring_t ring;
+    std::atomic<bool> done(false);
+    uint32_t skipped = 0;
+
+    CHECK(ei_audio_ring_init(&ring, block_samples, 2 * n_samples + block_samples));
+
+    std::thread prod(producer, &ring, blocks, 250, &done);
+    const uint32_t slices = consume(&ring, n_samples, work_us, &done, &skipped);
+    prod.join();
+
+    const uint32_t committed = ring.blocks_committed.load();
+    const uint32_t dropped = ring.blocks_dropped.load();
+    printf("work %5u us/slice: %u slices, %u blocks committed, %u dropped, %u skipped by the reader\n",
+        work_us, slices, committed, dropped, skipped);
+    CHECK(committed + dropped == blocks);
+    CHECK(slices == committed * block_samples / n_samples);
+    // drops after the last block that was read are not seen by the reader
+    CHECK(skipped <= dropped);
+    CHECK(expect_drops ? skipped > 0 : dropped == 0);
+
+    ei_audio_ring_free(&ring);
+}
+
+int main()
+{
+    test_capacity();
+    test_fill_and_wrap();
+    test_threads(0, false);
+    test_threads(10000, true);
+    return TEST_RESULT();
+}
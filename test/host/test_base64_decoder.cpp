@@ -0,0 +1,112 @@
+/* Streaming base64 decoder (base64_decode_block): random data split at random
+ * points, with line breaks and the '=' padding test_inference.py appends, must
+ * decode like base64_decode, stop at the output size and reject other characters */
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "at_base64_lib.h"
+#include "host_test.h"
+
+static std::string encode(const std::vector<uint8_t> &data)
+{
+    std::string out(BASE64_ENCODE_BLOCK_SIZE(data.size()), '\0');
+    out.resize(base64_encode_buffer((const char *)data.data(), data.size(), &out[0], out.size()));
+    while (out.size() % 4) {
+        out += '=';
+    }
+    return out;
+}
+
+static void test_random_splits()
+{
+    std::mt19937 rng(7);
+    int mismatches = 0;
+
+    for (int t = 0; t < 5000; t++) {
+        std::vector<uint8_t> data(rng() % 700);
+        for (auto &b : data) {
+            b = rng();
+        }
+        const std::string text = encode(data);
+
+        std::string sent;
+        for (char c : text) {
+            if (rng() % 50 == 0) {
+                sent += "\r\n";
+            }
+            sent += c;
+        }
+        sent += std::string(rng() % 20, '=');
+
+        // sometimes less room than the data, the rest is dropped
+        const size_t room = rng() % 4 == 0 ? rng() % (data.size() + 1) : data.size();
+        std::vector<uint8_t> out(room + 1, 0xAA);
+        base64_decoder_t decoder;
+        base64_decoder_init(&decoder);
+        size_t pos = 0, decoded = 0;
+        bool failed = false;
+        while (pos < sent.size()) {
+            const size_t n = std::min(sent.size() - pos, (size_t)(rng() % 40 + 1));
+            const int res = base64_decode_block(&decoder, sent.data() + pos, n, out.data() + decoded, room - decoded);
+            failed |= res < 0;
+            decoded += res < 0 ? 0 : res;
+            pos += n;
+        }
+
+        const std::vector<unsigned char> reference = base64_decode(text);
+        if (failed || decoded != room || memcmp(out.data(), data.data(), room) != 0 || out[room] != 0xAA
+            || reference != data) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+static void test_invalid()
+{
+    base64_decoder_t decoder;
+    uint8_t out[8];
+    base64_decoder_init(&decoder);
+    CHECK(base64_decode_block(&decoder, "AB*C", 4, out, sizeof(out)) == BASE64_DECODE_ERR_INVALID_CHAR);
+}
+
+static void test_speed()
+{
+    std::mt19937 rng(3);
+    std::vector<uint8_t> data(1 << 20);
+    for (auto &b : data) {
+        b = rng();
+    }
+    const std::string text = encode(data);
+    std::vector<uint8_t> out(data.size());
+
+    // in reads of 256 characters, as run_impulse_static_data does
+    const auto t0 = std::chrono::steady_clock::now();
+    base64_decoder_t decoder;
+    base64_decoder_init(&decoder);
+    size_t decoded = 0;
+    for (size_t pos = 0; pos < text.size(); pos += 256) {
+        decoded += base64_decode_block(&decoder, text.data() + pos, std::min<size_t>(256, text.size() - pos),
+            out.data() + decoded, out.size() - decoded);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const std::vector<unsigned char> reference = base64_decode(text);
+    const auto t2 = std::chrono::steady_clock::now();
+
+    printf("1 MB: streaming %.2f ms, base64_decode %.2f ms\n",
+        std::chrono::duration<double, std::milli>(t1 - t0).count(),
+        std::chrono::duration<double, std::milli>(t2 - t1).count());
+    CHECK(decoded == data.size() && out == data && reference == data);
+}
+
+int main()
+{
+    test_random_splits();
+    test_invalid();
+    test_speed();
+    return TEST_RESULT();
+}
@@ -0,0 +1,347 @@
+/* Base64 encoders (the group encoder behind base64_encode, base64_encode_chunk,
+ * base64_encode_buffer and the streaming base64_encode_block) against the
+ * character at a time encoder they replaced, kept below: byte for byte, every
+ * length 0-3 mod 3, lengths around the 141 / 144 byte internal blocks, random
+ * splits (empty parts and 1-2 byte parts completing a left over group included).
+ *
+ * base64_encode_buffer with the output buffer sized exactly to its check
+ * (input / 3 * 4 + input % 3): the old encoder wrote the padding past it, the
+ * new one stops at the end of the buffer. That case is compared against the
+ * prefix of the old output. */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "at_base64_lib.h"
+#include "host_test.h"
+
+static const char *reference_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                     "abcdefghijklmnopqrstuvwxyz"
+                                     "0123456789+/";
+
+/* base64_encode before the group encoder */
+static void reference_encode(const char *input, size_t input_size, void (*putc_f)(char))
+{
+    int i = 0;
+    int j = 0;
+    unsigned char char_array_3[3];
+    unsigned char char_array_4[4];
+
+    while (input_size--) {
+        char_array_3[i++] = *(input++);
+        if (i == 3) {
+            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+            char_array_4[3] = char_array_3[2] & 0x3f;
+
+            for (i = 0; (i < 4); i++) {
+                putc_f(reference_chars[char_array_4[i]]);
+            }
+            i = 0;
+        }
+    }
+
+    if (i) {
+        for (j = i; j < 3; j++) {
+            char_array_3[j] = '\0';
+        }
+
+        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+        char_array_4[3] = char_array_3[2] & 0x3f;
+
+        for (j = 0; (j < i + 1); j++) {
+            putc_f(reference_chars[char_array_4[j]]);
+        }
+
+        while ((i++ < 3)) {
+            putc_f('=');
+        }
+    }
+}
+
+/* base64_encode_chunk before the group encoder, input == nullptr flushes */
+static void reference_encode_chunk(const char *input, size_t input_size, void (*putc_f)(char))
+{
+    static char leftover[3];
+    static uint8_t leftover_size = 0;
+
+    if (input == nullptr) {
+        reference_encode(leftover, leftover_size, putc_f);
+        leftover_size = 0;
+        return;
+    }
+
+    if (leftover_size > 0) {
+        uint8_t to_copy = std::min((size_t)(3 - leftover_size), input_size);
+        memcpy(&leftover[leftover_size], input, to_copy);
+        leftover_size += to_copy;
+        if (leftover_size < 3) {
+            return;
+        }
+        reference_encode(leftover, leftover_size, putc_f);
+        leftover_size = 0;
+        input_size -= to_copy;
+        input += to_copy;
+    }
+
+    if (input_size % 3 == 0) {
+        reference_encode(input, input_size, putc_f);
+    }
+    else {
+        leftover_size = input_size % 3;
+        reference_encode(input, input_size - leftover_size, putc_f);
+        memcpy(leftover, &input[input_size - leftover_size], leftover_size);
+    }
+}
+
+/* base64_encode_buffer before the group encoder, same size check */
+static int reference_encode_buffer(const char *input, size_t input_size, char *output, size_t output_size)
+{
+    size_t output_size_check = floor(input_size / 3 * 4);
+    size_t mod = input_size % 3;
+    output_size_check += mod;
+
+    if (output_size < output_size_check) {
+        return -10;
+    }
+
+    int i = 0;
+    int j = 0;
+    unsigned char char_array_3[3];
+    unsigned char char_array_4[4];
+    size_t output_ix = 0;
+
+    while (input_size--) {
+        char_array_3[i++] = *(input++);
+        if (i == 3) {
+            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+            char_array_4[3] = char_array_3[2] & 0x3f;
+
+            for (i = 0; (i < 4); i++) {
+                output[output_ix++] = reference_chars[char_array_4[i]];
+            }
+            i = 0;
+        }
+    }
+
+    if (i) {
+        for (j = i; j < 3; j++) {
+            char_array_3[j] = '\0';
+        }
+
+        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+        char_array_4[3] = char_array_3[2] & 0x3f;
+
+        for (j = 0; (j < i + 1); j++) {
+            output[output_ix++] = reference_chars[char_array_4[j]];
+        }
+
+        while ((i++ < 3)) {
+            output[output_ix++] = '=';
+        }
+    }
+
+    return output_ix;
+}
+
+static std::string putc_out;
+
+static void putc_capture(char c)
+{
+    putc_out += c;
+}
+
+static std::string reference(const std::vector<uint8_t> &data)
+{
+    putc_out.clear();
+    reference_encode((const char *)data.data(), data.size(), putc_capture);
+    return putc_out;
+}
+
+static std::vector<uint8_t> random_data(std::mt19937 &rng, size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (auto &b : data) {
+        b = rng();
+    }
+    return data;
+}
+
+/* lengths 0-3 mod 3, and around the 141 byte chunk / 144 byte encode blocks */
+static std::vector<size_t> test_lengths()
+{
+    std::vector<size_t> lengths;
+    for (size_t len = 0; len <= 20; len++) {
+        lengths.push_back(len);
+    }
+    const size_t edges[] = { 141, 144, 282, 288, 432, 1000, 4096 };
+    for (size_t edge : edges) {
+        for (size_t len = edge - 4; len <= edge + 4; len++) {
+            lengths.push_back(len);
+        }
+    }
+    return lengths;
+}
+
+static void test_encode()
+{
+    std::mt19937 rng(44);
+    size_t cases = 0, mismatches = 0;
+
+    for (size_t len : test_lengths()) {
+        const std::vector<uint8_t> data = random_data(rng, len);
+        const std::string expected = reference(data);
+        CHECK(expected.size() == BASE64_ENCODE_BLOCK_SIZE(len));
+
+        putc_out.clear();
+        base64_encode((const char *)data.data(), len, putc_capture);
+        cases++;
+        if (putc_out != expected && mismatches++ == 0) {
+            printf("base64_encode length %zu differs\n", len);
+        }
+
+        // output buffer with room to spare, and sized exactly to the check
+        std::string out(BASE64_ENCODE_BLOCK_SIZE(len) + 8, '\xAA');
+        int res = base64_encode_buffer((const char *)data.data(), len, &out[0], out.size());
+        std::string out_expected(out.size(), '\xAA');
+        const int res_expected = reference_encode_buffer((const char *)data.data(), len, &out_expected[0], out_expected.size());
+        cases++;
+        if ((res != res_expected || out != out_expected || out.compare(0, res, expected) != 0) && mismatches++ == 0) {
+            printf("base64_encode_buffer length %zu differs\n", len);
+        }
+
+        // the old encoder writes the whole padding past the check, given room for it here
+        const size_t check = len / 3 * 4 + len % 3;
+        std::string tight(check + 4, '\xAA');
+        std::string tight_expected(check + 4, '\xAA');
+        reference_encode_buffer((const char *)data.data(), len, &tight_expected[0], check);
+        res = base64_encode_buffer((const char *)data.data(), len, &tight[0], check);
+        cases++;
+        if ((res != (int)check || tight.compare(0, check, tight_expected, 0, check) != 0
+            || tight.compare(check, 4, std::string(4, '\xAA')) != 0) && mismatches++ == 0) {
+            printf("base64_encode_buffer length %zu, tight buffer differs\n", len);
+        }
+
+        // one byte less than the check: both refuse
+        if (check > 0) {
+            CHECK(base64_encode_buffer((const char *)data.data(), len, &tight[0], check - 1) == -10);
+            CHECK(reference_encode_buffer((const char *)data.data(), len, &tight[0], check - 1) == -10);
+        }
+    }
+    printf("base64_encode / base64_encode_buffer: %zu cases, %zu differ\n", cases, mismatches);
+    CHECK(mismatches == 0);
+}
+
+/* random split points, parts of 0-3 bytes are frequent */
+static std::vector<size_t> random_splits(std::mt19937 &rng, size_t len)
+{
+    std::vector<size_t> parts;
+    size_t pos = 0;
+    while (pos < len) {
+        size_t part = rng() % 3 == 0 ? rng() % 4 : rng() % 400;
+        part = std::min(part, len - pos);
+        parts.push_back(part);
+        pos += part;
+    }
+    return parts;
+}
+
+static void test_streams()
+{
+    std::mt19937 rng(440);
+    size_t cases = 0, mismatches = 0;
+
+    for (int round = 0; round < 20; round++) {
+        for (size_t len : test_lengths()) {
+            const std::vector<uint8_t> data = random_data(rng, len);
+            const std::string expected = reference(data);
+            const std::vector<size_t> parts = random_splits(rng, len);
+
+            // base64_encode_block into a caller buffer
+            base64_encoder_t encoder;
+            base64_encoder_init(&encoder);
+            std::string block;
+            size_t pos = 0;
+            bool failed = false;
+            for (size_t part : parts) {
+                std::string out(BASE64_ENCODE_BLOCK_SIZE(part), '\0');
+                int res = base64_encode_block(&encoder, data.data() + pos, part, &out[0], out.size());
+                failed |= res < 0;
+                block.append(out.data(), res < 0 ? 0 : res);
+                pos += part;
+            }
+            char tail[4];
+            block.append(tail, base64_encode_block_finish(&encoder, tail));
+            CHECK(!failed);
+            cases++;
+            if (block != expected && mismatches++ == 0) {
+                printf("base64_encode_block length %zu in %zu parts differs\n", len, parts.size());
+            }
+
+            // base64_encode_chunk against the old chunk encoder, same splits
+            std::string chunk_expected;
+            putc_out.clear();
+            pos = 0;
+            for (size_t part : parts) {
+                reference_encode_chunk((const char *)data.data() + pos, part, putc_capture);
+                pos += part;
+            }
+            reference_encode_chunk(nullptr, 0, putc_capture);
+            chunk_expected.swap(putc_out);
+
+            pos = 0;
+            for (size_t part : parts) {
+                base64_encode_chunk((const char *)data.data() + pos, part, putc_capture);
+                pos += part;
+            }
+            base64_encode_finish(putc_capture);
+            cases++;
+            if ((putc_out != chunk_expected || putc_out != expected) && mismatches++ == 0) {
+                printf("base64_encode_chunk length %zu in %zu parts differs\n", len, parts.size());
+            }
+        }
+    }
+    printf("base64_encode_block / base64_encode_chunk: %zu streams, %zu differ\n", cases, mismatches);
+    CHECK(mismatches == 0);
+}
+
+/* the buffer variants, the putc ones are bound by the callback */
+static void benchmark()
+{
+    std::mt19937 rng(4400);
+    const std::vector<uint8_t> data = random_data(rng, 96 * 96 * 3);
+    std::string out(BASE64_ENCODE_BLOCK_SIZE(data.size()), '\0');
+    const int rounds = 200;
+
+    double reference_us = 0, encode_us = 0;
+    for (int r = 0; r < rounds; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        reference_encode_buffer((const char *)data.data(), data.size(), &out[0], out.size());
+        auto t1 = std::chrono::steady_clock::now();
+        base64_encode_buffer((const char *)data.data(), data.size(), &out[0], out.size());
+        auto t2 = std::chrono::steady_clock::now();
+        reference_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        encode_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+    }
+    printf("96x96 RGB frame (%zu B) to a buffer: old %.1f us, base64_encode_buffer %.1f us\n",
+        data.size(), reference_us / rounds, encode_us / rounds);
+}
+
+int main()
+{
+    test_encode();
+    test_streams();
+    benchmark();
+    return TEST_RESULT();
+}
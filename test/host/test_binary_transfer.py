@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+# Binary framed transfer over a pty pair: binary_transfer_device (the firmware's
+# ei_binary_transfer.cpp) on one end, the host client from
+# firmware-sdk/tools/binary_transfer.py on the other. Checks throughput, recovery
+# from corrupted frames (CRC errors, NAK and resend), from dropped ACKs
+# (timeout and resend) and that a silent or cancelling host stops the device.
+#
+#   test_binary_transfer.py <binary_transfer_device> <repo root>
+
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+import tty
+
+device_bin, repo_root = sys.argv[1], sys.argv[2]
+sys.path.insert(0, os.path.join(repo_root, "firmware-sdk", "tools"))
+from binary_transfer import Receiver, receive, PtyPort  # noqa: E402
+
+UART_BYTES_PER_S = 100000   # 1 Mbaud
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print("check failed: " + what)
+        failures += 1
+
+
+def parse_stats(line):
+    return {k: float(v) for k, v in (kv.split("=") for kv in line.split())}
+
+
+def start_device(data, corrupt=0.0, ack_drop=0.0, ack_blackout_ms=0, seed=1):
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    data_file = tempfile.NamedTemporaryFile(delete=False)
+    data_file.write(data)
+    data_file.close()
+    proc = subprocess.Popen(
+        [device_bin, os.ttyname(slave), data_file.name, str(UART_BYTES_PER_S),
+         str(corrupt), str(ack_drop), str(ack_blackout_ms), str(seed)],
+        stdout=subprocess.PIPE, text=True)
+    # keep the slave open until the device is done, reads on the master fail
+    # with EIO while no one has the slave open
+    return Device(proc, PtyPort(master), slave, data_file.name)
+
+
+class Device:
+    def __init__(self, proc, host, slave, data_path):
+        self.proc, self.host, self.slave, self.data_path = proc, host, slave, data_path
+
+    def finish(self):
+        try:
+            out, _ = self.proc.communicate(timeout=10)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            out, _ = self.proc.communicate()
+        self.host.f.close()
+        os.close(self.slave)
+        os.unlink(self.data_path)
+        # killed: report a failed transfer
+        return parse_stats(out) if out.strip() else dict.fromkeys(
+            ("result", "seconds", "sent", "resent", "naks", "timeouts", "corrupted", "dropped_acks"), 0)
+
+
+def transfer(name, size, **kwargs):
+    data = random.Random(size).randbytes(size)
+    device = start_device(data, **kwargs)
+    receiver = Receiver()
+    begin = time.monotonic()
+    try:
+        receive(device.host, receiver)
+    except IOError as e:
+        print("{}: {}".format(name, e))
+    elapsed = time.monotonic() - begin
+    stats = device.finish()
+
+    print("{:<14} {:>7} bytes {:5.2f} s {:6.1f} kB/s | device sent {:.0f} resent {:.0f} naks {:.0f} "
+          "timeouts {:.0f} corrupted {:.0f} dropped acks {:.0f} | host crc errors {} naks {} duplicates {}".format(
+              name, size, elapsed, size / elapsed / 1000, stats["sent"], stats["resent"], stats["naks"],
+              stats["timeouts"], stats["corrupted"], stats["dropped_acks"],
+              receiver.crc_errors, receiver.naks, receiver.duplicates))
+    check(device.proc.returncode == 0 and stats["result"] == 1, name + ": device reports success")
+    check(receiver.done and bytes(receiver.data) == data, name + ": data arrives intact")
+    return stats, receiver, size / elapsed
+
+
+def test_clean():
+    stats, receiver, rate = transfer("clean", 300000)
+    check(stats["resent"] == 0 and receiver.crc_errors == 0, "clean: no resends")
+    # the framing overhead is ~1.2%, base64 alone costs 25% of the link
+    check(rate > 0.8 * UART_BYTES_PER_S, "clean: above 80% of the link rate")
+
+
+def test_crc_errors():
+    stats, receiver, _ = transfer("corrupt 5%", 300000, corrupt=0.05, seed=3)
+    check(stats["corrupted"] > 0, "corrupt: frames were damaged")
+    check(receiver.crc_errors > 0 and receiver.naks > 0, "corrupt: host detects and NAKs")
+    check(stats["naks"] > 0 and stats["resent"] > 0, "corrupt: device resends on NAK")
+
+
+def test_dropped_acks():
+    # every ACK of the first 600 ms is lost: the window stalls, times out and is resent
+    stats, receiver, _ = transfer("ack blackout", 100000, ack_blackout_ms=600)
+    check(stats["dropped_acks"] > 0, "ack blackout: acks were dropped")
+    check(stats["timeouts"] > 0 and stats["resent"] > 0, "ack blackout: device times out and resends")
+    check(receiver.duplicates > 0, "ack blackout: host re-acks the duplicates")
+
+    # random losses are mostly covered by the next cumulative ACK
+    stats, receiver, _ = transfer("ack drop 20%", 200000, ack_drop=0.2, seed=5)
+    check(stats["dropped_acks"] > 0, "ack drop: acks were dropped")
+
+
+def test_silent_host():
+    # nobody answers: the device gives up after EI_BINARY_TRANSFER_MAX_RETRIES timeouts
+    device = start_device(bytes(100000))
+    begin = time.monotonic()
+    while device.proc.poll() is None and time.monotonic() - begin < 10:
+        device.host.read(4096)
+    elapsed = time.monotonic() - begin
+    stats = device.finish()
+    print("silent host: device gave up after {:.2f} s, {:.0f} timeouts".format(elapsed, stats["timeouts"]))
+    check(device.proc.returncode == 1 and stats["result"] == 0, "silent: device reports failure")
+    check(1.5 < elapsed < 5, "silent: gives up after ~8 timeouts")
+
+
+def test_cancel():
+    device = start_device(bytes(300000))
+    received, cancelled_at = 0, None
+    begin = time.monotonic()
+    while device.proc.poll() is None and time.monotonic() - begin < 10:
+        received += len(device.host.read(4096))
+        if cancelled_at is None and received > 20000:
+            device.host.write(b"CAN\r")
+            cancelled_at = time.monotonic()
+    stopped = time.monotonic() - cancelled_at
+    stats = device.finish()
+    print("cancel: device stopped {:.3f} s after CAN".format(stopped))
+    check(device.proc.returncode == 1 and stats["result"] == 0, "cancel: device reports failure")
+    check(stopped < 0.5, "cancel: stops right away")
+
+
+test_clean()
+test_crc_errors()
+test_dropped_acks()
+test_silent_host()
+test_cancel()
+print("FAILED" if failures else "OK")
+sys.exit(1 if failures else 0)
@@ -0,0 +1,214 @@
+/* speechpy::processing::cmvnw and cmvnw_ring (the out of place normalization
+ * of the continuous feature ring) against a direct evaluation of the speechpy
+ * definition in double, cmvnw_ring against cmvnw on the window copied in order
+ * for every position of the oldest row, plus the per inference cost of both
+ * continuous paths (window copy + cmvnw, cmvnw_ring) */
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <chrono>
+
+#include "edge-impulse-sdk/dsp/speechpy/processing.hpp"
+#include "host_test.h"
+
+using namespace ei;
+
+// speechpy cmvnw: symmetric padding, windowed mean of the input, then std of
+// the mean normalized values over the same windows
+static std::vector<double> reference_cmvnw(const std::vector<float> &in, int rows, int cols, int win_size, bool variance)
+{
+    const int pad = (win_size - 1) / 2;
+    auto reflect = [rows](int r) {
+        const int period = 2 * rows;
+        r %= period;
+        if (r < 0) r += period;
+        return r < rows ? r : period - 1 - r;
+    };
+
+    std::vector<double> mean_norm(rows * cols);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            double sum = 0;
+            for (int w = r - pad; w < r - pad + win_size; w++) {
+                sum += in[reflect(w) * cols + c];
+            }
+            mean_norm[r * cols + c] = in[r * cols + c] - sum / win_size;
+        }
+    }
+    if (!variance) {
+        return mean_norm;
+    }
+
+    std::vector<double> out(rows * cols);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            double sum = 0, sum_sq = 0;
+            for (int w = r - pad; w < r - pad + win_size; w++) {
+                sum += mean_norm[reflect(w) * cols + c];
+            }
+            const double mean = sum / win_size;
+            for (int w = r - pad; w < r - pad + win_size; w++) {
+                const double d = mean_norm[reflect(w) * cols + c] - mean;
+                sum_sq += d * d;
+            }
+            out[r * cols + c] = mean_norm[r * cols + c] / (sqrt(sum_sq / win_size) + 1e-10);
+        }
+    }
+    return out;
+}
+
+static std::vector<float> random_features(int rows, int cols, float offset, float spread, float trend = 0.0f)
+{
+    std::vector<float> data(rows * cols);
+    for (size_t ix = 0; ix < data.size(); ix++) {
+        data[ix] = offset + trend * (ix / cols) + spread * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    return data;
+}
+
+/* The window stored as a ring whose oldest row is first_row */
+static std::vector<float> rotate_rows(const std::vector<float> &in, int rows, int cols, int first_row)
+{
+    std::vector<float> ring(in.size());
+    for (int r = 0; r < rows; r++) {
+        memcpy(&ring[((first_row + r) % rows) * cols], &in[r * cols], cols * sizeof(float));
+    }
+    return ring;
+}
+
+static void test_matches_reference()
+{
+    struct { int rows, cols, win; float offset, spread, trend; } cases[] = {
+        { 99, 13, 101, 0.0f, 20.0f, 0.0f },
+        { 99, 13, 101, -350.0f, 2.0f, 0.0f },  // MFCC c0 like: large offset, small variation
+        { 49, 40, 101, 1000.0f, 0.5f, 0.0f },
+        { 99, 13, 101, 0.0f, 1.0f, 8.0f },     // trend, the windowed means of the mean
+        { 200, 8, 31, 0.0f, 1.0f, 20.0f },     // normalized values stay far from zero
+        { 50, 32, 301, 5.0f, 1.0f, 0.0f },     // window much larger than the matrix
+        { 7, 3, 4, 0.0f, 1.0f, 0.0f },         // even window, cmvnw_ring only
+        { 1, 8, 5, 2.0f, 1.0f, 0.0f },
+    };
+
+    for (auto &tc : cases) {
+        for (int variance = 0; variance < 4; variance++) {
+            const bool ring = variance >= 2;
+            std::vector<float> data = random_features(tc.rows, tc.cols, tc.offset, tc.spread, tc.trend);
+            std::vector<double> ref = reference_cmvnw(data, tc.rows, tc.cols, tc.win, variance & 1);
+
+            if (ring) {
+                const int first_row = tc.rows / 3;
+                std::vector<float> in = rotate_rows(data, tc.rows, tc.cols, first_row);
+                matrix_t m(tc.rows, tc.cols, data.data());
+                CHECK(speechpy::processing::cmvnw_ring(in.data(), first_row, &m, tc.win, variance & 1, false) == EIDSP_OK);
+            }
+            else if (tc.win % 2 == 0) {
+                continue; // cmvnw reads one row past its padded copy for even windows
+            }
+            else {
+                matrix_t m(tc.rows, tc.cols, data.data());
+                CHECK(speechpy::processing::cmvnw(&m, tc.win, variance & 1, false) == EIDSP_OK);
+            }
+
+            // relative to the spread of the output, plus what float storage of the
+            // input can resolve (the subtraction of the mean is done in float);
+            // cmvnw also sums each window in float, one rounding per row of the window
+            const double magnitude = fabs(tc.offset) + tc.trend * tc.rows;
+            const double tolerance = 1e-4 + 4 * FLT_EPSILON * magnitude / tc.spread * (ring ? 1 : tc.win);
+            double out_scale = 1e-3;
+            double max_err = 0;
+            for (size_t ix = 0; ix < ref.size(); ix++) {
+                out_scale = std::max(out_scale, fabs(ref[ix]));
+                max_err = std::max(max_err, fabs(ref[ix] - data[ix]));
+            }
+            if (tc.rows == 1) {
+                continue; // the output is ~0, nothing to compare against
+            }
+            if (max_err / out_scale > tolerance) {
+                printf("%s rows %d cols %d win %d offset %g variance %d: max err %g (scale %g)\n",
+                    ring ? "cmvnw_ring" : "cmvnw", tc.rows, tc.cols, tc.win, tc.offset, variance & 1, max_err, out_scale);
+            }
+            CHECK(max_err / out_scale <= tolerance);
+        }
+    }
+}
+
+/* cmvnw_ring on a ring with its oldest row anywhere gives what cmvnw gives on
+ * the window copied in order (MFCC: variance, MFE < v3: scaled) */
+static void test_ring_matches_cmvnw()
+{
+    struct { int rows, cols, win; bool variance, scale; float offset, spread; } cases[] = {
+        { 99, 13, 101, true, false, -20.0f, 30.0f },
+        { 99, 40, 101, false, true, 0.0f, 10.0f },
+        { 49, 13, 301, true, false, 5.0f, 1.0f },
+        { 12, 4, 5, true, false, 0.0f, 1.0f },
+    };
+
+    double max_err = 0;
+    for (auto &tc : cases) {
+        std::vector<float> data = random_features(tc.rows, tc.cols, tc.offset, tc.spread);
+        std::vector<float> expected = data;
+        matrix_t e(tc.rows, tc.cols, expected.data());
+        CHECK(speechpy::processing::cmvnw(&e, tc.win, tc.variance, tc.scale) == EIDSP_OK);
+
+        double out_scale = 1e-3;
+        for (float v : expected) {
+            out_scale = std::max(out_scale, (double)fabsf(v));
+        }
+        for (int first_row = 0; first_row < tc.rows; first_row++) {
+            std::vector<float> ring = rotate_rows(data, tc.rows, tc.cols, first_row);
+            std::vector<float> out(data.size());
+            matrix_t m(tc.rows, tc.cols, out.data());
+            CHECK(speechpy::processing::cmvnw_ring(ring.data(), first_row, &m, tc.win, tc.variance, tc.scale) == EIDSP_OK);
+            double err = 0;
+            for (size_t ix = 0; ix < out.size(); ix++) {
+                err = std::max(err, fabs((double)out[ix] - expected[ix]) / out_scale);
+            }
+            max_err = std::max(max_err, err);
+        }
+    }
+    printf("cmvnw_ring against cmvnw, every oldest row: max err %g of the output range\n", max_err);
+    CHECK(max_err <= 2e-5);
+}
+
+static void benchmark()
+{
+    // one inference of continuous classification: copy the window out of the
+    // feature ring and normalize it in place, or normalize it out of the ring
+    struct { const char *name; int rows, cols, win; bool variance; } shapes[] = {
+        { "MFCC 99x13, win 101", 99, 13, 101, true },
+        { "MFE 99x40, win 101", 99, 40, 101, false },
+    };
+    const int rounds = 2000;
+
+    printf("shape                  copy + cmvnw us  cmvnw_ring us\n");
+    for (auto &shape : shapes) {
+        std::vector<float> ring = random_features(shape.rows, shape.cols, -20.0f, 30.0f);
+        std::vector<float> normalized(ring.size());
+        matrix_t m(shape.rows, shape.cols, normalized.data());
+        double cmvnw_us = 0, ring_us = 0;
+
+        for (int r = 0; r < rounds; r++) {
+            auto t0 = std::chrono::steady_clock::now();
+            memcpy(normalized.data(), ring.data(), ring.size() * sizeof(float));
+            speechpy::processing::cmvnw(&m, shape.win, shape.variance, false);
+            auto t1 = std::chrono::steady_clock::now();
+            speechpy::processing::cmvnw_ring(ring.data(), r % shape.rows, &m, shape.win, shape.variance, false);
+            auto t2 = std::chrono::steady_clock::now();
+            cmvnw_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            ring_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+        }
+        printf("%-21s  %15.2f  %13.2f\n", shape.name, cmvnw_us / rounds, ring_us / rounds);
+    }
+}
+
+int main()
+{
+    srand(30);
+    test_matches_reference();
+    test_ring_matches_cmvnw();
+    benchmark();
+    return TEST_RESULT();
+}
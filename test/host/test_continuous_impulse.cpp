@@ -0,0 +1,143 @@
+/* Continuous classification (run_classifier_continuous) on the one window
+ * feature ring against the continuous path it replaced: the per slice
+ * extractors rolling a static window matrix, then the window copied and
+ * normalized in place by calc_cepstral_mean_and_var_normalization_*. Same
+ * synthetic audio through both, every inference compared.
+ *
+ *   test_continuous_impulse mfcc|mfe2|mfe4
+ *
+ * One block type per process (the feature ring is sized on first use). MFCC and
+ * MFE v2 are normalized by cmvnw_ring, within float rounding of cmvnw; MFE v4
+ * copies the window out of the ring and must match bit for bit. */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ei_continuous_impulse.h"
+#include "host_test.h"
+
+/* 6 s of background noise with tone bursts and chirps at varying levels, so
+ * the windowed means and deviations change across the window */
+static std::vector<int16_t> make_audio()
+{
+    std::mt19937 rng(30);
+    std::normal_distribution<float> noise(0.0f, 300.0f);
+    std::vector<int16_t> audio(6 * KWS_FREQUENCY);
+    for (size_t ix = 0; ix < audio.size(); ix++) {
+        const float t = (float)ix / KWS_FREQUENCY;
+        float v = noise(rng);
+        const float burst = fmodf(t, 0.7f);
+        if (burst < 0.3f) {
+            v += 8000.0f * sinf(burst * 10.0f) * sinf(2 * (float)M_PI * (300.0f + 2500.0f * burst) * t);
+        }
+        if (t > 3.0f && t < 4.2f) {
+            v += 12000.0f * sinf(2 * (float)M_PI * 1000.0f * t);
+        }
+        audio[ix] = (int16_t)std::max(-32768.0f, std::min(32767.0f, v));
+    }
+    return audio;
+}
+
+/* run_classifier_continuous on every slice */
+static std::vector<std::vector<float>> run_ring(const ei_impulse_t *impulse, const std::vector<int16_t> &audio)
+{
+    ei_impulse_handle_t handle(impulse);
+    run_classifier_init(&handle);
+    kws_captured.clear();
+    for (size_t offset = 0; offset + KWS_SLICE_SAMPLES <= audio.size(); offset += KWS_SLICE_SAMPLES) {
+        signal_t signal = kws_signal(audio.data() + offset, KWS_SLICE_SAMPLES);
+        ei_impulse_result_t result;
+        CHECK(run_classifier_continuous(&handle, &signal, &result, false) == EI_IMPULSE_OK);
+    }
+    return kws_captured;
+}
+
+/* The continuous path before the feature ring */
+static std::vector<std::vector<float>> run_roll(const ei_impulse_t *impulse, const std::vector<int16_t> &audio)
+{
+    const ei_model_dsp_t &block = impulse->dsp_blocks[0];
+    ei_dsp_clear_continuous_audio_state();
+    ei::matrix_t window(1, block.n_output_features);
+    memset(window.buffer, 0, block.n_output_features * sizeof(float));
+    size_t written = 0;
+    std::vector<std::vector<float>> out;
+
+    for (size_t offset = 0; offset + KWS_SLICE_SAMPLES <= audio.size(); offset += KWS_SLICE_SAMPLES) {
+        signal_t signal = kws_signal(audio.data() + offset, KWS_SLICE_SAMPLES);
+        matrix_size_t slice;
+        int ret = block.extract_fn == &extract_mfcc_features
+            ? extract_mfcc_per_slice_features(&signal, &window, block.config, impulse->frequency, &slice)
+            : extract_mfe_per_slice_features(&signal, &window, block.config, impulse->frequency, &slice);
+        CHECK(ret == EIDSP_OK);
+        written += slice.rows * slice.cols;
+        if (written < block.n_output_features) {
+            continue;
+        }
+
+        ei::matrix_t normalized(1, block.n_output_features);
+        memcpy(normalized.buffer, window.buffer, block.n_output_features * sizeof(float));
+        if (block.extract_fn == &extract_mfcc_features) {
+            calc_cepstral_mean_and_var_normalization_mfcc(&normalized, block.config);
+        }
+        else {
+            calc_cepstral_mean_and_var_normalization_mfe(&normalized, block.config);
+        }
+        out.emplace_back(normalized.buffer, normalized.buffer + block.n_output_features);
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s mfcc|mfe2|mfe4\n", argv[0]);
+        return 2;
+    }
+    const kws_block_t type = strcmp(argv[1], "mfcc") == 0 ? KWS_MFCC
+        : strcmp(argv[1], "mfe2") == 0 ? KWS_MFE_V2 : KWS_MFE_V4;
+    const ei_impulse_t *impulse = kws_make_impulse(type);
+    const std::vector<int16_t> audio = make_audio();
+
+    // twice through the ring, the second run starts from the first one's ring
+    // position: the window is filled again before the next inference
+    std::vector<std::vector<float>> ring = run_ring(impulse, audio);
+    std::vector<std::vector<float>> ring_again = run_ring(impulse, audio);
+    std::vector<std::vector<float>> roll = run_roll(impulse, audio);
+
+    const size_t expected = audio.size() / KWS_SLICE_SAMPLES - (KWS_SLICES - 1);
+    CHECK(roll.size() == expected);
+    CHECK(ring.size() == roll.size() && ring_again.size() == roll.size());
+    if (ring.size() != roll.size() || ring_again.size() != roll.size()) {
+        return TEST_RESULT();
+    }
+
+    double max_err = 0;
+    for (size_t inference = 0; inference < roll.size(); inference++) {
+        double out_scale = 1e-3;
+        for (float v : roll[inference]) {
+            out_scale = std::max(out_scale, (double)fabsf(v));
+        }
+        for (const std::vector<std::vector<float>> *run : { &ring, &ring_again }) {
+            const std::vector<float> &features = (*run)[inference];
+            CHECK(features.size() == roll[inference].size());
+            for (size_t ix = 0; ix < features.size(); ix++) {
+                max_err = std::max(max_err, fabs((double)features[ix] - roll[inference][ix]) / out_scale);
+            }
+        }
+    }
+    printf("%s: %u features, %zu inferences, max difference %g of the output range\n",
+        argv[1], (unsigned)impulse->nn_input_frame_size, roll.size(), max_err);
+    if (type == KWS_MFE_V4) {
+        CHECK(max_err == 0);
+    }
+    else {
+        // the min-max scaling of MFE v2 stretches the rounding of cmvnw_ring
+        CHECK(max_err <= (type == KWS_MFE_V2 ? 5e-5 : 2e-5));
+    }
+
+    run_classifier_deinit();
+    return TEST_RESULT();
+}
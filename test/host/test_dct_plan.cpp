@@ -0,0 +1,224 @@
+/* speechpy::dct_plan::dct2 (truncated DCT-II, cached plan) against the
+ * numpy::dct2 it replaced in MFCC: every kept coefficient, both normalizations,
+ * lengths that take the matrix route and lengths that take the FFT route, then
+ * MFCC end to end against the MFCC computed with numpy::dct2, plus the per
+ * window cost of both.
+ *
+ * Tolerances: both are float and sum in a different order (numpy::dct2 goes
+ * through kissfft), so a coefficient may differ by a few float roundings of the
+ * row: 1e-6 * sqrt(N) of the row's largest coefficient. numpy::dct2 refuses odd
+ * lengths, there dct_plan::dct2 is held to the DCT in double instead. MFCC
+ * moves by well under 1e-5 of the output range, checked at 2e-5. */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
+#include "host_test.h"
+
+using namespace ei;
+
+/* DCT-II in double, with the scaling of numpy::dct2 */
+static double direct_dct2(const float *x, size_t len, size_t k, bool ortho)
+{
+    double sum = 0;
+    for (size_t n = 0; n < len; n++) {
+        sum += x[n] * cos(M_PI * k * (2 * n + 1) / (2.0 * len));
+    }
+    sum *= 2;
+    if (ortho) {
+        sum *= sqrt(1.0 / ((k == 0 ? 4.0 : 2.0) * len));
+    }
+    return sum;
+}
+
+static void test_coefficients()
+{
+    std::mt19937 rng(37);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    const size_t lengths[] = { 2, 7, 8, 13, 20, 32, 40, 64, 80, 128, 256 };
+    const size_t rows = 9;
+    double max_err = 0, max_err_odd = 0;
+
+    for (size_t len : lengths) {
+        const size_t outs[] = { 1, 13, len / 2, len };
+        for (size_t num_out : outs) {
+            if (num_out == 0 || num_out > len) {
+                continue;
+            }
+            for (int ortho = 0; ortho < 2; ortho++) {
+                const DCT_NORMALIZATION_MODE mode = ortho ? DCT_NORMALIZATION_ORTHO : DCT_NORMALIZATION_NONE;
+                std::vector<float> input(rows * len);
+                for (size_t ix = 0; ix < input.size(); ix++) {
+                    // MFCC like rows: log energies with an offset, and plain noise
+                    input[ix] = (ix / len) % 2 ? -20.0f + 5.0f * normal(rng) : normal(rng);
+                }
+                std::vector<float> expected = input;
+                std::vector<float> data = input;
+                matrix_t e(rows, len, expected.data());
+                // numpy::dct2 goes through a real FFT and refuses odd lengths, those
+                // are compared against the DCT in double instead
+                const bool odd = len % 2 != 0;
+                CHECK((numpy::dct2(&e, mode) == EIDSP_OK) == !odd);
+                matrix_t m(rows, len, data.data());
+                CHECK(speechpy::dct_plan::dct2(&m, num_out, mode) == EIDSP_OK);
+
+                for (size_t row = 0; row < rows; row++) {
+                    const float *x = &input[row * len];
+                    if (odd) {
+                        for (size_t k = 0; k < len; k++) {
+                            expected[row * len + k] = (float)direct_dct2(x, len, k, ortho);
+                        }
+                    }
+                    // relative to the largest coefficient of the row
+                    double row_scale = 1e-6;
+                    for (size_t k = 0; k < len; k++) {
+                        row_scale = std::max(row_scale, (double)fabsf(expected[row * len + k]));
+                    }
+                    for (size_t k = 0; k < num_out; k++) {
+                        const double err = fabs((double)data[row * len + k] - expected[row * len + k]) / row_scale;
+                        double &worst = odd ? max_err_odd : max_err;
+                        worst = std::max(worst, err);
+                        if (err > 1e-6 * sqrt((double)len)) {
+                            printf("N %zu keep %zu ortho %d row %zu k %zu: %g vs %g\n", len, num_out, ortho, row, k,
+                                data[row * len + k], expected[row * len + k]);
+                        }
+                        CHECK(err <= 1e-6 * sqrt((double)len));
+                    }
+                }
+            }
+        }
+    }
+    printf("dct_plan::dct2 against numpy::dct2: max err %g of the row's largest coefficient "
+        "(odd lengths against double: %g)\n", max_err, max_err_odd);
+    speechpy::dct_plan::free_plan();
+}
+
+static std::vector<float> test_audio;
+
+static int get_test_audio(size_t offset, size_t length, float *out_ptr)
+{
+    memcpy(out_ptr, test_audio.data() + offset, length * sizeof(float));
+    return 0;
+}
+
+static signal_t audio_signal()
+{
+    signal_t signal;
+    signal.total_length = test_audio.size();
+    signal.get_data = &get_test_audio;
+    return signal;
+}
+
+/* feature::mfcc as it was, numpy::dct2 over all the filters */
+static void reference_mfcc(std::vector<float> &out, uint8_t num_cepstral, uint16_t num_filters, uint16_t fft_length)
+{
+    signal_t signal = audio_signal();
+    matrix_size_t size = speechpy::feature::calculate_mfe_buffer_size(test_audio.size(), 16000, 0.02f, 0.02f,
+        num_filters, 4);
+    matrix_t features(size.rows, size.cols);
+    matrix_t energy(size.rows, 1);
+    CHECK(speechpy::feature::mfe(&features, &energy, &signal, 16000, 0.02f, 0.02f, num_filters, fft_length,
+        0, 0, 4) == EIDSP_OK);
+    CHECK(numpy::log(&features) == EIDSP_OK);
+    CHECK(numpy::dct2(&features, DCT_NORMALIZATION_ORTHO) == EIDSP_OK);
+    out.resize(size.rows * num_cepstral);
+    for (size_t row = 0; row < size.rows; row++) {
+        features.buffer[row * features.cols] = numpy::log(energy.buffer[row]);
+        for (size_t i = 0; i < num_cepstral; i++) {
+            out[row * num_cepstral + i] = features.buffer[row * features.cols + i];
+        }
+    }
+}
+
+static void run_mfcc(std::vector<float> &out, uint8_t num_cepstral, uint16_t num_filters, uint16_t fft_length)
+{
+    signal_t signal = audio_signal();
+    matrix_size_t size = speechpy::feature::calculate_mfcc_buffer_size(test_audio.size(), 16000, 0.02f, 0.02f,
+        num_cepstral, 4);
+    out.resize(size.rows * size.cols);
+    matrix_t m(size.rows, size.cols, out.data());
+    CHECK(speechpy::feature::mfcc(&m, &signal, 16000, 0.02f, 0.02f, num_cepstral, num_filters, fft_length,
+        0, 0, true, 4) == EIDSP_OK);
+}
+
+static void test_mfcc()
+{
+    std::mt19937 rng(38);
+    std::normal_distribution<float> noise(0.0f, 200.0f);
+    test_audio.resize(16000);
+    for (size_t ix = 0; ix < test_audio.size(); ix++) {
+        const float t = ix / 16000.0f;
+        test_audio[ix] = 6000.0f * sinf(2 * (float)M_PI * (200.0f + 1500.0f * t) * t) * sinf(3.0f * t) + noise(rng);
+    }
+
+    const struct { uint8_t cepstral; uint16_t filters, fft; } shapes[] = {
+        { 13, 32, 256 }, { 13, 40, 512 }, { 20, 40, 512 }, { 40, 40, 512 },
+    };
+    for (auto &shape : shapes) {
+        std::vector<float> expected, got;
+        reference_mfcc(expected, shape.cepstral, shape.filters, shape.fft);
+        run_mfcc(got, shape.cepstral, shape.filters, shape.fft);
+        CHECK(got.size() == expected.size());
+        double out_scale = 1e-3, max_err = 0;
+        for (float v : expected) {
+            out_scale = std::max(out_scale, (double)fabsf(v));
+        }
+        for (size_t ix = 0; ix < got.size() && ix < expected.size(); ix++) {
+            max_err = std::max(max_err, fabs((double)got[ix] - expected[ix]) / out_scale);
+        }
+        printf("MFCC %u of %u filters: max difference %g of the output range\n",
+            shape.cepstral, shape.filters, max_err);
+        CHECK(max_err <= 2e-5);
+    }
+    speechpy::dct_plan::free_plan();
+}
+
+static void benchmark()
+{
+    // the DCT of one MFCC window (1 s, 20 ms stride)
+    const struct { const char *name; size_t rows, len, keep; } shapes[] = {
+        { "99x32 keep 13", 99, 32, 13 },
+        { "99x40 keep 13", 99, 40, 13 },
+        { "49x64 keep 64", 49, 64, 64 },
+    };
+    const int rounds = 200;
+    std::mt19937 rng(39);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    printf("shape           numpy::dct2 us  dct_plan::dct2 us\n");
+    for (auto &shape : shapes) {
+        std::vector<float> input(shape.rows * shape.len);
+        for (float &v : input) {
+            v = normal(rng);
+        }
+        std::vector<float> work(input.size());
+        matrix_t m(shape.rows, shape.len, work.data());
+        double numpy_us = 0, plan_us = 0;
+        for (int r = 0; r < rounds; r++) {
+            memcpy(work.data(), input.data(), input.size() * sizeof(float));
+            auto t0 = std::chrono::steady_clock::now();
+            numpy::dct2(&m, DCT_NORMALIZATION_ORTHO);
+            auto t1 = std::chrono::steady_clock::now();
+            memcpy(work.data(), input.data(), input.size() * sizeof(float));
+            auto t2 = std::chrono::steady_clock::now();
+            speechpy::dct_plan::dct2(&m, shape.keep, DCT_NORMALIZATION_ORTHO);
+            auto t3 = std::chrono::steady_clock::now();
+            numpy_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            plan_us += std::chrono::duration<double, std::micro>(t3 - t2).count();
+        }
+        printf("%-14s  %14.1f  %17.1f\n", shape.name, numpy_us / rounds, plan_us / rounds);
+    }
+    speechpy::dct_plan::free_plan();
+}
+
+int main()
+{
+    test_coefficients();
+    test_mfcc();
+    benchmark();
+    return TEST_RESULT();
+}
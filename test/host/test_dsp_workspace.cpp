@@ -0,0 +1,181 @@
+/* Cached DSP workspaces: the size query does not allocate, reserving allocates
+ * the FFT workspace once, ei_dsp_free_workspaces releases it and the DCT plan.
+ * FFT workspaces are cached per length: blocks with different lengths keep their
+ * own, and give the same output as with a freshly allocated workspace.
+ * Built with EIDSP_TRACK_ALLOCATIONS so ei_memory_in_use counts DSP memory. */
+
+#include <vector>
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/classifier/ei_run_dsp.h"
+#include "host_test.h"
+
+static ei_dsp_config_spectral_analysis_t fft_config(int fft_length)
+{
+    ei_dsp_config_spectral_analysis_t config;
+    memset(&config, 0, sizeof(config));
+    config.implementation_version = 4;
+    config.axes = 3;
+    config.scale_axes = 1.0f;
+    config.input_decimation_ratio = 1;
+    config.filter_type = "none";
+    config.analysis_type = "FFT";
+    config.fft_length = fft_length;
+    config.wavelet = "";
+    return config;
+}
+
+static void test_fft_workspace()
+{
+    ei_dsp_config_spectral_analysis_t config = fft_config(256);
+    const size_t in_use = ei_memory_in_use;
+
+    // size query only
+    const size_t size = get_spectral_analysis_workspace_size(&config, 3 * 300);
+    CHECK(size >= spectral::fft_workspace::get_size(256));
+    CHECK(ei_memory_in_use == in_use);
+
+    // reserve allocates the FFT workspace once
+    CHECK(reserve_spectral_analysis_workspace(&config));
+    CHECK(ei_memory_in_use == in_use + spectral::fft_workspace::get_size(256));
+    CHECK(reserve_spectral_analysis_workspace(&config));
+    CHECK(ei_memory_in_use == in_use + spectral::fft_workspace::get_size(256));
+
+    // the size query does not touch the cached workspace either
+    get_spectral_analysis_workspace_size(&config, 3 * 300);
+    CHECK(ei_memory_in_use == in_use + spectral::fft_workspace::get_size(256));
+
+    ei_dsp_free_workspaces();
+    CHECK(ei_memory_in_use == in_use);
+
+    // Wavelet blocks have nothing to reserve
+    config.analysis_type = "Wavelet";
+    config.wavelet = "haar";
+    config.wavelet_level = 1;
+    CHECK(reserve_spectral_analysis_workspace(&config));
+    CHECK(ei_memory_in_use == in_use);
+}
+
+static void test_dct_plan()
+{
+    const size_t in_use = ei_memory_in_use;
+    float data[4 * 32];
+    for (size_t ix = 0; ix < sizeof(data) / sizeof(data[0]); ix++) {
+        data[ix] = (float)(ix % 7);
+    }
+    matrix_t m(4, 32, data);
+
+    // the plan stays cached after the transform
+    CHECK(speechpy::dct_plan::dct2(&m, 13) == EIDSP_OK);
+    CHECK(ei_memory_in_use > in_use);
+
+    // together with an FFT workspace, both are released
+    ei_dsp_config_spectral_analysis_t config = fft_config(128);
+    CHECK(reserve_spectral_analysis_workspace(&config));
+    ei_dsp_free_workspaces();
+    CHECK(ei_memory_in_use == in_use);
+
+    // and rebuilt on next use
+    CHECK(speechpy::dct_plan::dct2(&m, 13) == EIDSP_OK);
+    ei_dsp_free_workspaces();
+    CHECK(ei_memory_in_use == in_use);
+}
+
+/* Two FFT lengths in turn stay resident, the least recently used length goes
+ * once there are more than EIDSP_FFT_WORKSPACE_CACHE_SIZE */
+static void test_fft_workspace_per_length()
+{
+    const size_t in_use = ei_memory_in_use;
+    const size_t both = spectral::fft_workspace::get_size(128) + spectral::fft_workspace::get_size(256);
+
+    ei_dsp_config_spectral_analysis_t config = fft_config(128);
+    CHECK(reserve_spectral_analysis_workspace(&config));
+    CHECK(reserve_speechpy_workspace(256));
+    CHECK(ei_memory_in_use == in_use + both);
+
+    // alternating between the two does not allocate
+    spectral::fft_workspace::plan_t *p128 = spectral::fft_workspace::get_plan(128);
+    spectral::fft_workspace::plan_t *p256 = spectral::fft_workspace::get_plan(256);
+    for (int round = 0; round < 4; round++) {
+        CHECK(spectral::fft_workspace::get_plan(128) == p128);
+        CHECK(spectral::fft_workspace::get_plan(256) == p256);
+    }
+    CHECK(p128->fft_length == 128 && p256->fft_length == 256);
+    CHECK(ei_memory_in_use == in_use + both);
+
+    // four lengths fit, a fifth one pushes out the least recently used (256)
+    CHECK(EIDSP_FFT_WORKSPACE_CACHE_SIZE == 4);
+    CHECK(spectral::fft_workspace::get_plan(64) != nullptr);
+    CHECK(spectral::fft_workspace::get_plan(512) != nullptr);
+    CHECK(spectral::fft_workspace::get_plan(128) == p128);
+    CHECK(spectral::fft_workspace::get_plan(1024) != nullptr);
+    size_t expected = 0;
+    for (size_t length : { 64, 128, 512, 1024 }) {
+        expected += spectral::fft_workspace::get_size(length);
+    }
+    CHECK(ei_memory_in_use == in_use + expected);
+    CHECK(spectral::fft_workspace::get_plan(128) == p128);
+    CHECK(ei_memory_in_use == in_use + expected);
+
+    ei_dsp_free_workspaces();
+    CHECK(ei_memory_in_use == in_use);
+}
+
+static std::vector<float> test_audio;
+
+static int get_test_audio(size_t offset, size_t length, float *out_ptr)
+{
+    memcpy(out_ptr, test_audio.data() + offset, length * sizeof(float));
+    return 0;
+}
+
+/* MFE with a 256 point FFT, spectrogram with 128 points on the same audio */
+static void run_blocks(std::vector<float> &mfe_out, std::vector<float> &spectrogram_out)
+{
+    signal_t signal;
+    signal.total_length = test_audio.size();
+    signal.get_data = &get_test_audio;
+    matrix_size_t size = speechpy::feature::calculate_mfe_buffer_size(test_audio.size(), 16000, 0.02f, 0.01f, 40, 4);
+    mfe_out.assign(size.rows * size.cols, 0.0f);
+    matrix_t mfe(size.rows, size.cols, mfe_out.data());
+    CHECK(speechpy::feature::mfe(&mfe, nullptr, &signal, 16000, 0.02f, 0.01f, 40, 256, 0, 0, 4) == EIDSP_OK);
+
+    signal.total_length = test_audio.size();
+    size = speechpy::feature::calculate_mfe_buffer_size(test_audio.size(), 16000, 0.016f, 0.008f, 65, 4);
+    spectrogram_out.assign(size.rows * size.cols, 0.0f);
+    matrix_t spectrogram(size.rows, size.cols, spectrogram_out.data());
+    CHECK(speechpy::feature::spectrogram(&spectrogram, &signal, 16000, 0.016f, 0.008f, 128, 4) == EIDSP_OK);
+}
+
+/* Blocks with different FFT lengths in turn on the cached workspaces give what
+ * each gives on a freshly allocated workspace, bit for bit */
+static void test_fft_workspace_output()
+{
+    test_audio.resize(8000);
+    for (size_t ix = 0; ix < test_audio.size(); ix++) {
+        test_audio[ix] = 3000.0f * sinf(ix * 0.05f) + 700.0f * sinf(ix * 1.3f) + (float)((ix * 7919) % 200) - 100.0f;
+    }
+
+    std::vector<float> mfe_cold, spectrogram_cold, mfe_warm, spectrogram_warm, unused;
+    ei_dsp_free_workspaces();
+    run_blocks(mfe_cold, unused);
+    ei_dsp_free_workspaces();
+    run_blocks(unused, spectrogram_cold);
+    ei_dsp_free_workspaces();
+
+    for (int round = 0; round < 3; round++) {
+        run_blocks(mfe_warm, spectrogram_warm);
+        CHECK(mfe_warm == mfe_cold);
+        CHECK(spectrogram_warm == spectrogram_cold);
+    }
+    ei_dsp_free_workspaces();
+}
+
+int main()
+{
+    test_fft_workspace();
+    test_dct_plan();
+    test_fft_workspace_per_length();
+    test_fft_workspace_output();
+    return TEST_RESULT();
+}
@@ -0,0 +1,182 @@
+/* LIS3DHTR FIFO streaming against a register level mock of the I2C bus: the
+ * 32 sample FIFO in stream mode, FIFO_SRC and the OUT_Z_H -> OUT_X_L address
+ * rollover of burst reads with the FIFO enabled */
+
+#include <cstring>
+#include <cmath>
+#include <deque>
+#include <array>
+
+#include "LIS3DHTR.h"
+#include "host_test.h"
+
+struct mock_chip {
+    uint8_t regs[128];
+    std::deque<std::array<int16_t, 3>> fifo;
+    int transactions;
+    int16_t next;
+    uint32_t dropped;
+
+    // the chip samples `count` new readings, stream mode drops the oldest when full
+    void produce(int count)
+    {
+        for (int ix = 0; ix < count; ix++) {
+            std::array<int16_t, 3> s = { next, (int16_t)(next + 1000), (int16_t)-next };
+            next++;
+            if (fifo.size() == LIS3DHTR_FIFO_SIZE) {
+                fifo.pop_front();
+                dropped++;
+            }
+            fifo.push_back(s);
+        }
+    }
+
+    uint8_t fifo_src()
+    {
+        const size_t n = fifo.size();
+        const size_t wtm = regs[LIS3DHTR_REG_ACCEL_FIFO_CTRL] & LIS3DHTR_REG_ACCEL_FIFO_CTRL_FTH_MASK;
+        return (n == 0 ? LIS3DHTR_REG_ACCEL_FIFO_SRC_EMPTY : 0)
+            | (n == LIS3DHTR_FIFO_SIZE ? LIS3DHTR_REG_ACCEL_FIFO_SRC_OVRN : 0)
+            | (n >= wtm ? LIS3DHTR_REG_ACCEL_FIFO_SRC_WTM : 0)
+            | (n == LIS3DHTR_FIFO_SIZE ? LIS3DHTR_FIFO_SIZE - 1 : n);
+    }
+};
+
+static int mock_write(void *ctx, uint8_t addr, const uint8_t *data, uint16_t len)
+{
+    mock_chip *chip = (mock_chip *)ctx;
+    chip->transactions++;
+    if (len != 2) {
+        return -1;
+    }
+    chip->regs[data[0] & 0x7F] = data[1];
+    if ((data[0] & 0x7F) == LIS3DHTR_REG_ACCEL_FIFO_CTRL
+        && (data[1] & LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_MASK) == LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_BYPASS) {
+        chip->fifo.clear();
+    }
+    return 0;
+}
+
+static int mock_write_read(void *ctx, uint8_t addr, const uint8_t *wr, uint16_t wr_len, uint8_t *rd, uint16_t rd_len)
+{
+    mock_chip *chip = (mock_chip *)ctx;
+    chip->transactions++;
+    uint8_t reg = wr[0] & 0x7F;
+    const bool increment = wr[0] & 0x80;
+
+    for (uint16_t ix = 0; ix < rd_len; ix++) {
+        if (reg == LIS3DHTR_REG_ACCEL_WHO_AM_I) {
+            rd[ix] = 0x33;
+        }
+        else if (reg == LIS3DHTR_REG_ACCEL_FIFO_SRC) {
+            rd[ix] = chip->fifo_src();
+        }
+        else if (reg >= LIS3DHTR_REG_ACCEL_OUT_X_L && reg <= LIS3DHTR_REG_ACCEL_OUT_Z_H) {
+            std::array<int16_t, 3> s = chip->fifo.empty() ? std::array<int16_t, 3>{ 0, 0, 0 } : chip->fifo.front();
+            const uint16_t v = s[(reg - LIS3DHTR_REG_ACCEL_OUT_X_L) / 2];
+            rd[ix] = (reg & 1) ? v >> 8 : v & 0xFF;
+            // reading OUT_Z_H pops the sample
+            if (reg == LIS3DHTR_REG_ACCEL_OUT_Z_H && !chip->fifo.empty()) {
+                chip->fifo.pop_front();
+            }
+        }
+        else {
+            rd[ix] = chip->regs[reg];
+        }
+
+        if (increment) {
+            reg++;
+            if (reg == LIS3DHTR_REG_ACCEL_OUT_Z_H + 1
+                && (chip->regs[LIS3DHTR_REG_ACCEL_CTRL_REG5] & LIS3DHTR_REG_ACCEL_CTRL_REG5_FIFO_EN)) {
+                reg = LIS3DHTR_REG_ACCEL_OUT_X_L;
+            }
+        }
+    }
+    return 0;
+}
+
+// mock counts are 1/16000 g at 2G full scale
+static int to_counts(float g)
+{
+    return (int)lroundf(g * 16000.0f);
+}
+
+static void test_stream()
+{
+    mock_chip chip;
+    memset(chip.regs, 0, sizeof(chip.regs));
+    chip.transactions = 0;
+    chip.next = 0;
+    chip.dropped = 0;
+    lis3dhtr_bus_t bus = { mock_write, mock_write_read, &chip };
+
+    LIS3DHTR lis;
+    lis.setBus(&bus);
+    lis.begin();
+    CHECK(lis.isConnection());
+    lis.setFullScaleRange(LIS3DHTR_RANGE_2G);
+
+    lis.enableFifo(16, true);
+    CHECK(chip.regs[LIS3DHTR_REG_ACCEL_CTRL_REG5] & LIS3DHTR_REG_ACCEL_CTRL_REG5_FIFO_EN);
+    CHECK((chip.regs[LIS3DHTR_REG_ACCEL_FIFO_CTRL] & LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_MASK) == LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_STREAM);
+    CHECK((chip.regs[LIS3DHTR_REG_ACCEL_FIFO_CTRL] & LIS3DHTR_REG_ACCEL_FIFO_CTRL_FTH_MASK) == 16);
+    CHECK(chip.regs[LIS3DHTR_REG_ACCEL_CTRL_REG3] & LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_WTM);
+
+    chip.produce(10);
+    CHECK(!lis.fifoWatermark());
+    CHECK(lis.getFifoLevel() == 10);
+    chip.produce(10);
+    CHECK(lis.fifoWatermark());
+
+    // polls with 0..39 new samples, past 32 the chip itself drops the oldest
+    int expect = 0, received = 0;
+    for (int round = 0; round < 50; round++) {
+        if (round) {
+            chip.produce(round % 40);
+        }
+        const int before = chip.transactions;
+        const uint16_t drained = lis.serviceFifo();
+        // one FIFO_SRC read plus one burst read, whatever the level
+        CHECK(chip.transactions - before == (drained ? 2 : 1));
+
+        float x, y, z;
+        while (lis.popSample(&x, &y, &z)) {
+            const int v = to_counts(x);
+            CHECK(v >= expect);
+            CHECK(to_counts(y) == v + 1000);
+            CHECK(to_counts(z) == -v);
+            expect = v + 1;
+            received++;
+        }
+    }
+    // everything the chip kept arrives in order
+    CHECK(received == chip.next - (int)chip.dropped);
+    CHECK(chip.dropped > 0);
+    CHECK(lis.getFifoOverruns() > 0);
+
+    // the software ring overflows when nothing pops
+    const uint32_t overruns = lis.getFifoOverruns();
+    for (int ix = 0; ix < 3; ix++) {
+        chip.produce(LIS3DHTR_FIFO_SIZE - 1);
+        lis.serviceFifo();
+    }
+    CHECK(lis.fifoAvailable() == LIS3DHTR_FIFO_RING_SIZE);
+    CHECK(lis.getFifoOverruns() == overruns + 3 * (LIS3DHTR_FIFO_SIZE - 1) - LIS3DHTR_FIFO_RING_SIZE);
+    // the newest samples are kept
+    float x, y, z, last = 0;
+    while (lis.popSample(&x, &y, &z)) {
+        last = x;
+    }
+    CHECK(to_counts(last) == chip.next - 1);
+
+    lis.disableFifo();
+    CHECK(!(chip.regs[LIS3DHTR_REG_ACCEL_CTRL_REG5] & LIS3DHTR_REG_ACCEL_CTRL_REG5_FIFO_EN));
+    CHECK((chip.regs[LIS3DHTR_REG_ACCEL_FIFO_CTRL] & LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_MASK) == LIS3DHTR_REG_ACCEL_FIFO_CTRL_FM_BYPASS);
+    CHECK(!(chip.regs[LIS3DHTR_REG_ACCEL_CTRL_REG3] & LIS3DHTR_REG_ACCEL_CTRL_REG3_I1_WTM));
+}
+
+int main()
+{
+    test_stream();
+    return TEST_RESULT();
+}
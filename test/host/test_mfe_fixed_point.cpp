@@ -0,0 +1,440 @@
+/* Fixed-point MFE front end (speechpy::feature_q15 through
+ * extract_mfe_features_quantized) against the float path it stands in for:
+ * extract_mfe_features (pre-emphasis, feature::mfe, mfe_normalization) and the
+ * model input quantization of tflite_helper.h (pre_cast_quantize).
+ * The audio goes through WAV files: synthetic voiced / unvoiced speech, tones,
+ * chirps, quiet and silent audio are written to the working directory and read
+ * back, any 16-bit PCM WAV given on the command line is added to them.
+ *
+ *   test_mfe_fixed_point [file.wav...]
+ *
+ * Every feature within one quantization step of the float path, and few of them
+ * off by that step (rounding of log10 values that land on a 1/256 boundary). */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/classifier/ei_run_dsp.h"
+#include "host_test.h"
+
+typedef struct {
+    std::string name;
+    uint32_t frequency;
+    std::vector<int16_t> samples;
+} wav_t;
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int b = 0; b < 4; b++) {
+        out.push_back((uint8_t)(v >> (8 * b)));
+    }
+}
+
+static void put_u16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* 16-bit PCM mono WAV */
+static bool write_wav(const char *path, const wav_t &wav)
+{
+    const uint32_t data_size = (uint32_t)(wav.samples.size() * 2);
+    std::vector<uint8_t> out;
+    out.insert(out.end(), { 'R', 'I', 'F', 'F' });
+    put_u32(out, 36 + data_size);
+    out.insert(out.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    put_u32(out, 16);
+    put_u16(out, 1);
+    put_u16(out, 1);
+    put_u32(out, wav.frequency);
+    put_u32(out, wav.frequency * 2);
+    put_u16(out, 2);
+    put_u16(out, 16);
+    out.insert(out.end(), { 'd', 'a', 't', 'a' });
+    put_u32(out, data_size);
+    for (int16_t s : wav.samples) {
+        put_u16(out, (uint16_t)s);
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    const bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return fclose(f) == 0 && ok;
+}
+
+/* 16-bit PCM WAV, first channel only */
+static bool read_wav(const char *path, wav_t &wav)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    std::vector<uint8_t> in;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        in.insert(in.end(), buf, buf + n);
+    }
+    fclose(f);
+
+    if (in.size() < 12 || memcmp(in.data(), "RIFF", 4) != 0 || memcmp(in.data() + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    uint16_t channels = 0, bits = 0, format = 0;
+    wav.name = path;
+    wav.samples.clear();
+    for (size_t pos = 12; pos + 8 <= in.size(); ) {
+        const uint32_t size = get_u32(&in[pos + 4]);
+        const uint8_t *chunk = &in[pos + 8];
+        if (pos + 8 + size > in.size()) {
+            return false;
+        }
+        if (memcmp(&in[pos], "fmt ", 4) == 0 && size >= 16) {
+            format = get_u16(chunk);
+            channels = get_u16(chunk + 2);
+            wav.frequency = get_u32(chunk + 4);
+            bits = get_u16(chunk + 14);
+        }
+        else if (memcmp(&in[pos], "data", 4) == 0) {
+            if (format != 1 || bits != 16 || channels == 0) {
+                return false;
+            }
+            for (size_t ix = 0; ix + 2 * channels <= size; ix += 2 * channels) {
+                wav.samples.push_back((int16_t)get_u16(chunk + ix));
+            }
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return !wav.samples.empty();
+}
+
+static int16_t clip16(float v)
+{
+    return (int16_t)std::max(-32768.0f, std::min(32767.0f, roundf(v)));
+}
+
+/* Voiced: a 120 Hz pulse train through three formants, with vibrato and a swell */
+static std::vector<int16_t> make_vowel(std::mt19937 &rng, float amplitude)
+{
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const float formants[3][2] = { { 700.0f, 1.0f }, { 1220.0f, 0.5f }, { 2600.0f, 0.2f } };
+    std::vector<int16_t> out(16000);
+    float phase = 0.0f;
+    for (size_t ix = 0; ix < out.size(); ix++) {
+        const float t = ix / 16000.0f;
+        const float f0 = 120.0f + 8.0f * sinf(2 * (float)M_PI * 5.0f * t);
+        phase += f0 / 16000.0f;
+        float v = 0.0f;
+        for (int h = 1; h * f0 < 7500.0f; h++) {
+            float gain = 0.0f;
+            for (auto &formant : formants) {
+                const float d = (h * f0 - formant[0]) / 90.0f;
+                gain += formant[1] / (1.0f + d * d);
+            }
+            v += gain / h * sinf(2 * (float)M_PI * h * phase);
+        }
+        const float swell = sinf((float)M_PI * t);
+        out[ix] = clip16(amplitude * swell * v + 20.0f * noise(rng));
+    }
+    return out;
+}
+
+/* Unvoiced: white noise, first difference (high frequencies), bursts */
+static std::vector<int16_t> make_fricative(std::mt19937 &rng, float amplitude)
+{
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::vector<int16_t> out(16000);
+    float prev = 0.0f;
+    for (size_t ix = 0; ix < out.size(); ix++) {
+        const float t = ix / 16000.0f;
+        const float n = noise(rng);
+        const float envelope = fmodf(t, 0.4f) < 0.25f ? 1.0f : 0.05f;
+        out[ix] = clip16(amplitude * envelope * (n - prev));
+        prev = n;
+    }
+    return out;
+}
+
+/* A made up word: silence, fricative, vowel, stop, vowel at another level */
+static std::vector<int16_t> make_word(std::mt19937 &rng)
+{
+    std::vector<int16_t> vowel = make_vowel(rng, 3000.0f);
+    std::vector<int16_t> soft = make_vowel(rng, 600.0f);
+    std::vector<int16_t> fricative = make_fricative(rng, 1500.0f);
+    std::normal_distribution<float> noise(0.0f, 4.0f);
+    std::vector<int16_t> out(16000);
+    for (size_t ix = 0; ix < out.size(); ix++) {
+        float v = noise(rng);
+        if (ix >= 1600 && ix < 4000) v += fricative[ix];
+        else if (ix >= 4000 && ix < 9000) v += vowel[ix];
+        else if (ix >= 9000 && ix < 9400) v += (ix < 9050 ? 9000.0f : 0.0f);
+        else if (ix >= 9400 && ix < 14000) v += soft[ix];
+        out[ix] = clip16(v);
+    }
+    return out;
+}
+
+static std::vector<int16_t> make_tones()
+{
+    std::vector<int16_t> out(16000);
+    for (size_t ix = 0; ix < out.size(); ix++) {
+        const float t = ix / 16000.0f;
+        out[ix] = clip16(9000.0f * sinf(2 * (float)M_PI * 440.0f * t) + 300.0f * sinf(2 * (float)M_PI * 3000.0f * t));
+    }
+    return out;
+}
+
+static std::vector<int16_t> make_chirp(float amplitude)
+{
+    std::vector<int16_t> out(16000);
+    for (size_t ix = 0; ix < out.size(); ix++) {
+        const float t = ix / 16000.0f;
+        out[ix] = clip16(amplitude * sinf(2 * (float)M_PI * (100.0f * t + 3450.0f * t * t)));
+    }
+    return out;
+}
+
+static std::vector<int16_t> make_noise(std::mt19937 &rng, float sigma)
+{
+    std::normal_distribution<float> noise(0.0f, sigma);
+    std::vector<int16_t> out(16000);
+    for (auto &s : out) {
+        s = clip16(noise(rng));
+    }
+    return out;
+}
+
+/* Square wave clipping at full scale */
+static std::vector<int16_t> make_loud()
+{
+    std::vector<int16_t> out(16000);
+    for (size_t ix = 0; ix < out.size(); ix++) {
+        out[ix] = clip16(60000.0f * sinf(2 * (float)M_PI * 250.0f * ix / 16000.0f));
+    }
+    return out;
+}
+
+/* signal_t over the audio being compared */
+static const int16_t *test_audio;
+
+static int get_audio(size_t offset, size_t length, float *out_ptr)
+{
+    return numpy::int16_to_float(test_audio + offset, out_ptr, length);
+}
+
+static signal_t audio_signal(const std::vector<int16_t> &audio)
+{
+    test_audio = audio.data();
+    signal_t signal;
+    signal.total_length = audio.size();
+    signal.get_data = &get_audio;
+    return signal;
+}
+
+static ei_dsp_config_mfe_t mfe_config(uint16_t version, float frame_length, float frame_stride, int fft_length,
+    int noise_floor_db)
+{
+    ei_dsp_config_mfe_t config = { 1, version, 1, nullptr, 0, frame_length, frame_stride, 40, fft_length,
+        0, 0, 101, noise_floor_db };
+    return config;
+}
+
+typedef struct {
+    size_t features;
+    size_t differing;
+    int max_diff;
+    double float_us;
+    double fixed_us;
+} compare_t;
+
+/* One window through both paths */
+static void compare(const std::vector<int16_t> &audio, ei_dsp_config_mfe_t &config, float scale, int zero_point,
+    bool is_signed, compare_t &stats)
+{
+    signal_t signal = audio_signal(audio);
+    const matrix_size_t size = speechpy::feature::calculate_mfe_buffer_size(audio.size(), 16000,
+        config.frame_length, config.frame_stride, config.num_filters, config.implementation_version);
+    const size_t features = size.rows * size.cols;
+
+    ei::matrix_t float_features(1, features);
+    auto t0 = std::chrono::steady_clock::now();
+    CHECK(extract_mfe_features(&signal, &float_features, &config, 16000) == EIDSP_OK);
+    std::vector<int> expected(features);
+    for (size_t ix = 0; ix < features; ix++) {
+        expected[ix] = pre_cast_quantize(float_features.buffer[ix], scale, zero_point, is_signed);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::vector<int8_t> input(features);
+    ei::matrix_i8_t fixed_features(1, features, input.data());
+    signal = audio_signal(audio);
+    CHECK(extract_mfe_features_quantized(&signal, &fixed_features, &config, scale, (float)zero_point, 16000,
+        is_signed) == EIDSP_OK);
+    auto t2 = std::chrono::steady_clock::now();
+    CHECK(fixed_features.rows == 1 && fixed_features.cols == features);
+
+    for (size_t ix = 0; ix < features; ix++) {
+        const int got = is_signed ? (int)input[ix] : (int)(uint8_t)input[ix];
+        const int diff = abs(got - expected[ix]);
+        stats.max_diff = std::max(stats.max_diff, diff);
+        stats.differing += diff != 0;
+    }
+    stats.features += features;
+    stats.float_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+    stats.fixed_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+}
+
+static std::vector<wav_t> make_wavs()
+{
+    std::mt19937 rng(32);
+    std::vector<wav_t> generated = {
+        { "vowel", 16000, make_vowel(rng, 4000.0f) },
+        { "vowel_quiet", 16000, make_vowel(rng, 150.0f) },
+        { "fricative", 16000, make_fricative(rng, 2000.0f) },
+        { "word", 16000, make_word(rng) },
+        { "tones", 16000, make_tones() },
+        { "chirp", 16000, make_chirp(12000.0f) },
+        { "chirp_quiet", 16000, make_chirp(40.0f) },
+        { "noise_quiet", 16000, make_noise(rng, 8.0f) },
+        { "silence", 16000, std::vector<int16_t>(16000, 0) },
+        { "loud", 16000, make_loud() },
+    };
+
+    // through the file format, as recorded audio would come in
+    std::vector<wav_t> wavs;
+    for (const wav_t &wav : generated) {
+        const std::string path = "mfe_" + wav.name + ".wav";
+        wav_t read;
+        CHECK(write_wav(path.c_str(), wav));
+        CHECK(read_wav(path.c_str(), read));
+        CHECK(read.frequency == wav.frequency && read.samples == wav.samples);
+        read.name = wav.name;
+        wavs.push_back(read);
+    }
+    return wavs;
+}
+
+static void test_against_float(const std::vector<wav_t> &wavs)
+{
+    struct {
+        const char *name;
+        ei_dsp_config_mfe_t config;
+    } configs[] = {
+        { "v3 fft 256, 20/10 ms", mfe_config(3, 0.02f, 0.01f, 256, -52) },
+        { "v4 fft 512, 32/16 ms", mfe_config(4, 0.032f, 0.016f, 512, -52) },
+        { "v4 fft 256, 25/10 ms", mfe_config(4, 0.025f, 0.01f, 256, -72) },  // frames truncated to the fft
+        { "v4 fft 1024, 20/20 ms", mfe_config(4, 0.02f, 0.02f, 1024, -40) }, // zero padded
+    };
+
+    printf("config                  input          features  differing  max diff  float us  fixed us\n");
+    for (auto &c : configs) {
+        for (int quantization = 0; quantization < 2; quantization++) {
+            // int8 model input (scale 1/256, zero point -128) and uint8 (1/255, 0)
+            const bool is_signed = quantization == 0;
+            const float scale = is_signed ? 1.0f / 256.0f : 1.0f / 255.0f;
+            const int zero_point = is_signed ? -128 : 0;
+            for (const wav_t &wav : wavs) {
+                if (wav.frequency != 16000) {
+                    continue;
+                }
+                // 1 s windows, the last one may be short (and is skipped)
+                compare_t stats = {};
+                for (size_t offset = 0; offset + 16000 <= wav.samples.size(); offset += 16000) {
+                    std::vector<int16_t> window(wav.samples.begin() + offset, wav.samples.begin() + offset + 16000);
+                    compare(window, c.config, scale, zero_point, is_signed, stats);
+                }
+                if (stats.features == 0) {
+                    continue;
+                }
+                const double fraction = (double)stats.differing / stats.features;
+                if (is_signed) {
+                    printf("%-22s  %-13s  %8zu  %8.2f%%  %8d  %8.0f  %8.0f\n", c.name, wav.name.c_str(),
+                        stats.features, 100.0 * fraction, stats.max_diff, stats.float_us, stats.fixed_us);
+                }
+                if (stats.max_diff > 1 || fraction > 0.02) {
+                    printf("%s %s %s: %zu of %zu features differ, by up to %d\n", c.name, wav.name.c_str(),
+                        is_signed ? "int8" : "uint8", stats.differing, stats.features, stats.max_diff);
+                }
+                CHECK(stats.max_diff <= 1);
+                CHECK(fraction <= 0.02);
+            }
+        }
+    }
+}
+
+/* Blocks the fixed-point path does not take, and the plan's memory */
+static void test_supported_and_plan()
+{
+    ei_dsp_config_mfe_t v4 = mfe_config(4, 0.02f, 0.01f, 256, -52);
+    ei_dsp_config_mfe_t v2 = mfe_config(2, 0.02f, 0.01f, 256, -52);
+    ei_dsp_config_mfe_t not_pow2 = mfe_config(4, 0.02f, 0.01f, 400, -52);
+    ei_dsp_config_mfe_t two_axes = v4;
+    two_axes.axes = 2;
+    ei_dsp_config_mfe_t no_range = mfe_config(4, 0.02f, 0.01f, 256, 12);
+
+    CHECK(!can_extract_mfe_features_quantized(&v2, 16000));
+    CHECK(!can_extract_mfe_features_quantized(&not_pow2, 16000));
+    CHECK(!can_extract_mfe_features_quantized(&two_axes, 16000));
+    CHECK(!can_extract_mfe_features_quantized(&no_range, 16000));
+
+    ei_dsp_free_workspaces();
+    const size_t in_use = ei_memory_in_use;
+    CHECK(can_extract_mfe_features_quantized(&v4, 16000));
+    CHECK(ei_memory_in_use > in_use);
+    const size_t with_plan = ei_memory_in_use;
+
+    // the plan built by the check is the one the extraction uses, no allocation per call
+    std::vector<int16_t> audio(16000, 100);
+    const matrix_size_t size = speechpy::feature::calculate_mfe_buffer_size(audio.size(), 16000,
+        v4.frame_length, v4.frame_stride, v4.num_filters, v4.implementation_version);
+    std::vector<int8_t> input(size.rows * size.cols);
+    ei::matrix_i8_t features(1, input.size(), input.data());
+    signal_t signal = audio_signal(audio);
+    CHECK(extract_mfe_features_quantized(&signal, &features, &v4, 1.0f / 256.0f, -128.0f, 16000, true) == EIDSP_OK);
+    CHECK(ei_memory_in_use == with_plan);
+
+    // an output that is too small is refused
+    ei::matrix_i8_t small(1, input.size() - 1, input.data());
+    signal = audio_signal(audio);
+    CHECK(extract_mfe_features_quantized(&signal, &small, &v4, 1.0f / 256.0f, -128.0f, 16000, true) != EIDSP_OK);
+
+    ei_dsp_free_workspaces();
+    CHECK(ei_memory_in_use == in_use);
+    printf("fixed-point plan, 40 filters, fft 256: %zu bytes\n", with_plan - in_use);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<wav_t> wavs = make_wavs();
+    for (int ix = 1; ix < argc; ix++) {
+        wav_t wav;
+        CHECK(read_wav(argv[ix], wav));
+        if (wav.frequency != 16000) {
+            printf("%s: %u Hz, only 16 kHz audio is compared\n", argv[ix], (unsigned)wav.frequency);
+        }
+        wavs.push_back(wav);
+    }
+
+    test_against_float(wavs);
+    test_supported_and_plan();
+    return TEST_RESULT();
+}
@@ -0,0 +1,117 @@
+/* Streamed snapshot message (write_snapshot_frame_msg): frames of random size
+ * split into parts must decode with QCBOR to a one entry map holding the frame
+ * as a byte string, the parts handed over without a copy. Only the snapshot
+ * message streams, the small get_*_msg builders are not covered here. */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "remote-mgmt.h"
+#include "QCBOR/inc/qcbor.h"
+#include "host_test.h"
+
+static std::vector<fused_sensors_t> fusion_list;
+
+const std::vector<fused_sensors_t> &ei_get_sensor_fusion_list(void)
+{
+    return fusion_list;
+}
+
+typedef struct {
+    std::vector<uint8_t> out;
+    std::vector<const uint8_t *> parts;
+} sink_t;
+
+static bool sink_write(const uint8_t *data, size_t length, void *ctx)
+{
+    sink_t *sink = (sink_t *)ctx;
+    sink->out.insert(sink->out.end(), data, data + length);
+    sink->parts.push_back(data);
+    return true;
+}
+
+static bool fail_write(const uint8_t *data, size_t length, void *ctx)
+{
+    return false;
+}
+
+static void test_round_trip()
+{
+    std::mt19937 rng(1);
+    int failures = 0;
+
+    for (int t = 0; t < 200; t++) {
+        std::vector<uint8_t> frame(t == 0 ? 0 : rng() % 40000);
+        for (auto &b : frame) {
+            b = rng();
+        }
+        const size_t n = frame.size();
+        const size_t p1 = n ? rng() % n : 0;
+        const size_t p2 = std::min(n, n ? p1 + rng() % (n - p1 + 1) : 0);
+        remote_mgmt_part_t parts[3] = {
+            { frame.data(), p1 }, { frame.data() + p1, p2 - p1 }, { frame.data() + p2, n - p2 },
+        };
+        sink_t sink;
+        remote_mgmt_writer_t writer = { sink_write, &sink };
+
+        const int length = write_snapshot_frame_msg(&writer, parts, 3);
+        bool ok = length > 0 && (size_t)length == sink.out.size();
+
+        // the header first, then every non-empty part as it is
+        size_t expected_calls = 1;
+        for (const remote_mgmt_part_t &part : parts) {
+            if (part.length > 0) {
+                ok = ok && expected_calls < sink.parts.size() && sink.parts[expected_calls] == part.data;
+                expected_calls++;
+            }
+        }
+        ok = ok && sink.parts.size() == expected_calls;
+
+        QCBORDecodeContext dc;
+        QCBORItem item;
+        QCBORDecode_Init(&dc, (UsefulBufC){ sink.out.data(), sink.out.size() }, QCBOR_DECODE_MODE_NORMAL);
+        ok = ok && QCBORDecode_GetNext(&dc, &item) == QCBOR_SUCCESS
+            && item.uDataType == QCBOR_TYPE_MAP && item.val.uCount == 1;
+        ok = ok && QCBORDecode_GetNext(&dc, &item) == QCBOR_SUCCESS
+            && item.uDataType == QCBOR_TYPE_BYTE_STRING && item.uLabelType == QCBOR_TYPE_TEXT_STRING
+            && item.label.string.len == 13 && memcmp(item.label.string.ptr, "snapshotFrame", 13) == 0
+            && item.val.string.len == n && (n == 0 || memcmp(item.val.string.ptr, frame.data(), n) == 0);
+        ok = ok && QCBORDecode_Finish(&dc) == QCBOR_SUCCESS;
+
+        failures += !ok;
+    }
+    CHECK(failures == 0);
+}
+
+static void test_size()
+{
+    // a 20 kB JPEG: as a byte string versus base64 in a text string
+    std::vector<uint8_t> frame(20000);
+    remote_mgmt_part_t part = { frame.data(), frame.size() };
+    sink_t sink;
+    remote_mgmt_writer_t writer = { sink_write, &sink };
+    const int length = write_snapshot_frame_msg(&writer, &part, 1);
+
+    const std::string base64((frame.size() + 2) / 3 * 4, 'A');
+    const int base64_length = get_snapshot_frame_msg(nullptr, UINT32_MAX, base64.c_str());
+    printf("20 kB frame: %d B message, %d B with base64\n", length, base64_length);
+    CHECK(length > 0 && (size_t)length < frame.size() + 32);
+    CHECK(base64_length > length);
+}
+
+static void test_write_error()
+{
+    std::vector<uint8_t> frame(100);
+    remote_mgmt_part_t part = { frame.data(), frame.size() };
+    remote_mgmt_writer_t writer = { fail_write, nullptr };
+    CHECK(write_snapshot_frame_msg(&writer, &part, 1) == 0);
+}
+
+int main()
+{
+    test_round_trip();
+    test_size();
+    test_write_error();
+    return TEST_RESULT();
+}
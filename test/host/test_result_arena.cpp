@@ -0,0 +1,158 @@
+/* Result arena of the object detection decoders (ei_result_arena.h): a crowded
+ * YOLOv5 frame with more than EI_CLASSIFIER_RESULT_ARENA_CAPACITY candidates,
+ * most of them overlapping duplicates of strong objects, must keep every
+ * distinct object through non-max suppression. When more distinct objects than
+ * the capacity survive, the strongest are kept and the rest is reported in
+ * bounding_boxes_overflow_count */
+
+#include <cstring>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+// the decoders and NMS of a YOLOv5 model, whatever model is checked in
+#undef EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER
+#define EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER EI_CLASSIFIER_LAST_LAYER_YOLOV5
+#define EI_HAS_OBJECT_DETECTION 1
+#define EI_HAS_YOLOV5 1
+
+#include "edge-impulse-sdk/classifier/ei_fill_result_struct.h"
+#include "host_test.h"
+
+static const char *categories[] = { "object" };
+
+typedef struct {
+    float xc, yc, w, h, score;
+} candidate_t;
+
+static ei_impulse_t make_impulse()
+{
+    ei_impulse_t impulse = {};
+    impulse.input_width = 320;
+    impulse.input_height = 320;
+    impulse.label_count = 1;
+    impulse.categories = categories;
+    impulse.object_detection_count = 10;
+    impulse.object_detection_nms.confidence_threshold = 0.5f;
+    impulse.object_detection_nms.iou_threshold = 0.45f;
+    return impulse;
+}
+
+/* One YOLOv5 output row per candidate: xc, yc, w, h, score, class score */
+static std::vector<float> output_rows(const std::vector<candidate_t> &candidates)
+{
+    std::vector<float> out;
+    for (const candidate_t &c : candidates) {
+        out.insert(out.end(), { c.xc, c.yc, c.w, c.h, c.score, 1.0f });
+    }
+    return out;
+}
+
+/* Cells of the boxes returned, so every object can be matched to its cell */
+static std::set<std::pair<int, int>> cells(const ei_impulse_result_t &result, int cell_w, int cell_h)
+{
+    std::set<std::pair<int, int>> out;
+    for (uint32_t ix = 0; ix < result.bounding_boxes_count; ix++) {
+        const ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[ix];
+        out.insert({ (int)(bb.x + bb.width / 2) / cell_w, (int)(bb.y + bb.height / 2) / cell_h });
+    }
+    return out;
+}
+
+static ei_learning_block_config_tflite_graph_t make_block_config()
+{
+    ei_learning_block_config_tflite_graph_t block_config;
+    memset(&block_config, 0, sizeof(block_config));
+    block_config.threshold = 0.5f;
+    return block_config;
+}
+
+/* 30 strong objects with 5 duplicates each, then 40 weak distinct objects (190 candidates) */
+static void test_crowded_frame()
+{
+    const ei_impulse_t impulse = make_impulse();
+    const ei_learning_block_config_tflite_graph_t block_config = make_block_config();
+    std::vector<candidate_t> candidates;
+    for (int cell = 0; cell < 70; cell++) {
+        const float xc = (cell % 10) * 32 + 16, yc = (cell / 10) * 32 + 16;
+        if (cell < 30) {
+            for (int d = 0; d < 5; d++) {
+                candidates.push_back({ xc + d, yc, 20, 20, 0.99f - d * 0.01f - cell * 0.001f });
+            }
+        }
+        else {
+            candidates.push_back({ xc, yc, 20, 20, 0.6f });
+        }
+    }
+    CHECK(candidates.size() > ei_result_arena_t::capacity());
+
+    std::vector<float> data = output_rows(candidates);
+    ei_result_arena_t arena;
+    ei_result_arena_bind(&arena);
+    ei_impulse_result_t result;
+    memset(&result, 0, sizeof(result));
+    CHECK(fill_result_struct_f32_yolov5(&impulse, &block_config, &result, 5, data.data(), data.size()) == EI_IMPULSE_OK);
+    printf("crowded frame: %zu candidates, %u boxes after NMS, %u dropped\n",
+        candidates.size(), result.bounding_boxes_count, result.bounding_boxes_overflow_count);
+    CHECK(result.bounding_boxes_count == 70);
+    CHECK(cells(result, 32, 32).size() == 70);
+    CHECK(result.bounding_boxes_overflow_count == 0);
+    CHECK(arena.candidates.empty());
+
+    // the same frame quantized (uint8, scale 1/256 on the normalized coordinates of version 6)
+    std::vector<uint8_t> quantized;
+    for (const candidate_t &c : candidates) {
+        for (float v : { c.xc / 320.0f, c.yc / 320.0f, c.w / 320.0f, c.h / 320.0f, c.score, 0.99f }) {
+            quantized.push_back((uint8_t)std::min(255.0f, v * 256.0f + 0.5f));
+        }
+    }
+    memset(&result, 0, sizeof(result));
+    CHECK(fill_result_struct_quantized_yolov5(&impulse, &block_config, &result, 6, quantized.data(), 0.0f,
+        1.0f / 256.0f, quantized.size()) == EI_IMPULSE_OK);
+    printf("crowded frame, quantized: %u boxes after NMS, %u dropped\n",
+        result.bounding_boxes_count, result.bounding_boxes_overflow_count);
+    CHECK(result.bounding_boxes_count == 70);
+    CHECK(cells(result, 32, 32).size() == 70);
+}
+
+/* 120 distinct objects survive NMS: the 100 strongest are kept, 20 reported as dropped */
+static void test_overflow()
+{
+    const ei_impulse_t impulse = make_impulse();
+    const ei_learning_block_config_tflite_graph_t block_config = make_block_config();
+    std::vector<candidate_t> candidates;
+    for (int cell = 0; cell < 120; cell++) {
+        candidates.push_back({ (cell % 12) * 26.0f + 13, (cell / 12) * 32.0f + 16, 16, 16, 0.52f + cell * 0.0035f });
+    }
+
+    std::vector<float> data = output_rows(candidates);
+    ei_result_arena_t arena;
+    ei_result_arena_bind(&arena);
+    ei_impulse_result_t result;
+    memset(&result, 0, sizeof(result));
+    CHECK(fill_result_struct_f32_yolov5(&impulse, &block_config, &result, 5, data.data(), data.size()) == EI_IMPULSE_OK);
+    printf("120 objects: %u boxes, %u dropped\n", result.bounding_boxes_count, result.bounding_boxes_overflow_count);
+    CHECK(result.bounding_boxes_count == ei_result_arena_t::capacity());
+    CHECK(result.bounding_boxes_overflow_count == 120 - ei_result_arena_t::capacity());
+
+    float weakest = 1.0f;
+    for (uint32_t ix = 0; ix < result.bounding_boxes_count; ix++) {
+        weakest = std::min(weakest, result.bounding_boxes[ix].value);
+    }
+    CHECK(weakest >= candidates[120 - ei_result_arena_t::capacity()].score - 1e-6f);
+
+    // the next frame starts over
+    data = output_rows({ candidates[0] });
+    memset(&result, 0, sizeof(result));
+    CHECK(fill_result_struct_f32_yolov5(&impulse, &block_config, &result, 5, data.data(), data.size()) == EI_IMPULSE_OK);
+    CHECK(result.bounding_boxes_count == 1 && result.bounding_boxes_overflow_count == 0);
+}
+
+int main()
+{
+    test_crowded_frame();
+    test_overflow();
+    return TEST_RESULT();
+}
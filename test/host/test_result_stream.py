@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+# Binary result stream over a pty pair: result_stream_device (the firmware's
+# ei_result_stream.cpp) on one end, the Decoder from
+# firmware-sdk/tools/result_stream.py on the other. Results, error records and a
+# maximum size record (255 boxes, 3086 bytes in the 4096 byte ring) must decode
+# as pushed, with the text printed before the stream skipped. A burst the
+# host does not read must drop whole records, never corrupt the stream.
+#
+#   test_result_stream.py <result_stream_device> <repo root>
+
+import os
+import subprocess
+import sys
+import time
+import tty
+
+device_bin, repo_root = sys.argv[1], sys.argv[2]
+sys.path.insert(0, os.path.join(repo_root, "firmware-sdk", "tools"))
+from result_stream import Decoder, HEADER, ENTRY, CRC  # noqa: E402
+from binary_transfer import PtyPort  # noqa: E402
+
+MAX_RECORD = HEADER.size + 255 * ENTRY.size + CRC.size
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print("check failed: " + what)
+        failures += 1
+
+
+def expected_entries(frame_id, count):
+    """The boxes push_frame() in result_stream_device makes up for a frame"""
+    entries = []
+    for ix in range(min(count, 255)):
+        score = 0.5 + ((frame_id * 7 + ix) % 50) / 100.0
+        entries.append(((frame_id + ix) % 2, 0, int(score * 65535 + 0.5), (frame_id + ix * 8) % 96,
+                        ix % 96, 8 + ix % 4, 8))
+    return entries
+
+
+def expected_frame(frame_id):
+    """What the frames mode pushes for frame_id: (fields, entries), entries None for an error"""
+    if frame_id % 50 == 49:
+        return [4, frame_id, frame_id * 100, -5], None
+    entries = expected_entries(frame_id, 300 if frame_id == 198 else frame_id % 5)
+    return [frame_id, frame_id * 100, 1000 + frame_id, 20000 + frame_id, 0], entries
+
+
+def same_entries(got, want):
+    # scores are rounded from a float on the device
+    return len(got) == len(want) and all(
+        g[:2] == w[:2] and abs(g[2] - w[2]) <= 1 and g[3:] == w[3:] for g, w in zip(got, want))
+
+
+def run(mode, read_delay=0.0):
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    proc = subprocess.Popen([device_bin, os.ttyname(slave), mode], stderr=subprocess.PIPE, text=True)
+    host = PtyPort(master)
+    decoder = Decoder()
+    records = []
+    time.sleep(read_delay)
+    deadline = time.monotonic() + 30
+    idle_since = None
+    while time.monotonic() < deadline:
+        data = host.read(4096)
+        if data:
+            records += decoder.feed(data)
+            idle_since = None
+        elif proc.poll() is not None:
+            # the device has exited, take what is still in the pty
+            idle_since = idle_since or time.monotonic()
+            if time.monotonic() - idle_since > 0.2:
+                break
+    if proc.poll() is None:
+        proc.kill()
+    stats = dict(kv.split("=") for kv in proc.communicate()[1].split())
+    # keep the slave open until the device is done, reads on the master fail
+    # with EIO while no one has the slave open
+    host.f.close()
+    os.close(slave)
+    return records, decoder, {k: int(v) for k, v in stats.items()}
+
+
+def test_frames():
+    records, decoder, stats = run("frames")
+    print("frames: {} records, {} CRC errors, {} bytes skipped, device {}".format(
+        len(records), decoder.crc_errors, decoder.skipped, stats))
+    check(len(records) == 200 and stats["written"] == 200 and stats["dropped"] == 0, "all frames received")
+    check(decoder.crc_errors == 0, "no CRC errors")
+    check(decoder.skipped == len("Inferencing settings:\r\n\tImage resolution: 96x96\r\n"), "text skipped")
+    errors = 0
+    for frame_id, (fields, entries) in enumerate(records):
+        want_fields, want_entries = expected_frame(frame_id)
+        if want_entries is None:
+            ok = entries is None and fields == want_fields
+            errors += 1
+        else:
+            ok = entries is not None and fields == want_fields and same_entries(entries, want_entries)
+        check(ok, "frame {}".format(frame_id))
+    check(errors == 4, "error records")
+    check(len(records) > 198 and records[198][1] is not None and len(records[198][1]) == 255,
+          "maximum size record")
+
+
+def test_burst():
+    records, decoder, stats = run("burst", read_delay=0.5)
+    print("burst: {} records received, device {}".format(len(records), stats))
+    check(stats["written"] + stats["dropped"] == 100, "every record written or dropped")
+    check(stats["dropped"] > 0, "ring full, records dropped")
+    check(len(records) == stats["written"] and stats["bytes"] == stats["written"] * MAX_RECORD,
+          "written records received whole")
+    check(decoder.crc_errors == 0, "no CRC errors")
+    frame_ids = [fields[0] for fields, _ in records]
+    check(frame_ids == sorted(set(frame_ids)), "frames in order")
+    check(all(entries is not None and same_entries(entries, expected_entries(fields[0], 255))
+              for fields, entries in records), "burst records decode")
+
+
+def main():
+    test_frames()
+    test_burst()
+    print("FAILED" if failures else "OK")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
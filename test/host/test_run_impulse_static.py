@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+# AT+RUNIMPULSESTATIC over a pty pair: run_impulse_static_device (the firmware's
+# run_impulse_static_data) on one end, send_uart() from
+# firmware-sdk/tools/test_inference.py on the other. The features run_classifier
+# gets must match what the host sent, at every chunk size, for the bulk
+# ei_read_string and the ei_getchar fallback; a stalled host must end in TIMEOUT
+# and broken base64 in ERR.
+#
+#   test_run_impulse_static.py <bulk device> <getchar device> <repo root> <features>
+
+import os
+import random
+import select
+import struct
+import subprocess
+import sys
+import time
+import tty
+
+bulk_bin, getchar_bin, repo_root, n_features = sys.argv[1], sys.argv[2], sys.argv[3], int(sys.argv[4])
+sys.path.insert(0, os.path.join(repo_root, "firmware-sdk", "tools"))
+import test_inference  # noqa: E402
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print("check failed: " + what)
+        failures += 1
+
+
+class PtySerial:
+    """Master end of the pty with the part of the pyserial API test_inference.py uses,
+    remembers every line read"""
+
+    def __init__(self, fd, timeout=0.5):
+        self.fd, self.timeout, self.buf, self.lines = fd, timeout, b"", []
+
+    def write(self, data):
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def readline(self):
+        end = time.monotonic() + self.timeout
+        while b"\n" not in self.buf and time.monotonic() < end:
+            ready, _, _ = select.select([self.fd], [], [], max(0, end - time.monotonic()))
+            if ready:
+                self.buf += os.read(self.fd, 4096)
+        ix = self.buf.index(b"\n") + 1 if b"\n" in self.buf else len(self.buf)
+        line, self.buf = self.buf[:ix], self.buf[ix:]
+        if line:
+            self.lines.append(line.decode())
+        return line
+
+    def close(self):
+        pass
+
+    def find(self, prefix):
+        return [line for line in self.lines if line.startswith(prefix)]
+
+
+class Device:
+    def __init__(self, binary, chunk_size, bytes_per_s):
+        master, self.slave = os.openpty()
+        tty.setraw(self.slave)
+        # keep the slave open until the device is done, reads on the master fail
+        # with EIO while no one has the slave open
+        self.proc = subprocess.Popen([binary, os.ttyname(self.slave), str(chunk_size), str(bytes_per_s)],
+                                     stdout=subprocess.PIPE, text=True)
+        self.ser = PtySerial(master)
+
+    def finish(self):
+        self.ser.write(b"QUIT\r")
+        try:
+            out, _ = self.proc.communicate(timeout=10)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            out, _ = self.proc.communicate()
+        os.close(self.ser.fd)
+        os.close(self.slave)
+        return "result=1" in out
+
+
+def features_checksum(features):
+    # what the device computes, on the features as floats
+    floats = struct.unpack("{}f".format(len(features)), struct.pack("{}f".format(len(features)), *features))
+    return sum(v * (ix % 7 + 1) for ix, v in enumerate(floats))
+
+
+def run(name, binary, chunk_size, bytes_per_s):
+    features = [random.Random(chunk_size).uniform(-100, 100) for _ in range(n_features)]
+    device = Device(binary, chunk_size, bytes_per_s)
+    begin = time.monotonic()
+    test_inference.send_uart(test_inference.base64_encode(features), n_features, device.ser, startup_delay=0.1)
+    elapsed = time.monotonic() - begin
+    res = device.finish()
+
+    checksum = device.ser.find("CHECKSUM")
+    stats = device.ser.find("TRANSFER STATS")
+    print("{:<22} chunk {:4} {:6.2f} s | {}".format(name, chunk_size, elapsed, stats[0].strip() if stats else "no stats"))
+    check(res, name + ": run_impulse_static_data succeeds")
+    check(device.ser.find("TRANSFER COMPLETED {}".format(n_features)), name + ": all features received")
+    check(len(checksum) == 1 and abs(float(checksum[0].split()[1]) - features_checksum(features)) < 0.01,
+          name + ": run_classifier gets the features sent")
+    check(device.ser.find("RESULT 0"), name + ": impulse result")
+    # TRANSFER STATS <chars> chars in <ms> ms (<rate> B/s), ...
+    return int(stats[0].split("(")[1].split()[0]) if stats else 0
+
+
+def test_chunks():
+    # 1 Mbaud: the 1024 byte chunks of the firmware, the 128 byte ones of old,
+    # and one that makes the host pad the last chunk with '='
+    for chunk_size in (1024, 128, 1000):
+        run("bulk 1 Mbaud", bulk_bin, chunk_size, 100000)
+    run("getchar 1 Mbaud", getchar_bin, 1024, 100000)
+    # the console default, one round trip per chunk costs little next to the line
+    rate = run("bulk 115200", bulk_bin, 1024, 11520)
+    check(rate > 0.9 * 11520, "bulk 115200: close to the line rate")
+    run("unpaced", bulk_bin, 1024, 1e9)
+
+
+def start_transfer(device):
+    device.ser.write(b"AT+RUNIMPULSESTATIC=n,%d\r" % n_features)
+    test_inference.await_response("OK", device.ser)
+
+
+def test_stalled_host():
+    device = Device(bulk_bin, 1024, 100000)
+    start_transfer(device)
+    device.ser.write(b"AAAA" * 100)
+    test_inference.await_response_exact("END OUTPUT\r\n", device.ser)
+    res = device.finish()
+    check(not res and device.ser.find("TIMEOUT"), "stalled host: device times out")
+    check(not device.ser.find("CHECKSUM"), "stalled host: no inference")
+
+
+def test_invalid_input():
+    device = Device(bulk_bin, 1024, 100000)
+    start_transfer(device)
+    device.ser.write(b"AAAA*AAA" + b"A" * 1016)
+    test_inference.await_response_exact("END OUTPUT\r\n", device.ser)
+    res = device.finish()
+    check(not res and device.ser.find("ERR: Invalid base64 input"), "invalid input: device reports it")
+    check(not device.ser.find("CHECKSUM"), "invalid input: no inference")
+
+
+test_chunks()
+test_stalled_host()
+test_invalid_input()
+print("FAILED" if failures else "OK")
+sys.exit(1 if failures else 0)
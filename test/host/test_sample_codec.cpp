@@ -0,0 +1,208 @@
+/* Lossless int16 sample codec (ei_sample_codec.h): streams of 1-4 channels in
+ * random chunks must read back exactly, in order and at random offsets, the
+ * encoded size must stay within EI_SAMPLE_CODEC_MAX_ENCODED_SIZE, and damaged
+ * containers must not crash the reader. Then ratio and speed on synthetic
+ * audio and accelerometer data */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ei_sample_codec.h"
+#include "host_test.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+static bool read_vector(void *ctx, size_t offset, uint8_t *data, size_t length)
+{
+    const bytes_t *v = (const bytes_t *)ctx;
+    if (offset + length > v->size()) {
+        return false;
+    }
+    memcpy(data, v->data() + offset, length);
+    return true;
+}
+
+/* Container of raw bytes plus samples, encoded `chunk` samples at a time (0 = random) */
+static bytes_t encode(const std::vector<int16_t> &samples, const bytes_t &raw, uint8_t channels,
+    size_t chunk, std::mt19937 &rng)
+{
+    bytes_t out(EI_SAMPLE_CODEC_HEADER_SIZE);
+    ei_sample_encode_header(out.data(), raw.size(), channels);
+    out.insert(out.end(), raw.begin(), raw.end());
+
+    ei_sample_encoder_t encoder;
+    ei_sample_encoder_init(&encoder, channels);
+    bytes_t buf;
+    for (size_t pos = 0; pos < samples.size();) {
+        const size_t n = std::min(samples.size() - pos, chunk ? chunk : 1 + rng() % 1500);
+        buf.resize(EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(n));
+        const int res = ei_sample_encode(&encoder, &samples[pos], n, buf.data(), buf.size());
+        CHECK(res >= 0);
+        out.insert(out.end(), buf.begin(), buf.begin() + std::max(res, 0));
+        pos += n;
+    }
+    buf.resize(EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(1));
+    const int res = ei_sample_encode_finish(&encoder, buf.data(), buf.size());
+    CHECK(res >= 0);
+    out.insert(out.end(), buf.begin(), buf.begin() + std::max(res, 0));
+    return out;
+}
+
+static void test_round_trip()
+{
+    std::mt19937 rng(7);
+    int failures = 0;
+
+    for (int t = 0; t < 3000; t++) {
+        // noise, silence, full scale, small steps, steps after a gain of 8, spikes
+        std::vector<int16_t> samples(rng() % 3000);
+        int16_t v = rng();
+        for (auto &x : samples) {
+            switch (t % 6) {
+                case 0: x = rng(); break;
+                case 1: x = 0; break;
+                case 2: x = (rng() & 1) ? 32767 : -32768; break;
+                case 3: x = v += (int16_t)((int)(rng() % 64) - 32); break;
+                case 4: x = v += (int16_t)(((int)(rng() % 64) - 32) * 8); break;
+                default: x = rng() % 100 == 0 ? (int16_t)rng() : (v += (int)(rng() % 5) - 2); break;
+            }
+        }
+        bytes_t raw(rng() % 40);
+        for (auto &b : raw) {
+            b = rng();
+        }
+        const uint8_t channels = 1 + t % 4;
+        const bytes_t container = encode(samples, raw, channels, 0, rng);
+        bool ok = container.size() <= EI_SAMPLE_CODEC_HEADER_SIZE + raw.size()
+            + EI_SAMPLE_CODEC_MAX_ENCODED_SIZE(samples.size());
+
+        bytes_t expected(raw);
+        expected.insert(expected.end(), (const uint8_t *)samples.data(), (const uint8_t *)(samples.data() + samples.size()));
+
+        ei_sample_reader_t reader;
+        if (!ei_sample_reader_open(&reader, read_vector, (void *)&container)) {
+            failures++;
+            continue;
+        }
+
+        // in order, in random chunks
+        bytes_t back(expected.size());
+        for (size_t pos = 0; pos < back.size();) {
+            const size_t n = std::min<size_t>(back.size() - pos, 1 + rng() % 2000);
+            ok = ok && ei_sample_reader_read(&reader, pos, &back[pos], n) == n;
+            pos += n;
+        }
+        ok = ok && back == expected;
+
+        // random access
+        for (int q = 0; q < 20 && !expected.empty(); q++) {
+            const size_t offset = rng() % expected.size();
+            const size_t n = 1 + rng() % (expected.size() - offset);
+            bytes_t part(n);
+            ok = ok && ei_sample_reader_read(&reader, offset, part.data(), n) == n
+                && memcmp(part.data(), &expected[offset], n) == 0;
+        }
+
+        // reads stop at the end, the encoded size of the whole sample is the container
+        bytes_t past(expected.size() + 100);
+        ok = ok && ei_sample_reader_read(&reader, 0, past.data(), past.size()) == expected.size();
+        ok = ok && ei_sample_reader_encoded_size(&reader, expected.size()) == container.size();
+
+        // truncated or damaged containers read short or wrong, but never crash
+        bytes_t damaged = container;
+        damaged.resize(damaged.size() * (rng() % 100) / 100);
+        ei_sample_reader_t reader2;
+        if (ei_sample_reader_open(&reader2, read_vector, &damaged)) {
+            ei_sample_reader_read(&reader2, 0, past.data(), past.size());
+        }
+        damaged = container;
+        for (int e = 0; e < 5 && damaged.size() > EI_SAMPLE_CODEC_HEADER_SIZE; e++) {
+            damaged[EI_SAMPLE_CODEC_HEADER_SIZE + rng() % (damaged.size() - EI_SAMPLE_CODEC_HEADER_SIZE)] ^= 1 << (rng() % 8);
+        }
+        if (ei_sample_reader_open(&reader2, read_vector, &damaged)) {
+            ei_sample_reader_read(&reader2, 0, past.data(), past.size());
+        }
+
+        failures += !ok;
+    }
+    CHECK(failures == 0);
+}
+
+/* Ratio and speed on one signal, as the microphone path writes it: 2048 samples per call */
+static double benchmark(const char *name, const std::vector<int16_t> &samples, uint8_t channels)
+{
+    std::mt19937 rng(1);
+    const int reps = 50;
+    bytes_t container;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        container = encode(samples, bytes_t(), channels, 2048, rng);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+
+    bytes_t back(samples.size() * sizeof(int16_t));
+    for (int r = 0; r < reps; r++) {
+        ei_sample_reader_t reader;
+        ei_sample_reader_open(&reader, read_vector, &container);
+        for (size_t pos = 0; pos < back.size(); pos += 1536) {
+            ei_sample_reader_read(&reader, pos, &back[pos], std::min<size_t>(1536, back.size() - pos));
+        }
+    }
+    const auto t2 = std::chrono::steady_clock::now();
+
+    const double mb = back.size() * (double)reps / 1e6;
+    const double ratio = (double)back.size() / container.size();
+    printf("%-26s %7zu -> %7zu bytes, ratio %.2f, encode %4.0f MB/s, decode %4.0f MB/s\n",
+        name, back.size(), container.size(), ratio,
+        mb / std::chrono::duration<double>(t1 - t0).count(), mb / std::chrono::duration<double>(t2 - t1).count());
+    CHECK(memcmp(back.data(), samples.data(), back.size()) == 0);
+    return ratio;
+}
+
+static void test_benchmark()
+{
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0, 1);
+
+    // voiced speech at 16 kHz: a few harmonics of a gliding pitch, syllable
+    // envelope, a little noise, then the microphone gain of 8
+    std::vector<int16_t> speech(160000);
+    double phase = 0;
+    for (size_t ix = 0; ix < speech.size(); ix++) {
+        const double t = ix / 16000.0;
+        phase += 2 * M_PI * (140 + 60 * sin(2 * M_PI * 0.7 * t)) / 16000.0;
+        const double envelope = std::max(0.0, sin(2 * M_PI * 3 * t));
+        const double v = envelope * (900 * sin(phase) + 400 * sin(2 * phase) + 200 * sin(3 * phase)) + 20 * noise(rng);
+        speech[ix] = (int16_t)lround(v) * 8;
+    }
+
+    // 3-axis accelerometer at 100 Hz, +-4 g: gravity, slow motion, sensor noise
+    std::vector<int16_t> accel(3 * 6000);
+    for (size_t ix = 0; ix < accel.size() / 3; ix++) {
+        const double t = ix / 100.0;
+        accel[ix * 3 + 0] = (int16_t)lround(800 * sin(2 * M_PI * 0.5 * t) + 15 * noise(rng));
+        accel[ix * 3 + 1] = (int16_t)lround(500 * sin(2 * M_PI * 1.3 * t + 1) + 15 * noise(rng));
+        accel[ix * 3 + 2] = (int16_t)lround(8192 + 300 * sin(2 * M_PI * 0.8 * t) + 15 * noise(rng));
+    }
+
+    std::vector<int16_t> white(100000);
+    for (auto &x : white) {
+        x = rng();
+    }
+
+    CHECK(benchmark("speech 16 kHz, gain 8", speech, 1) > 1.8);
+    // deltas to the same axis of the previous frame, not to the previous value
+    const double interleaved = benchmark("accelerometer 3 axes", accel, 3);
+    CHECK(interleaved > 1.5 && interleaved > 1.3 * benchmark("accelerometer as 1 channel", accel, 1));
+    CHECK(benchmark("white noise", white, 1) > 0.95);
+}
+
+int main()
+{
+    test_round_trip();
+    test_benchmark();
+    return TEST_RESULT();
+}
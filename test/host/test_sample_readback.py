@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Sample readback (AT+READBUFFER) of packed and raw samples: the in process
+# base64 checks of sample_readback_device, then the binary transfer of both over
+# a pty pair, with the packed one decoded by decode_sample() from
+# firmware-sdk/tools/binary_transfer.py. Both must give the recording back.
+#
+#   test_sample_readback.py <sample_readback_device> <repo root>
+
+import os
+import subprocess
+import sys
+import tempfile
+import tty
+
+device_bin, repo_root = sys.argv[1], sys.argv[2]
+sys.path.insert(0, os.path.join(repo_root, "firmware-sdk", "tools"))
+from binary_transfer import Receiver, receive, PtyPort, decode_sample  # noqa: E402
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print("check failed: " + what)
+        failures += 1
+
+
+def send(kind, length, expected_path):
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    proc = subprocess.Popen([device_bin, expected_path, "send", os.ttyname(slave), kind, str(length)])
+    host = PtyPort(master)
+    receiver = Receiver()
+    try:
+        receive(host, receiver)
+    except IOError as e:
+        print("{} {}: {}".format(kind, length, e))
+    try:
+        result = proc.wait(timeout=10)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        result = proc.wait()
+    # keep the slave open until the device is done, reads on the master fail
+    # with EIO while no one has the slave open
+    host.f.close()
+    os.close(slave)
+    return result, bytes(receiver.data)
+
+
+def main():
+    expected_file = tempfile.NamedTemporaryFile(delete=False)
+    expected_file.close()
+    expected_path = expected_file.name
+
+    check(subprocess.run([device_bin, expected_path, "check"]).returncode == 0, "base64 readback")
+    with open(expected_path, "rb") as f:
+        expected = f.read()
+
+    for kind in ("packed", "raw"):
+        for length in (len(expected), 1000):
+            result, data = send(kind, length, expected_path)
+            if kind == "packed":
+                # whole blocks are sent, the host cuts the decoded sample to the length asked for
+                check(length < len(expected) or len(data) < length, "packed: sent {} bytes".format(len(data)))
+                data = decode_sample(data)[:length]
+            print("{} {}: {} bytes received".format(kind, length, len(data)))
+            check(result == 0 and data == expected[:length], "{} {}: round trip".format(kind, length))
+
+    os.unlink(expected_path)
+    print("FAILED" if failures else "OK")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
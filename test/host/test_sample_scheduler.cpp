@@ -0,0 +1,84 @@
+/* Sample scheduler on its POSIX backend: absolute deadlines must not drift,
+ * the sample count must match the elapsed time, a callback slower than the
+ * interval skips deadlines instead of queueing them. Prints the jitter stats */
+
+#include <atomic>
+#include <cmath>
+#include <unistd.h>
+
+#include "ei_sample_scheduler.h"
+#include "host_test.h"
+
+static std::atomic<int> samples(0);
+static int target;
+static int64_t first_us, last_us;
+
+static void count_cb(void)
+{
+    const int64_t now = ei_sample_scheduler_timestamp_us();
+    if (samples == 0) {
+        first_us = now;
+    }
+    last_us = now;
+    if (++samples == target) {
+        ei_sample_scheduler_stop();
+    }
+}
+
+static void slow_cb(void)
+{
+    usleep(2500);
+}
+
+static void test_drift()
+{
+    // 62.5 Hz, 1 kHz, 1.6 kHz and 300 Hz (an interval that does not round to whole us)
+    const float intervals_ms[] = { 16.0f, 1.0f, 0.625f, 1000.0f / 300.0f };
+
+    for (float interval : intervals_ms) {
+        samples = 0;
+        target = (int)(1000.0f / interval); // ~1 s
+        CHECK(ei_sample_scheduler_start(count_cb, interval));
+        while (ei_sample_scheduler_running()) {
+            usleep(1000);
+        }
+
+        ei_sample_scheduler_stats_t stats;
+        ei_sample_scheduler_get_stats(&stats);
+        const double span_ms = (last_us - first_us) / 1000.0;
+        // skipped deadlines (host preemption) push the last sample to a later deadline
+        const double ideal_ms = (stats.samples + stats.missed - 1) * interval;
+        printf("interval %.4f ms: %d samples, span %.3f ms vs %.3f ideal, drift %.3f ms\n",
+            interval, (int)samples, span_ms, ideal_ms, span_ms - ideal_ms);
+        ei_sample_scheduler_print_stats();
+
+        CHECK(samples == target);
+        CHECK(stats.samples == (uint32_t)target);
+        // the last sample is only late by its own jitter, never by the sum of the
+        // earlier ones (a relative timer would be several ms off after 1 s)
+        CHECK(fabs(span_ms - ideal_ms) <= interval + stats.max_jitter_us / 1000.0 + 0.5);
+    }
+}
+
+static void test_slow_callback()
+{
+    // 2.5 ms callback on a 1 ms interval runs at every third deadline
+    CHECK(ei_sample_scheduler_start(slow_cb, 1.0f));
+    usleep(300000);
+    ei_sample_scheduler_stop();
+    usleep(10000);
+    CHECK(!ei_sample_scheduler_running());
+
+    ei_sample_scheduler_stats_t stats;
+    ei_sample_scheduler_get_stats(&stats);
+    ei_sample_scheduler_print_stats();
+    CHECK(stats.samples > 50 && stats.samples < 150);
+    CHECK(stats.missed >= stats.samples);
+}
+
+int main()
+{
+    test_drift();
+    test_slow_callback();
+    return TEST_RESULT();
+}
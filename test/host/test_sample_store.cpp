@@ -0,0 +1,289 @@
+/* Sample store on the file backed NOR simulation (ei_flash_file_sim.h): round
+ * trip, remount with and without checkpoints, wear of the log sectors, and a
+ * power cut injected at every program and erase of a workload. Also runs the
+ * store over the write-behind memory, as the firmware does */
+
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "ei_sample_store.h"
+#include "ei_write_behind_memory.h"
+#include "ei_flash_file_sim.h"
+#include "host_test.h"
+
+EiSampleStore *ei_get_sample_store(void)
+{
+    return nullptr;
+}
+
+// in the ctest working directory (the build directory)
+static const char *flash_path = "sample_store_flash.bin";
+static const char *base_path = "sample_store_base.bin";
+static const uint32_t block_size = 4096;
+static const uint32_t blocks = 64;
+
+static std::vector<uint8_t> content(int ix)
+{
+    std::vector<uint8_t> v(2000 + (uint32_t)(ix * 7919u) % 18000);
+    uint32_t x = 0x9E3779B9u * (ix + 1);
+    for (auto &b : v) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        b = x;
+    }
+    return v;
+}
+
+static void copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb");
+    FILE *out = fopen(to, "wb");
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        fwrite(buf, 1, n, out);
+    }
+    fclose(in);
+    fclose(out);
+}
+
+// every live sample reads back, verifies and belongs to the workload
+static bool check_contents(EiSampleStore &store)
+{
+    for (uint32_t k = 0; k < store.count(); k++) {
+        const ei_sample_info_t *e = store.at(k);
+        const std::vector<uint8_t> v = content(atoi(e->name + 1));
+        std::vector<uint8_t> back(v.size());
+        if (e->length != v.size() || !store.verify(e->id) || strcmp(e->sensor, "imu") != 0) {
+            return false;
+        }
+        if (store.read(e->id, 0, back.data(), back.size()) != back.size() || back != v) {
+            return false;
+        }
+        // AT+READBUFFER resolves addresses inside a sample to its start
+        if (store.find_address(e->address) != e || store.find_address(e->address + e->length / 2) != e
+            || store.find_address(e->address + e->length - 1) != e) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::set<std::string> names(EiSampleStore &store)
+{
+    std::set<std::string> out;
+    for (uint32_t k = 0; k < store.count(); k++) {
+        out.insert(store.at(k)->name);
+    }
+    return out;
+}
+
+/**
+ * Commit samples s<from>..s<to-1>, every 7th step also removes one. Returns false
+ * when the power went away, in_commit / in_remove name the sample in flight
+ */
+static bool workload(EiFlashFileSim &sim, EiSampleStore &store, int from, int to,
+    std::string &in_commit, std::string &in_remove)
+{
+    for (int ix = from; ix < to; ix++) {
+        if (ix % 7 == 6 && store.count() > 2) {
+            in_remove = store.at(1)->name;
+            const bool ok = store.remove(store.at(1)->id);
+            if (!sim.is_powered()) {
+                return false;
+            }
+            CHECK(ok);
+            in_remove.clear();
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "s%d", ix);
+        const std::vector<uint8_t> v = content(ix);
+        uint32_t address;
+        in_commit = name;
+        bool ok = store.begin("imu", name, v.size() + 100, &address);
+        for (size_t offset = 0; ok && offset < v.size(); offset += 512) {
+            ok = store.append(&v[offset], std::min<size_t>(512, v.size() - offset));
+        }
+        ok = ok && store.commit();
+        if (!sim.is_powered()) {
+            return false;
+        }
+        CHECK(ok);
+        in_commit.clear();
+    }
+    return true;
+}
+
+static void test_remount_and_wear()
+{
+    unlink(flash_path);
+    EiFlashFileSim sim(flash_path, 1000, block_size, blocks);
+    EiSampleStore store(&sim);
+    CHECK(store.mount());
+    std::string a, b;
+    CHECK(workload(sim, store, 0, 300, a, b));
+    CHECK(check_contents(store));
+
+    // the log wraps several times, the erases spread over every log sector
+    uint32_t min_erases = ~0u, max_erases = 0;
+    for (uint32_t s = 3; s < blocks; s++) {
+        min_erases = std::min(min_erases, sim.erase_count(s));
+        max_erases = std::max(max_erases, sim.erase_count(s));
+    }
+    printf("300 samples: %u live, log sector erases min %u max %u, checkpoint sectors %u/%u\n",
+        store.count(), min_erases, max_erases, sim.erase_count(1), sim.erase_count(2));
+    CHECK(min_erases > 0 && max_erases <= min_erases + 4);
+    const std::set<std::string> before = names(store);
+
+    ei_sample_store_stats_t stats;
+    {
+        EiFlashFileSim sim2(flash_path, 1000, block_size, blocks);
+        EiSampleStore store2(&sim2);
+        CHECK(store2.mount());
+        store2.get_stats(&stats);
+        printf("remount: full scan %d, reads %u, replayed %u\n", stats.full_scan, stats.mount_reads, stats.replayed);
+        CHECK(!stats.full_scan);
+        CHECK(names(store2) == before && check_contents(store2));
+
+        // wipe both checkpoint sectors, mount falls back to a full scan
+        std::vector<uint8_t> zero(block_size, 0);
+        sim2.write_sample_data(zero.data(), 0, block_size);
+        sim2.write_sample_data(zero.data(), block_size, block_size);
+    }
+    const uint32_t checkpoint_reads = stats.mount_reads;
+
+    EiFlashFileSim sim3(flash_path, 1000, block_size, blocks);
+    EiSampleStore store3(&sim3);
+    CHECK(store3.mount());
+    store3.get_stats(&stats);
+    printf("no checkpoint: full scan %d, reads %u\n", stats.full_scan, stats.mount_reads);
+    CHECK(stats.full_scan);
+    CHECK(stats.mount_reads > checkpoint_reads);
+    CHECK(names(store3) == before && check_contents(store3));
+}
+
+static void test_power_loss()
+{
+    // 30 committed samples as the starting image
+    unlink(flash_path);
+    {
+        EiFlashFileSim sim(flash_path, 1000, block_size, blocks);
+        EiSampleStore store(&sim);
+        CHECK(store.mount());
+        std::string a, b;
+        CHECK(workload(sim, store, 0, 30, a, b));
+    }
+    copy_file(flash_path, base_path);
+
+    // count the programs and erases of the workload under test
+    uint32_t total_ops;
+    {
+        EiFlashFileSim sim(flash_path, 1000, block_size, blocks);
+        EiSampleStore store(&sim);
+        CHECK(store.mount());
+        sim.power_loss_after(0, 0);
+        std::string a, b;
+        CHECK(workload(sim, store, 30, 60, a, b));
+        total_ops = sim.get_ops();
+    }
+
+    int cuts = 0, failures = 0, undone_evictions = 0;
+    for (uint32_t cut = 1; cut <= total_ops; cut++) {
+        copy_file(base_path, flash_path);
+        std::set<std::string> pre;
+        std::string in_commit, in_remove;
+        {
+            EiFlashFileSim sim(flash_path, 1000, block_size, blocks);
+            EiSampleStore store(&sim);
+            CHECK(store.mount());
+            sim.power_loss_after(cut, cut * 2654435761u);
+            const bool done = workload(sim, store, 30, 60, in_commit, in_remove);
+            pre = names(store);
+            if (done) {
+                continue;
+            }
+        }
+        cuts++;
+
+        // next boot: every sample committed before the cut is intact, only the
+        // one being committed or removed may differ
+        EiFlashFileSim sim(flash_path, 1000, block_size, blocks);
+        EiSampleStore store(&sim);
+        bool ok = store.mount() && check_contents(store);
+        const std::set<std::string> post = names(store);
+        for (const std::string &n : pre) {
+            ok = ok && (post.count(n) || n == in_remove);
+        }
+        for (const std::string &n : post) {
+            if (pre.count(n) || n == in_commit) {
+                continue;
+            }
+            // an eviction cut before its sectors were erased leaves the old sample intact
+            ok = ok && atoi(n.c_str() + 1) < 60;
+            undone_evictions++;
+        }
+
+        // and the store keeps working, with a checkpoint for the next mount
+        std::string a, b;
+        ok = ok && workload(sim, store, 100, 112, a, b);
+        const std::set<std::string> after = names(store);
+        EiFlashFileSim sim2(flash_path, 1000, block_size, blocks);
+        EiSampleStore store2(&sim2);
+        ok = ok && store2.mount() && names(store2) == after && check_contents(store2);
+        ei_sample_store_stats_t stats;
+        store2.get_stats(&stats);
+        ok = ok && !stats.full_scan;
+
+        if (!ok) {
+            printf("power cut at operation %u: lost or corrupted samples\n", cut);
+            failures++;
+        }
+    }
+    printf("power loss: %d cut points, %d failures, %d intact evictions undone\n", cuts, failures, undone_evictions);
+    CHECK(cuts > 0 && (uint32_t)cuts == total_ops);
+    CHECK(failures == 0);
+
+    unlink(flash_path);
+    unlink(base_path);
+}
+
+static void test_write_behind()
+{
+    static EiDeviceRAMLatency<block_size, blocks> mem(1000, 300, 20);
+    EiSampleStore store(&mem);
+    CHECK(store.mount());
+    for (int ix = 0; ix < 120; ix++) {
+        char name[16];
+        snprintf(name, sizeof(name), "s%d", ix);
+        const std::vector<uint8_t> v = content(ix);
+        uint32_t address;
+        bool ok = store.begin("imu", name, v.size() + 100, &address);
+        for (size_t offset = 0; ok && offset < v.size(); offset += 300) {
+            ok = store.append(&v[offset], std::min<size_t>(300, v.size() - offset));
+        }
+        CHECK(ok && store.commit());
+    }
+    CHECK(check_contents(store));
+
+    EiSampleStore store2(&mem);
+    CHECK(store2.mount());
+    CHECK(names(store2) == names(store));
+
+    ei_write_behind_stats_t stats;
+    mem.get_stats(&stats);
+    printf("write-behind: %u live, programs %u, erases %u, failed %u\n",
+        store.count(), stats.programs, stats.erases, stats.failed_bytes);
+    CHECK(stats.failed_bytes == 0);
+}
+
+int main()
+{
+    test_remount_and_wear();
+    test_power_loss();
+    test_write_behind();
+    return TEST_RESULT();
+}
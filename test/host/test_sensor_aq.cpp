@@ -0,0 +1,283 @@
+/* sensor_aq batched encoding: the file must decode with QCBOR into the same
+ * values, the values must be the bytes QCBOREncode produces for one sample at a
+ * time (the format the ingestion service decodes), the signature must cover the
+ * whole file, and the batch split must not change a byte */
+
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sensor-aq/sensor_aq.h"
+#include "host_test.h"
+
+/* FNV-1a as a stand-in signature, 8 bytes of hash in a 32 byte signature */
+static uint64_t hash;
+static size_t signature_updates;
+
+static int sig_init(sensor_aq_signing_ctx_t *)
+{
+    hash = 1469598103934665603ULL;
+    signature_updates = 0;
+    return 0;
+}
+
+static void fnv(uint64_t *h, const uint8_t *buf, size_t len)
+{
+    for (size_t ix = 0; ix < len; ix++) {
+        *h ^= buf[ix];
+        *h *= 1099511628211ULL;
+    }
+}
+
+static int sig_update(sensor_aq_signing_ctx_t *, const uint8_t *buf, size_t len)
+{
+    signature_updates++;
+    fnv(&hash, buf, len);
+    return 0;
+}
+
+static int sig_finish(sensor_aq_signing_ctx_t *, uint8_t *out)
+{
+    memset(out, 0, 32);
+    memcpy(out, &hash, sizeof(hash));
+    return 0;
+}
+
+static const char *axis_names[EI_MAX_SENSOR_AXES] = {
+    "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "a8", "a9",
+    "a10", "a11", "a12", "a13", "a14", "a15", "a16", "a17", "a18", "a19",
+};
+
+struct test_data {
+    size_t axes;
+    size_t samples;
+    bool is_float;
+    std::vector<float> f32;
+    std::vector<int16_t> i16;
+};
+
+static test_data make_data(std::mt19937 &rng, size_t axes, size_t samples, bool is_float)
+{
+    // zeros, infinities, NaN, float subnormals, half exact and half overflowing values
+    const float specials[] = {
+        0.0f, -0.0f, INFINITY, -INFINITY, NAN, -NAN, 1e-40f, -1e-42f, 0.5f, 65504.0f,
+        65520.0f, 1.0f / 3, 6.1035156e-05f, 6.0e-05f, -2.0f, 1e38f, 1.17549435e-38f, 3.0517578e-05f,
+    };
+    const int16_t int_specials[] = { 0, 1, -1, 23, 24, -24, -25, 255, 256, -256, -257, 32767, -32768 };
+    std::normal_distribution<float> normal(0, 10);
+    std::uniform_int_distribution<int> uniform(-32768, 32767);
+
+    test_data d = { axes, samples, is_float, {}, {} };
+    for (size_t ix = 0; ix < axes * samples; ix++) {
+        if (is_float) {
+            d.f32.push_back(ix % 7 == 0 ? specials[(ix / 7) % 18]
+                : ix % 5 == 0 ? std::round(normal(rng) * 4) / 4 : normal(rng));
+        }
+        else {
+            d.i16.push_back(ix % 3 == 0 ? int_specials[(ix / 3) % 13] : (int16_t)uniform(rng));
+        }
+    }
+    return d;
+}
+
+/**
+ * Encode through sensor_aq into a file, `batch` samples per call (0 = the single
+ * sample API), returns the file contents
+ */
+static std::string encode(const test_data &d, size_t batch, size_t buffer_size)
+{
+    std::vector<unsigned char> buffer(buffer_size);
+    sensor_aq_signing_ctx_t sig = { "HS256", 32, sig_init, NULL, sig_update, sig_finish, NULL };
+    sensor_aq_ctx ctx = { { buffer.data(), buffer.size() }, &sig, &fwrite, &fseek, NULL };
+    sensor_aq_payload_info payload = { "host", "test", 10.0f, {} };
+    for (size_t ix = 0; ix < d.axes; ix++) {
+        payload.sensors[ix] = { axis_names[ix], "m/s2" };
+    }
+
+    FILE *file = tmpfile();
+    CHECK(sensor_aq_init(&ctx, &payload, file, false) == AQ_OK);
+
+    std::vector<float> f32 = d.f32;
+    std::vector<int16_t> i16 = d.i16;
+    for (size_t s = 0; s < d.samples;) {
+        int res;
+        if (batch == 0) {
+            res = d.is_float ? sensor_aq_add_data(&ctx, &f32[s * d.axes], d.axes)
+                : sensor_aq_add_data_i16(&ctx, &i16[s * d.axes], d.axes);
+            s++;
+        }
+        else {
+            const size_t n = std::min(batch, d.samples - s);
+            res = d.is_float ? sensor_aq_add_data_batch_f32(&ctx, &f32[s * d.axes], n)
+                : sensor_aq_add_data_batch_i16(&ctx, &i16[s * d.axes], n);
+            s += n;
+        }
+        CHECK(res == AQ_OK);
+    }
+    CHECK(sensor_aq_finish(&ctx) == AQ_OK);
+
+    std::string out;
+    fseek(file, 0, SEEK_END);
+    out.resize(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    CHECK(fread(&out[0], 1, out.size(), file) == out.size());
+    fclose(file);
+    return out;
+}
+
+/* The values array as QCBOREncode writes it, one sample at a time */
+static std::string reference_values(const test_data &d)
+{
+    std::string out;
+    std::vector<uint8_t> buf(16 + d.axes * 9);
+    for (size_t s = 0; s < d.samples; s++) {
+        QCBOREncodeContext enc;
+        QCBOREncode_Init(&enc, (UsefulBuf){ buf.data(), buf.size() });
+        if (d.axes != 1) {
+            QCBOREncode_OpenArray(&enc);
+        }
+        for (size_t a = 0; a < d.axes; a++) {
+            if (d.is_float) {
+                QCBOREncode_AddDouble(&enc, d.f32[s * d.axes + a]);
+            }
+            else {
+                QCBOREncode_AddInt64(&enc, d.i16[s * d.axes + a]);
+            }
+        }
+        if (d.axes != 1) {
+            QCBOREncode_CloseArray(&enc);
+        }
+        UsefulBufC encoded;
+        CHECK(QCBOREncode_Finish(&enc, &encoded) == QCBOR_SUCCESS);
+        out.append((const char *)encoded.ptr, encoded.len);
+    }
+    return out;
+}
+
+static bool label_is(const QCBORItem &item, const char *label)
+{
+    return item.uLabelType == QCBOR_TYPE_TEXT_STRING
+        && item.label.string.len == strlen(label)
+        && memcmp(item.label.string.ptr, label, item.label.string.len) == 0;
+}
+
+static bool same_value(double decoded, float expected)
+{
+    if (std::isnan(expected)) {
+        return std::isnan(decoded);
+    }
+    return (float)decoded == expected && std::signbit(decoded) == std::signbit(expected);
+}
+
+/* Decode the file with QCBOR and compare every value, checks the signature */
+static void check_decode(const std::string &file, const test_data &d)
+{
+    QCBORDecodeContext dec;
+    QCBORDecode_Init(&dec, (UsefulBufC){ file.data(), file.size() }, QCBOR_DECODE_MODE_NORMAL);
+
+    QCBORItem item;
+    std::string signature;
+    size_t sensors = 0, samples = 0, values = 0;
+    uint8_t values_level = 0xff;
+    bool mismatch = false;
+
+    int err;
+    while ((err = QCBORDecode_GetNext(&dec, &item)) == QCBOR_SUCCESS) {
+        if (item.uNestingLevel == 1 && label_is(item, "signature")) {
+            signature.assign((const char *)item.val.string.ptr, item.val.string.len);
+        }
+        else if (item.uNestingLevel == 2 && label_is(item, "sensors")) {
+            sensors = item.val.uCount;
+        }
+        else if (item.uNestingLevel == 2 && label_is(item, "values")) {
+            values_level = item.uNestingLevel;
+        }
+        else if (values_level != 0xff && item.uNestingLevel > values_level) {
+            // a sample array (more than one axis) or a bare value
+            if (item.uDataType == QCBOR_TYPE_ARRAY) {
+                mismatch |= item.val.uCount != d.axes;
+                samples++;
+                continue;
+            }
+            if (d.axes == 1) {
+                samples++;
+            }
+            const size_t ix = values++;
+            if (ix >= d.axes * d.samples) {
+                mismatch = true;
+            }
+            else if (d.is_float) {
+                // half, single and double precision all decode to a double
+                const double v = item.uDataType == QCBOR_TYPE_DOUBLE ? item.val.dfnum : NAN;
+                mismatch |= !same_value(v, d.f32[ix]);
+            }
+            else {
+                mismatch |= item.uDataType != QCBOR_TYPE_INT64 || item.val.int64 != d.i16[ix];
+            }
+        }
+    }
+    // this QCBOR version does not close the enclosing definite length maps when the
+    // input ends on the break of the values array, so QCBORDecode_Finish() reports
+    // them open; all input has to be consumed though
+    CHECK(err == QCBOR_ERR_HIT_END);
+    CHECK(sensors == d.axes);
+    CHECK(samples == d.samples);
+    CHECK(values == d.axes * d.samples);
+    CHECK(!mismatch);
+
+    // the signature is computed with its own field filled with '0'
+    CHECK(signature.size() == 64);
+    std::string unsigned_file = file;
+    const size_t sig_ix = file.find(signature);
+    CHECK(sig_ix != std::string::npos);
+    if (sig_ix == std::string::npos) {
+        return;
+    }
+    unsigned_file.replace(sig_ix, signature.size(), signature.size(), '0');
+    uint64_t h = 1469598103934665603ULL;
+    fnv(&h, (const uint8_t *)unsigned_file.data(), unsigned_file.size());
+    char expected[17];
+    for (int ix = 0; ix < 8; ix++) {
+        snprintf(expected + ix * 2, 3, "%02x", (uint8_t)(h >> (ix * 8)));
+    }
+    CHECK(signature.compare(0, 16, expected) == 0);
+}
+
+static void test_round_trip()
+{
+    std::mt19937 rng(41);
+    const size_t axes_list[] = { 1, 3, 6, 20 };
+    const size_t batches[] = { 1, 7, 32, 100, 5000 };
+
+    for (int is_float = 0; is_float < 2; is_float++) {
+        for (size_t axes : axes_list) {
+            const test_data d = make_data(rng, axes, 1500, is_float);
+            const std::string single = encode(d, 0, 1024);
+            const size_t single_updates = signature_updates;
+
+            // header, the values in QCBOREncode's bytes, the closing break
+            const std::string values = reference_values(d);
+            CHECK(single.size() > values.size() + 1);
+            CHECK(single.compare(single.size() - values.size() - 1, values.size(), values) == 0);
+            CHECK((uint8_t)single.back() == 0xff);
+            check_decode(single, d);
+
+            for (size_t batch : batches) {
+                CHECK(encode(d, batch, 1024) == single);
+            }
+            // a small buffer flushes mid batch
+            CHECK(encode(d, 5000, 384 + axes * 16) == single);
+            encode(d, 5000, 1024);
+            printf("%s %2zu axes: %zu bytes, signature updates %zu single / %zu batched\n",
+                is_float ? "f32" : "i16", axes, single.size(), single_updates, signature_updates);
+        }
+    }
+}
+
+int main()
+{
+    test_round_trip();
+    return TEST_RESULT();
+}
@@ -0,0 +1,448 @@
+/* JPEG snapshot stream of ei_image_lib.cpp (AT+SNAPSHOTSTREAM with a JPEG
+ * quality) on a mock camera, base64 and binary framed output:
+ * - the sensor's JPEG at the requested resolution is forwarded as is (the
+ *   binary transfer gets the driver's own buffer) and released every frame
+ * - a sensor JPEG of another size is released and the frame re-encoded
+ * - a resized frame is re-encoded at every quality, decodes (tjpgd of the
+ *   camera component) to the resized image, and lower quality is smaller
+ * - grayscale re-encodes, raw mode still sends the pixels
+ * plus the quality argument of encode_*_signal_as_jpg: the default is
+ * JPEG_Q_BEST, and the base64 variants send the base64 of the buffer variants.
+ * encode_as_jpg.h is included here and by ei_image_lib.cpp, the inline
+ * definitions have to link. */
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "at_base64_lib.h"
+#include "ei_binary_transfer.h"
+#include "ei_camera_interface.h"
+#include "ei_device_info_lib.h"
+#include "ei_device_interface.h"
+#include "ei_image_lib.h"
+#include "edge-impulse-sdk/dsp/image/processing.hpp"
+#include "jpeg/encode_as_jpg.h"
+#include "host_test.h"
+
+extern "C" {
+#include "tjpgd.h"
+}
+
+/* base64 output, one entry per snapshot (split at every stop check) */
+static std::string console;
+static std::vector<std::string> snapshots;
+static int frames_left;
+
+void ei_putchar(char c)
+{
+    console.push_back(c);
+}
+
+EI_IMPULSE_ERROR ei_sleep(int32_t time_ms)
+{
+    return EI_IMPULSE_OK;
+}
+
+bool ei_user_invoke_stop_lib(void)
+{
+    if (!console.empty()) {
+        snapshots.push_back(console);
+        console.clear();
+    }
+    return frames_left-- <= 0;
+}
+
+/* binary framed output */
+typedef struct {
+    ei_binary_content_t content;
+    const uint8_t *data;
+    std::vector<uint8_t> bytes;
+} transfer_t;
+
+static std::vector<transfer_t> transfers;
+
+bool ei_binary_transfer_send_buffer(ei_binary_content_t content, const uint8_t *data, size_t length)
+{
+    transfers.push_back({ content, data, std::vector<uint8_t>(data, data + length) });
+    return true;
+}
+
+static ei_device_snapshot_resolutions_t resolutions[] = { { 96, 96 }, { 160, 120 }, { 320, 240 } };
+
+/* test pattern, value of a pixel channel at sensor resolution */
+static uint8_t pattern(int x, int y, int channel)
+{
+    return (uint8_t)(128 + 100 * sinf(x * 0.07f + channel) * cosf(y * 0.05f - channel) + (x / 40 + y / 30) % 2 * 20);
+}
+
+class MockCamera : public EiCamera {
+public:
+    ei_device_snapshot_resolutions_t mode = { 160, 120 };
+    ei_device_snapshot_resolutions_t jpeg_mode = { 160, 120 };
+    std::vector<uint8_t> jpeg;
+    int jpeg_gets = 0;
+    int jpeg_releases = 0;
+    int captures = 0;
+
+    bool init(uint16_t width, uint16_t height) override
+    {
+        mode = search_resolution(width, height);
+        return true;
+    }
+
+    ei_device_snapshot_resolutions_t get_min_resolution(void) override
+    {
+        return resolutions[0];
+    }
+
+    void get_resolutions(ei_device_snapshot_resolutions_t **res, uint8_t *res_num) override
+    {
+        *res = resolutions;
+        *res_num = 3;
+    }
+
+    bool set_resolution(const ei_device_snapshot_resolutions_t res) override
+    {
+        mode = res;
+        return true;
+    }
+
+    bool ei_camera_capture_rgb888_packed_big_endian(uint8_t *image, uint32_t image_size) override
+    {
+        captures++;
+        for (uint32_t ix = 0; ix < image_size; ix++) {
+            const uint32_t pixel = ix / 3;
+            image[ix] = pattern(pixel % mode.width, pixel / mode.width, ix % 3);
+        }
+        return true;
+    }
+
+    bool ei_camera_capture_grayscale_packed_big_endian(uint8_t *image, uint32_t image_size) override
+    {
+        captures++;
+        for (uint32_t ix = 0; ix < image_size; ix++) {
+            image[ix] = pattern(ix % mode.width, ix / mode.width, 0);
+        }
+        return true;
+    }
+
+    bool ei_camera_get_jpeg_frame(
+        const uint8_t **jpeg_out,
+        size_t *jpeg_size,
+        ei_device_snapshot_resolutions_t *res) override
+    {
+        jpeg_gets++;
+        *jpeg_out = jpeg.data();
+        *jpeg_size = jpeg.size();
+        *res = jpeg_mode;
+        return true;
+    }
+
+    void ei_camera_release_jpeg_frame(void) override
+    {
+        jpeg_releases++;
+    }
+};
+
+static MockCamera camera;
+
+EiCamera *EiCamera::get_camera()
+{
+    return &camera;
+}
+
+class TestDevice : public EiDeviceInfo {
+public:
+    std::string color_depth = "RGB";
+
+    void init_device_id(void) override
+    {
+    }
+
+    EiSnapshotProperties get_snapshot_list() override
+    {
+        EiSnapshotProperties props = { true, true, color_depth, 3, resolutions };
+        return props;
+    }
+};
+
+static TestDevice device;
+
+EiDeviceInfo *EiDeviceInfo::get_device(void)
+{
+    return &device;
+}
+
+/* RGB888 (packed 0xRRGGBB per float) or grayscale pixels as a signal */
+static const uint8_t *signal_pixels;
+static int signal_pixel_size;
+
+static int get_pixels(size_t offset, size_t length, float *out_ptr)
+{
+    for (size_t ix = 0; ix < length; ix++) {
+        const uint8_t *p = &signal_pixels[(offset + ix) * signal_pixel_size];
+        out_ptr[ix] = signal_pixel_size == 3 ? (float)((p[0] << 16) + (p[1] << 8) + p[2]) : (float)p[0];
+    }
+    return 0;
+}
+
+static ei::signal_t pixel_signal(const uint8_t *pixels, int width, int height, int pixel_size)
+{
+    signal_pixels = pixels;
+    signal_pixel_size = pixel_size;
+    ei::signal_t signal;
+    signal.total_length = width * height;
+    signal.get_data = &get_pixels;
+    return signal;
+}
+
+/* the pattern at a sensor resolution, optionally resized as ei_image_lib does */
+static std::vector<uint8_t> expected_image(ei_device_snapshot_resolutions_t sensor, int width, int height, int pixel_size)
+{
+    std::vector<uint8_t> image(sensor.width * sensor.height * pixel_size);
+    for (size_t ix = 0; ix < image.size(); ix++) {
+        const size_t pixel = ix / pixel_size;
+        image[ix] = pattern(pixel % sensor.width, pixel / sensor.width, ix % pixel_size);
+    }
+    if (sensor.width != width || sensor.height != height) {
+        ei::image::processing::crop_and_interpolate_image(image.data(), sensor.width, sensor.height,
+            image.data(), width, height, pixel_size);
+        image.resize(width * height * pixel_size);
+    }
+    return image;
+}
+
+/* tjpgd, RGB888 out */
+typedef struct {
+    const std::vector<uint8_t> *jpeg;
+    size_t offset;
+    std::vector<uint8_t> rgb;
+    unsigned width;
+} decode_t;
+
+static UINT decode_input(JDEC *jd, BYTE *buf, UINT len)
+{
+    decode_t *d = (decode_t *)jd->device;
+    len = std::min<size_t>(len, d->jpeg->size() - d->offset);
+    if (buf) {
+        memcpy(buf, d->jpeg->data() + d->offset, len);
+    }
+    d->offset += len;
+    return len;
+}
+
+static UINT decode_output(JDEC *jd, void *bitmap, JRECT *rect)
+{
+    decode_t *d = (decode_t *)jd->device;
+    const BYTE *src = (const BYTE *)bitmap;
+    for (unsigned y = rect->top; y <= rect->bottom; y++) {
+        for (unsigned x = rect->left; x <= rect->right; x++) {
+            memcpy(&d->rgb[(y * d->width + x) * 3], src, 3);
+            src += 3;
+        }
+    }
+    return 1;
+}
+
+static bool decode_jpeg(const std::vector<uint8_t> &jpeg, unsigned *width, unsigned *height, std::vector<uint8_t> &rgb)
+{
+    static uint8_t pool[8192];
+    JDEC jd;
+    decode_t d = { &jpeg, 0, {}, 0 };
+    if (jd_prepare(&jd, decode_input, pool, sizeof(pool), &d) != JDR_OK) {
+        return false;
+    }
+    d.width = jd.width;
+    d.rgb.resize(jd.width * jd.height * 3);
+    if (jd_decomp(&jd, decode_output, 0) != JDR_OK) {
+        return false;
+    }
+    *width = jd.width;
+    *height = jd.height;
+    rgb = d.rgb;
+    return true;
+}
+
+static double psnr(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+{
+    double sum = 0;
+    for (size_t ix = 0; ix < a.size(); ix++) {
+        sum += (a[ix] - b[ix]) * (a[ix] - b[ix]);
+    }
+    return 10 * log10(255.0 * 255.0 / std::max(sum / a.size(), 1e-9));
+}
+
+static bool is_jpeg(const std::vector<uint8_t> &bytes)
+{
+    return bytes.size() > 4 && bytes[0] == 0xff && bytes[1] == 0xd8
+        && bytes[bytes.size() - 2] == 0xff && bytes[bytes.size() - 1] == 0xd9;
+}
+
+static std::vector<uint8_t> from_base64(const std::string &text)
+{
+    return base64_decode(text);
+}
+
+static void stream(int width, int height, bool binary, int quality, int frames)
+{
+    snapshots.clear();
+    transfers.clear();
+    console.clear();
+    camera.jpeg_gets = camera.jpeg_releases = camera.captures = 0;
+    frames_left = frames;
+    CHECK(ei_camera_start_snapshot_stream(width, height, false, binary, quality));
+}
+
+/* the sensor JPEG of the requested size, forwarded untouched */
+static void test_pass_through()
+{
+    const std::vector<uint8_t> image = expected_image({ 160, 120 }, 160, 120, 3);
+    ei::signal_t signal = pixel_signal(image.data(), 160, 120, 3);
+    camera.jpeg.resize(160 * 120 * 3);
+    size_t size = 0;
+    // a lower quality than the re-encode below, the two JPEGs differ
+    CHECK(encode_rgb888_signal_as_jpg(&signal, 160, 120, camera.jpeg.data(), camera.jpeg.size(), &size, JPEG_Q_LOW) == 0);
+    camera.jpeg.resize(size);
+    camera.jpeg_mode = { 160, 120 };
+
+    for (int binary = 0; binary < 2; binary++) {
+        stream(160, 120, binary, JPEG_Q_LOW, 3);
+        CHECK(camera.jpeg_gets == 3 && camera.jpeg_releases == 3 && camera.captures == 0);
+        if (binary) {
+            CHECK(transfers.size() == 3);
+            for (const transfer_t &t : transfers) {
+                CHECK(t.content == EI_BINARY_CONTENT_SNAPSHOT_JPEG);
+                CHECK(t.data == camera.jpeg.data() && t.bytes == camera.jpeg);
+            }
+        }
+        else {
+            CHECK(snapshots.size() == 3);
+            for (const std::string &s : snapshots) {
+                CHECK(from_base64(s) == camera.jpeg);
+            }
+        }
+    }
+    printf("pass-through: %zu B sensor JPEG forwarded as is\n", camera.jpeg.size());
+
+    // sensor in another mode: released, the frame is captured and re-encoded
+    camera.jpeg_mode = { 320, 240 };
+    stream(160, 120, true, JPEG_Q_BEST, 1);
+    CHECK(camera.jpeg_gets == 1 && camera.jpeg_releases == 1 && camera.captures == 1);
+    CHECK(transfers.size() == 1 && transfers[0].content == EI_BINARY_CONTENT_SNAPSHOT_JPEG);
+    CHECK(transfers.size() == 1 && transfers[0].bytes != camera.jpeg);
+    unsigned w = 0, h = 0;
+    std::vector<uint8_t> rgb;
+    CHECK(transfers.size() == 1 && decode_jpeg(transfers[0].bytes, &w, &h, rgb) && w == 160 && h == 120);
+    CHECK(rgb.size() == image.size() && psnr(rgb, image) > 30);
+    camera.jpeg_mode = { 160, 120 };
+}
+
+/* resized frames, re-encoded at every quality */
+static void test_re_encode()
+{
+    const std::vector<uint8_t> image = expected_image({ 160, 120 }, 128, 96, 3);
+    size_t previous_size = SIZE_MAX;
+    for (int quality = JPEG_Q_BEST; quality <= JPEG_Q_LOW; quality++) {
+        for (int binary = 0; binary < 2; binary++) {
+            stream(128, 96, binary, quality, 1);
+            // a resize is needed, the sensor JPEG is not even asked for
+            CHECK(camera.jpeg_gets == 0 && camera.captures == 1);
+            std::vector<uint8_t> jpeg;
+            if (binary) {
+                CHECK(transfers.size() == 1 && transfers[0].content == EI_BINARY_CONTENT_SNAPSHOT_JPEG);
+                if (transfers.size() == 1) jpeg = transfers[0].bytes;
+            }
+            else {
+                CHECK(snapshots.size() == 1);
+                if (snapshots.size() == 1) jpeg = from_base64(snapshots[0]);
+            }
+            unsigned w = 0, h = 0;
+            std::vector<uint8_t> rgb;
+            CHECK(is_jpeg(jpeg) && decode_jpeg(jpeg, &w, &h, rgb) && w == 128 && h == 96);
+            const double db = rgb.size() == image.size() ? psnr(rgb, image) : 0;
+            CHECK(db > 24);
+            if (binary) {
+                printf("quality %d: %zu B, PSNR %.1f dB\n", quality, jpeg.size(), db);
+                CHECK(jpeg.size() < previous_size);
+                previous_size = jpeg.size();
+            }
+        }
+    }
+
+    device.color_depth = "Grayscale";
+    stream(128, 96, true, JPEG_Q_MED, 1);
+    CHECK(camera.jpeg_gets == 0 && camera.captures == 1);
+    CHECK(transfers.size() == 1 && transfers[0].content == EI_BINARY_CONTENT_SNAPSHOT_JPEG);
+    CHECK(transfers.size() == 1 && is_jpeg(transfers[0].bytes));
+    device.color_depth = "RGB";
+}
+
+/* without a JPEG quality the stream sends the pixels, as before */
+static void test_raw()
+{
+    stream(128, 96, true, EI_SNAPSHOT_FORMAT_RAW, 2);
+    CHECK(camera.jpeg_gets == 0 && camera.captures == 2);
+    CHECK(transfers.size() == 2);
+    for (const transfer_t &t : transfers) {
+        CHECK(t.content == EI_BINARY_CONTENT_SNAPSHOT && t.bytes == expected_image({ 160, 120 }, 128, 96, 3));
+    }
+    stream(160, 120, false, EI_SNAPSHOT_FORMAT_RAW, 1);
+    CHECK(snapshots.size() == 1 && from_base64(snapshots[0]) == expected_image({ 160, 120 }, 160, 120, 3));
+}
+
+/* encode_*_signal_as_jpg with the quality argument */
+static void test_encoder_quality()
+{
+    for (int pixel_size = 1; pixel_size <= 3; pixel_size += 2) {
+        const std::vector<uint8_t> image = expected_image({ 96, 96 }, 96, 96, pixel_size);
+        auto encode = [&](int quality, bool use_default) {
+            ei::signal_t signal = pixel_signal(image.data(), 96, 96, pixel_size);
+            std::vector<uint8_t> out(96 * 96 * 3 + 1024);
+            size_t size = 0;
+            int rc;
+            if (pixel_size == 3) {
+                rc = use_default
+                    ? encode_rgb888_signal_as_jpg(&signal, 96, 96, out.data(), out.size(), &size)
+                    : encode_rgb888_signal_as_jpg(&signal, 96, 96, out.data(), out.size(), &size, quality);
+            }
+            else {
+                rc = use_default
+                    ? encode_bw_signal_as_jpg(&signal, 96, 96, out.data(), out.size(), &size)
+                    : encode_bw_signal_as_jpg(&signal, 96, 96, out.data(), out.size(), &size, quality);
+            }
+            CHECK(rc == 0);
+            out.resize(size);
+            return out;
+        };
+        auto encode_base64 = [&](int quality) {
+            ei::signal_t signal = pixel_signal(image.data(), 96, 96, pixel_size);
+            console.clear();
+            CHECK((pixel_size == 3
+                ? encode_rgb888_signal_as_jpg_and_output_base64(&signal, 96, 96, quality)
+                : encode_bw_signal_as_jpg_and_output_base64(&signal, 96, 96, quality)) == 0);
+            return from_base64(console);
+        };
+
+        CHECK(encode(0, true) == encode(JPEG_Q_BEST, false));
+        for (int quality = JPEG_Q_BEST; quality <= JPEG_Q_LOW; quality++) {
+            const std::vector<uint8_t> jpeg = encode(quality, false);
+            CHECK(is_jpeg(jpeg));
+            CHECK(encode_base64(quality) == jpeg);
+            if (quality > JPEG_Q_BEST) {
+                CHECK(jpeg.size() < encode(quality - 1, false).size());
+            }
+        }
+    }
+    console.clear();
+}
+
+int main()
+{
+    test_pass_through();
+    test_re_encode();
+    test_raw();
+    test_encoder_quality();
+    return TEST_RESULT();
+}
@@ -0,0 +1,1049 @@
+/* speechpy::feature (frame_reader and the cached FFT workspace) against the
+ * implementation it replaced, kept below as reference_feature: mfe, mfe_v3,
+ * spectrogram and mfcc, versions 1-4, over frame lengths / strides (odd sample
+ * counts too), FFT lengths including non powers of two, filter counts and band
+ * edges, on signal lengths that do and do not fill the last frame. Output must
+ * be bit identical; the time of both is printed.
+ *
+ * reference_feature is speechpy/feature.hpp as of the baseline with the
+ * baseline processing::stack_frames as a member. Its MFCC can run the DCT of
+ * dct_plan instead of numpy::dct2: the frame reader is held to that bit for
+ * bit, the baseline MFCC to the 2e-5 of test_dct_plan.cpp. The MFE energies
+ * are compared along with the features. */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
+#include "host_test.h"
+
+using namespace ei;
+using namespace ei::speechpy;
+
+class reference_feature {
+public:
+    // the MFCC DCT of user-037 instead of numpy::dct2
+    static bool use_dct_plan;
+
+    /**
+     * Frame a signal into overlapping frames.
+     * @param info This is both the base object and where we'll store our results.
+     * @param sampling_frequency (int): The sampling frequency of the signal.
+     * @param frame_length (float): The length of the frame in second.
+     * @param frame_stride (float): The stride between frames.
+     * @param zero_padding (bool): If the samples is not a multiple of
+     *        frame_length(number of frames sample), zero padding will
+     *        be done for generating last frame.
+     * @returns EIDSP_OK if OK
+     */
+    static int stack_frames(stack_frames_info_t *info,
+                            float sampling_frequency,
+                            float frame_length,
+                            float frame_stride,
+                            bool zero_padding,
+                            uint16_t version)
+    {
+        if (!info->signal || !info->signal->get_data || info->signal->total_length == 0) {
+            EIDSP_ERR(EIDSP_SIGNAL_SIZE_MISMATCH);
+        }
+
+        size_t length_signal = info->signal->total_length;
+        int frame_sample_length;
+        int length;
+        if (version == 1) {
+            frame_sample_length = static_cast<int>(round(static_cast<float>(sampling_frequency) * frame_length));
+            frame_stride = round(static_cast<float>(sampling_frequency) * frame_stride);
+            length = frame_sample_length;
+        }
+        else {
+            frame_sample_length = static_cast<int>(processing::ceil_unless_very_close_to_floor(static_cast<float>(sampling_frequency) * frame_length));
+            float frame_stride_arg = frame_stride;
+            frame_stride = processing::ceil_unless_very_close_to_floor(static_cast<float>(sampling_frequency) * frame_stride_arg);
+            length = (frame_sample_length - (int)frame_stride);
+        }
+
+        volatile int numframes;
+        volatile int len_sig;
+
+        if (zero_padding) {
+            // Calculation of number of frames
+            numframes = static_cast<int>(
+                ceil(static_cast<float>(length_signal - length) / frame_stride));
+
+            // Zero padding
+            len_sig = static_cast<int>(static_cast<float>(numframes) * frame_stride) + frame_sample_length;
+
+            info->signal->total_length = static_cast<size_t>(len_sig);
+        }
+        else {
+            numframes = static_cast<int>(
+                floor(static_cast<float>(length_signal - length) / frame_stride));
+            len_sig = static_cast<int>(
+                (static_cast<float>(numframes - 1) * frame_stride + frame_sample_length));
+
+            info->signal->total_length = static_cast<size_t>(len_sig);
+        }
+
+        info->frame_ixs.clear();
+        info->frame_ixs.reserve(numframes); //limit the memory allocation
+
+        int frame_count = 0;
+
+        for (size_t ix = 0; ix < static_cast<uint32_t>(len_sig); ix += static_cast<size_t>(frame_stride)) {
+            if (++frame_count > numframes) break;
+
+            info->frame_ixs.push_back(ix);
+        }
+
+        info->frame_length = frame_sample_length;
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Compute the Mel-filterbanks. Each filter will be stored in one rows.
+     * The columns correspond to fft bins.
+     *
+     * @param filterbanks Matrix of size num_filter * coefficients
+     * @param num_filter the number of filters in the filterbank
+     * @param coefficients (fftpoints//2 + 1)
+     * @param sampling_freq  the samplerate of the signal we are working
+     *                       with. It affects mel spacing.
+     * @param low_freq lowest band edge of mel filters, default 0 Hz
+     * @param high_freq highest band edge of mel filters, default samplerate / 2
+     * @param output_transposed If set to true this will transpose the matrix (memory efficient).
+     *                          This is more efficient than calling this function and then transposing
+     *                          as the latter requires the filterbank to be allocated twice (for a short while).
+     * @returns EIDSP_OK if OK
+     */
+    static int filterbanks(
+#if EIDSP_QUANTIZE_FILTERBANK
+        quantized_matrix_t *filterbanks,
+#else
+        matrix_t *filterbanks,
+#endif
+        uint16_t num_filter, int coefficients, uint32_t sampling_freq,
+        uint32_t low_freq, uint32_t high_freq,
+        bool output_transposed = false
+        )
+    {
+        const size_t mels_mem_size = (num_filter + 2) * sizeof(float);
+        const size_t hertz_mem_size = (num_filter + 2) * sizeof(float);
+        const size_t freq_index_mem_size = (num_filter + 2) * sizeof(int);
+
+        float *mels = (float*)ei_dsp_malloc(mels_mem_size);
+        if (!mels) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        if (filterbanks->rows != num_filter || filterbanks->cols != static_cast<uint32_t>(coefficients)) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+#if EIDSP_QUANTIZE_FILTERBANK
+        memset(filterbanks->buffer, 0, filterbanks->rows * filterbanks->cols * sizeof(uint8_t));
+#else
+        memset(filterbanks->buffer, 0, filterbanks->rows * filterbanks->cols * sizeof(float));
+#endif
+
+        // Computing the Mel filterbank
+        // converting the upper and lower frequencies to Mels.
+        // num_filter + 2 is because for num_filter filterbanks we need
+        // num_filter+2 point.
+        numpy::linspace(
+            functions::frequency_to_mel(static_cast<float>(low_freq)),
+            functions::frequency_to_mel(static_cast<float>(high_freq)),
+            num_filter + 2,
+            mels);
+
+        // we should convert Mels back to Hertz because the start and end-points
+        // should be at the desired frequencies.
+        float *hertz = (float*)ei_dsp_malloc(hertz_mem_size);
+        if (!hertz) {
+            ei_dsp_free(mels, mels_mem_size);
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        for (uint16_t ix = 0; ix < num_filter + 2; ix++) {
+            hertz[ix] = functions::mel_to_frequency(mels[ix]);
+            if (hertz[ix] < low_freq) {
+                hertz[ix] = low_freq;
+            }
+            if (hertz[ix] > high_freq) {
+                hertz[ix] = high_freq;
+            }
+
+            // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
+            // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
+            // thus calculating the bucket to 64, not 65.
+            // we're adjusting this here a tiny bit to ensure we have the same result
+            if (ix == num_filter + 2 - 1) {
+                hertz[ix] -= 0.001;
+            }
+        }
+        ei_dsp_free(mels, mels_mem_size);
+
+        // The frequency resolution required to put filters at the
+        // exact points calculated above should be extracted.
+        //  So we should round those frequencies to the closest FFT bin.
+        int *freq_index = (int*)ei_dsp_malloc(freq_index_mem_size);
+        if (!freq_index) {
+            ei_dsp_free(hertz, hertz_mem_size);
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        for (uint16_t ix = 0; ix < num_filter + 2; ix++) {
+            freq_index[ix] = static_cast<int>(floor((coefficients + 1) * hertz[ix] / sampling_freq));
+        }
+        ei_dsp_free(hertz, hertz_mem_size);
+
+        for (size_t i = 0; i < num_filter; i++) {
+            int left = freq_index[i];
+            int middle = freq_index[i + 1];
+            int right = freq_index[i + 2];
+
+            EI_DSP_MATRIX(z, 1, (right - left + 1));
+            if (!z.buffer) {
+                ei_dsp_free(freq_index, freq_index_mem_size);
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+            numpy::linspace(left, right, (right - left + 1), z.buffer);
+            functions::triangle(z.buffer, (right - left + 1), left, middle, right);
+
+            // so... z now contains some values that we need to overwrite in the filterbank
+            for (int zx = 0; zx < (right - left + 1); zx++) {
+                size_t index = (i * filterbanks->cols) + (left + zx);
+
+                if (output_transposed) {
+                    index = ((left + zx) * filterbanks->rows) + i;
+                }
+
+#if EIDSP_QUANTIZE_FILTERBANK
+                filterbanks->buffer[index] = numpy::quantize_zero_one(z.buffer[zx]);
+#else
+                filterbanks->buffer[index] = z.buffer[zx];
+#endif
+            }
+        }
+
+        if (output_transposed) {
+            uint16_t r = filterbanks->rows;
+            filterbanks->rows = filterbanks->cols;
+            filterbanks->cols = r;
+        }
+
+        ei_dsp_free(freq_index, freq_index_mem_size);
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * @brief Get the fft bin index from hertz
+     *
+     * @param fft_size Size of fft
+     * @param hertz Desired hertz
+     * @param sampling_freq In Hz
+     * @return int the index of the bin closest to the hertz
+     */
+    static int get_fft_bin_from_hertz(uint16_t fft_size, float hertz, uint32_t sampling_freq)
+    {
+        return static_cast<int>(floor((fft_size + 1) * hertz / sampling_freq));
+    }
+
+    /**
+     * Compute Mel-filterbank energy features from an audio signal.
+     * @param out_features Use `calculate_mfe_buffer_size` to allocate the right matrix.
+     * @param out_energies A matrix in the form of Mx1 where M is the rows from `calculate_mfe_buffer_size`
+     * @param signal: audio signal structure with functions to retrieve data from a signal
+     * @param sampling_frequency (int): the sampling frequency of the signal
+     *     we are working with.
+     * @param frame_length (float): the length of each frame in seconds.
+     *     Default is 0.020s
+     * @param frame_stride (float): the step between successive frames in seconds.
+     *     Default is 0.02s (means no overlap)
+     * @param num_filters (int): the number of filters in the filterbank,
+     *     default 40.
+     * @param fft_length (int): number of FFT points. Default is 512.
+     * @param low_frequency (int): lowest band edge of mel filters.
+     *     In Hz, default is 0.
+     * @param high_frequency (int): highest band edge of mel filters.
+     *     In Hz, default is samplerate/2
+     * @EIDSP_OK if OK
+     */
+    static int mfe(matrix_t *out_features, matrix_t *out_energies,
+        signal_t *signal,
+        uint32_t sampling_frequency,
+        float frame_length, float frame_stride, uint16_t num_filters,
+        uint16_t fft_length, uint32_t low_frequency, uint32_t high_frequency,
+        uint16_t version
+        )
+    {
+        int ret = 0;
+
+        if (high_frequency == 0) {
+            high_frequency = sampling_frequency / 2;
+        }
+
+        if (version<4) {
+            if (low_frequency == 0) {
+                low_frequency = 300;
+            }
+        }
+
+        stack_frames_info_t stack_frame_info = { 0 };
+        stack_frame_info.signal = signal;
+
+        ret = stack_frames(
+            &stack_frame_info,
+            sampling_frequency,
+            frame_length,
+            frame_stride,
+            false,
+            version
+        );
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        if (stack_frame_info.frame_ixs.size() != out_features->rows) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (num_filters != out_features->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (out_energies) {
+            if (stack_frame_info.frame_ixs.size() != out_energies->rows || out_energies->cols != 1) {
+                EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+            }
+        }
+
+        for (uint32_t i = 0; i < out_features->rows * out_features->cols; i++) {
+            *(out_features->buffer + i) = 0;
+        }
+
+        const size_t power_spectrum_frame_size = (fft_length / 2 + 1);
+        // Computing the Mel filterbank
+        // converting the upper and lower frequencies to Mels.
+        // num_filter + 2 is because for num_filter filterbanks we need
+        // num_filter+2 point.
+        float *mels;
+        const int MELS_SIZE = num_filters + 2;
+        const size_t mem_size = MELS_SIZE * sizeof(float);
+        mels = (float*)ei_dsp_calloc(MELS_SIZE, sizeof(float));
+        EI_ERR_AND_RETURN_ON_NULL(mels, EIDSP_OUT_OF_MEM);
+        ei_unique_ptr_t __ptr__(mels,[mem_size](void* ptr){ei::ei_dsp_free_func(ptr, mem_size);});
+        uint16_t* bins = reinterpret_cast<uint16_t*>(mels); // alias the mels array so we can reuse the space
+
+        numpy::linspace(
+            functions::frequency_to_mel(static_cast<float>(low_frequency)),
+            functions::frequency_to_mel(static_cast<float>(high_frequency)),
+            num_filters + 2,
+            mels);
+
+        uint16_t max_bin = version >= 4 ? fft_length : power_spectrum_frame_size; // preserve a bug in v<4
+        // go to -1 size b/c special handling, see after
+        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
+            mels[ix] = functions::mel_to_frequency(mels[ix]);
+            if (mels[ix] < low_frequency) {
+                mels[ix] = low_frequency;
+            }
+            if (mels[ix] > high_frequency) {
+                mels[ix] = high_frequency;
+            }
+            bins[ix] = get_fft_bin_from_hertz(max_bin, mels[ix], sampling_frequency);
+        }
+
+        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
+        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
+        // thus calculating the bucket to 64, not 65.
+        // we're adjusting this here a tiny bit to ensure we have the same result
+        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
+        if (mels[MELS_SIZE-1] > high_frequency) {
+            mels[MELS_SIZE-1] = high_frequency;
+        }
+        mels[MELS_SIZE-1] -= 0.001;
+        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(max_bin, mels[MELS_SIZE-1], sampling_frequency);
+
+        EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
+        if (!power_spectrum_frame.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        // get signal data from the audio file
+        EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
+
+        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
+            // don't read outside of the audio buffer... we'll automatically zero pad then
+            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
+            size_t signal_length = stack_frame_info.frame_length;
+            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
+                signal_length = signal_length -
+                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
+            }
+
+            ret = stack_frame_info.signal->get_data(
+                signal_offset,
+                signal_length,
+                signal_frame.buffer
+            );
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            ret = numpy::power_spectrum(
+                signal_frame.buffer,
+                stack_frame_info.frame_length,
+                power_spectrum_frame.buffer,
+                power_spectrum_frame_size,
+                fft_length
+            );
+
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
+            if (energy == 0) {
+                energy = 1e-10;
+            }
+
+            if (out_energies) {
+                out_energies->buffer[ix] = energy;
+            }
+
+            auto row_ptr = out_features->get_row_ptr(ix);
+            for (size_t i = 0; i < num_filters; i++) {
+                size_t left = bins[i];
+                size_t middle = bins[i+1];
+                size_t right = bins[i+2];
+
+                assert(right < power_spectrum_frame_size);
+                // now we have weights and locations to move from fft to mel sgram
+                // both left and right become zero weights, so skip them
+
+                // middle always has weight of 1.0
+                // since we skip left and right, if left = middle we need to handle that
+                row_ptr[i] = power_spectrum_frame.buffer[middle];
+
+                for (size_t bin = left+1; bin < right; bin++) {
+                    if (bin < middle) {
+                        row_ptr[i] +=
+                            ((static_cast<float>(bin) - left) / (middle - left)) * // weight *
+                            power_spectrum_frame.buffer[bin];
+                    }
+                    // intentionally skip middle, handled above
+                    if (bin > middle) {
+                        row_ptr[i] +=
+                            ((right - static_cast<float>(bin)) / (right - middle)) * // weight *
+                            power_spectrum_frame.buffer[bin];
+                    }
+                }
+            }
+
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        numpy::zero_handling(out_features);
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Compute Mel-filterbank energy features from an audio signal.
+     * @param out_features Use `calculate_mfe_buffer_size` to allocate the right matrix.
+     * @param out_energies A matrix in the form of Mx1 where M is the rows from `calculate_mfe_buffer_size`
+     * @param signal: audio signal structure with functions to retrieve data from a signal
+     * @param sampling_frequency (int): the sampling frequency of the signal
+     *     we are working with.
+     * @param frame_length (float): the length of each frame in seconds.
+     *     Default is 0.020s
+     * @param frame_stride (float): the step between successive frames in seconds.
+     *     Default is 0.02s (means no overlap)
+     * @param num_filters (int): the number of filters in the filterbank,
+     *     default 40.
+     * @param fft_length (int): number of FFT points. Default is 512.
+     * @param low_frequency (int): lowest band edge of mel filters.
+     *     In Hz, default is 0.
+     * @param high_frequency (int): highest band edge of mel filters.
+     *     In Hz, default is samplerate/2
+     * @EIDSP_OK if OK
+     */
+    static int mfe_v3(matrix_t *out_features, matrix_t *out_energies,
+        signal_t *signal,
+        uint32_t sampling_frequency,
+        float frame_length, float frame_stride, uint16_t num_filters,
+        uint16_t fft_length, uint32_t low_frequency, uint32_t high_frequency,
+        uint16_t version
+        )
+    {
+        int ret = 0;
+
+        if (high_frequency == 0) {
+            high_frequency = sampling_frequency / 2;
+        }
+
+        if (low_frequency == 0) {
+            low_frequency = 300;
+        }
+
+        stack_frames_info_t stack_frame_info = { 0 };
+        stack_frame_info.signal = signal;
+
+        ret = stack_frames(
+            &stack_frame_info,
+            sampling_frequency,
+            frame_length,
+            frame_stride,
+            false,
+            version
+        );
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        if (stack_frame_info.frame_ixs.size() != out_features->rows) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (num_filters != out_features->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (out_energies) {
+            if (stack_frame_info.frame_ixs.size() != out_energies->rows || out_energies->cols != 1) {
+                EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+            }
+        }
+
+        for (uint32_t i = 0; i < out_features->rows * out_features->cols; i++) {
+            *(out_features->buffer + i) = 0;
+        }
+
+        uint16_t coefficients = fft_length / 2 + 1;
+
+        // calculate the filterbanks first... preferably I would want to do the matrix multiplications
+        // whenever they happen, but OK...
+#if EIDSP_QUANTIZE_FILTERBANK
+        EI_DSP_QUANTIZED_MATRIX(filterbanks, num_filters, coefficients, &numpy::dequantize_zero_one);
+#else
+        EI_DSP_MATRIX(filterbanks, num_filters, coefficients);
+#endif
+        if (!filterbanks.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        ret = feature::filterbanks(
+            &filterbanks, num_filters, coefficients, sampling_frequency, low_frequency, high_frequency, true);
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
+            size_t power_spectrum_frame_size = (fft_length / 2 + 1);
+
+            EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
+            if (!power_spectrum_frame.buffer) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+
+            // get signal data from the audio file
+            EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
+
+            // don't read outside of the audio buffer... we'll automatically zero pad then
+            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
+            size_t signal_length = stack_frame_info.frame_length;
+            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
+                signal_length = signal_length -
+                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
+            }
+
+            ret = stack_frame_info.signal->get_data(
+                signal_offset,
+                signal_length,
+                signal_frame.buffer
+            );
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            ret = numpy::power_spectrum(
+                signal_frame.buffer,
+                stack_frame_info.frame_length,
+                power_spectrum_frame.buffer,
+                power_spectrum_frame_size,
+                fft_length
+            );
+
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
+            if (energy == 0) {
+                energy = 1e-10;
+            }
+
+            if (out_energies) {
+                out_energies->buffer[ix] = energy;
+            }
+
+            // calculate the out_features directly here
+            ret = numpy::dot_by_row(
+                ix,
+                power_spectrum_frame.buffer,
+                power_spectrum_frame_size,
+                &filterbanks,
+                out_features
+            );
+
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        numpy::zero_handling(out_features);
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Compute spectrogram from a sensor signal.
+     * @param out_features Use `calculate_mfe_buffer_size` to allocate the right matrix.
+     * @param signal: audio signal structure with functions to retrieve data from a signal
+     * @param sampling_frequency (int): the sampling frequency of the signal
+     *     we are working with.
+     * @param frame_length (float): the length of each frame in seconds.
+     *     Default is 0.020s
+     * @param frame_stride (float): the step between successive frames in seconds.
+     *     Default is 0.02s (means no overlap)
+     * @param fft_length (int): number of FFT points. Default is 512.
+     * @EIDSP_OK if OK
+     */
+    static int spectrogram(matrix_t *out_features,
+        signal_t *signal, float sampling_frequency,
+        float frame_length, float frame_stride, uint16_t fft_length,
+        uint16_t version
+        )
+    {
+        int ret = 0;
+
+        stack_frames_info_t stack_frame_info = { 0 };
+        stack_frame_info.signal = signal;
+
+        ret = stack_frames(
+            &stack_frame_info,
+            sampling_frequency,
+            frame_length,
+            frame_stride,
+            false,
+            version
+        );
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        if (stack_frame_info.frame_ixs.size() != out_features->rows) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        uint16_t coefficients = fft_length / 2 + 1;
+
+        if (coefficients != out_features->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        for (uint32_t i = 0; i < out_features->rows * out_features->cols; i++) {
+            *(out_features->buffer + i) = 0;
+        }
+
+        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
+            // get signal data from the audio file
+            EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
+
+            // don't read outside of the audio buffer... we'll automatically zero pad then
+            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
+            size_t signal_length = stack_frame_info.frame_length;
+            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
+                signal_length = signal_length -
+                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
+            }
+
+            ret = stack_frame_info.signal->get_data(
+                signal_offset,
+                signal_length,
+                signal_frame.buffer
+            );
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            // normalize data (only when version is 3)
+            if (version == 3) {
+                // it might be that everything is already normalized here...
+                bool all_between_min_1_and_1 = true;
+                for (size_t ix = 0; ix < signal_frame.rows * signal_frame.cols; ix++) {
+                    if (signal_frame.buffer[ix] < -1.0f || signal_frame.buffer[ix] > 1.0f) {
+                        all_between_min_1_and_1 = false;
+                        break;
+                    }
+                }
+
+                if (!all_between_min_1_and_1) {
+                    ret = numpy::scale(&signal_frame, 1.0f / 32768.0f);
+                    if (ret != 0) {
+                        EIDSP_ERR(ret);
+                    }
+                }
+            }
+
+            ret = numpy::power_spectrum(
+                signal_frame.buffer,
+                stack_frame_info.frame_length,
+                out_features->buffer + (ix * coefficients),
+                coefficients,
+                fft_length
+            );
+
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        numpy::zero_handling(out_features);
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Calculate the buffer size for MFE
+     * @param signal_length: Length of the signal.
+     * @param sampling_frequency (int): The sampling frequency of the signal.
+     * @param frame_length (float): The length of the frame in second.
+     * @param frame_stride (float): The stride between frames.
+     * @param num_filters
+     */
+    static matrix_size_t calculate_mfe_buffer_size(
+        size_t signal_length,
+        uint32_t sampling_frequency,
+        float frame_length, float frame_stride, uint16_t num_filters,
+        uint16_t version)
+    {
+        int32_t rows = processing::calculate_no_of_stack_frames(
+            signal_length,
+            sampling_frequency,
+            frame_length,
+            frame_stride,
+            false,
+            version);
+        int32_t cols = num_filters;
+
+        matrix_size_t size_matrix;
+        size_matrix.rows = (uint32_t)rows;
+        size_matrix.cols = (uint32_t)cols;
+        return size_matrix;
+    }
+
+    /**
+     * Compute MFCC features from an audio signal.
+     * @param out_features Use `calculate_mfcc_buffer_size` to allocate the right matrix.
+     * @param signal: audio signal structure from which to compute features.
+     *     has functions to retrieve data from a signal lazily.
+     * @param sampling_frequency (int): the sampling frequency of the signal
+     *     we are working with.
+     * @param frame_length (float): the length of each frame in seconds.
+     *     Default is 0.020s
+     * @param frame_stride (float): the step between successive frames in seconds.
+     *     Default is 0.01s (means no overlap)
+     * @param num_cepstral (int): Number of cepstral coefficients.
+     * @param num_filters (int): the number of filters in the filterbank,
+     *     default 40.
+     * @param fft_length (int): number of FFT points. Default is 512.
+     * @param low_frequency (int): lowest band edge of mel filters.
+     *     In Hz, default is 0.
+     * @param high_frequency (int): highest band edge of mel filters.
+     *     In Hz, default is samplerate/2
+     * @param dc_elimination Whether the first dc component should
+     *     be eliminated or not.
+     * @returns 0 if OK
+     */
+    static int mfcc(matrix_t *out_features, signal_t *signal,
+        uint32_t sampling_frequency, float frame_length, float frame_stride,
+        uint8_t num_cepstral, uint16_t num_filters, uint16_t fft_length,
+        uint32_t low_frequency, uint32_t high_frequency, bool dc_elimination,
+        uint16_t version)
+    {
+        if (out_features->cols != num_cepstral) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        matrix_size_t mfe_matrix_size =
+            calculate_mfe_buffer_size(
+                signal->total_length,
+                sampling_frequency,
+                frame_length,
+                frame_stride,
+                num_filters,
+                version);
+
+        if (out_features->rows != mfe_matrix_size.rows) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        int ret = EIDSP_OK;
+
+        // allocate some memory for the MFE result
+        EI_DSP_MATRIX(features_matrix, mfe_matrix_size.rows, mfe_matrix_size.cols);
+        if (!features_matrix.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        EI_DSP_MATRIX(energy_matrix, mfe_matrix_size.rows, 1);
+        if (!energy_matrix.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        ret = mfe(&features_matrix, &energy_matrix, signal,
+            sampling_frequency, frame_length, frame_stride, num_filters, fft_length,
+            low_frequency, high_frequency, version);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // ok... now we need to calculate the MFCC from this...
+        // first do log() over all features...
+        ret = numpy::log(&features_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // now do DST type 2
+        ret = use_dct_plan
+            ? dct_plan::dct2(&features_matrix, num_cepstral, DCT_NORMALIZATION_ORTHO)
+            : numpy::dct2(&features_matrix, DCT_NORMALIZATION_ORTHO);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // replace first cepstral coefficient with log of frame energy for DC elimination
+        if (dc_elimination) {
+            for (size_t row = 0; row < features_matrix.rows; row++) {
+                features_matrix.buffer[row * features_matrix.cols] = numpy::log(energy_matrix.buffer[row]);
+            }
+        }
+
+        // copy to the output...
+        for (size_t row = 0; row < features_matrix.rows; row++) {
+            for(int i = 0; i < num_cepstral; i++) {
+                *(out_features->buffer + (num_cepstral * row) + i) = *(features_matrix.buffer + (features_matrix.cols * row) + i);
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Calculate the buffer size for MFCC
+     * @param signal_length: Length of the signal.
+     * @param sampling_frequency (int): The sampling frequency of the signal.
+     * @param frame_length (float): The length of the frame in second.
+     * @param frame_stride (float): The stride between frames.
+     * @param num_cepstral
+     */
+    static matrix_size_t calculate_mfcc_buffer_size(
+        size_t signal_length,
+        uint32_t sampling_frequency,
+        float frame_length, float frame_stride, uint16_t num_cepstral,
+        uint16_t version)
+    {
+        int32_t rows = processing::calculate_no_of_stack_frames(
+            signal_length,
+            sampling_frequency,
+            frame_length,
+            frame_stride,
+            false,
+            version);
+        int32_t cols = num_cepstral;
+
+        matrix_size_t size_matrix;
+        size_matrix.rows = (uint32_t)rows;
+        size_matrix.cols = (uint32_t)cols;
+        return size_matrix;
+    }
+};
+
+bool reference_feature::use_dct_plan = false;
+
+static std::vector<float> test_audio;
+
+static int get_test_audio(size_t offset, size_t length, float *out_ptr)
+{
+    memcpy(out_ptr, test_audio.data() + offset, length * sizeof(float));
+    return 0;
+}
+
+/* a fresh signal per call, framing trims total_length */
+static signal_t audio_signal(size_t length)
+{
+    signal_t signal;
+    signal.total_length = length;
+    signal.get_data = &get_test_audio;
+    return signal;
+}
+
+typedef struct {
+    float frame_length;
+    float frame_stride;
+    uint16_t fft_length;
+    uint16_t num_filters;
+    uint32_t low_frequency;
+    uint32_t high_frequency;
+} shape_t;
+
+typedef enum { MFE, MFE_V3, SPECTROGRAM, MFCC, MFCC_NUMPY_DCT } block_t;
+
+static const char *block_names[] = { "mfe", "mfe_v3", "spectrogram", "mfcc", "mfcc (numpy::dct2)" };
+
+static int run(bool reference, block_t block, const shape_t &s, uint16_t version, size_t length,
+    std::vector<float> &out, double &us)
+{
+    const uint32_t fs = 16000;
+    const uint8_t num_cepstral = 13;
+    signal_t signal = audio_signal(length);
+    matrix_size_t size;
+    if (block == SPECTROGRAM) {
+        size = feature::calculate_mfe_buffer_size(length, fs, s.frame_length, s.frame_stride,
+            s.fft_length / 2 + 1, version);
+    }
+    else if (block == MFCC || block == MFCC_NUMPY_DCT) {
+        size = feature::calculate_mfcc_buffer_size(length, fs, s.frame_length, s.frame_stride,
+            num_cepstral, version);
+    }
+    else {
+        size = feature::calculate_mfe_buffer_size(length, fs, s.frame_length, s.frame_stride,
+            s.num_filters, version);
+    }
+    out.assign(size.rows * size.cols, 0.0f);
+    matrix_t features(size.rows, size.cols, out.data());
+    matrix_t energies(size.rows, 1);
+    reference_feature::use_dct_plan = block != MFCC_NUMPY_DCT;
+
+    auto t0 = std::chrono::steady_clock::now();
+    int ret = EIDSP_OK;
+    switch (block) {
+    case MFE:
+        ret = reference
+            ? reference_feature::mfe(&features, &energies, &signal, fs, s.frame_length, s.frame_stride,
+                s.num_filters, s.fft_length, s.low_frequency, s.high_frequency, version)
+            : feature::mfe(&features, &energies, &signal, fs, s.frame_length, s.frame_stride,
+                s.num_filters, s.fft_length, s.low_frequency, s.high_frequency, version);
+        break;
+    case MFE_V3:
+        ret = reference
+            ? reference_feature::mfe_v3(&features, &energies, &signal, fs, s.frame_length, s.frame_stride,
+                s.num_filters, s.fft_length, s.low_frequency, s.high_frequency, version)
+            : feature::mfe_v3(&features, &energies, &signal, fs, s.frame_length, s.frame_stride,
+                s.num_filters, s.fft_length, s.low_frequency, s.high_frequency, version);
+        break;
+    case SPECTROGRAM:
+        ret = reference
+            ? reference_feature::spectrogram(&features, &signal, fs, s.frame_length, s.frame_stride,
+                s.fft_length, version)
+            : feature::spectrogram(&features, &signal, fs, s.frame_length, s.frame_stride,
+                s.fft_length, version);
+        break;
+    case MFCC:
+    case MFCC_NUMPY_DCT:
+        ret = reference
+            ? reference_feature::mfcc(&features, &signal, fs, s.frame_length, s.frame_stride, num_cepstral,
+                s.num_filters, s.fft_length, s.low_frequency, s.high_frequency, true, version)
+            : feature::mfcc(&features, &signal, fs, s.frame_length, s.frame_stride, num_cepstral,
+                s.num_filters, s.fft_length, s.low_frequency, s.high_frequency, true, version);
+        break;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (block == MFE || block == MFE_V3) {
+        // the frame energies are part of the output
+        out.insert(out.end(), energies.buffer, energies.buffer + size.rows);
+    }
+    return ret;
+}
+
+int main()
+{
+    // 1.5 s of a chirp under an envelope, noise and a click
+    std::mt19937 rng(38);
+    std::normal_distribution<float> noise(0.0f, 300.0f);
+    test_audio.resize(24000);
+    for (size_t ix = 0; ix < test_audio.size(); ix++) {
+        const float t = ix / 16000.0f;
+        test_audio[ix] = 9000.0f * sinf(2 * (float)M_PI * (150.0f + 2000.0f * t) * t) * sinf(2.0f * t)
+            + noise(rng) + (ix == 7000 ? 20000.0f : 0.0f);
+    }
+
+    const shape_t shapes[] = {
+        { 0.02f, 0.02f, 256, 32, 0, 0 },
+        { 0.025f, 0.01f, 512, 40, 0, 0 },
+        { 0.032f, 0.016f, 512, 40, 80, 7600 },
+        { 0.0255f, 0.0123f, 400, 24, 300, 0 },
+        { 0.05f, 0.025f, 1024, 64, 0, 6000 },
+        { 0.016f, 0.008f, 200, 16, 0, 0 },
+    };
+    const size_t lengths[] = { 16000, 16000 + 123, 24000 - 7 };
+
+    const block_t blocks[] = { MFE, MFE_V3, SPECTROGRAM, MFCC, MFCC_NUMPY_DCT };
+    for (block_t block : blocks) {
+        size_t runs = 0, mismatches = 0;
+        double reference_us = 0, feature_us = 0, max_err = 0;
+        for (const shape_t &shape : shapes) {
+            for (uint16_t version = 1; version <= 4; version++) {
+                for (size_t length : lengths) {
+                    std::vector<float> expected, got;
+                    CHECK(run(true, block, shape, version, length, expected, reference_us) == EIDSP_OK);
+                    CHECK(run(false, block, shape, version, length, got, feature_us) == EIDSP_OK);
+                    CHECK(got.size() == expected.size());
+                    runs++;
+                    if (block == MFCC_NUMPY_DCT) {
+                        double out_scale = 1e-3;
+                        for (float v : expected) {
+                            out_scale = std::max(out_scale, (double)fabsf(v));
+                        }
+                        for (size_t ix = 0; ix < got.size() && ix < expected.size(); ix++) {
+                            max_err = std::max(max_err, fabs((double)got[ix] - expected[ix]) / out_scale);
+                        }
+                        continue;
+                    }
+                    if (got.size() == expected.size()
+                        && memcmp(got.data(), expected.data(), got.size() * sizeof(float)) != 0) {
+                        mismatches++;
+                        for (size_t ix = 0; ix < got.size(); ix++) {
+                            if (memcmp(&got[ix], &expected[ix], sizeof(float)) != 0) {
+                                printf("%s v%u frame %g / %g fft %u length %zu: value %zu %.9g vs %.9g\n",
+                                    block_names[block], version, shape.frame_length, shape.frame_stride,
+                                    shape.fft_length, length, ix, got[ix], expected[ix]);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if (block == MFCC_NUMPY_DCT) {
+            printf("%-18s %3zu runs, max difference %g of the output range\n", block_names[block], runs, max_err);
+            CHECK(max_err <= 2e-5);
+        }
+        else {
+            printf("%-18s %3zu runs, %zu not bit identical; reference %.0f us, feature %.0f us\n",
+                block_names[block], runs, mismatches, reference_us, feature_us);
+            CHECK(mismatches == 0);
+        }
+    }
+
+    spectral::fft_workspace::free_plan();
+    dct_plan::free_plan();
+    return TEST_RESULT();
+}
@@ -0,0 +1,239 @@
+/* signal::upfirdn (polyphase, only the retained outputs) and the block SOS
+ * decimate_simple against the implementations they replaced, kept below:
+ * upfirdn zero stuffed the input, convolved every sample and kept every
+ * down-th output, decimate_simple filtered a copy of the whole input and
+ * picked every factor-th sample.
+ *
+ * upfirdn: input lengths 1-300 (odd ones included), up 1-7, down 1-11, odd and
+ * even filter lengths, plus resample_poly on the ratios the spectral blocks
+ * use. decimate_simple: lengths around and across the 64 sample block, odd
+ * factors and factors that do not divide the block, in place and out of
+ * place, final filter state included. spectral::feature::_decimate on several
+ * axes against each axis decimated on its own. Everything bit identical. */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "edge-impulse-sdk/dsp/spectral/feature.hpp"
+#include "host_test.h"
+
+using namespace ei;
+using fvec = ei_vector<float>;
+
+/* signal::upfirdn before the polyphase rewrite */
+static void reference_upfirdn(const float* x, size_t x_size, fvec& y, int up, int down, const fvec& h)
+{
+    int nx = x_size;
+    int nh = h.size();
+
+    // Upsample the input signal by inserting zeros
+    fvec r(up * nx);
+    for (int i = 0; i < nx; i++)
+    {
+        r[i * up] = x[i];
+    }
+
+    // Filter the upsampled signal using the given filter coefficients
+    fvec z(nh + up * nx - 1);
+    for (int i = 0; i < up * nx; i++)
+    {
+        for (int j = 0; j < nh; j++)
+        {
+            if (i - j >= 0 && i - j < up * nx)
+            {
+                z[i] += r[i - j] * h[j];
+            }
+        }
+    }
+
+    // Downsample the filtered signal by skipping samples
+    int skip = (nh - 1) / 2;
+    for (size_t i = 0; i < y.size(); i++)
+    {
+        y[i] = z[i * down + skip];
+    }
+}
+
+/* SOS signal::decimate_simple before the block rewrite */
+static void reference_decimate_simple(
+    const float* input,
+    const size_t input_size,
+    float* output,
+    const size_t output_size,
+    size_t factor,
+    signal::sosfilt& sos)
+{
+    sos.init(input[0]);
+
+    fvec filtered(input_size);
+    sos.run(input, input_size, filtered.data());
+
+    size_t expected_size = signal::get_decimated_size(input_size, factor);
+    assert(output_size >= expected_size);
+
+    for (size_t ix = 0; ix < expected_size; ix++) {
+        output[ix] = filtered[ix * factor];
+    }
+}
+
+static bool same(const float *a, const float *b, size_t n)
+{
+    return memcmp(a, b, n * sizeof(float)) == 0;
+}
+
+static void test_upfirdn()
+{
+    std::mt19937 rng(34);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    size_t cases = 0, mismatches = 0;
+
+    const size_t lengths[] = { 1, 2, 3, 7, 16, 33, 64, 65, 127, 200, 299, 300 };
+    const size_t taps[] = { 1, 2, 5, 8, 21, 30, 63 };
+    for (size_t nx : lengths) {
+        for (int up = 1; up <= 7; up++) {
+            for (int down = 1; down <= 11; down++) {
+                for (size_t nh : taps) {
+                    fvec x(nx), h(nh);
+                    for (float &v : x) v = 100.0f * normal(rng);
+                    for (float &v : h) v = normal(rng);
+
+                    // output length of resample_poly
+                    const size_t n_out = (nx * up + down - 1) / down;
+                    fvec expected(n_out), got(n_out);
+                    reference_upfirdn(x.data(), nx, expected, up, down, h);
+                    signal::upfirdn(x.data(), nx, got, up, down, h);
+                    cases++;
+                    if (!same(got.data(), expected.data(), n_out)) {
+                        if (mismatches++ == 0) {
+                            printf("upfirdn nx %zu up %d down %d nh %zu differs\n", nx, up, down, nh);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    printf("upfirdn: %zu cases, %zu not bit identical\n", cases, mismatches);
+    CHECK(mismatches == 0);
+
+    // resample_poly as the spectral blocks call it: odd window, ratio reduced by the gcd
+    const int ratios[][2] = { { 1, 3 }, { 2, 3 }, { 3, 2 }, { 4, 6 }, { 5, 7 }, { 10, 1 } };
+    for (auto &ratio : ratios) {
+        fvec x(257), window(31);
+        for (float &v : x) v = 100.0f * normal(rng);
+        for (float &v : window) v = normal(rng);
+        fvec got;
+        signal::resample_poly(x.data(), x.size(), got, ratio[0], ratio[1], window);
+
+        const int g = signal::gcd(ratio[0], ratio[1]);
+        const int up = ratio[0] / g, down = ratio[1] / g;
+        fvec h = window;
+        signal::scale(h, float(up));
+        fvec expected((x.size() * up + down - 1) / down);
+        reference_upfirdn(x.data(), x.size(), expected, up, down, h);
+        CHECK(got.size() == expected.size() && same(got.data(), expected.data(), got.size()));
+    }
+}
+
+/* a stable cascade of num_sections biquads with random initial conditions */
+static void make_sos(std::mt19937 &rng, size_t num_sections, std::vector<float> &coeff, std::vector<float> &zi)
+{
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    coeff.clear();
+    zi.clear();
+    for (size_t sect = 0; sect < num_sections; sect++) {
+        const float radius = 0.5f + 0.45f * uniform(rng);
+        const float angle = 3.0f * uniform(rng);
+        const float gain = 0.1f + uniform(rng);
+        const float b[] = { gain, 2.0f * gain * uniform(rng), gain * uniform(rng) };
+        const float a[] = { 1.0f, -2.0f * radius * cosf(angle), radius * radius };
+        coeff.insert(coeff.end(), b, b + 3);
+        coeff.insert(coeff.end(), a, a + 3);
+        zi.push_back(uniform(rng) - 0.5f);
+        zi.push_back(uniform(rng) - 0.5f);
+    }
+}
+
+static void test_decimate_simple()
+{
+    std::mt19937 rng(340);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    size_t cases = 0, mismatches = 0;
+
+    const size_t lengths[] = { 1, 2, 5, 63, 64, 65, 100, 127, 128, 129, 191, 333, 1000 };
+    const size_t factors[] = { 1, 2, 3, 5, 7, 10, 13, 64, 100 };
+    for (size_t len : lengths) {
+        for (size_t factor : factors) {
+            for (size_t num_sections = 1; num_sections <= 4; num_sections += 3) {
+                for (int in_place = 0; in_place < 2; in_place++) {
+                    std::vector<float> coeff, zi;
+                    make_sos(rng, num_sections, coeff, zi);
+                    std::vector<float> x(len);
+                    for (float &v : x) v = 10.0f + 100.0f * normal(rng);
+
+                    const size_t out_size = signal::get_decimated_size(len, factor);
+                    std::vector<float> expected(out_size);
+                    signal::sosfilt reference_sos(coeff.data(), zi.data(), num_sections);
+                    reference_decimate_simple(x.data(), len, expected.data(), out_size, factor, reference_sos);
+
+                    signal::sosfilt sos(coeff.data(), zi.data(), num_sections);
+                    std::vector<float> buffer = x;
+                    std::vector<float> out(out_size);
+                    float *y = in_place ? buffer.data() : out.data();
+                    signal::decimate_simple(buffer.data(), len, y, out_size, factor, sos);
+
+                    cases++;
+                    const bool ok = same(y, expected.data(), out_size)
+                        && same(sos.zi_vec.data(), reference_sos.zi_vec.data(), 2 * num_sections);
+                    if (!ok && mismatches++ == 0) {
+                        printf("decimate_simple len %zu factor %zu sections %zu in place %d differs\n",
+                            len, factor, num_sections, in_place);
+                    }
+                }
+            }
+        }
+    }
+    printf("decimate_simple: %zu cases, %zu not bit identical\n", cases, mismatches);
+    CHECK(mismatches == 0);
+}
+
+static void test_spectral_decimate()
+{
+    std::mt19937 rng(3400);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    const size_t ratios[] = { 3, 10 };
+    const size_t lengths[] = { 100, 257, 1000 };
+
+    for (size_t ratio : ratios) {
+        for (size_t len : lengths) {
+            const size_t axes = 3;
+            const size_t out_size = signal::get_decimated_size(len, ratio);
+            matrix_t input(axes, len);
+            for (size_t ix = 0; ix < axes * len; ix++) {
+                input.buffer[ix] = (ix / len) * 50.0f + 20.0f * normal(rng);
+            }
+
+            // each axis on its own: a fresh filter state, as before the state was reloaded
+            std::vector<float> expected(axes * out_size);
+            for (size_t row = 0; row < axes; row++) {
+                matrix_t one(1, len);
+                memcpy(one.buffer, input.get_row_ptr(row), len * sizeof(float));
+                matrix_t out(1, out_size);
+                CHECK(spectral::feature::_decimate(&one, &out, ratio) == out_size);
+                memcpy(&expected[row * out_size], out.buffer, out_size * sizeof(float));
+            }
+
+            matrix_t output(axes, out_size);
+            CHECK(spectral::feature::_decimate(&input, &output, ratio) == out_size);
+            CHECK(same(output.buffer, expected.data(), axes * out_size));
+        }
+    }
+}
+
+int main()
+{
+    test_upfirdn();
+    test_decimate_simple();
+    test_spectral_decimate();
+    return TEST_RESULT();
+}
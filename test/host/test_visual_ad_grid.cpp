@@ -0,0 +1,203 @@
+/* Visual anomaly grid: region merging (EI_CLASSIFIER_VISUAL_AD_MERGE_REGIONS)
+ * against a reference flood fill, plus a timing of both output paths */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "edge-impulse-sdk/classifier/ei_visual_ad_grid.h"
+#include "host_test.h"
+
+struct ref_box {
+    uint32_t x0, y0, x1, y1; // cell extent, end exclusive
+    float value;
+};
+
+// 4-connectivity flood fill, regions ordered by their first cell in row-major order
+static std::vector<ref_box> reference_regions(const std::vector<float> &data, uint32_t gx, uint32_t gy, float threshold)
+{
+    std::vector<ref_box> out;
+    std::vector<uint8_t> seen(gx * gy, 0);
+    std::vector<uint32_t> stack;
+
+    for (uint32_t start = 0; start < gx * gy; start++) {
+        if (seen[start] || data[start] < threshold) {
+            continue;
+        }
+        ref_box box = { start % gx, start / gx, start % gx + 1, start / gx + 1, 0 };
+        stack.push_back(start);
+        seen[start] = 1;
+        while (!stack.empty()) {
+            const uint32_t cell = stack.back();
+            stack.pop_back();
+            const uint32_t x = cell % gx, y = cell / gx;
+            box.x0 = std::min(box.x0, x);
+            box.y0 = std::min(box.y0, y);
+            box.x1 = std::max(box.x1, x + 1);
+            box.y1 = std::max(box.y1, y + 1);
+            box.value = std::max(box.value, data[cell]);
+
+            const int dx[4] = { -1, 1, 0, 0 };
+            const int dy[4] = { 0, 0, -1, 1 };
+            for (int k = 0; k < 4; k++) {
+                const int nx = (int)x + dx[k], ny = (int)y + dy[k];
+                if (nx < 0 || ny < 0 || nx >= (int)gx || ny >= (int)gy) {
+                    continue;
+                }
+                const uint32_t n = ny * gx + nx;
+                if (!seen[n] && data[n] >= threshold) {
+                    seen[n] = 1;
+                    stack.push_back(n);
+                }
+            }
+        }
+        out.push_back(box);
+    }
+    return out;
+}
+
+static std::vector<float> random_grid(uint32_t cells, float density)
+{
+    std::vector<float> data(cells);
+    for (auto &v : data) {
+        const float r = (float)rand() / RAND_MAX;
+        // above the threshold (0.5) with probability `density`
+        v = r < density ? 0.5f + r : r * 0.49f;
+    }
+    return data;
+}
+
+static void test_regions_match_flood_fill()
+{
+    ei_visual_ad_grid_t grid;
+    memset(&grid, 0, sizeof(grid));
+
+    for (int iter = 0; iter < 2000; iter++) {
+        const uint32_t gx = 1 + rand() % 40;
+        const uint32_t gy = 1 + rand() % 40;
+        const uint32_t width = gx * (1 + rand() % 8) + rand() % 5;
+        const uint32_t height = gy * (1 + rand() % 8) + rand() % 5;
+        const float density = (float)rand() / RAND_MAX;
+        std::vector<float> data = random_grid(gx * gy, density);
+
+        CHECK(ei_visual_ad_grid_reserve(&grid, gx, gy, 10));
+        ei_visual_ad_grid_reduce(&grid, data.data(), 0.5f);
+        const uint32_t count = ei_visual_ad_grid_regions_to_boxes(&grid, data.data(), width, height);
+
+        std::vector<ref_box> ref = reference_regions(data, gx, gy, 0.5f);
+        CHECK(count == ref.size());
+        if (count != ref.size()) {
+            continue;
+        }
+
+        // both sides emit regions ordered by their first cell
+        for (uint32_t ix = 0; ix < count; ix++) {
+            const ei_impulse_result_bounding_box_t *bb = &grid.boxes[ix];
+            const uint32_t x0 = ref[ix].x0 * width / gx, x1 = ref[ix].x1 * width / gx;
+            const uint32_t y0 = ref[ix].y0 * height / gy, y1 = ref[ix].y1 * height / gy;
+            CHECK(bb->x == x0);
+            CHECK(bb->y == y0);
+            CHECK(bb->width == x1 - x0);
+            CHECK(bb->height == y1 - y0);
+            CHECK(bb->value == ref[ix].value);
+            CHECK(strcmp(bb->label, "anomaly") == 0);
+        }
+    }
+
+    ei_visual_ad_grid_free(&grid);
+}
+
+static void test_shapes()
+{
+    ei_visual_ad_grid_t grid;
+    memset(&grid, 0, sizeof(grid));
+
+    // U shape: two columns joined only by the bottom row, the left and right
+    // arms are different runs until the last row merges them
+    const uint32_t gx = 5, gy = 4;
+    const float u[gx * gy] = {
+        1, 0, 0, 0, 2,
+        1, 0, 0, 0, 1,
+        1, 0, 0, 0, 1,
+        1, 1, 1, 1, 1,
+    };
+    CHECK(ei_visual_ad_grid_reserve(&grid, gx, gy, 10));
+    ei_visual_ad_grid_reduce(&grid, u, 0.5f);
+    CHECK(grid.anomalous_count == 11);
+    CHECK(grid.max_value == 2.0f);
+    CHECK(grid.mean_value == 12.0f / 20.0f);
+    CHECK(ei_visual_ad_grid_regions_to_boxes(&grid, u, 50, 40) == 1);
+    CHECK(grid.boxes[0].x == 0 && grid.boxes[0].y == 0);
+    CHECK(grid.boxes[0].width == 50 && grid.boxes[0].height == 40);
+    CHECK(grid.boxes[0].value == 2.0f);
+
+    // diagonal neighbours are not 4-connected
+    const float diag[gx * gy] = {
+        1, 0, 0, 0, 0,
+        0, 1, 0, 0, 0,
+        0, 0, 1, 0, 0,
+        0, 0, 0, 0, 3,
+    };
+    ei_visual_ad_grid_reduce(&grid, diag, 0.5f);
+    CHECK(ei_visual_ad_grid_regions_to_boxes(&grid, diag, 50, 40) == 4);
+    CHECK(ei_visual_ad_grid_cells_to_boxes(&grid, diag, 50, 40) == 4);
+    CHECK(grid.boxes[3].x == 40 && grid.boxes[3].y == 30);
+    CHECK(grid.boxes[3].width == 10 && grid.boxes[3].height == 10);
+    CHECK(grid.boxes[3].value == 3.0f);
+
+    // nothing above the threshold
+    const float none[gx * gy] = { 0 };
+    ei_visual_ad_grid_reduce(&grid, none, 0.5f);
+    CHECK(grid.anomalous_count == 0);
+    CHECK(ei_visual_ad_grid_regions_to_boxes(&grid, none, 50, 40) == 0);
+    CHECK(ei_visual_ad_grid_cells_to_boxes(&grid, none, 50, 40) == 0);
+
+    ei_visual_ad_grid_free(&grid);
+}
+
+static void benchmark()
+{
+    const uint32_t gx = 28, gy = 28;
+    const int rounds = 20000;
+    const float densities[] = { 0.02f, 0.1f, 0.3f };
+    ei_visual_ad_grid_t grid;
+    memset(&grid, 0, sizeof(grid));
+    CHECK(ei_visual_ad_grid_reserve(&grid, gx, gy, 10));
+
+    printf("grid %ux%u, %d frames\n", gx, gy, rounds);
+    printf("density  cells/frame  per-cell us  merged us  boxes cell/merged\n");
+    for (float density : densities) {
+        std::vector<float> data = random_grid(gx * gy, density);
+        uint32_t cell_boxes = 0, merged_boxes = 0;
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            ei_visual_ad_grid_reduce(&grid, data.data(), 0.5f);
+            cell_boxes = ei_visual_ad_grid_cells_to_boxes(&grid, data.data(), 224, 224);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            ei_visual_ad_grid_reduce(&grid, data.data(), 0.5f);
+            merged_boxes = ei_visual_ad_grid_regions_to_boxes(&grid, data.data(), 224, 224);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        const double cell_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds;
+        const double merged_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / rounds;
+        printf("%7.2f  %11u  %11.2f  %9.2f  %5u/%u\n",
+            density, grid.anomalous_count, cell_us, merged_us, cell_boxes, merged_boxes);
+    }
+
+    ei_visual_ad_grid_free(&grid);
+}
+
+int main()
+{
+    srand(26);
+    test_regions_match_flood_fill();
+    test_shapes();
+    benchmark();
+    return TEST_RESULT();
+}
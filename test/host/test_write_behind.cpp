@@ -0,0 +1,139 @@
+/* Write-behind sample memory on the latency injecting RAM stand-in: a paced
+ * writer must read back what a direct (synchronous) device stores, and must
+ * no longer wait on erases and page programs */
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ei_write_behind_memory.h"
+#include "host_test.h"
+
+typedef std::chrono::steady_clock test_clock;
+
+static const uint32_t block_size = 4096;
+static const uint32_t sample_blocks = 31;
+static const uint32_t written = 28 * block_size;
+
+// the RAM device behind the layer, to check what reached it
+class TestMemory : public EiDeviceRAMLatency<block_size, 32> {
+public:
+    using EiDeviceRAMLatency::EiDeviceRAMLatency;
+    const uint8_t *raw(void) { return ram_memory; }
+};
+
+typedef struct {
+    double total_ms;
+    double erase_call_us;
+    double max_write_us;
+    double mean_write_us;
+    size_t mismatches;
+    size_t raw_mismatches;
+    uint32_t failed;
+    ei_write_behind_stats_t stats;
+} run_result_t;
+
+static run_result_t run(bool write_behind, uint32_t erase_us, uint32_t program_us, uint32_t pace_ns_per_byte)
+{
+    TestMemory *mem = new TestMemory(1000, erase_us, program_us);
+    run_result_t r = {};
+
+    // stale content in the sample area, written straight to the device
+    mem->set_write_behind(false);
+    std::vector<uint8_t> stale(sample_blocks * block_size, 0x5A);
+    mem->erase_sample_data(0, stale.size());
+    mem->write_sample_data(stale.data(), 0, stale.size());
+    mem->set_write_behind(write_behind);
+
+    // what a NOR flash holds after the same operations
+    std::vector<uint8_t> model(stale);
+    std::mt19937 rng(42);
+    const auto t0 = test_clock::now();
+
+    CHECK(mem->erase_sample_data(0, written) == written);
+    r.erase_call_us = std::chrono::duration<double, std::micro>(test_clock::now() - t0).count();
+    std::fill(model.begin(), model.begin() + written, 0xFF);
+
+    // a header, then sequential chunks of random size, with plenty of 4 byte ones
+    std::vector<uint8_t> chunk(1200);
+    uint32_t address = 0, calls = 0;
+    double sum_us = 0;
+    while (address < written - chunk.size()) {
+        const uint32_t n = address == 0 ? 37 : (rng() % 3 == 0 ? 4 : rng() % chunk.size() + 1);
+        for (uint32_t ix = 0; ix < n; ix++) {
+            chunk[ix] = rng();
+            model[address + ix] &= chunk[ix];
+        }
+
+        const auto start = test_clock::now();
+        CHECK(mem->write_sample_data(chunk.data(), address, n) == n);
+        const double us = std::chrono::duration<double, std::micro>(test_clock::now() - start).count();
+        r.max_write_us = std::max(r.max_write_us, us);
+        sum_us += us;
+        calls++;
+
+        address += n;
+        std::this_thread::sleep_for(std::chrono::nanoseconds(n * pace_ns_per_byte));
+    }
+    r.failed = mem->flush_data();
+    r.total_ms = std::chrono::duration<double, std::milli>(test_clock::now() - t0).count();
+    r.mean_write_us = sum_us / calls;
+
+    std::vector<uint8_t> back(model.size());
+    mem->read_sample_data(back.data(), 0, back.size());
+    for (size_t ix = 0; ix < model.size(); ix++) {
+        r.mismatches += back[ix] != model[ix];
+        // the config takes the first block
+        r.raw_mismatches += mem->raw()[block_size + ix] != model[ix];
+    }
+    mem->get_stats(&r.stats);
+
+    delete mem;
+    return r;
+}
+
+static void print_result(const char *name, const run_result_t &r)
+{
+    printf("%-12s total %7.1f ms, erase call %8.1f us, write call mean %6.1f us max %8.1f us, programs %u (%u bytes), erases %u, stalls %u (max %u us)\n",
+        name, r.total_ms, r.erase_call_us, r.mean_write_us, r.max_write_us, r.stats.programs, r.stats.program_bytes,
+        r.stats.erases, r.stats.stalls, r.stats.max_stall_us);
+}
+
+static void test_latency()
+{
+    // NOR like latencies: 20 ms sector erase, 0.7 ms page program, writer at ~100 KB/s
+    const run_result_t direct = run(false, 20000, 700, 10000);
+    const run_result_t behind = run(true, 20000, 700, 10000);
+    print_result("direct", direct);
+    print_result("write-behind", behind);
+
+    CHECK(direct.mismatches == 0 && direct.raw_mismatches == 0 && direct.failed == 0);
+    CHECK(behind.mismatches == 0 && behind.raw_mismatches == 0 && behind.failed == 0);
+
+    // the direct erase waits for all 28 sectors, the deferred one returns right away
+    CHECK(direct.erase_call_us >= 28 * 20000);
+    CHECK(behind.erase_call_us < 20000);
+    // the direct writer waits for every page program, write-behind only copies
+    CHECK(direct.max_write_us >= 700);
+    CHECK(behind.max_write_us < direct.max_write_us / 4);
+    CHECK(behind.mean_write_us < direct.mean_write_us / 4);
+    // sectors are programmed in a few large spans instead of once per write call
+    CHECK(behind.stats.programs < 3 * (written / block_size));
+    CHECK(behind.stats.erases == written / block_size);
+}
+
+static void test_no_latency()
+{
+    // without latency (and without pacing) the buffers churn as fast as possible
+    const run_result_t behind = run(true, 0, 0, 0);
+    print_result("unpaced", behind);
+    CHECK(behind.mismatches == 0 && behind.raw_mismatches == 0 && behind.failed == 0);
+}
+
+int main()
+{
+    test_latency();
+    test_no_latency();
+    return TEST_RESULT();
+}
@@ -0,0 +1,6 @@
+/* tjpgd of the camera component, built for the host: its LONG / DWORD typedefs
+ * are long and have to be 32 bit (the bit stream and IDCT shifts rely on it),
+ * long is 64 bit here. JDEC only holds pointers to them, the layout seen by the
+ * tests is the same. */
+#define long int
+#include "tjpgd.c"